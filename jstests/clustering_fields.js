@@ -0,0 +1,79 @@
+// Projected clustering indexes store only the declared clusteringFields with each key, and cover
+// queries whose projection fits in the key, pk and those fields.
+
+var t = db.clustering_fields;
+t.drop();
+
+var pad = new Array(4096).join("x");
+for (i = 0; i < 100; i++) {
+    t.insert({a: i, b: i * 2, c: "c" + i, pad: pad});
+}
+t.insert({a: 100, pad: pad});
+t.ensureIndex({a: 1}, {clusteringFields: {b: 1, c: 1}});
+assert.eq(null, db.getLastError());
+
+// Covered: a from the key, b and c from the stored fields, _id from the pk.
+var plan = t.find({a: {$gte: 10, $lt: 20}}, {a: 1, b: 1, c: 1}).hint({a: 1}).explain();
+assert.eq(true, plan.indexOnly, "projection of key and clustering fields should be covered");
+assert.eq(0, plan.nscannedObjects, "covered query should not load documents");
+t.find({a: {$gte: 10, $lt: 20}}, {a: 1, b: 1, c: 1}).hint({a: 1}).forEach(function(o) {
+    assert.eq(o.a * 2, o.b);
+    assert.eq("c" + o.a, o.c);
+    assert(o._id, "_id should come from the pk");
+    assert.eq(undefined, o.pad);
+});
+
+// A document without the stored fields has them left out, as with an unindexed projection.
+var o = t.find({a: 100}, {b: 1, _id: 0}).hint({a: 1}).next();
+assert.eq({}, o);
+
+// Not covered: pad is not stored, so the full document is read from the pk.
+plan = t.find({a: 5}, {a: 1, pad: 1}).hint({a: 1}).explain();
+assert.eq(false, plan.indexOnly, "pad is not a clustering field");
+assert.eq(pad, t.find({a: 5}, {a: 1, pad: 1}).hint({a: 1}).next().pad);
+// Queries without a projection still return the whole document.
+assert.eq(pad, t.find({a: 5}).hint({a: 1}).next().pad);
+
+// Updates to stored fields are reflected in the index, updates to other fields leave it alone.
+t.update({a: 5}, {$set: {b: -5}});
+t.update({a: 5}, {$set: {pad: "short"}});
+t.update({a: 6}, {a: 6, b: -6, pad: pad});
+assert.eq(null, db.getLastError());
+assert.eq(-5, t.find({a: 5}, {b: 1, _id: 0}).hint({a: 1}).next().b);
+assert.eq(-6, t.find({a: 6}, {b: 1, _id: 0}).hint({a: 1}).next().b);
+assert.eq(undefined, t.find({a: 6}, {c: 1, _id: 0}).hint({a: 1}).next().c);
+assert.eq("short", t.findOne({a: 5}).pad);
+
+// Built on existing data in the foreground, which goes through the loader.
+t.dropIndexes();
+t.ensureIndex({a: 1, c: 1}, {clusteringFields: {b: 1}});
+assert.eq(null, db.getLastError());
+plan = t.find({a: {$gte: 20, $lt: 30}}, {a: 1, b: 1, c: 1, _id: 0}).hint({a: 1, c: 1}).explain();
+assert.eq(true, plan.indexOnly);
+assert.eq(0, plan.nscannedObjects);
+assert.eq(10, t.find({a: {$gte: 20, $lt: 30}}, {a: 1, b: 1, c: 1, _id: 0}).hint({a: 1, c: 1}).itcount());
+t.find({a: {$gte: 20, $lt: 30}}, {a: 1, b: 1, c: 1, _id: 0}).hint({a: 1, c: 1}).forEach(function(o) {
+    assert.eq(o.a * 2, o.b, "foreground build should store b");
+    assert.eq("c" + o.a, o.c);
+});
+assert.eq({a: 100}, t.find({a: 100}, {a: 1, b: 1, _id: 0}).hint({a: 1, c: 1}).next());
+
+// And in the background.
+t.dropIndexes();
+t.ensureIndex({a: 1, c: 1}, {clusteringFields: {b: 1}, background: true});
+assert.eq(null, db.getLastError());
+plan = t.find({a: 7}, {b: 1, c: 1, _id: 0}).hint({a: 1, c: 1}).explain();
+assert.eq(true, plan.indexOnly);
+assert.eq(14, t.find({a: 7}, {b: 1, c: 1, _id: 0}).hint({a: 1, c: 1}).next().b);
+t.remove({a: 7});
+assert.eq(0, t.find({a: 7}, {b: 1, _id: 0}).hint({a: 1, c: 1}).itcount());
+
+// Bad specs.
+t.ensureIndex({c: 1}, {clusteringFields: {b: 1}, clustering: true});
+assert.eq(17371, db.getLastErrorObj().code);
+t.ensureIndex({c: 1}, {clusteringFields: {"x.y": 1}});
+assert.eq(17372, db.getLastErrorObj().code);
+t.ensureIndex({c: 1}, {clusteringFields: {}});
+assert.eq(17370, db.getLastErrorObj().code);
+t.ensureIndex({c: "hashed"}, {clusteringFields: {b: 1}});
+assert.eq(17373, db.getLastErrorObj().code);
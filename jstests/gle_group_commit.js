@@ -0,0 +1,39 @@
+// getLastError with j or fsync waits on a shared recovery log flush; the groupCommit section of
+// serverStatus reports how those flushes were batched.
+
+t = db.gle_group_commit;
+t.drop();
+
+var oldPeriod = db.adminCommand( { getParameter : 1 , logFlushPeriod : 1 } ).logFlushPeriod;
+assert.commandWorked( db.adminCommand( { setParameter : 1 , logFlushPeriod : 100 } ) );
+
+var before = db.serverStatus().groupCommit;
+assert( before , "groupCommit section missing" );
+
+// concurrent writers, each waiting for durability after every insert
+var writers = [];
+for ( var w = 0; w < 4; w++ ) {
+    writers.push( startParallelShell( "for ( i = 0; i < 200; i++ ) {" +
+                                      "    db.gle_group_commit.insert( { w : " + w + " , i : i } );" +
+                                      "    assert.eq( null , db.runCommand( { getlasterror : 1 , j : true } ).err );" +
+                                      "}" ) );
+}
+for ( var i = 0; i < 200; i++ ) {
+    t.insert( { w : -1 , i : i } );
+    assert.eq( null , db.runCommand( { getlasterror : 1 , fsync : true } ).err );
+}
+writers.forEach( function( join ) { join(); } );
+
+assert.eq( 1000 , t.count() );
+
+var after = db.serverStatus().groupCommit;
+printjson( after );
+var waiters = after.waiters - before.waiters;
+var flushes = after.flushes - before.flushes;
+assert.eq( 1000 , waiters , "every durable wait is counted once" );
+assert.lt( 0 , flushes );
+assert.lte( flushes , waiters );
+assert.lte( after.latencyMicros.p50 , after.latencyMicros.p95 );
+assert.lte( after.latencyMicros.p95 , after.latencyMicros.p99 );
+
+assert.commandWorked( db.adminCommand( { setParameter : 1 , logFlushPeriod : oldPeriod } ) );
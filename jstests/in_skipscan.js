@@ -0,0 +1,39 @@
+// Large $in lists skip between their values, mostly within the rows already fetched.
+
+var t = db.in_skipscan;
+t.drop();
+
+for (i = 0; i < 20000; i++) {
+    t.insert({a: i, b: i % 3});
+}
+t.ensureIndex({a: 1});
+t.ensureIndex({b: 1, a: 1});
+assert.eq(null, db.getLastError());
+
+var ids = [];
+for (i = 0; i < 20000; i += 5) {
+    ids.push(i);
+}
+
+var plan = t.find({a: {$in: ids}}).hint({a: 1}).explain();
+assert.eq(4000, plan.n);
+assert.eq(4000, plan.nscannedObjects);
+assert(plan.nseeks + plan.nbufferedSeeks > 0, "skips should be counted");
+assert.lt(plan.nseeks, 4000, "skips between nearby values should use the row buffer");
+
+assert.eq(4000, t.find({a: {$in: ids}}).hint({a: 1}).itcount());
+assert.eq(4000, t.find({a: {$in: ids}}).sort({a: -1}).hint({a: 1}).itcount());
+var prev = 20000;
+t.find({a: {$in: ids}}).sort({a: -1}).hint({a: 1}).forEach(function(o) {
+    assert.eq(0, o.a % 5);
+    assert.lt(o.a, prev);
+    prev = o.a;
+});
+
+// Compound bounds, skipping both within and between values of the leading field.
+assert.eq(t.find({b: {$in: [0, 2]}, a: {$in: ids}}).hint({a: 1}).itcount(),
+          t.find({b: {$in: [0, 2]}, a: {$in: ids}}).hint({b: 1, a: 1}).itcount());
+assert.eq(2667, t.find({b: {$in: [0, 2]}, a: {$in: ids}}).hint({b: 1, a: 1}).itcount());
+
+// Values far apart still land on the right keys.
+assert.eq(3, t.find({a: {$in: [-1, 7, 19999, 12345, 20001]}}).itcount());
@@ -0,0 +1,40 @@
+// Row lock waits and timeouts are aggregated per index and key range, and reported by
+// showLockContention and serverStatus.
+
+var t = db.lock_contention;
+t.drop();
+t.insert({}); // collection has to exist, otherwise the transaction gets a write lock on it
+
+var admin = db.getSisterDB('admin');
+assert.commandWorked(db.showLockContention({reset: true}));
+admin.runCommand({ setParameter: 1, lockTimeout: 1000 });
+
+db.runCommand('beginTransaction');
+t.insert({_id: 1});
+assert.eq(null, db.getLastError());
+
+// waits long enough to be sampled, then times out
+var join = startParallelShell('db.lock_contention.insert({_id: 1}); assert.neq(null, db.getLastError());');
+join();
+db.runCommand('rollbackTransaction');
+admin.runCommand({ setParameter: 1, lockTimeout: 4000 });
+
+var res = db.showLockContention({limit: 5, sort: 'timeouts'});
+assert.commandWorked(res);
+assert.gt(res.ranges.length, 0);
+var top = res.ranges[0];
+assert.eq(t.getFullName() + '.$_id_', top.index);
+assert.eq(1, top.timeouts);
+assert.eq(1, top.waits);
+assert.gte(top.waitMillis, 500);
+assert.eq(2, top.bounds.length);
+
+var ss = db.serverStatus().lockContention;
+assert.eq(1, ss.collections[t.getFullName()].timeouts);
+assert.eq(1, ss.indexes[t.getFullName() + '.$_id_'].waits);
+
+assert.commandFailed(db.showLockContention({sort: 'bogus'}));
+assert.commandWorked(db.showLockContention({reset: true}));
+assert.eq(0, db.showLockContention().ranges.length);
+
+t.drop();
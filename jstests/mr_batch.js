@@ -0,0 +1,59 @@
+// mapReduce maps documents in batches; the results must not depend on the batch size.
+
+t = db.mr_batch;
+t.drop();
+
+for ( var i = 0; i < 1000; i++ ) {
+    t.insert( { _id : i , k : i % 13 , tags : [ i % 2 , i % 3 ] } );
+}
+assert.eq( null , db.getLastError() );
+
+m = function() {
+    emit( this.k , { n : 1 , sum : this._id } );
+    for ( var j = 0; j < this.tags.length; j++ )
+        emit( "tag" + this.tags[j] , { n : 1 , sum : 0 } );
+}
+
+r = function( k , vals ) {
+    var res = { n : 0 , sum : 0 };
+    vals.forEach( function( v ) { res.n += v.n; res.sum += v.sum; } );
+    return res;
+}
+
+function run( batchSize , extra ) {
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , mapReduceBatchSize : batchSize } ) );
+    var cmd = { mapreduce : t.getName() , map : m , reduce : r , out : { inline : 1 } };
+    for ( var f in extra )
+        cmd[f] = extra[f];
+    var res = db.runCommand( cmd );
+    assert.commandWorked( res );
+    return res;
+}
+
+var old = db.adminCommand( { getParameter : 1 , mapReduceBatchSize : 1 } ).mapReduceBatchSize;
+
+var expected = run( 1 );
+[ 2 , 7 , 128 , 5000 ].forEach( function( size ) {
+    var res = run( size );
+    assert.eq( expected.counts , res.counts , "batch size " + size );
+    assert.eq( expected.results , res.results , "batch size " + size );
+
+    // limit and query cut the input in the middle of a batch
+    assert.eq( run( 1 , { limit : 101 } ).results , run( size , { limit : 101 } ).results );
+    assert.eq( run( 1 , { query : { _id : { $gt : 500 } } } ).results ,
+               run( size , { query : { _id : { $gt : 500 } } } ).results );
+} );
+
+// errors in a batch still fail the command
+assert.commandWorked( db.adminCommand( { setParameter : 1 , mapReduceBatchSize : 128 } ) );
+var res = db.runCommand( { mapreduce : t.getName() ,
+                           map : function() { if ( this._id == 500 ) throw "bad doc"; emit( 1 , 1 ); } ,
+                           reduce : r , out : { inline : 1 } } );
+assert.eq( 0 , res.ok , tojson( res ) );
+assert( /bad doc/.test( res.errmsg ) , tojson( res ) );
+
+// $where still sees obj and fullObject
+assert.eq( 77 , t.find( { $where : "obj.k == 0 && fullObject" } ).itcount() );
+assert.eq( 77 , t.find( { $where : function() { return this.k == 0 && obj._id == this._id; } } ).itcount() );
+
+assert.commandWorked( db.adminCommand( { setParameter : 1 , mapReduceBatchSize : old } ) );
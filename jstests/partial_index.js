@@ -0,0 +1,72 @@
+// Partial indexes only index the documents matching their partialFilterExpression, and are only
+// used for queries that imply it.
+
+var t = db.partial_index;
+t.drop();
+
+for (i = 0; i < 200; i++) {
+    t.insert({a: i, status: (i % 10 == 0) ? "active" : "done", n: i % 7});
+}
+t.ensureIndex({a: 1}, {partialFilterExpression: {status: "active"}});
+assert.eq(null, db.getLastError());
+
+// Only the matching documents have keys.
+var plan = t.find({status: "active"}).hint({a: 1}).explain();
+assert.eq(20, plan.n, "hinted scan should only see active documents");
+
+// Used when the query implies the filter.
+plan = t.find({status: "active", a: {$gte: 50}}).explain();
+assert.eq("BtreeCursor a_1", plan.cursor);
+assert.eq(15, plan.n);
+assert.eq(15, t.find({status: "active", a: {$gte: 50}}).itcount());
+assert.eq(15, t.find({status: {$in: ["active"]}, a: {$gte: 50}}).count());
+
+// Not used when it doesn't, the results must include unindexed documents.
+plan = t.find({a: {$gte: 50}}).explain();
+assert.neq("BtreeCursor a_1", plan.cursor);
+assert.eq(150, t.find({a: {$gte: 50}}).itcount());
+assert.eq(150, t.find({a: {$gte: 50}}).count());
+assert.eq(200, t.find().sort({a: 1}).itcount());
+assert.eq(200, t.count());
+plan = t.find({status: {$in: ["active", "done"]}, a: 5}).explain();
+assert.neq("BtreeCursor a_1", plan.cursor);
+assert.eq(1, t.find({status: {$in: ["active", "done"]}, a: 5}).itcount());
+
+// Moving documents in and out of the filter maintains the index.
+t.update({a: 1}, {$set: {status: "active"}});
+t.update({a: 0}, {$set: {status: "done"}});
+t.update({a: 10}, {$inc: {n: 1}});
+assert.eq(null, db.getLastError());
+var active = t.find({status: "active", a: {$lt: 20}}).toArray();
+assert.eq([1, 10], active.map(function(o) { return o.a; }));
+t.remove({a: 10});
+assert.eq(19, t.find({status: "active"}).hint({a: 1}).itcount());
+
+// Unique only among the indexed documents.
+t.drop();
+t.ensureIndex({u: 1}, {unique: true, partialFilterExpression: {n: {$gt: 0}}});
+t.insert({u: 1, n: 0});
+t.insert({u: 1, n: 0});
+assert.eq(null, db.getLastError());
+t.insert({u: 1, n: 1});
+assert.eq(null, db.getLastError());
+t.insert({u: 1, n: 2});
+assert.neq(null, db.getLastError(), "duplicate among indexed documents");
+
+// Built on existing data.
+t.drop();
+for (i = 0; i < 100; i++) {
+    t.insert({a: i, b: i % 2});
+}
+t.ensureIndex({a: 1}, {partialFilterExpression: {b: 1}, background: true});
+assert.eq(null, db.getLastError());
+assert.eq(50, t.find({b: 1}).hint({a: 1}).itcount());
+assert.eq(10, t.find({b: 1, a: {$lt: 20}}).itcount());
+
+// Filters must be exactly representable as field ranges.
+t.ensureIndex({c: 1}, {partialFilterExpression: {c: /x/}});
+assert.eq(17375, db.getLastErrorObj().code);
+t.ensureIndex({c: 1}, {partialFilterExpression: {$or: [{b: 1}, {b: 2}]}});
+assert.eq(17376, db.getLastErrorObj().code);
+t.ensureIndex({c: 1}, {partialFilterExpression: 5});
+assert.eq(17374, db.getLastErrorObj().code);
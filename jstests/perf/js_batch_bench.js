@@ -0,0 +1,41 @@
+// Times mapReduce with the map function called once per document against batched calls, and
+// $where.
+
+t = db.js_batch_bench;
+t.drop();
+
+var str = new Array( 64 ).join( "x" );
+for ( var i = 0; i < 200000; i++ ) {
+    t.insert( { _id : i , k : i % 100 , v : i , s : str } );
+}
+assert.eq( null , db.getLastError() );
+
+m = function() { emit( this.k , this.v ); };
+r = function( k , vals ) { return Array.sum( vals ); };
+
+var old = db.adminCommand( { getParameter : 1 , mapReduceBatchSize : 1 } ).mapReduceBatchSize;
+
+function timeMR( batchSize ) {
+    assert.commandWorked( db.adminCommand( { setParameter : 1 , mapReduceBatchSize : batchSize } ) );
+    var start = new Date();
+    var res = db.runCommand( { mapreduce : t.getName() , map : m , reduce : r , out : { inline : 1 } } );
+    assert.commandWorked( res );
+    assert.eq( t.count() , res.counts.input );
+    return new Date() - start;
+}
+
+var results = {};
+[ 1 , 16 , 128 , 1024 ].forEach( function( size ) {
+    timeMR( size ); // warm up
+    results[ "mapReduce batch " + size ] = timeMR( size );
+} );
+
+var start = new Date();
+assert.eq( 2000 , t.find( { $where : "this.k == 7" } ).itcount() );
+results[ "$where" ] = new Date() - start;
+
+print( "js_batch_bench millis:" );
+printjson( results );
+
+assert.commandWorked( db.adminCommand( { setParameter : 1 , mapReduceBatchSize : old } ) );
+t.drop();
@@ -0,0 +1,67 @@
+// Profile entries are written by a background thread; reads of system.profile still see the ops
+// that came before them.  Also covers sampling and per-collection slowms thresholds.
+
+// special db so that it can be run in parallel tests
+var stddb = db;
+var db = db.getSisterDB("profile_sampled");
+
+try {
+    db.dropDatabase();
+    db.runCommand({profile: 0});
+    db.system.profile.drop();
+    db.createCollection("system.profile", {capped: true, size: 10 * 1024 * 1024});
+
+    var t = db.profile_sampled;
+    for (var i = 0; i < 100; i++) {
+        t.insert({_id: i});
+    }
+
+    // everything at level 2, visible right away
+    assert.commandWorked(db.runCommand({profile: 2}));
+    for (var i = 0; i < 100; i++) {
+        t.findOne({_id: i});
+    }
+    assert.eq(100, db.system.profile.count({op: "query", ns: t.getFullName()}), "all profiled");
+
+    // a sample rate of 0 profiles nothing, and is reported back
+    var res = db.runCommand({profile: 2, sampleRate: 0});
+    assert.commandWorked(res);
+    assert.eq(1, res.sampleRate);
+    for (var i = 0; i < 100; i++) {
+        t.findOne({_id: i});
+    }
+    assert.eq(100, db.system.profile.count({op: "query", ns: t.getFullName()}), "none sampled");
+
+    // roughly half
+    assert.eq(0, db.runCommand({profile: 2, sampleRate: 0.5}).sampleRate);
+    for (var i = 0; i < 1000; i++) {
+        t.findOne({_id: i % 100});
+    }
+    var n = db.system.profile.count({op: "query", ns: t.getFullName()}) - 100;
+    assert.gt(n, 300, "half sampled");
+    assert.lt(n, 700, "half sampled");
+    assert.commandFailed(db.runCommand({profile: -1, sampleRate: 2}));
+    assert.commandWorked(db.runCommand({profile: 0, sampleRate: 1}));
+
+    // at level 1, a collection's own slowms overrides the global one
+    db.system.profile.drop();
+    db.createCollection("system.profile", {capped: true, size: 10 * 1024 * 1024});
+    var u = db.profile_sampled_other;
+    u.insert({_id: 0});
+    assert.commandWorked(db.runCommand({profile: 1, slowms: 100000}));
+    assert.commandWorked(db.runCommand({profile: 1, ns: t.getName(), slowms: 0}));
+    res = db.runCommand({profile: -1});
+    assert.eq(0, res.nsSlowms[t.getFullName()]);
+    assert.eq(100000, res.slowms);
+    t.findOne({_id: 1});
+    u.findOne({_id: 0});
+    assert.eq(1, db.system.profile.count({op: "query", ns: t.getFullName()}), "own slowms");
+    assert.eq(0, db.system.profile.count({op: "query", ns: u.getFullName()}), "global slowms");
+
+    assert.commandWorked(db.runCommand({profile: 1, ns: t.getName(), slowms: -1}));
+    assert.eq(undefined, db.runCommand({profile: -1}).nsSlowms[t.getFullName()]);
+} finally {
+    // disable profiling for subsequent tests
+    assert.commandWorked(db.runCommand({profile: 0, slowms: 100, sampleRate: 1}));
+    db = stddb;
+}
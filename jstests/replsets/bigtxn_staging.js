@@ -0,0 +1,60 @@
+// verify that secondaries stage the oplog.refs entries of a big txn while it is still open on the
+// primary, and only copy what is left when it commits
+
+doTest = function( signal ) {
+
+  var name = "bigtxn_staging";
+
+  var replTest = new ReplSetTest( {name: name, nodes: 2, txnMemLimit: 1000} );
+
+  var nodes = replTest.startSet();
+
+  var config = replTest.getReplSetConfig();
+
+  replTest.initiate(config);
+
+  var master = replTest.getMaster().getDB(name);
+  var slaveConn = replTest.liveNodes.slaves[0];
+  slaveConn.setSlaveOk();
+  var slave = slaveConn.getDB(name);
+  var slaveAdmin = slaveConn.getDB("admin");
+  replTest.awaitReplication();
+
+  var before = slaveAdmin.serverStatus().metrics.repl.largeTxn;
+
+  print("insert into primary");
+  var n = 5000;
+  master.runCommand("beginTransaction");
+  for (var i=1; i<=n; i++) {
+    master.x.insert({i:i, s:"some padding so that the txn spills"});
+  }
+  master.getLastError();
+
+  // the secondary picks up the spilled entries before we commit
+  assert.soon(function() {
+    var st = slaveAdmin.serverStatus().largeTxnStaging;
+    printjson(st);
+    return st.staging > 0;
+  }, "secondary never started staging");
+  master.runCommand("commitTransaction");
+
+  replTest.awaitReplication();
+
+  // verify
+  assert.eq(n,master.x.count());
+  assert.eq(n,slave.x.count());
+  var s = 0;
+  slave.x.find().forEach(function (x) { s+=x.i; });
+  assert.eq(s, n*(n+1)/2);
+
+  var after = slaveAdmin.serverStatus().metrics.repl.largeTxn;
+  printjson(after);
+  assert.eq(1, after.count - before.count);
+  assert.lt(0, after.preStagedBytes - before.preStagedBytes, "nothing was pre-staged");
+  var recent = slaveAdmin.serverStatus().largeTxnStaging.recent;
+  assert.lt(0, recent[recent.length - 1].preStagedRatio);
+
+  replTest.stopSet(signal);
+}
+
+doTest(15);
@@ -0,0 +1,36 @@
+// Blind upserts by _id replicate as the same insert-or-modify update message.
+
+var replTest = new ReplSetTest({ name: 'fastUpsert', nodes: 2 });
+var conns = replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var secondary = replTest.liveNodes.slaves[0];
+secondary.setSlaveOk();
+var primarydb = primary.getDB('db');
+var secondarydb = secondary.getDB('db');
+
+primarydb.counters.drop();
+for (i = 0; i < 300; i++) {
+    // Leave gaps for the upserts to fill in.
+    if (i % 3 != 0) {
+        primarydb.counters.insert({ _id: i, n: 10 });
+    }
+}
+assert.commandWorked(primarydb.adminCommand({ setParameter: 1, fastUpdates: true }));
+var before = primarydb.serverStatus().metrics.fastUpdates.performed.upsert;
+for (i = 0; i < 300; i++) {
+    primarydb.counters.update({ _id: i }, { $inc: { n: 1 }, $setOnInsert: { fresh: true } }, { upsert: true });
+}
+assert.eq(null, primarydb.getLastError());
+assert.commandWorked(primarydb.adminCommand({ setParameter: 1, fastUpdates: false }));
+assert.eq(300, primarydb.serverStatus().metrics.fastUpdates.performed.upsert - before);
+
+replTest.awaitReplication();
+[ primarydb, secondarydb ].forEach(function(d) {
+    assert.eq(300, d.counters.count());
+    assert.eq(100, d.counters.count({ n: 1, fresh: true }));
+    assert.eq(200, d.counters.count({ n: 11, fresh: { $exists: false } }));
+});
+
+replTest.stopSet();
@@ -0,0 +1,59 @@
+// The oplog partition thread adds partitions and drops old ones to keep the oplog under
+// expireOplogBytes, and reports the oplog window in serverStatus.
+
+var replTest = new ReplSetTest({ name: 'oplogPartitionBytes', nodes: 1 });
+var nodes = replTest.nodeList();
+replTest.startSet();
+replTest.initiate({ "_id": "oplogPartitionBytes",
+                    "members": [ { "_id": 0, "host": nodes[0] } ] });
+var master = replTest.getMaster();
+var admin = master.getDB("admin");
+var localdb = master.getDB("local");
+var coll = master.getDB("foo").foo;
+
+assert.soon(function() { return admin.serverStatus().oplogPartitions.window != undefined; },
+            "no oplog window in serverStatus", 60 * 1000);
+var status = admin.serverStatus().oplogPartitions;
+printjson(status);
+assert.eq(1, status.partitions);
+assert.eq(0, status.expireOplogBytes);
+assert.eq(0, status.dropped.bytes);
+
+var limit = 4 * 1024 * 1024;
+assert.commandWorked(admin.runCommand({ setParameter: 1, expireOplogBytes: limit }));
+
+// write about three times the limit, in bursts
+var pad = new Array(1024).join("x");
+for (var burst = 0; burst < 12; burst++) {
+    for (var i = 0; i < 1000; i++) {
+        coll.insert({ burst: burst, i: i, pad: pad });
+    }
+    assert.eq(null, coll.getDB().getLastError());
+    sleep(2000);
+}
+
+assert.soon(function() {
+    status = admin.serverStatus().oplogPartitions;
+    printjson(status);
+    return status.added.bytes > 0 && status.dropped.bytes > 0 && status.window.bytes <= limit;
+}, "oplog was not trimmed to expireOplogBytes", 3 * 60 * 1000, 2000);
+
+var info = localdb.runCommand({ getPartitionInfo: "oplog.rs" });
+printjson(info);
+assert.gt(info.numPartitions, 1);
+// the oldest writes are gone, the newest are still there
+assert.gt(info.partitions[0]._id, 0);
+assert.eq(status.partitions, info.numPartitions);
+assert.gt(status.window.secs, 0);
+assert.eq(1, localdb.oplog.rs.find({ "ops.o.burst": 11, "ops.o.i": 999 }).itcount());
+assert.eq(0, localdb.oplog.rs.find({ "ops.o.burst": 0, "ops.o.i": 0 }).itcount());
+
+// without a byte limit, nothing else is dropped
+assert.commandWorked(admin.runCommand({ setParameter: 1, expireOplogBytes: 0 }));
+var dropped = status.dropped.bytes;
+sleep(25 * 1000);
+status = admin.serverStatus().oplogPartitions;
+assert.eq(dropped, status.dropped.bytes);
+assert.eq(0, status.dropped.age);
+
+replTest.stopSet();
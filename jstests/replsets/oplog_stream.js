@@ -0,0 +1,52 @@
+// Secondaries stream the primary's oplog, acknowledge writes they have written, and the primary
+// reports each stream in replSetGetStatus.
+
+var replTest = new ReplSetTest({ name: 'oplogStream', nodes: 3 });
+var conns = replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var db = primary.getDB('test');
+db.foo.drop();
+
+var data = new Array(1024).join('x');
+for (var i = 0; i < 1000; i++) {
+    db.foo.insert({ _id: i, data: data });
+}
+var res = db.runCommand({ getLastError: 1, w: 3, wtimeout: 60000 });
+assert.eq(null, res.err, tojson(res));
+
+var streams;
+assert.soon(function() {
+    streams = primary.getDB('admin').runCommand({ replSetGetStatus: 1 }).oplogStreams;
+    printjson(streams);
+    return streams && streams.length == 2 && streams.every(function(s) { return s.windowBytes > 0; });
+}, "secondaries did not stream the oplog");
+streams.forEach(function(s) {
+    assert.gt(s.sentOps, 0, tojson(s));
+    assert.gte(s.sentBytes, s.inFlightBytes, tojson(s));
+    // a secondary never acknowledges more than was sent
+    assert.gte(s.inFlightBytes, 0, tojson(s));
+});
+
+// Acknowledgement still waits for the secondaries to write the ops.
+for (var i = 1000; i < 1100; i++) {
+    db.foo.insert({ _id: i });
+    res = db.runCommand({ getLastError: 1, w: 3, wtimeout: 60000 });
+    assert.eq(null, res.err, tojson(res));
+}
+replTest.awaitReplication();
+
+// Both ends count the same batches, the query's reply included, so once the secondaries have
+// caught up nothing is left in flight.
+assert.soon(function() {
+    streams = primary.getDB('admin').runCommand({ replSetGetStatus: 1 }).oplogStreams;
+    streams.forEach(function(s) { assert.gte(s.inFlightBytes, 0, tojson(s)); });
+    return streams.length == 2 && streams.every(function(s) { return s.inFlightBytes == 0; });
+}, "stream byte counts did not settle");
+replTest.liveNodes.slaves.forEach(function(s) {
+    s.setSlaveOk();
+    assert.eq(1100, s.getDB('test').foo.count());
+});
+
+replTest.stopSet();
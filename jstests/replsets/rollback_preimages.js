@@ -0,0 +1,46 @@
+// with rollbackPreImageWindowSecs set, rollback undoes updates locally from their pre-images
+// instead of refetching the documents from the sync source
+
+load('jstests/replsets/_rollback_helpers.js');
+
+preloadData = function(conn) {
+    conn.getDB("test").createCollection("foo");
+    conn.getDB("test").foo.ensureIndex({a:1});
+    for (var i = 0; i < 10; i++) {
+        conn.getDB("test").foo.insert({_id : i, state : 0, a : i});
+    }
+};
+
+preloadMoreData = function(conn) {
+    for (var i = 10; i < 20; i++) {
+        conn.getDB("test").foo.insert({_id : i, state : 100});
+    }
+    conn.getDB("test").foo.update({_id : 5}, {$inc : {state : 3}});
+    for (var i = 20; i < 30; i++) {
+        conn.getDB("test").foo.insert({_id : i, state : 100});
+    }
+    conn.getDB("test").foo.update({_id : 5}, {$inc : {state : 3}});
+};
+
+enablePreImages = function(conn) {
+    assert.commandWorked(conn.getDB("admin").runCommand({setParameter : 1, rollbackPreImageWindowSecs : 3600}));
+    assert.soon(function() {
+        return conn.getDB("local").runCommand({'_collectionsExist': ['local.rollback.preimages']}).ok;
+    }, "local.rollback.preimages was not created", 30 * 1000);
+};
+
+doUpdates = function(conn) {
+    enablePreImages(conn);
+    conn.getDB("test").foo.update({_id : 5}, {$inc : {state : 1}});
+    conn.getDB("test").foo.update({_id : 6}, {$inc : {state : 1}, $set : {a : 60}});
+    conn.getDB("test").foo.update({_id : 7}, {state : 1000, a : 70});
+    conn.getDB("test").foo.update({_id : 7}, {$inc : {state : 1}});
+};
+
+checkUndoneLocally = function(conn) {
+    var rollback = conn.getDB("admin").serverStatus().metrics.repl.rollback;
+    printjson(rollback);
+    assert.gt(rollback.updatesUndoneLocally, 0);
+};
+
+doRollbackTest( 15, 1000000, 31000, preloadData, preloadMoreData, doUpdates, false, checkUndoneLocally );
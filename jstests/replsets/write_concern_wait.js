@@ -0,0 +1,42 @@
+// getLastError with w waits for members to catch up without polling, and records how long it
+// waited by kind of w.
+
+var replTest = new ReplSetTest({ name: 'writeConcernWait', nodes: 3 });
+var conns = replTest.startSet();
+replTest.initiate();
+
+var primary = replTest.getMaster();
+var db = primary.getDB('test');
+db.foo.drop();
+
+for (var i = 0; i < 200; i++) {
+    db.foo.insert({ _id: i });
+    var res = db.runCommand({ getLastError: 1, w: (i % 2) ? 2 : 'majority', wtimeout: 60000 });
+    assert.eq(null, res.err, tojson(res));
+    assert(!res.wtimeout, tojson(res));
+}
+for (var i = 200; i < 300; i++) {
+    db.foo.insert({ _id: i });
+    var res = db.runCommand({ getLastError: 1, w: 3, wtimeout: 60000 });
+    assert.eq(null, res.err, tojson(res));
+    assert.gte(res.writtenTo.length, 3);
+}
+
+var lat = primary.getDB('admin').serverStatus().replAckLatencyMillis;
+printjson(lat);
+assert.eq(200, lat.number.count);
+assert.eq(100, lat.majority.count);
+assert.eq(0, lat.tag.count);
+assert.lte(lat.number.p50, lat.number.p99);
+
+// With a member down, w:3 still times out on schedule, and doesn't count as acknowledged.
+replTest.stop(2);
+db.foo.insert({ _id: 'down' });
+var res = db.runCommand({ getLastError: 1, w: 3, wtimeout: 1500 });
+assert.eq('timeout', res.err, tojson(res));
+assert(res.waited >= 1500 && res.waited < 10000, tojson(res));
+assert.eq(200, primary.getDB('admin').serverStatus().replAckLatencyMillis.number.count);
+// but w:2 is still fine
+assert.eq(null, db.runCommand({ getLastError: 1, w: 2, wtimeout: 60000 }).err);
+
+replTest.stopSet();
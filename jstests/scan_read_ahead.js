@@ -0,0 +1,46 @@
+// Unfiltered scans read ahead of themselves, and explain says how far and how long they waited.
+
+var t = db.scan_read_ahead;
+t.drop();
+
+var pad = new Array(200).join("x");
+for (i = 0; i < 20000; i++) {
+    t.insert({_id: i, a: i % 100, pad: pad});
+}
+t.ensureIndex({a: 1});
+assert.eq(null, db.getLastError());
+
+var plan = t.find().explain();
+printjson(plan.readAhead);
+assert.eq("BasicCursor", plan.cursor);
+assert.eq(20000, plan.n);
+assert(plan.readAhead, "unfiltered scans should read ahead");
+assert.gt(plan.readAhead.windowBytes, 0);
+assert.gte(plan.readAhead.distanceBytes, 0);
+assert.gte(plan.readAhead.maxDistanceBytes, plan.readAhead.distanceBytes);
+assert.gte(plan.readAhead.stallMillis, 0);
+
+// reverse scans and full index scans too
+assert(t.find().sort({$natural: -1}).explain().readAhead, "reverse scans should read ahead");
+assert(t.find().hint({a: 1}).explain().readAhead, "full index scans should read ahead");
+
+// filtered and limited scans do not
+assert.eq(undefined, t.find({pad: pad}).explain().readAhead);
+assert.eq(undefined, t.find({a: {$gte: 50}}).explain().readAhead);
+assert.eq(undefined, t.find().limit(10).explain().readAhead);
+
+// the results are the same either way
+assert.eq(20000, t.find().itcount());
+assert.eq(20000, t.count());
+var prev = 20000;
+t.find().sort({$natural: -1}).forEach(function(o) {
+    assert.eq(prev - 1, o._id);
+    prev = o._id;
+});
+assert.eq(0, prev);
+
+// off when the window is 0
+assert.commandWorked(db.adminCommand({setParameter: 1, scanReadAheadBytes: 0}));
+assert.eq(undefined, t.find().explain().readAhead);
+assert.eq(20000, t.count());
+assert.commandWorked(db.adminCommand({setParameter: 1, scanReadAheadBytes: 16 * 1024 * 1024}));
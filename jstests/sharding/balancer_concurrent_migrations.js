@@ -0,0 +1,85 @@
+// The balancer moves chunks between disjoint pairs of shards at the same time, and reports its
+// migrations in serverStatus.
+
+var st = new ShardingTest({shards : 4, mongos : 1, other : {chunksize : 1}});
+st.stopBalancer();
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var config = mongos.getDB("config");
+
+assert(admin.runCommand({enableSharding : "foo"}).ok);
+var primaryName = config.databases.findOne({_id : "foo"}).primary;
+var shards = config.shards.find({}, {_id : 1}).sort({_id : 1}).toArray().map(function(s) {
+    return s._id;
+});
+var others = shards.filter(function(s) { return s != primaryName; });
+
+// Two collections, each with all its chunks on a different shard, and two empty shards.
+var colls = [mongos.getCollection("foo.a"), mongos.getCollection("foo.b")];
+colls.forEach(function(coll, c) {
+    assert(admin.runCommand({shardCollection : coll + "", key : {_id : 1}}).ok);
+    for (var i = 1; i < 10; i++) {
+        assert(admin.runCommand({split : coll + "", middle : {_id : i * 100}}).ok);
+    }
+    for (var i = 0; i < 1000; i++) {
+        coll.insert({_id : i});
+    }
+    assert.eq(null, coll.getDB().getLastError());
+    if (c == 1) {
+        for (var i = 0; i < 10; i++) {
+            assert(admin.runCommand({moveChunk : coll + "", find : {_id : i * 100},
+                                     to : others[0]}).ok);
+        }
+    }
+});
+
+var status = admin.serverStatus().balancer;
+printjson(status);
+assert(status);
+assert.eq(0, status.started);
+assert.eq(0, status.inFlight.length);
+
+st.startBalancer();
+assert.soon(function() {
+    var counts = colls.map(function(coll) {
+        var perShard = {};
+        config.chunks.find({ns : coll + ""}).forEach(function(chunk) {
+            perShard[chunk.shard] = (perShard[chunk.shard] || 0) + 1;
+        });
+        var n = shards.map(function(s) { return perShard[s] || 0; });
+        return Math.max.apply(null, n) - Math.min.apply(null, n);
+    });
+    printjson(counts);
+    return counts[0] <= 2 && counts[1] <= 2;
+}, "collections did not balance", 5 * 60 * 1000, 1000);
+st.stopBalancer();
+
+status = admin.serverStatus().balancer;
+printjson(status);
+assert.gt(status.started, 0);
+assert.gt(status.succeeded, 0);
+assert.eq(status.started, status.succeeded + status.failed);
+assert.eq(0, status.inFlight.length);
+
+// Each shard took part in at most one migration at a time.  The donor logs moveChunk.from when
+// a migration ends, whether or not it committed.
+var migrating = {};
+var open = {};
+config.changelog.find({what : /^moveChunk\.(start|from)$/}).sort({time : 1}).forEach(function(e) {
+    var key = e.ns + tojson(e.details.min);
+    if (e.what == "moveChunk.start") {
+        [e.details.from, e.details.to].forEach(function(s) {
+            assert(!migrating[s], "shard " + s + " in two migrations: " + tojson(e));
+            migrating[s] = true;
+        });
+        open[key] = e.details;
+    }
+    else if (open[key]) {
+        delete migrating[open[key].from];
+        delete migrating[open[key].to];
+        delete open[key];
+    }
+});
+
+st.stop();
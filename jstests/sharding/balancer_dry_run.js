@@ -0,0 +1,69 @@
+// The balancer dry run explains what each policy would move, without moving anything.
+
+var st = new ShardingTest({shards : 2, mongos : 1, other : {chunksize : 1}});
+st.stopBalancer();
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var coll = mongos.getCollection("foo.bar");
+
+assert(admin.runCommand({enableSharding : "foo"}).ok);
+assert(admin.runCommand({shardCollection : coll + "", key : {_id : 1}}).ok);
+assert(admin.runCommand({split : coll + "", middle : {_id : 1000}}).ok);
+assert(admin.runCommand({split : coll + "", middle : {_id : 2000}}).ok);
+
+// All the data goes in the first two chunks, and the empty one goes to the other shard, so
+// the chunk counts are as even as they get but the data isn't.
+var pad = new Array(4096).join("x");
+for (var i = 0; i < 2000; i++) {
+    coll.insert({_id : i, pad : pad});
+}
+assert.eq(null, coll.getDB().getLastError());
+
+var primary = st.getServer("foo");
+var primaryName = mongos.getDB("config").databases.findOne({_id : "foo"}).primary;
+var otherName = mongos.getDB("config").shards.findOne({_id : {$ne : primaryName}})._id;
+assert(admin.runCommand({moveChunk : coll + "", find : {_id : 2000}, to : otherName}).ok);
+
+var sizes = primary.getDB("foo").runCommand({chunkDataSizes : coll + "",
+                                             keyPattern : {_id : 1},
+                                             chunks : [{min : {_id : MinKey}, max : {_id : 1000}},
+                                                       {min : {_id : 1000}, max : {_id : 2000}}]});
+assert.commandWorked(sizes);
+assert.eq(2, sizes.sizes.length);
+printjson(sizes);
+
+var chunksBefore = mongos.getDB("config").chunks.find().sort({min : 1}).toArray();
+
+var res = admin.runCommand({balancerDryRun : 1, ns : coll + "", policy : "chunkCount"});
+printjson(res);
+assert.commandWorked(res);
+assert.eq("chunkCount", res.policy);
+assert.eq("balanced", res.collections[coll + ""].reason);
+
+res = admin.runCommand({balancerDryRun : 1, ns : coll + "", policy : "load"});
+printjson(res);
+assert.commandWorked(res);
+assert.eq("load", res.policy);
+var explain = res.collections[coll + ""];
+if (sizes.sizes[0] + sizes.sizes[1] > 0) {
+    assert.eq("load", explain.reason);
+    assert.eq(primaryName, explain.from);
+    assert.eq(otherName, explain.to);
+    assert.eq("load", explain.tags[0].policy);
+    assert(explain.tags[0].shards[primaryName].cost > explain.tags[0].shards[otherName].cost);
+}
+
+// The default is the policy in the balancer settings.
+mongos.getDB("config").settings.update({_id : "balancer"}, {$set : {policy : "load"}}, true);
+res = admin.runCommand({balancerDryRun : 1});
+assert.commandWorked(res);
+assert.eq("load", res.policy);
+assert(res.collections[coll + ""]);
+
+assert.commandFailed(admin.runCommand({balancerDryRun : 1, policy : "random"}));
+
+// Nothing moved.
+assert.eq(chunksBefore, mongos.getDB("config").chunks.find().sort({min : 1}).toArray());
+
+st.stop();
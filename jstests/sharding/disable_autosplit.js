@@ -23,6 +23,9 @@ var admin = mongos.getDB( "admin" )
 var config = mongos.getDB( "config" )
 var coll = mongos.getCollection( "foo.bar" )
 
+// Shards split their own chunks too, unless told not to
+assert( st.shard0.getDB( "admin" ).runCommand({ setParameter : 1, shardAutoSplit : false }).ok )
+
 printjson( admin.runCommand({ enableSharding : coll.getDB() + "" }) )
 printjson( admin.runCommand({ shardCollection : coll + "", key : { _id : 1 } }) )
 
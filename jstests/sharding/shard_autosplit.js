@@ -0,0 +1,56 @@
+// A shard splits chunks that mongos sends it enough writes for, without mongos' help, and
+// reports what it did in serverStatus.
+
+var chunkSize = 1; // MB
+
+var st = new ShardingTest({shards : 1, mongos : 1,
+                           other : {chunksize : chunkSize, mongosOptions : {noAutoSplit : ""}}});
+
+var mongos = st.s0;
+var admin = mongos.getDB("admin");
+var config = mongos.getDB("config");
+var coll = mongos.getCollection("foo.bar");
+var shardAdmin = st.shard0.getDB("admin");
+
+assert(admin.runCommand({enableSharding : coll.getDB() + ""}).ok);
+assert(admin.runCommand({shardCollection : coll + "", key : {_id : 1}}).ok);
+
+var data = "x";
+while (data.length < 16 * 1024) {
+    data += data;
+}
+
+// Only suggest splits at first.
+assert(shardAdmin.runCommand({setParameter : 1, shardAutoSplit : false}).ok);
+for (var i = 0; i < 300; i++) {
+    coll.insert({_id : i, data : data});
+}
+assert.eq(null, coll.getDB().getLastError());
+
+assert.soon(function() {
+    var status = shardAdmin.serverStatus().autoSplit;
+    printjson(status);
+    return status && status.checks > 0 && status.suggestedSplits.length > 0;
+}, "no split was suggested", 2 * 60 * 1000, 1000);
+assert.eq(1, config.chunks.find({ns : coll + ""}).count());
+var suggestion = shardAdmin.serverStatus().autoSplit.suggestedSplits[0];
+assert.eq(coll + "", suggestion.ns);
+assert.gt(suggestion.splitKeys.length, 0);
+
+// Now let the shard split.
+assert(shardAdmin.runCommand({setParameter : 1, shardAutoSplit : true}).ok);
+for (var i = 300; i < 600; i++) {
+    coll.insert({_id : i, data : data});
+}
+assert.eq(null, coll.getDB().getLastError());
+
+assert.soon(function() {
+    return config.chunks.find({ns : coll + ""}).count() > 1;
+}, "shard did not split the chunk", 2 * 60 * 1000, 1000);
+var status = shardAdmin.serverStatus().autoSplit;
+printjson(status);
+assert.gt(status.splits, 0);
+assert.eq(600, coll.find().itcount());
+
+st.printShardingStatus();
+st.stop();
@@ -0,0 +1,52 @@
+// Sorted and unsorted merges across shards that need several getMores per shard, which exercises
+// the background prefetch of shard batches in mongos.
+
+s = new ShardingTest( "sorted_merge_prefetch" , 3 , 0 , 1 );
+s.stopBalancer();
+
+s.adminCommand( { enablesharding : "test" } );
+s.adminCommand( { shardcollection : "test.data" , key : { _id : 1 } } );
+
+db = s.getDB( "test" );
+
+N = 30000;
+for ( i=0; i<N; i++ ){
+    db.data.insert( { _id : i , x : ( i * 7919 ) % N , s : "some padding to make batches fill up" } );
+}
+db.getLastError();
+
+s.adminCommand( { split : "test.data" , middle : { _id : N / 3 } } );
+s.adminCommand( { split : "test.data" , middle : { _id : 2 * N / 3 } } );
+
+servers = s.config.shards.find().toArray();
+s.adminCommand( { movechunk : "test.data" , find : { _id : 0 } , to : servers[0]._id , waitForDelete : true } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : N / 2 } , to : servers[1]._id , waitForDelete : true } );
+s.adminCommand( { movechunk : "test.data" , find : { _id : N - 1 } , to : servers[2]._id , waitForDelete : true } );
+
+// sorted merge on a field that interleaves the shards
+prev = -1;
+n = 0;
+db.data.find().sort( { x : 1 } ).batchSize( 100 ).forEach( function( z ) {
+    assert.lt( prev , z.x , "sorted order" );
+    prev = z.x;
+    n++;
+} );
+assert.eq( N , n , "sorted count" );
+
+// descending, with a skip
+a = db.data.find().sort( { x : -1 } ).skip( 10 ).batchSize( 50 ).toArray();
+assert.eq( N - 10 , a.length , "skip count" );
+assert.eq( N - 11 , a[0].x , "skip first" );
+
+// unsorted
+assert.eq( N , db.data.find().batchSize( 100 ).itcount() , "unsorted count" );
+
+// explain reports the time spent waiting on each shard
+e = db.data.find().sort( { x : 1 } ).explain();
+printjson( e.shardWaits );
+assert( e.shardWaits , "shardWaits missing" );
+for ( shard in e.shardWaits ) {
+    assert.lte( 0 , e.shardWaits[shard].waitMicros , "waitMicros" );
+}
+
+s.stop();
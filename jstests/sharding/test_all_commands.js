@@ -26,6 +26,7 @@ var commands = [
     'authenticate',
     'availableQueryOptions',
     'availablequeryoptions',
+    'balancerDryRun',
     // enterprise only
     //'backupStart',
     //'backupStatus',
@@ -36,6 +37,7 @@ var commands = [
     'buildinfo',
     'checkShardingIndex',
     'checkpoint',
+    'chunkDataSizes',
     'clean',
     'clone',
     'cloneCollection',
@@ -155,6 +157,7 @@ var commands = [
     'shardConnPoolStats',
     'shardingState',
     'showLiveTransactions',
+    'showLockContention',
     'showPendingLockRequests',
     'shutdown',
     'sleep',
@@ -0,0 +1,42 @@
+// test dumping and restoring several collections at once, with a big collection split into _id
+// ranges
+
+t = new ToolTest( "dumprestore_parallel" );
+t.startDB( "foo" );
+db = t.db;
+
+var pad = new Array(100).join("x");
+for (var c = 0; c < 5; c++) {
+    for (var i = 0; i < 100; i++) {
+        db["small" + c].insert({_id: i, c: c});
+    }
+}
+// mixed _id types, so the ranges have to cover every type
+var n = 30000;
+for (var i = 0; i < n; i++) {
+    db.big.insert({_id: (i % 3 == 0) ? "s" + i : i, i: i, pad: pad});
+}
+db.big.ensureIndex({i: 1});
+assert.eq(null, db.getLastError());
+
+t.runTool( "dump" , "--out" , t.ext , "-j" , "4" , "--splitSize" , "1" );
+
+db.dropDatabase();
+assert.eq( 0 , db.big.count() , "after drop" );
+
+t.runTool( "restore" , "--dir" , t.ext , "-j" , "4" );
+
+for (var c = 0; c < 5; c++) {
+    assert.eq( 100 , db["small" + c].count() , "small" + c );
+}
+assert.eq( n , db.big.count() , "big" );
+var sum = 0;
+db.big.find().forEach(function(o) { sum += o.i; });
+assert.eq( n * (n - 1) / 2 , sum , "big contents" );
+assert.eq( 2 , db.big.getIndexes().length , "indexes" );
+
+// restoring without --drop adds to what's there, in batches that keep going past duplicates
+t.runTool( "restore" , "--dir" , t.ext , "-j" , "2" );
+assert.eq( n , db.big.count() , "no duplicates" );
+
+t.stop();
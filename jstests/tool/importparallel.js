@@ -0,0 +1,39 @@
+// importparallel.js
+
+t = new ToolTest( "importparallel" );
+
+c = t.startDB( "foo" );
+
+var n = 20000;
+for ( var i = 0; i < n; i++ ) {
+    c.insert( { _id : i , s : "row " + i + " with a \"quoted\" part" , x : i * 1.5 , big : 1e12 + i } );
+}
+assert.eq( n , c.count() , "setup" );
+
+t.runTool( "export" , "--out" , t.extFile , "-d" , t.baseName , "-c" , "foo" );
+
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--numParsers" , "4" );
+assert.eq( n , c.count() , "after import" );
+var sum = 0;
+c.find().forEach( function( o ) {
+    assert.eq( "row " + o._id + " with a \"quoted\" part" , o.s );
+    assert.eq( o._id * 1.5 , o.x );
+    assert.eq( 1e12 + o._id , o.big );
+    sum += o._id;
+} );
+assert.eq( n * ( n - 1 ) / 2 , sum , "contents" );
+
+// into an existing collection, the loader can't be used and several connections insert; the
+// duplicates are reported but don't fail the import
+c.remove( { _id : { $gte : n / 2 } } );
+assert.eq( 0 , t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" ,
+                          "--numParsers" , "3" , "--numInsertionWorkers" , "3" ) );
+assert.eq( n , c.count() , "after import into existing collection" );
+
+// upserts are still applied in input order
+c.drop();
+t.runTool( "import" , "--file" , t.extFile , "-d" , t.baseName , "-c" , "foo" , "--numParsers" , "4" , "--upsert" );
+assert.eq( n , c.count() , "after upsert" );
+
+t.stop();
@@ -63,3 +63,33 @@ function checkUpdate(initialDocs, query, updateobj, options) {
         }
     });
 });
+
+// Counter-style upserts by _id on a collection with no secondary indexes are sent blind, without
+// reading the document first.
+fastcoll.drop();
+nonfastcoll.drop();
+[ [ { _id: 0, c: 5 } ], [ { _id: 100 } ] ].forEach(function(initialDocs) {
+    checkUpdate(initialDocs, { _id: 0 }, { $inc: { c: 1 }, $setOnInsert: { created: true } }, { upsert: true });
+    checkUpdate(initialDocs, { _id: "s" }, { $set: { "a.b": 1 } }, { upsert: true });
+});
+if (!db.runCommand("isdbgrid").ok) {
+    fastcoll.drop();
+    var before = db.serverStatus().metrics.fastUpdates;
+    changeFastUpdates(true);
+    for (i = 0; i < 10; i++) {
+        fastcoll.update({ _id: i % 5 }, { $inc: { n: 1 } }, { upsert: true });
+    }
+    assert.eq(null, db.getLastError());
+    changeFastUpdates(false);
+    fastcoll.update({ _id: 7 }, { $inc: { n: 1 } }, { upsert: true });
+    var after = db.serverStatus().metrics.fastUpdates;
+    assert.eq(10, after.performed.upsert - before.performed.upsert);
+    assert.eq(1, after.eligible.upsert - before.eligible.upsert);
+    assert.eq(6, fastcoll.count());
+    assert.eq(5, fastcoll.count({ n: 2 }));
+
+    // Not eligible once there is a secondary index to maintain.
+    fastcoll.ensureIndex({ n: 1 });
+    fastcoll.update({ _id: 8 }, { $inc: { n: 1 } }, { upsert: true });
+    assert.eq(1, db.serverStatus().metrics.fastUpdates.eligible.upsert - before.eligible.upsert);
+}
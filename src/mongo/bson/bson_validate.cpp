@@ -15,7 +15,8 @@
  *    limitations under the License.
  */
 
-#include <deque>
+#include <cstring>
+#include <vector>
 
 #include "mongo/bson/bson_validate.h"
 #include "mongo/bson/oid.h"
@@ -127,7 +128,63 @@ namespace mongo {
             int _startPosition;
         };
 
-        Status validateElementInfo(Buffer* buffer, ValidationState::State* nextState) {
+        /**
+         * The frames of the objects being validated, innermost last.  Nearly every document is
+         * only a few levels deep, so the first frames live inline and validating doesn't have to
+         * allocate.
+         */
+        class ValidationFrameStack {
+        public:
+            ValidationFrameStack() : _size(0) {}
+
+            ValidationObjectFrame* push() {
+                if (_size < InlineFrames) {
+                    _inline[_size] = ValidationObjectFrame();
+                    return &_inline[_size++];
+                }
+                _overflow.push_back(ValidationObjectFrame());
+                _size++;
+                return &_overflow.back();
+            }
+
+            void pop() {
+                _size--;
+                if (_size >= InlineFrames) {
+                    _overflow.pop_back();
+                }
+            }
+
+            ValidationObjectFrame* back() {
+                return _size <= InlineFrames ? &_inline[_size - 1] : &_overflow.back();
+            }
+
+            bool empty() const { return _size == 0; }
+            size_t size() const { return _size; }
+
+        private:
+            enum { InlineFrames = 16 };
+            ValidationObjectFrame _inline[InlineFrames];
+            std::vector<ValidationObjectFrame> _overflow;
+            size_t _size;
+        };
+
+        /**
+         * Checks a top level field against the rules for inserted documents, which are
+         * otherwise checked by validateInsert with another walk over the object.
+         */
+        inline bool insertableField(char type, const StringData& name) {
+            if (name.size() > 0 && name[0] == '$') {
+                return false;
+            }
+            if (name.size() == 3 && memcmp(name.rawData(), "_id", 3) == 0) {
+                return type != Array && type != RegEx && type != Undefined;
+            }
+            return true;
+        }
+
+        // insertable, if not NULL, is cleared when a field breaks the insert rules.
+        Status validateElementInfo(Buffer* buffer, ValidationState::State* nextState,
+                                   bool* insertable) {
             Status status = Status::OK();
 
             char type;
@@ -144,6 +201,9 @@ namespace mongo {
             if ( !status.isOK() )
                 return status;
 
+            if ( insertable && !insertableField( type, name ) )
+                *insertable = false;
+
             switch ( type ) {
             case MinKey:
             case MaxKey:
@@ -221,16 +281,15 @@ namespace mongo {
             }
         }
 
-        Status validateBSONIterative(Buffer* buffer) {
-            std::deque<ValidationObjectFrame> frames;
+        Status validateBSONIterative(Buffer* buffer, bool* insertable) {
+            ValidationFrameStack frames;
             ValidationObjectFrame* curr = NULL;
             ValidationState::State state = ValidationState::BeginObj;
 
             while (state != ValidationState::Done) {
                 switch (state) {
                 case ValidationState::BeginObj:
-                    frames.push_back(ValidationObjectFrame());
-                    curr = &frames.back();
+                    curr = frames.push();
                     curr->setStartPosition(buffer->position());
                     curr->setIsCodeWithScope(false);
                     if (!buffer->readNumber<int>(&curr->expectedSize)) {
@@ -240,7 +299,9 @@ namespace mongo {
                     state = ValidationState::WithinObj;
                     // fall through
                 case ValidationState::WithinObj: {
-                    Status status = validateElementInfo(buffer, &state);
+                    // only the top level is subject to the insert rules
+                    Status status = validateElementInfo(buffer, &state,
+                                                        frames.size() == 1 ? insertable : NULL);
                     if (!status.isOK())
                         return status;
                     break;
@@ -251,12 +312,12 @@ namespace mongo {
                         return Status( ErrorCodes::InvalidBSON,
                                        "bson length doesn't match what we found" );
                     }
-                    frames.pop_back();
+                    frames.pop();
                     if (frames.empty()) {
                         state = ValidationState::Done;
                     }
                     else {
-                        curr = &frames.back();
+                        curr = frames.back();
                         if (curr->isCodeWithScope())
                             state = ValidationState::EndCodeWScope;
                         else
@@ -265,8 +326,7 @@ namespace mongo {
                     break;
                 }
                 case ValidationState::BeginCodeWScope: {
-                    frames.push_back(ValidationObjectFrame());
-                    curr = &frames.back();
+                    curr = frames.push();
                     curr->setStartPosition(buffer->position());
                     curr->setIsCodeWithScope(true);
                     if ( !buffer->readNumber<int>( &curr->expectedSize ) )
@@ -283,10 +343,10 @@ namespace mongo {
                         return Status( ErrorCodes::InvalidBSON,
                                        "bson length for CodeWScope doesn't match what we found" );
                     }
-                    frames.pop_back();
+                    frames.pop();
                     if (frames.empty())
                         return Status(ErrorCodes::InvalidBSON, "unnested CodeWScope");
-                    curr = &frames.back();
+                    curr = frames.back();
                     state = ValidationState::WithinObj;
                     break;
                 }
@@ -306,7 +366,18 @@ namespace mongo {
         }
 
         Buffer buf( originalBuffer, maxLength );
-        return validateBSONIterative( &buf );
+        return validateBSONIterative( &buf, NULL );
+    }
+
+    Status validateBSONForInsert( const char* originalBuffer, uint64_t maxLength,
+                                  bool* insertable ) {
+        if ( maxLength < 5 ) {
+            return Status( ErrorCodes::InvalidBSON, "bson data has to be at least 5 bytes" );
+        }
+
+        *insertable = true;
+        Buffer buf( originalBuffer, maxLength );
+        return validateBSONIterative( &buf, insertable );
     }
 
 }  // namespace mongo
@@ -31,5 +31,13 @@ namespace mongo {
      */
     Status validateBSON( const char* buf, uint64_t maxLength );
 
+    /**
+     * Like validateBSON, and in the same pass checks the top level fields against the rules for
+     * documents to be inserted: no field names starting with '$', and no array, regex or
+     * undefined _id.  Sets *insertable to whether they pass; it is only meaningful if the
+     * returned Status is OK.  The size limit is left to the caller.
+     */
+    Status validateBSONForInsert( const char* buf, uint64_t maxLength, bool* insertable );
+
 }
 
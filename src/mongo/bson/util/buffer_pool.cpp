@@ -0,0 +1,139 @@
+/* buffer_pool.cpp */
+
+/*    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#include "mongo/pch.h"
+
+#include "mongo/bson/util/buffer_pool.h"
+
+#include <string.h>
+
+#include "mongo/util/concurrency/threadlocal.h"
+
+namespace mongo {
+
+    TSP_DECLARE(BufferPool, threadBufferPool);
+    TSP_DEFINE(BufferPool, threadBufferPool);
+
+    // Upper bound on what a single thread may hold cached while an operation is running.
+    static const size_t maxCachedBytes = 16 * 1024 * 1024;
+
+    BufferPool::BufferPool() : _cachedBytes(0), _depth(0) {
+        for (int i = 0; i < NumBuckets; ++i) {
+            _buckets[i] = NULL;
+            _counts[i] = 0;
+        }
+    }
+
+    BufferPool::~BufferPool() {
+        trim(0);
+    }
+
+    void *BufferPool::allocate(size_t sz) {
+        _stats.allocs++;
+        int shift = MinShift;
+        while ((size_t(1) << shift) < sz) {
+            if (++shift > MaxShift) {
+                return malloc(sz);
+            }
+        }
+        const int b = shift - MinShift;
+        FreeBuf *f = _buckets[b];
+        if (f != NULL) {
+            _buckets[b] = f->next;
+            _counts[b]--;
+            _cachedBytes -= size_t(1) << shift;
+            _stats.reuses++;
+            return f;
+        }
+        return malloc(size_t(1) << shift);
+    }
+
+    void *BufferPool::reallocate(void *p, size_t oldSz, size_t newSz) {
+        void *n = allocate(newSz);
+        if (n != NULL && p != NULL) {
+            memcpy(n, p, oldSz < newSz ? oldSz : newSz);
+            release(p, oldSz);
+        }
+        return n;
+    }
+
+    void BufferPool::release(void *p, size_t sz) {
+        if (p == NULL) {
+            return;
+        }
+        // The buffer's true capacity is at least sz, so file it under the largest bucket that
+        // does not exceed sz.
+        if (sz < (size_t(1) << MinShift) || sz >= (size_t(1) << (MaxShift + 1))) {
+            free(p);
+            return;
+        }
+        int shift = MaxShift;
+        while ((size_t(1) << shift) > sz) {
+            shift--;
+        }
+        const int b = shift - MinShift;
+        const size_t bytes = size_t(1) << shift;
+        if (_counts[b] >= MaxCachedPerBucket || _cachedBytes + bytes > maxCachedBytes) {
+            free(p);
+            return;
+        }
+        FreeBuf *f = static_cast<FreeBuf *>(p);
+        f->next = _buckets[b];
+        _buckets[b] = f;
+        _counts[b]++;
+        _cachedBytes += bytes;
+    }
+
+    void BufferPool::trim(size_t maxBytes) {
+        for (int b = NumBuckets - 1; b >= 0 && _cachedBytes > maxBytes; --b) {
+            const size_t bytes = size_t(1) << (b + MinShift);
+            while (_buckets[b] != NULL && _cachedBytes > maxBytes) {
+                FreeBuf *f = _buckets[b];
+                _buckets[b] = f->next;
+                _counts[b]--;
+                _cachedBytes -= bytes;
+                free(f);
+            }
+        }
+    }
+
+    void BufferPool::reset() {
+        trim(RetainedBytes);
+    }
+
+    BufferPool *BufferPool::active() {
+        BufferPool *pool = threadBufferPool.get();
+        return (pool != NULL && pool->_depth > 0) ? pool : NULL;
+    }
+
+    BufferPool &BufferPool::forThread() {
+        return *threadBufferPool.getMake();
+    }
+
+    BufferPool::Scope::Scope() : _pool(forThread()) {
+        _pool._depth++;
+    }
+
+    BufferPool::Scope::~Scope() {
+        // Threads that never reach the end of a client operation (replication, background
+        // indexing) must not sit on a full cache between uses.
+        if (--_pool._depth == 0 && _pool._cachedBytes > RetainedBytes) {
+            _pool.trim(RetainedBytes);
+        }
+    }
+
+} // namespace mongo
@@ -0,0 +1,96 @@
+/* buffer_pool.h */
+
+/*    Copyright (C) 2014 Tokutek Inc.
+ *
+ *    Licensed under the Apache License, Version 2.0 (the "License");
+ *    you may not use this file except in compliance with the License.
+ *    You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ *    Unless required by applicable law or agreed to in writing, software
+ *    distributed under the License is distributed on an "AS IS" BASIS,
+ *    WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ *    See the License for the specific language governing permissions and
+ *    limitations under the License.
+ */
+
+#pragma once
+
+#include <stddef.h>
+#include <stdlib.h>
+
+namespace mongo {
+
+    /**
+     * BufferPool is a per-thread cache of malloc'd buffers that BufBuilder (through
+     * TrivialAllocator) draws from while a BufferPool::Scope is active on the current thread.
+     *
+     * Buffers are bucketed by power-of-two capacity.  Every buffer handed out is a plain malloc
+     * block, so a BufBuilder may still decouple() its buffer into a BSONObj or a Message, which
+     * will later free() it as usual; such buffers simply never come back to the pool.
+     *
+     * Hot paths that build many short-lived objects (key generation, projections, update mods,
+     * reply building) open a Scope; the server calls reset() once an operation completes, which
+     * trims what the thread keeps cached.  Outside any Scope, TrivialAllocator is just malloc.
+     */
+    class BufferPool {
+    public:
+        struct Stats {
+            Stats() : allocs(0), reuses(0) {}
+            long long allocs;   // allocations served while a Scope was active
+            long long reuses;   // ... of which were satisfied from the cache
+        };
+
+        BufferPool();
+        ~BufferPool();
+
+        void *allocate(size_t sz);
+        void *reallocate(void *p, size_t oldSz, size_t newSz);
+        void release(void *p, size_t sz);
+
+        /** Frees cached buffers beyond what we retain between operations. */
+        void reset();
+
+        const Stats &stats() const { return _stats; }
+
+        /** @return the pool for this thread if a Scope is active, otherwise NULL. */
+        static BufferPool *active();
+
+        /** @return the pool for this thread, creating it if necessary. */
+        static BufferPool &forThread();
+
+        /** Routes BufBuilder allocations on this thread through its pool while in scope. */
+        class Scope {
+        public:
+            Scope();
+            ~Scope();
+        private:
+            Scope(const Scope &);
+            Scope &operator=(const Scope &);
+            BufferPool &_pool;
+        };
+
+    private:
+        BufferPool(const BufferPool &);
+        BufferPool &operator=(const BufferPool &);
+
+        struct FreeBuf {
+            FreeBuf *next;
+        };
+
+        // Buckets hold buffers of capacity 2^(MinShift + i).  Anything bigger bypasses the pool.
+        enum { MinShift = 6, MaxShift = 20, NumBuckets = MaxShift - MinShift + 1 };
+        // Per-bucket and total bounds on what a thread may keep cached.
+        enum { MaxCachedPerBucket = 64, RetainedBytes = 1024 * 1024 };
+
+        void trim(size_t maxBytes);
+
+        FreeBuf *_buckets[NumBuckets];
+        int _counts[NumBuckets];
+        size_t _cachedBytes;
+        int _depth;
+        Stats _stats;
+    };
+
+} // namespace mongo
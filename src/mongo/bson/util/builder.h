@@ -26,6 +26,7 @@
 #include <string.h>
 
 #include "mongo/bson/inline_decls.h"
+#include "mongo/bson/util/buffer_pool.h"
 #include "mongo/base/string_data.h"
 #include "mongo/util/assert_util.h"
 
@@ -63,11 +64,24 @@ namespace mongo {
     template <typename Allocator>
     class StringBuilderImpl;
 
+    /** Plain malloc, except while a BufferPool::Scope is active on this thread. */
     class TrivialAllocator { 
     public:
-        void* Malloc(size_t sz) { return malloc(sz); }
-        void* Realloc(void *p, size_t sz) { return realloc(p, sz); }
-        void Free(void *p) { free(p); }
+        void* Malloc(size_t sz) {
+            BufferPool *pool = BufferPool::active();
+            return pool ? pool->allocate(sz) : malloc(sz);
+        }
+        void* Realloc(void *p, size_t oldSz, size_t sz) {
+            BufferPool *pool = BufferPool::active();
+            return pool ? pool->reallocate(p, oldSz, sz) : realloc(p, sz);
+        }
+        void Free(void *p, size_t sz) {
+            BufferPool *pool = BufferPool::active();
+            if ( pool )
+                pool->release(p, sz);
+            else
+                free(p);
+        }
     };
 
     class StackAllocator {
@@ -77,7 +91,7 @@ namespace mongo {
             if( sz <= SZ ) return buf;
             return malloc(sz); 
         }
-        void* Realloc(void *p, size_t sz) { 
+        void* Realloc(void *p, size_t oldSz, size_t sz) { 
             if( p == buf ) {
                 if( sz <= SZ ) return buf;
                 void *d = malloc(sz);
@@ -88,7 +102,7 @@ namespace mongo {
             }
             return realloc(p, sz); 
         }
-        void Free(void *p) { 
+        void Free(void *p, size_t sz) { 
             if( p != buf )
                 free(p); 
         }
@@ -118,7 +132,7 @@ namespace mongo {
 
         void kill() {
             if ( data ) {
-                al.Free(data);
+                al.Free(data, size);
                 data = 0;
             }
         }
@@ -129,7 +143,7 @@ namespace mongo {
         void reset( int maxSize ) {
             l = 0;
             if ( maxSize && size > maxSize ) {
-                al.Free(data);
+                al.Free(data, size);
                 data = (char*)al.Malloc(maxSize);
                 if ( data == 0 )
                     msgasserted( 15913 , "out of memory BufBuilder::reset" );
@@ -227,7 +241,7 @@ namespace mongo {
                 ss << "BufBuilder attempted to grow() to " << a << " bytes, past the 64MB limit.";
                 msgasserted(13548, ss.str().c_str());
             }
-            data = (char *) al.Realloc(data, a);
+            data = (char *) al.Realloc(data, size, a);
             if ( data == NULL )
                 msgasserted( 16070 , "out of memory BufBuilder::grow_reallocate" );
             size = a;
@@ -31,4 +31,51 @@ namespace mongo {
         ASSERT_EQUALS( 0, strcmp( bb.buf(), "eliot" ) );
         ASSERT_EQUALS( 0, strcmp( "eliot", bb.buf() ) );
     }
+
+    TEST( BufferPool, ReusesFreedBuffers ) {
+        BufferPool::Scope scope;
+        const BufferPool::Stats before = BufferPool::forThread().stats();
+        const char *first;
+        {
+            BufBuilder bb( 128 );
+            bb.appendStr( "eliot" );
+            first = bb.buf();
+        }
+        {
+            BufBuilder bb( 128 );
+            ASSERT_EQUALS( first, bb.buf() );
+        }
+        const BufferPool::Stats &after = BufferPool::forThread().stats();
+        ASSERT_EQUALS( 2, after.allocs - before.allocs );
+        ASSERT_EQUALS( 1, after.reuses - before.reuses );
+    }
+
+    TEST( BufferPool, GrowAndDecouple ) {
+        char *data;
+        {
+            BufferPool::Scope scope;
+            BufBuilder bb( 64 );
+            for ( int i = 0; i < 1000; i++ ) {
+                bb.appendNum( i );
+            }
+            ASSERT_EQUALS( 4000, bb.len() );
+            for ( int i = 0; i < 1000; i++ ) {
+                ASSERT_EQUALS( i, reinterpret_cast<int *>( bb.buf() )[i] );
+            }
+            data = bb.buf();
+            bb.decouple();
+        }
+        // decoupled buffers are plain malloc blocks
+        free( data );
+        BufferPool::forThread().reset();
+    }
+
+    TEST( BufferPool, InactiveOutsideScope ) {
+        ASSERT( BufferPool::active() == NULL );
+        {
+            BufferPool::Scope scope;
+            ASSERT( BufferPool::active() == &BufferPool::forThread() );
+        }
+        ASSERT( BufferPool::active() == NULL );
+    }
 }
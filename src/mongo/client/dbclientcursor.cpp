@@ -26,13 +26,118 @@
 #include "mongo/db/namespacestring.h"
 #include "mongo/s/shard.h"
 #include "mongo/s/stale_exception.h"  // for RecvStaleConfigException
+#include "mongo/util/concurrency/thread_pool.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
     void assembleRequest( const string &ns, BSONObj query, int nToReturn, int nToSkip, const BSONObj *fieldsToReturn, int queryOptions, Message &toSend );
 
+    static void assembleGetMore( const string &ns, int opts, int nToReturn, long long cursorId, Message &toSend ) {
+        BufBuilder b;
+        b.appendNum( opts );
+        b.appendStr( ns );
+        b.appendNum( nToReturn );
+        b.appendNum( cursorId );
+        toSend.setData( dbGetMore, b.buf(), b.len() );
+    }
+
+    /**
+     * A getMore sent ahead of time by a pool thread.  Shared between the cursor and the pool
+     * thread so that either may finish with it first.
+     */
+    class DBClientCursor::Prefetch : boost::noncopyable {
+    public:
+        Prefetch( const string &host, const string &ns, int opts, int nToReturn, long long cursorId ) :
+            _host( host ), _ns( ns ), _opts( opts ), _nToReturn( nToReturn ), _cursorId( cursorId ),
+            _m( "DBClientCursor::Prefetch" ), _state( Queued ), _errcode( 0 ) {
+        }
+
+        static void run( shared_ptr<Prefetch> p ) { p->_run(); }
+
+        /**
+         * Blocks until the getMore completes.
+         * @return the reply, or NULL if no thread had picked the prefetch up yet, in which case it
+         *         is cancelled and the caller should issue the getMore itself.
+         */
+        auto_ptr<Message> wait() {
+            scoped_lock lk( _m );
+            if ( _state == Queued ) {
+                _state = Cancelled;
+                return auto_ptr<Message>();
+            }
+            while ( _state != Done ) {
+                _cv.wait( lk.boost() );
+            }
+            if ( _errcode ) {
+                uasserted( _errcode, _errmsg );
+            }
+            return _response;
+        }
+
+    private:
+        void _run() {
+            {
+                scoped_lock lk( _m );
+                if ( _state == Cancelled ) {
+                    return;
+                }
+                _state = Running;
+            }
+
+            auto_ptr<Message> response( new Message() );
+            int errcode = 0;
+            string errmsg;
+            try {
+                Message toSend;
+                assembleGetMore( _ns, _opts, _nToReturn, _cursorId, toSend );
+                scoped_ptr<ScopedDbConnection> conn(
+                        ScopedDbConnection::getScopedDbConnection( _host ) );
+                conn->get()->call( toSend, *response );
+                conn->done();
+            }
+            catch ( DBException &e ) {
+                errcode = e.getCode() ? e.getCode() : 17365;
+                errmsg = str::stream() << "prefetching getMore from " << _host << " failed: " << e.what();
+            }
+
+            scoped_lock lk( _m );
+            _response = response;
+            _errcode = errcode;
+            _errmsg = errmsg;
+            _state = Done;
+            _cv.notify_all();
+        }
+
+        const string _host;
+        const string _ns;
+        const int _opts;
+        const int _nToReturn;
+        const long long _cursorId;
+
+        mongo::mutex _m;
+        boost::condition _cv;
+        enum { Queued, Cancelled, Running, Done } _state;
+        auto_ptr<Message> _response;
+        int _errcode;
+        string _errmsg;
+    };
+
+    static mongo::mutex prefetchPoolMutex( "DBClientCursor prefetch pool" );
+    static ThreadPool *prefetchPool = NULL;
+
+    static ThreadPool &getPrefetchPool() {
+        scoped_lock lk( prefetchPoolMutex );
+        if ( prefetchPool == NULL ) {
+            prefetchPool = new ThreadPool( 16 );
+        }
+        return *prefetchPool;
+    }
+
     void DBClientCursor::_finishConsInit() {
         _originalHost = _client->toString();
+        _waitMicros = 0;
+        _prefetchedBatches = 0;
     }
 
     int DBClientCursor::nextBatchSize() {
@@ -51,12 +156,7 @@ namespace mongo {
             assembleRequest( ns, query, nextBatchSize() , nToSkip, fieldsToReturn, opts, toSend );
         }
         else {
-            BufBuilder b;
-            b.appendNum( opts );
-            b.appendStr( ns );
-            b.appendNum( nToReturn );
-            b.appendNum( cursorId );
-            toSend.setData( dbGetMore, b.buf(), b.len() );
+            assembleGetMore( ns, opts, nToReturn, cursorId, toSend );
         }
     }
 
@@ -87,7 +187,9 @@ namespace mongo {
 
     bool DBClientCursor::initLazyFinish( bool& retry ) {
 
+        Timer t;
         bool recvd = _client->recv( *batch.m );
+        _waitMicros += t.micros();
 
         // If we get a bad response, return false
         if ( ! recvd || batch.m->empty() ) {
@@ -117,21 +219,45 @@ namespace mongo {
         return ok;
     }
 
+    void DBClientCursor::prefetchMore() {
+        if ( _prefetch || !cursorId || _client || _scopedHost.empty() || haveLimit ||
+             ( opts & ( QueryOption_CursorTailable | QueryOption_Exhaust ) ) ) {
+            return;
+        }
+        _prefetch.reset( new Prefetch( _scopedHost, ns, opts, nextBatchSize(), cursorId ) );
+        getPrefetchPool().schedule( &Prefetch::run, _prefetch );
+    }
+
     void DBClientCursor::requestMore() {
         verify( cursorId && batch.pos == batch.nReturned );
 
+        Timer t;
+        if ( _prefetch ) {
+            shared_ptr<Prefetch> prefetch;
+            prefetch.swap( _prefetch );
+            auto_ptr<Message> response = prefetch->wait();
+            if ( response.get() ) {
+                _prefetchedBatches++;
+                this->batch.m = response;
+                dataReceived();
+                _waitMicros += t.micros();
+                return;
+            }
+        }
+
+        if ( opts & QueryOption_Exhaust ) {
+            // the server sends the next batch without being asked
+            exhaustReceiveMore();
+            _waitMicros += t.micros();
+            return;
+        }
+
         if (haveLimit) {
             nToReturn -= batch.nReturned;
             verify(nToReturn > 0);
         }
-        BufBuilder b;
-        b.appendNum(opts);
-        b.appendStr(ns);
-        b.appendNum(nextBatchSize());
-        b.appendNum(cursorId);
-
         Message toSend;
-        toSend.setData(dbGetMore, b.buf(), b.len());
+        assembleGetMore(ns, opts, nextBatchSize(), cursorId, toSend);
         auto_ptr<Message> response(new Message());
 
         if ( _client ) {
@@ -150,6 +276,7 @@ namespace mongo {
             _client = 0;
             conn->done();
         }
+        _waitMicros += t.micros();
     }
 
     /** with QueryOption_Exhaust, the server just blasts data at us (marked at end with cursorid==0). */
@@ -321,6 +448,12 @@ namespace mongo {
 
         DESTRUCTOR_GUARD (
 
+        if ( _prefetch ) {
+            // Let an in-flight getMore finish before we kill the cursor out from under it.
+            _prefetch->wait();
+            _prefetch.reset();
+        }
+
         if ( cursorId && _ownCursor && ! inShutdown() ) {
             BufBuilder b;
             b.appendNum( (int)0 ); // reserved
@@ -55,6 +55,8 @@ namespace mongo {
             then perhaps stop.
         */
         int objsLeftInBatch() const { _assertIfNull(); return _putBack.size() + batch.nReturned - batch.pos; }
+        /** @return the number of objects in the last batch received from the server. */
+        int objsInBatch() const { _assertIfNull(); return batch.nReturned; }
         bool moreInCurrentBatch() { return objsLeftInBatch() > 0; }
 
         /** next
@@ -202,6 +204,23 @@ namespace mongo {
         void initLazy( bool isRetry = false );
         bool initLazyFinish( bool& retry );
 
+        /**
+         * Issue the getMore for the next batch now, from a background thread and on a pooled
+         * connection of its own, so that it is ready by the time the current batch is consumed.
+         * A no-op unless the cursor has been attach()ed, is not tailable/exhaust, has no limit,
+         * and has no prefetch already outstanding.
+         */
+        void prefetchMore();
+
+        /** @return true if a background getMore is outstanding or its reply is waiting. */
+        bool prefetching() const { return _prefetch.get() != NULL; }
+
+        /** @return microseconds spent blocked waiting for replies from the server. */
+        long long waitMicros() const { return _waitMicros; }
+
+        /** @return number of batches that were fetched ahead of time by prefetchMore(). */
+        int prefetchedBatches() const { return _prefetchedBatches; }
+
         class Batch : boost::noncopyable { 
             friend class DBClientCursor;
             auto_ptr<Message> m;
@@ -241,6 +260,8 @@ namespace mongo {
         friend class DBClientBase;
         friend class DBClientConnection;
 
+        class Prefetch;
+
         int nextBatchSize();
         void _finishConsInit();
         
@@ -262,6 +283,9 @@ namespace mongo {
         string _scopedHost;
         string _lazyHost;
         bool wasError;
+        shared_ptr<Prefetch> _prefetch;
+        long long _waitMicros;
+        int _prefetchedBatches;
 
         void dataReceived() { bool retry; string lazyHost; dataReceived( retry, lazyHost ); }
         void dataReceived( bool& retry, string& lazyHost );
@@ -76,6 +76,7 @@
 
 #include "../util/text.cpp"
 #include "../bson/oid.cpp"
+#include "../bson/util/buffer_pool.cpp"
 #include "../db/lasterror.cpp"
 #include "../db/json.cpp"
 #include "../db/jsobj.cpp"
@@ -294,6 +294,20 @@ namespace mongo {
         b.append( "numQueries" , (int)numExplains );
         b.append( "numShards" , (int)out.size() );
 
+        {
+            // Time spent blocked on each shard, including the initial query.
+            BSONObjBuilder waits( b.subobjStart( "shardWaits" ) );
+            for( map< Shard, PCMData >::iterator i = _cursorMap.begin(), end = _cursorMap.end(); i != end; ++i ){
+                DBClientCursorPtr cursor = i->second.pcState ? i->second.pcState->cursor : DBClientCursorPtr();
+                if( ! cursor ) continue;
+                BSONObjBuilder w( waits.subobjStart( i->first.getAddress().toString() ) );
+                w.appendNumber( "waitMicros" , cursor->waitMicros() );
+                w.append( "prefetchedBatches" , cursor->prefetchedBatches() );
+                w.done();
+            }
+            waits.done();
+        }
+
         if ( out.size() == 1 ) {
             b.append( "indexBounds" , indexBounds );
             if ( ! oldPlan.isEmpty() ) {
@@ -310,15 +324,15 @@ namespace mongo {
 
     // --------  FilteringClientCursor -----------
     FilteringClientCursor::FilteringClientCursor( const BSONObj filter )
-        : _matcher( filter ) , _pcmData( NULL ), _done( true ) {
+        : _matcher( filter ) , _pcmData( NULL ), _done( true ), _prefetch( false ) {
     }
 
     FilteringClientCursor::FilteringClientCursor( auto_ptr<DBClientCursor> cursor , const BSONObj filter )
-        : _matcher( filter ) , _cursor( cursor ) , _pcmData( NULL ), _done( cursor.get() == 0 ) {
+        : _matcher( filter ) , _cursor( cursor ) , _pcmData( NULL ), _done( cursor.get() == 0 ), _prefetch( false ) {
     }
 
     FilteringClientCursor::FilteringClientCursor( DBClientCursor* cursor , const BSONObj filter )
-        : _matcher( filter ) , _cursor( cursor ) , _pcmData( NULL ), _done( cursor == 0 ) {
+        : _matcher( filter ) , _cursor( cursor ) , _pcmData( NULL ), _done( cursor == 0 ), _prefetch( false ) {
     }
 
 
@@ -376,6 +390,10 @@ namespace mongo {
 
         while ( _cursor->more() ) {
             _next = _cursor->next();
+            if ( _prefetch && _cursor->objsLeftInBatch() * 4 <= _cursor->objsInBatch() ) {
+                // Less than a quarter of the batch left, get the next one on its way.
+                _cursor->prefetchMore();
+            }
             if ( _matcher.matches( _next ) ) {
                 if ( ! _cursor->moreInCurrentBatch() )
                     _next = _next.getOwned();
@@ -478,6 +496,7 @@ namespace mongo {
         _numServers = _servers.size();
         _lastFrom = 0;
         _cursors = 0;
+        _mergeHeapInit = false;
 
         if( ! _qSpec.isEmpty() ){
 
@@ -1262,6 +1281,7 @@ namespace mongo {
             PCMData& mdata = i->second;
 
             _cursors[ index ].reset( mdata.pcState->cursor.get(), &mdata );
+            _cursors[ index ].enablePrefetch();
             _servers.insert( ServerAndQuery( i->first.getConnString(), BSONObj() ) );
 
             index++;
@@ -1606,7 +1626,49 @@ namespace mongo {
         return false;
     }
 
+    void ParallelSortClusteredCursor::_initMergeHeap() {
+        _mergeHeap.clear();
+        for ( int i = 0; i < _numServers; i++ ) {
+            if ( _cursors[i].more() )
+                _mergeHeap.push_back( i );
+            else if ( _cursors[i].rawMData() )
+                _cursors[i].rawMData()->pcState->done = true;
+        }
+        make_heap( _mergeHeap.begin(), _mergeHeap.end(), MergeHeapCmp( *this ) );
+        _mergeHeapInit = true;
+    }
+
     BSONObj ParallelSortClusteredCursor::next() {
+        if ( ! _sortKey.isEmpty() ) {
+            // Sorted merge: keep the servers in a heap ordered by their next object, rather than
+            // comparing every server's next object on every call.
+            if ( ! _mergeHeapInit )
+                _initMergeHeap();
+
+            uassert( 17366 , "no more elements" , ! _mergeHeap.empty() );
+
+            MergeHeapCmp cmp( *this );
+            pop_heap( _mergeHeap.begin(), _mergeHeap.end(), cmp );
+            const int from = _mergeHeap.back();
+
+            BSONObj best = _cursors[from].next();
+            _lastFrom = from;
+
+            if( _cursors[from].rawMData() )
+                _cursors[from].rawMData()->pcState->count++;
+
+            if ( _cursors[from].more() ) {
+                push_heap( _mergeHeap.begin(), _mergeHeap.end(), cmp );
+            }
+            else {
+                _mergeHeap.pop_back();
+                if( _cursors[from].rawMData() )
+                    _cursors[from].rawMData()->pcState->done = true;
+            }
+
+            return best;
+        }
+
         BSONObj best = BSONObj();
         int bestFrom = -1;
 
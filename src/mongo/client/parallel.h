@@ -142,6 +142,12 @@ namespace mongo {
         DBClientCursor* raw() { return _cursor.get(); }
         ParallelConnectionMetadata* rawMData(){ return _pcmData; }
 
+        /**
+         * Have the underlying cursor fetch its next batch in the background once the current one
+         * is mostly consumed, rather than on demand.
+         */
+        void enablePrefetch() { _prefetch = true; }
+
         // Required for new PCursor
         void release(){
             _cursor.release();
@@ -157,6 +163,7 @@ namespace mongo {
 
         BSONObj _next;
         bool _done;
+        bool _prefetch;
     };
 
 
@@ -371,6 +378,16 @@ namespace mongo {
         virtual void _explain( map< string,list<BSONObj> >& out );
 
         void _markStaleNS( const NamespaceString& staleNS, const StaleConfigException& e, bool& forceReload, bool& fullReload );
+
+        /** Orders _mergeHeap so that the front is the server with the least next object. */
+        struct MergeHeapCmp {
+            MergeHeapCmp( ParallelSortClusteredCursor &c ) : _c( c ) {}
+            bool operator()( int a, int b ) const {
+                return _c._cursors[a].peek().woSortOrder( _c._cursors[b].peek(), _c._sortKey, true ) > 0;
+            }
+            ParallelSortClusteredCursor &_c;
+        };
+        void _initMergeHeap();
         void _handleStaleNS( const NamespaceString& staleNS, bool forceReload, bool fullReload );
 
         set<Shard> _qShards;
@@ -392,6 +409,10 @@ namespace mongo {
         FilteringClientCursor * _cursors;
         int _needToSkip;
 
+        // Servers that still have results, as a heap; only used for sorted merges.
+        vector<int> _mergeHeap;
+        bool _mergeHeapInit;
+
     private:
         /**
          * Setups the shard version of the connection. When using a replica
@@ -85,6 +85,8 @@ namespace mongo {
             @return true -- iff the abort was successful
          */
         bool abort(BSONObj *res = NULL);
+        /** @return true -- iff beginLoad succeeded, false if this fell back to normal inserts */
+        bool usingLoader() const { return _usingLoader; }
     };
 
 } // namespace mongo
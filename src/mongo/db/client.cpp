@@ -482,6 +482,8 @@ namespace mongo {
         fastmodinsert = false;
         upsert = false;
         keyUpdates = 0;  // unsigned, so -1 not possible
+        bufAllocs = -1;
+        bufReuses = -1;
         
         exceptionInfo.reset();
         lockNotGrantedInfo = BSONObj();
@@ -542,6 +544,8 @@ namespace mongo {
         OPDEBUG_TOSTRING_HELP_BOOL( fastmodinsert );
         OPDEBUG_TOSTRING_HELP_BOOL( upsert );
         OPDEBUG_TOSTRING_HELP( keyUpdates );
+        OPDEBUG_TOSTRING_HELP( bufAllocs );
+        OPDEBUG_TOSTRING_HELP( bufReuses );
         
         if ( extra.len() )
             s << " " << extra.str();
@@ -610,6 +614,8 @@ namespace mongo {
         OPDEBUG_APPEND_BOOL( fastmodinsert );
         OPDEBUG_APPEND_BOOL( upsert );
         OPDEBUG_APPEND_NUMBER( keyUpdates );
+        OPDEBUG_APPEND_NUMBER( bufAllocs );
+        OPDEBUG_APPEND_NUMBER( bufReuses );
 
         b.append( "lockStats" , curop.lockStat().report() );
         
@@ -27,6 +27,8 @@
 
 #include "mongo/db/clientcursor.h"
 
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
 #include <string>
 #include <time.h>
 #include <vector>
@@ -58,10 +60,17 @@
 
 namespace mongo {
 
-    CCById ClientCursor::clientCursorsById;
-    boost::recursive_mutex& ClientCursor::ccmutex( *(new boost::recursive_mutex()) );
+    ClientCursor::Partition ClientCursor::partitions[ClientCursor::NumPartitions];
+    AtomicUInt32 ClientCursor::numOpen;
     long long ClientCursor::numberTimedOut = 0;
 
+    // Cursors unlinked from their partition that are not destroyed yet.  Counted up under the
+    // cursor's partition lock, so once a thread holds every partition lock and sees zero, no
+    // cursor is left anywhere.
+    static boost::mutex pendingDestroysMutex;
+    static boost::condition_variable pendingDestroysDone;
+    static int pendingDestroys = 0;
+
     void ClientCursor::invalidateAllCursors() {
         verify(Lock::isW());
         for( LockedIterator i; i.ok(); ) {
@@ -136,7 +145,7 @@ namespace mongo {
         return Status::OK();
     }
 
-    /* note called outside of locks (other than ccmutex) so care must be exercised */
+    /* note called outside of locks (other than the cursor's partition lock) so care must be exercised */
     bool ClientCursor::shouldTimeout( unsigned millis ) {
         _idleAgeMillis += millis;
         dassert(idleAgeTimeoutMillis > 0);
@@ -149,35 +158,89 @@ namespace mongo {
 
     /* called every 4 seconds.  millis is amount of idle time passed since the last call -- could be zero */
     void ClientCursor::idleTimeReport(unsigned millis) {
-        LockedIterator i;
-        unsigned sz = clientCursorsById.size();
+        unsigned sz = numCursors();
         if (sz >= 100000) { 
             RATELIMITED(300000) log() << "warning number of open cursors is very large: " << sz << endl;
         }
-        while (i.ok()) {
-            ClientCursor *cc = i.current();
-            if (cc->shouldTimeout(millis)) {
-                LOG(1) << "killing old cursor " << cc->_cursorid << ' ' << cc->_ns
-                       << " idle:" << cc->idleTime() << "ms" << endl;
-                i.deleteAndAdvance();
-            } else {
-                i.advance();
+        // Sweep one partition at a time so getMores elsewhere are not held up, and destroy the
+        // timed out cursors once the partition lock is released.
+        vector<ClientCursor *> timedOut;
+        for (int p = 0; p < NumPartitions; p++) {
+            {
+                recursive_scoped_lock lock(partitions[p].mutex);
+                CCById &cursors = partitions[p].cursors;
+                for (CCById::iterator i = cursors.begin(); i != cursors.end(); ) {
+                    ClientCursor *cc = i->second;
+                    ++i;
+                    if (cc->shouldTimeout(millis)) {
+                        LOG(1) << "killing old cursor " << cc->_cursorid << ' ' << cc->_ns
+                               << " idle:" << cc->idleTime() << "ms" << endl;
+                        _unlink_inlock(cc);
+                        timedOut.push_back(cc);
+                    }
+                }
+            }
+            for (vector<ClientCursor *>::iterator i = timedOut.begin(); i != timedOut.end(); ++i) {
+                _destroyUnlinked(*i);
+            }
+            timedOut.clear();
+        }
+    }
+
+    ClientCursor::LockedIterator::LockedIterator() : _p(0) {
+        while (1) {
+            for (int p = 0; p < NumPartitions; p++) {
+                partitions[p].mutex.lock();
+            }
+            boost::unique_lock<boost::mutex> lk(pendingDestroysMutex);
+            if (pendingDestroys == 0) {
+                break;
+            }
+            // A destroy in progress may need a partition lock to finish, so wait without them.
+            for (int p = NumPartitions - 1; p >= 0; p--) {
+                partitions[p].mutex.unlock();
+            }
+            while (pendingDestroys > 0) {
+                pendingDestroysDone.wait(lk);
             }
         }
+        _i = partitions[0].cursors.begin();
+        skipEmpty();
+    }
+
+    ClientCursor::LockedIterator::~LockedIterator() {
+        for (int p = NumPartitions - 1; p >= 0; p--) {
+            partitions[p].mutex.unlock();
+        }
+    }
+
+    void ClientCursor::LockedIterator::skipEmpty() {
+        while (_i == partitions[_p].cursors.end()) {
+            if (++_p == NumPartitions) {
+                return;
+            }
+            _i = partitions[_p].cursors.begin();
+        }
     }
 
     void ClientCursor::LockedIterator::deleteAndAdvance() {
         ClientCursor *cc = current();
         CursorId id = cc->cursorid();
         delete cc;
-        _i = clientCursorsById.upper_bound( id );
+        _i = partitions[_p].cursors.upper_bound( id );
+        skipEmpty();
     }
 
     void ClientCursor::initCursorID() {
-        {
-            recursive_scoped_lock lock(ccmutex);
-            _cursorid = allocCursorId_inlock();
-            clientCursorsById.insert( make_pair(_cursorid, this) );
+        while (1) {
+            CursorId id = allocCursorId();
+            Partition &p = partitionFor(id);
+            recursive_scoped_lock lock(p.mutex);
+            if (p.cursors.insert( make_pair(id, this) ).second) {
+                _cursorid = id;
+                numOpen.fetchAndAdd(1);
+                break;
+            }
         }
         
         if (_partOfMultiStatementTxn) {
@@ -233,9 +296,15 @@ namespace mongo {
         }
 
         if (_cursorid != INVALID_CURSOR_ID) {
-            recursive_scoped_lock lock(ccmutex);
-
-            clientCursorsById.erase(_cursorid);
+            Partition &p = partitionFor(_cursorid);
+            recursive_scoped_lock lock(p.mutex);
+
+            // Already unlinked if we were erased or timed out.
+            CCById::iterator it = p.cursors.find(_cursorid);
+            if (it != p.cursors.end() && it->second == this) {
+                p.cursors.erase(it);
+                numOpen.fetchAndSubtract(1);
+            }
 
             // defensive:
             _cursorid = INVALID_CURSOR_ID;
@@ -326,7 +395,8 @@ namespace mongo {
     void ClientCursor::fillQueryResultFromObj( BufBuilder &b, const MatchDetails* details ) const {
         const Projection::KeyOnly *keyFieldsOnly = c()->keyFieldsOnly();
         if ( keyFieldsOnly ) {
-            mongo::fillQueryResultFromObj( b, 0, keyFieldsOnly->hydrate( c()->currKey(), c()->currPK() ), details );
+            mongo::fillQueryResultFromObj( b, 0, keyFieldsOnly->hydrate( c()->currKey(), c()->currPK(),
+                                                                            c()->currClusteringFields() ), details );
         }
         else {
             mongo::fillQueryResultFromObj( b, fields.get(), c()->current(), details );
@@ -334,13 +404,14 @@ namespace mongo {
     }
 
     namespace {
-        // so we don't have to do find() which is a little slow very often.
-        long long cursorGenTSLast = 0;
+        SimpleMutex cursorGenMutex("cursorGen");
         PseudoRandom* cursorGenRandom = NULL;
     }
 
-    long long ClientCursor::allocCursorId_inlock() {
+    long long ClientCursor::allocCursorId() {
         // It is important that cursor IDs not be reused within a short period of time.
+        // initCursorID() retries if the id happens to be in use.
+        SimpleMutex::scoped_lock lk(cursorGenMutex);
 
         if ( ! cursorGenRandom ) {
             scoped_ptr<SecureRandom> sr( SecureRandom::create() );
@@ -361,12 +432,9 @@ namespace mongo {
             if ( x < 0 )
                 x *= -1;
 
-            if ( ts != cursorGenTSLast || ClientCursor::find_inlock(x, false) == 0 )
-                break;
+            break;
         }
 
-        cursorGenTSLast = ts;
-
         return x;
     }
 
@@ -387,19 +455,24 @@ namespace mongo {
     }
 
     void ClientCursor::appendStats( BSONObjBuilder& result ) {
-        recursive_scoped_lock lock(ccmutex);
-        result.appendNumber("totalOpen", clientCursorsById.size() );
-        result.appendNumber("clientCursors_size", (int) numCursors());
-        result.appendNumber("timedOut" , numberTimedOut);
+        size_t open = 0;
         unsigned pinned = 0;
         unsigned notimeout = 0;
-        for ( CCById::iterator i = clientCursorsById.begin(); i != clientCursorsById.end(); i++ ) {
-            unsigned p = i->second->_pinValue;
-            if( p >= 100 )
-                pinned++;
-            else if( p > 0 )
-                notimeout++;
+        for ( int p = 0; p < NumPartitions; p++ ) {
+            recursive_scoped_lock lock(partitions[p].mutex);
+            const CCById &cursors = partitions[p].cursors;
+            open += cursors.size();
+            for ( CCById::const_iterator i = cursors.begin(); i != cursors.end(); i++ ) {
+                unsigned pv = i->second->_pinValue;
+                if( pv >= 100 )
+                    pinned++;
+                else if( pv > 0 )
+                    notimeout++;
+            }
         }
+        result.appendNumber("totalOpen", open );
+        result.appendNumber("clientCursors_size", (int) numCursors());
+        result.appendNumber("timedOut" , numberTimedOut);
         if( pinned ) 
             result.append("pinned", pinned);
         if( notimeout )
@@ -455,38 +528,55 @@ namespace mongo {
     }
 
     void ClientCursor::find( const string& ns , set<CursorId>& all ) {
-        recursive_scoped_lock lock(ccmutex);
-
-        for ( CCById::iterator i=clientCursorsById.begin(); i!=clientCursorsById.end(); ++i ) {
-            if ( i->second->_ns == ns )
-                all.insert( i->first );
+        for ( int p = 0; p < NumPartitions; p++ ) {
+            recursive_scoped_lock lock(partitions[p].mutex);
+            const CCById &cursors = partitions[p].cursors;
+            for ( CCById::const_iterator i=cursors.begin(); i!=cursors.end(); ++i ) {
+                if ( i->second->_ns == ns )
+                    all.insert( i->first );
+            }
         }
     }
 
-    bool ClientCursor::_erase_inlock(ClientCursor* cursor) {
+    void ClientCursor::_unlink_inlock(ClientCursor* cursor) {
         // Must not have an active ClientCursor::Pin.
         massert( 16089,
                 str::stream() << "Cannot kill active cursor " << cursor->cursorid(),
                 cursor->_pinValue < 100 );
 
+        partitionFor(cursor->_cursorid).cursors.erase(cursor->_cursorid);
+        numOpen.fetchAndSubtract(1);
+        boost::unique_lock<boost::mutex> lk(pendingDestroysMutex);
+        pendingDestroys++;
+    }
+
+    void ClientCursor::_destroyUnlinked(ClientCursor* cursor) {
         delete cursor;
-        return true;
+        boost::unique_lock<boost::mutex> lk(pendingDestroysMutex);
+        if (--pendingDestroys == 0) {
+            pendingDestroysDone.notify_all();
+        }
     }
 
     bool ClientCursor::erase(CursorId id) {
-        recursive_scoped_lock lock(ccmutex);
-        ClientCursor* cursor = find_inlock(id);
-        if (!cursor) {
-            return false;
+        ClientCursor* cursor;
+        {
+            recursive_scoped_lock lock(partitionFor(id).mutex);
+            cursor = find_inlock(id);
+            if (!cursor) {
+                return false;
+            }
+            _unlink_inlock(cursor);
         }
 
-        return _erase_inlock(cursor);
+        _destroyUnlinked(cursor);
+        return true;
     }
 
     bool ClientCursor::eraseIfAuthorized(CursorId id) {
         std::string ns;
         {
-            recursive_scoped_lock lock(ccmutex);
+            recursive_scoped_lock lock(partitionFor(id).mutex);
             ClientCursor* cursor = find_inlock(id);
             if (!cursor) {
                 return false;
@@ -502,19 +592,24 @@ namespace mongo {
         // It is safe to lookup the cursor again after temporarily releasing the mutex because
         // of 2 invariants: that the cursor ID won't be re-used in a short period of time, and that
         // the namespace associated with a cursor cannot change.
-        recursive_scoped_lock lock(ccmutex);
-        ClientCursor* cursor = find_inlock(id);
-        if (!cursor) {
-            // Cursor was deleted in another thread since we found it earlier in this function.
-            return false;
-        }
-        if (cursor->ns() != ns) {
-            warning() << "Cursor namespace changed. Previous ns: " << ns << ", current ns: "
-                    << cursor->ns() << endl;
-            return false;
+        ClientCursor* cursor;
+        {
+            recursive_scoped_lock lock(partitionFor(id).mutex);
+            cursor = find_inlock(id);
+            if (!cursor) {
+                // Cursor was deleted in another thread since we found it earlier in this function.
+                return false;
+            }
+            if (cursor->ns() != ns) {
+                warning() << "Cursor namespace changed. Previous ns: " << ns << ", current ns: "
+                        << cursor->ns() << endl;
+                return false;
+            }
+            _unlink_inlock(cursor);
         }
 
-        return _erase_inlock(cursor);
+        _destroyUnlinked(cursor);
+        return true;
     }
 
     int ClientCursor::erase(int n, long long *ids) {
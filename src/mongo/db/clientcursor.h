@@ -34,6 +34,7 @@
 #include "mongo/db/matcher.h"
 #include "mongo/db/projection.h"
 #include "mongo/db/keypattern.h"
+#include "mongo/platform/atomic_word.h"
 #include "mongo/s/d_chunk_manager.h"
 #include "mongo/util/net/message.h"
 #include "mongo/util/net/listen.h"
@@ -69,7 +70,7 @@ namespace mongo {
         public:
             Pin( long long cursorid ) :
                 _cursorid( INVALID_CURSOR_ID ) {
-                recursive_scoped_lock lock( ccmutex );
+                recursive_scoped_lock lock( partitionFor( cursorid ).mutex );
                 ClientCursor *cursor = ClientCursor::find_inlock( cursorid, true );
                 if ( cursor ) {
                     uassert( 12051, "clientcursor already in use? driver problem?",
@@ -142,22 +143,24 @@ namespace mongo {
         };
 
         /**
-         * Iterates through all ClientCursors, under its own ccmutex lock.
+         * Iterates through all ClientCursors, holding every partition lock for its lifetime.
          * Also supports deletion on the fly.
          */
         class LockedIterator : boost::noncopyable {
         public:
-            LockedIterator() : _lock( ccmutex ), _i( clientCursorsById.begin() ) {}
-            bool ok() const { return _i != clientCursorsById.end(); }
+            LockedIterator();
+            ~LockedIterator();
+            bool ok() const { return _p < NumPartitions; }
             ClientCursor *current() const { return _i->second; }
-            void advance() { ++_i; }
+            void advance() { ++_i; skipEmpty(); }
             /**
              * Delete 'current' and advance. Properly handles cascading deletions that may occur
              * when one ClientCursor is directly deleted.
              */
             void deleteAndAdvance();
         private:
-            recursive_scoped_lock _lock;
+            void skipEmpty();
+            int _p;
             CCById::const_iterator _i;
         };
         
@@ -249,9 +252,11 @@ namespace mongo {
         ShardChunkManagerPtr getChunkManager(){ return _chunkManager; }
 
     private:
+        // Requires the lock of partitionFor(id).
         static ClientCursor* find_inlock(CursorId id, bool warn = true) {
-            CCById::iterator it = clientCursorsById.find(id);
-            if ( it == clientCursorsById.end() ) {
+            CCById &cursors = partitionFor(id).cursors;
+            CCById::iterator it = cursors.find(id);
+            if ( it == cursors.end() ) {
                 if ( warn )
                     OCCASIONALLY out() << "ClientCursor::find(): cursor not found in map " << id << " (ok after a drop)\n";
                 return 0;
@@ -261,7 +266,7 @@ namespace mongo {
 
     public:
         static ClientCursor* find(CursorId id, bool warn = true) {
-            recursive_scoped_lock lock(ccmutex);
+            recursive_scoped_lock lock(partitionFor(id).mutex);
             ClientCursor *c = find_inlock(id, warn);
             // if this asserts, your code was not thread safe - you either need to set no timeout
             // for the cursor or keep a ClientCursor::Pointer in scope for it.
@@ -278,7 +283,7 @@ namespace mongo {
         static bool erase(CursorId id);
         // Same as erase but checks to make sure this thread has read permission on the cursor's
         // namespace.  This should be called when receiving killCursors from a client.  This should
-        // not be called when ccmutex is held.
+        // not be called when a partition lock is held.
         static bool eraseIfAuthorized(CursorId id);
 
         /**
@@ -303,7 +308,7 @@ namespace mongo {
         static void idleTimeReport(unsigned millis);
 
         static void appendStats( BSONObjBuilder& result );
-        static unsigned numCursors() { return clientCursorsById.size(); }
+        static unsigned numCursors() { return numOpen.load(); }
         static void find( const string& ns , set<CursorId>& all );
 
     public:
@@ -330,7 +335,11 @@ namespace mongo {
         // setting this prevents timeout of the cursor in question.
         void noTimeout() { _pinValue++; }
 
-        static bool _erase_inlock(ClientCursor* cursor);
+        // Removes an unpinned cursor from its partition without destroying it.  Requires the
+        // cursor's partition lock.
+        static void _unlink_inlock(ClientCursor* cursor);
+        // Destroys a cursor that _unlink_inlock removed.  Requires no partition lock.
+        static void _destroyUnlinked(ClientCursor* cursor);
 
         CursorId _cursorid;
 
@@ -367,10 +376,31 @@ namespace mongo {
 
     private: // static members
 
-        static CCById clientCursorsById;
+        /**
+         * Open cursors are spread over a fixed number of partitions by cursor id, each with its
+         * own mutex, so that creating, pinning and killing unrelated cursors don't contend.
+         *
+         * A thread holding one partition lock must not block on another, except through
+         * LockedIterator, which takes all of them in order.  So a cursor is unlinked under its
+         * partition lock and destroyed after releasing it, because destroying a cursor can end
+         * its transaction and erase other cursors.  LockedIterator waits for those destroys to
+         * finish, so that invalidation never returns while a cursor on the namespace still
+         * exists.
+         */
+        struct Partition {
+            Partition() : mutex( *(new boost::recursive_mutex()) ) {}
+            boost::recursive_mutex& mutex;
+            CCById cursors;
+        };
+        enum { NumPartitions = 64 };
+        static Partition partitions[NumPartitions];
+        static Partition& partitionFor(CursorId id) {
+            return partitions[id & (NumPartitions - 1)];
+        }
+
+        static AtomicUInt32 numOpen;
         static long long numberTimedOut;
-        static boost::recursive_mutex& ccmutex;   // must use this for all statics above!
-        static CursorId allocCursorId_inlock();
+        static CursorId allocCursorId();
 
     };
 
@@ -423,6 +423,18 @@ namespace mongo {
                 const BSONElement e = o.next();
                 _indexedPaths.addPath( e.fieldName() );
             }
+            // Changing a field stored by a projected clustering index changes
+            // that index's rows, just like changing one of its keys.
+            BSONObjIterator f( idx(i).clusteringFields() );
+            while ( f.more() ) {
+                _indexedPaths.addPath( f.next().fieldName() );
+            }
+            // So does changing a field that decides whether a document belongs
+            // in a partial index.
+            BSONObjIterator p( idx(i).partialFilter() );
+            while ( p.more() ) {
+                _indexedPaths.addPath( p.next().fieldName() );
+            }
         }
     }
 
@@ -1830,7 +1842,8 @@ namespace mongo {
         for (int i = 1; i < nIndexes(); i++) {
             const IndexDetails &index = idx(i);
             IndexDetails::Stats st = index.getStats();
-            if (!index.sparse() && !isMultiKey(i) && st.dataSize < smallestIndexSize) {
+            if (!index.sparse() && index.partialFilter().isEmpty() &&
+                !isMultiKey(i) && st.dataSize < smallestIndexSize) {
                 smallestIndexSize = st.dataSize;
                 chosenIndex = i;
             }
@@ -1844,6 +1857,10 @@ namespace mongo {
         const IndexDetails* bestMultiKeyIndex = NULL;
         for (int i = 0; i < nIndexesBeingBuilt(); i++) {
             const IndexDetails &index = idx(i);
+            if (!index.partialFilter().isEmpty()) {
+                // Callers scan key ranges expecting to see every document.
+                continue;
+            }
             if (keyPattern.isPrefixOf(index.keyPattern())) {
                 if (!isMultikey(i)) {
                     return &index;
@@ -348,6 +348,7 @@ namespace mongo {
         static const uint64_t NO_UNIQUE_CHECKS = 2; // skip uniqueness checks on all keys
         static const uint64_t KEYS_UNAFFECTED_HINT = 4; // an update did not update secondary indexes
         static const uint64_t NO_PK_UNIQUE_CHECKS = 8; // skip uniqueness checks only on the primary key
+        static const uint64_t INSERT_RULES_CHECKED = 16; // inserted objects already passed validateInsert's checks
 
         // Creates the appropriate Collection implementation based on options.
         //
@@ -32,6 +32,7 @@
 #include "mongo/db/matcher.h"
 #include "mongo/db/query_optimizer.h"
 #include "mongo/db/replutil.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/ops/insert.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/scripting/engine.h"
@@ -66,9 +67,30 @@ namespace mongo {
             _scope->setFunction(_type.c_str(), _code.c_str());
         }
 
+        // How many documents each call into the JS engine maps, 1 to call once per document.
+        MONGO_EXPORT_SERVER_PARAMETER(mapReduceBatchSize, int, 128);
+
+        // Batches are also cut at this many bytes of documents.
+        static const int maxMapBatchBytes = 1024 * 1024;
+
         void JSMapper::init( State * state ) {
             _func.init( state );
             _params = state->config().mapParams;
+
+            if ( mapReduceBatchSize > 1 ) {
+                Scope * s = _func.scope();
+                // map params as a real array, for apply()
+                BSONObj params = BSON( "__mapParams" << BSONArray( _params ) );
+                s->setElement( "__mapParams", params.firstElement() );
+                _batchFunc = s->createFunction(
+                            "function(docs) {"
+                            "  var map = _map;"
+                            "  var params = __mapParams;"
+                            "  for (var i = 0; i < docs.length; i++)"
+                            "    map.apply(docs[i], params);"
+                            "}");
+                massert( 17378, "error initializing JavaScript batched map function", _batchFunc != 0 );
+            }
         }
 
         /**
@@ -77,7 +99,40 @@ namespace mongo {
         void JSMapper::map( const BSONObj& o ) {
             Scope * s = _func.scope();
             verify( s );
-            if (s->invoke(_func.func(), &_params, &o, 0, true))
+            if ( ! _batchFunc ) {
+                if (s->invoke(_func.func(), &_params, &o, 0, true))
+                    uasserted(9014, str::stream() << "map invoke failed: " << s->getError());
+                return;
+            }
+
+            // cut the batch before o would take it past maxMapBatchBytes, so that the batch
+            // stays a valid BSON object however large the documents are
+            if ( _batchCount && _batch->len() + o.objsize() > maxMapBatchBytes )
+                flush();
+
+            if ( ! _batch ) {
+                _batch.reset( new BSONObjBuilder() );
+                _batchDocs.reset( new BSONArrayBuilder( _batch->subarrayStart( "0" ) ) );
+            }
+            _batchDocs->append( o );
+            _batchCount++;
+            if ( _batchCount >= mapReduceBatchSize )
+                flush();
+        }
+
+        void JSMapper::flush() {
+            if ( ! _batchCount )
+                return;
+
+            _batchDocs->done();
+            BSONObj args = _batch->done();
+            Scope * s = _func.scope();
+            int err = s->invoke( _batchFunc, &args, 0, 0, true );
+
+            _batchDocs.reset();
+            _batch.reset();
+            _batchCount = 0;
+            if ( err )
                 uasserted(9014, str::stream() << "map invoke failed: " << s->getError());
         }
 
@@ -1239,6 +1294,11 @@ namespace mongo {
                                 if ( config.limit && num >= config.limit )
                                     break;
                             }
+
+                            if ( config.verbose ) mt.reset();
+                            config.mapper->flush();
+                            if ( config.verbose ) mapTime += mt.micros();
+                            state.checkSize();
                         }
                         pm.finished();
 
@@ -44,6 +44,9 @@ namespace mongo {
             virtual void init( State * state ) = 0;
 
             virtual void map( const BSONObj& o ) = 0;
+
+            /** maps whatever map() held back, called once the input is exhausted */
+            virtual void flush() {}
         };
 
         class Finalizer : boost::noncopyable {
@@ -98,15 +101,27 @@ namespace mongo {
             ScriptingFunction _func;
         };
 
+        /**
+         * Unless mapReduceBatchSize is 1 or less, map() copies documents into a batch, and the
+         * whole batch goes into the engine in one invocation that applies the map function to
+         * each document in a loop.  The emits come out the same, in the same order.
+         */
         class JSMapper : public Mapper {
         public:
-            JSMapper( const BSONElement & code ) : _func( "_map" , code ) {}
+            JSMapper( const BSONElement & code ) : _func( "_map" , code ), _batchFunc( 0 ), _batchCount( 0 ) {}
             virtual void map( const BSONObj& o );
+            virtual void flush();
             virtual void init( State * state );
 
         private:
             JSFunction _func;
             BSONObj _params;
+
+            ScriptingFunction _batchFunc;   // 0 to map one document per invocation
+            // arguments of the next batch invocation, the documents are field "0"
+            scoped_ptr<BSONObjBuilder> _batch;
+            scoped_ptr<BSONArrayBuilder> _batchDocs;
+            int _batchCount;
         };
 
         class JSReducer : public Reducer {
@@ -21,6 +21,7 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/database.h"
+#include "mongo/db/introspect.h"
 
 namespace mongo {
 
@@ -111,6 +112,10 @@ namespace mongo {
     void CurOp::leave( Client::Context * context ) {
     }
 
+    bool CurOp::shouldDBProfile( int ms ) const {
+        return shouldProfile( _dbprofile , _ns , ms );
+    }
+
     void CurOp::recordGlobalTime( long long micros ) const {
         if ( _client ) {
             const LockState& ls = _client->lockState();
@@ -198,6 +203,12 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> displayIdhack( "operation.idhack", &idhackCounter );
     static ServerStatusMetricField<Counter64> displayScanAndOrder( "operation.scanAndOrder", &scanAndOrderCounter );
 
+    static Counter64 bufAllocsCounter;
+    static Counter64 bufReusesCounter;
+
+    static ServerStatusMetricField<Counter64> displayBufAllocs( "operation.bufferPool.allocs", &bufAllocsCounter );
+    static ServerStatusMetricField<Counter64> displayBufReuses( "operation.bufferPool.reuses", &bufReusesCounter );
+
     void OpDebug::recordStats() {
         if ( nreturned > 0 )
             returnedCounter.increment( nreturned );
@@ -214,5 +225,9 @@ namespace mongo {
             idhackCounter.increment();
         if ( scanAndOrder )
             scanAndOrderCounter.increment();
+        if ( bufAllocs > 0 )
+            bufAllocsCounter.increment( bufAllocs );
+        if ( bufReuses > 0 )
+            bufReusesCounter.increment( bufReuses );
     }
 }
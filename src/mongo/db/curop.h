@@ -72,6 +72,8 @@ namespace mongo {
         bool fastmodinsert;  // upsert of an $operation. builds a default object
         bool upsert;         // true if the update actually did an insert
         int keyUpdates;
+        long long bufAllocs;  // builder allocations served by the thread's BufferPool
+        long long bufReuses;  // ... of which reused a cached buffer
 
         // error handling
         ExceptionInfo exceptionInfo;
@@ -171,12 +173,7 @@ namespace mongo {
         int profileLevel() const   { return _dbprofile; }
         const char * getNS() const { return _ns.c_str(); }
 
-        bool shouldDBProfile( int ms ) const {
-            if ( _dbprofile <= 0 )
-                return false;
-
-            return _dbprofile >= 2 || ms >= cmdLine.slowMS;
-        }
+        bool shouldDBProfile( int ms ) const;
 
         AtomicUInt opNum() const { return _opNum; }
 
@@ -22,7 +22,9 @@
 #include "mongo/db/kill_current_op.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/collection.h"
+#include "mongo/db/scan_read_ahead.h"
 #include "mongo/db/storage/exception.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -122,6 +124,7 @@ namespace mongo {
                      ScanCursor::startKey(idx.keyPattern(), direction),
                      ScanCursor::endKey(idx.keyPattern(), direction),
                      true, direction, numWanted ) {
+        startReadAhead();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
@@ -184,6 +187,7 @@ namespace mongo {
                 return 0;
             }
             info->bufferedRowCount++;
+            info->bytesCounted += key->size + val->size;
             return TOKUDB_CURSOR_CONTINUE;
         } catch (const std::exception &ex) {
             info->saveException(ex);
@@ -200,11 +204,15 @@ namespace mongo {
         DBC *cursor = _cursor->dbc();
         struct count_cursor_getf_extra extra(_bufferedRowCount, _exhausted,
                                              _endSKeyPrefix, _ordering, _endKeyInclusive);
+        Timer timer;
         const int r = cursor->c_getf_next(cursor, getf_flags(), count_cursor_getf, &extra);
         if (r != 0 && r != DB_NOTFOUND) {
             extra.throwException();
             storage::handle_ydb_error(r);
         }
+        if (_readAhead) {
+            _readAhead->noteFetched(extra.bytesCounted, timer.micros());
+        }
         return _bufferedRowCount > 0;
     }
 
@@ -231,6 +239,7 @@ namespace mongo {
                           ScanCursor::endKey(idx.keyPattern(), 1),
                           true ) {
         verify(forward());
+        startReadAhead();
     }
 
     ////////////////////////////////////////////////////////////////////////////////////////////////
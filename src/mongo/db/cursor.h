@@ -31,13 +31,14 @@ namespace mongo {
 
     class Collection;
     class CoveredIndexMatcher;
+    class ScanReadAhead;
 
     /**
      * Query cursors, base class.  This is for our internal cursors.  "ClientCursor" is a separate
      * concept and is for the user's cursor.
      *
      * WARNING concurrency: the vfunctions below are called back from within a
-     * ClientCursor::ccmutex.  Don't cause a deadlock, you've been warned.
+     * ClientCursor partition lock.  Don't cause a deadlock, you've been warned.
      */
     class Cursor : boost::noncopyable {
     public:
@@ -112,6 +113,9 @@ namespace mongo {
         /* current associated primary key (_id key) for the document */
         virtual BSONObj currPK() const { return BSONObj(); }
 
+        /* fields stored with the current key by a projected clustering index, empty otherwise */
+        virtual BSONObj currClusteringFields() const { return BSONObj(); }
+
         /* Implement these if you want the cursor to be "tailable" */
 
         /* Request that the cursor starts tailing after advancing past last record. */
@@ -286,6 +290,7 @@ namespace mongo {
 
         BSONObj currPK() const { return _currPK; }
         BSONObj currKey() const { return _currKey; }
+        BSONObj currClusteringFields() const { return _currClusteringFields; }
         BSONObj current();
         BSONObj indexKeyPattern() const { return _idx.keyPattern(); }
 
@@ -302,6 +307,8 @@ namespace mongo {
         
         long long nscanned() const { return _nscanned; }
 
+        virtual void explainDetails( BSONObjBuilder& b ) const;
+
     protected:
         bool forward() const;
 
@@ -332,6 +339,10 @@ namespace mongo {
                      const shared_ptr< FieldRangeVector > &bounds,
                      int singleIntervalLimit, int direction, int numWanted = 0);
 
+        /** Start reading ahead of a full scan, if the operation asked for it. See ScanReadAhead. */
+        void startReadAhead();
+        void explainReadAhead( BSONObjBuilder& b ) const;
+
     private:
 
         /** Initialize the internal DBC */
@@ -339,6 +350,7 @@ namespace mongo {
         void _prelockCompoundBounds(const int currentRange, vector<const FieldInterval *> &combo,
                                     BufBuilder &startKeyBuilder, BufBuilder &endKeyBuilder);
         void _prelockBounds();
+        void _prelockLeadingIntervals();
         void _prelockRange(const BSONObj &startKey, const BSONObj &endKey);
 
         /** Get the current key/pk/obj from the row buffer and set _currKey/PK/Obj */
@@ -351,8 +363,9 @@ namespace mongo {
             RowBuffer *buffer;
             int rows_fetched;
             int rows_to_fetch;
+            long long bytes_fetched;
             cursor_getf_extra(RowBuffer *buf, int n_to_fetch) :
-                buffer(buf), rows_fetched(0), rows_to_fetch(n_to_fetch) {
+                buffer(buf), rows_fetched(0), rows_to_fetch(n_to_fetch), bytes_fetched(0) {
             }
         };
         static int cursor_getf(const DBT *key, const DBT *val, void *extra);
@@ -364,6 +377,8 @@ namespace mongo {
         void findKey(const BSONObj &key);
         /** find by key and a given PK */
         void setPosition(const BSONObj &key, const BSONObj &pk);
+        /** position as setPosition would, using only rows already in the row buffer, if possible */
+        bool setPositionFromBuffer(const BSONObj &key, const BSONObj &pk);
         /** check if the current key is out of bounds, invalidate the current key if so */
         bool checkCurrentAgainstBounds();
         void skipPrefix(const BSONObj &key, const int k);
@@ -404,6 +419,9 @@ namespace mongo {
         shared_ptr<Projection::KeyOnly> _keyFieldsOnly;
         long long _nscanned;
         long long _nscannedObjects;
+        // Repositionings of the ydb cursor, and those served from the row buffer instead.
+        long long _nseeks;
+        long long _nbufferedSeeks;
 
         // Prelock is true if the caller does not want a limited result set from the cursor.
         // Even if the query looks like { a: { $gte: 5 } }, the caller may want limited results for:
@@ -427,6 +445,7 @@ namespace mongo {
         BSONObj _currKey;
         BSONObj _currPK;
         BSONObj _currObj;
+        BSONObj _currClusteringFields;
         BufBuilder _currKeyBufBuilder;
 
         // Row buffer to store rows in using bulk fetch. Also track the iteration
@@ -434,6 +453,9 @@ namespace mongo {
         RowBuffer _buffer;
         int _getf_iteration;
 
+        // Keeps the nodes the bulk fetches will need next in cache, for full scans.
+        scoped_ptr<ScanReadAhead> _readAhead;
+
         // for interrupt checking
         ExceptionSaver _interrupt_extra;
 
@@ -503,13 +525,15 @@ namespace mongo {
         struct count_cursor_getf_extra : public ExceptionSaver {
             count_cursor_getf_extra(int &c, bool &e, const storage::Key &key,
                                     const Ordering &o, const bool inc) :
-                bufferedRowCount(c), exhausted(e), endSKeyPrefix(key), ordering(o), endKeyInclusive(inc) {
+                bufferedRowCount(c), exhausted(e), endSKeyPrefix(key), ordering(o), endKeyInclusive(inc),
+                bytesCounted(0) {
             }
             int &bufferedRowCount;
             bool &exhausted;
             const storage::Key &endSKeyPrefix;
             const Ordering &ordering;
             const bool endKeyInclusive;
+            long long bytesCounted;
         };
         static int count_cursor_getf(const DBT *key, const DBT *val, void *extra);
 
@@ -566,7 +590,7 @@ namespace mongo {
         virtual bool isMultiKey() const { return false; }
         virtual bool modifiedKeys() const { return false; }
         virtual BSONObj prettyIndexBounds() const { return BSONArray(); }
-        virtual void explainDetails( BSONObjBuilder& b ) const { return; }
+        virtual void explainDetails( BSONObjBuilder& b ) const { explainReadAhead( b ); }
 
     private:
         BasicCursor(CollectionData *cl, int direction);
@@ -686,6 +710,10 @@ namespace mongo {
             return _currentCursor->currPK();
         }
 
+        virtual BSONObj currClusteringFields() const {
+            return _currentCursor->currClusteringFields();
+        }
+
         virtual BSONObj indexKeyPattern() const {
             return _currentCursor->indexKeyPattern();
         }
@@ -847,6 +875,10 @@ namespace mongo {
             return frontCursor()->currPK();
         }
 
+        virtual BSONObj currClusteringFields() const {
+            return frontCursor()->currClusteringFields();
+        }
+
         virtual BSONObj indexKeyPattern() const {
             return frontCursor()->indexKeyPattern();
         }
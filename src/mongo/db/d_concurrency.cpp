@@ -115,8 +115,12 @@ namespace mongo {
         
         void lock_w() { 
             verify( threadState() == 0 );
-            WaiterManager wm(_writeLockWaiters);
             lockState().lockedStart( 'w' );
+            if ( q.lock_w_try_fast() ) {
+                // nothing to wait for, don't touch the shared waiter count either
+                return;
+            }
+            WaiterManager wm(_writeLockWaiters);
             q.lock_w(); 
         }
         
@@ -53,9 +53,11 @@
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/snapshots.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/db/storage/lock_contention.h"
 #include "mongo/db/ttl.h"
 #include "mongo/db/txn_complete_hooks.h"
 #include "mongo/plugins/loader.h"
+#include "mongo/s/d_autosplit.h"
 #include "mongo/s/d_writeback.h"
 #include "mongo/scripting/engine.h"
 #include "mongo/util/background.h"
@@ -735,6 +737,9 @@ namespace mongo {
         snapshotThread.go();
         d.clientCursorMonitor.go();
         PeriodicTask::theRunner->go();
+        startProfileWriter();
+        storage::startLockContentionSampler();
+        startChunkAutoSplitter();
         if (missingRepl) {
             // a warning was logged earlier
         }
@@ -57,9 +57,12 @@
 #include "mongo/db/query_optimizer.h"
 #include "mongo/db/ops/count.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/db/server_parameters.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/timer_stats.h"
 #include "mongo/db/storage/env.h"
+#include "mongo/db/storage/group_commit.h"
+#include "mongo/db/storage/lock_contention.h"
 #include "mongo/db/oplog_helpers.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/d_writeback.h"
@@ -105,6 +108,10 @@ namespace mongo {
     static TimerStats gleWtimeStats;
     static ServerStatusMetricField<TimerStats> displayGleLatency( "getLastError.wtime", &gleWtimeStats );
 
+    // How often getLastError waiting for w rechecks that we're still primary and that the op
+    // wasn't killed, while no member has caught up.
+    MONGO_EXPORT_SERVER_PARAMETER(replAckCheckIntervalMillis, int, 100);
+
     static Counter64 gleWtimeouts;
     static ServerStatusMetricField<Counter64> gleWtimeoutsDisplay( "getLastError.wtimeouts", &gleWtimeouts );
 
@@ -168,8 +175,9 @@ namespace mongo {
                 if ( cmdObj["j"].trueValue() || cmdObj["fsync"].trueValue()) {
                     // if there's a non-zero log flush period, transactions
                     // do not fsync on commit and so we must do it here.
+                    // concurrent waiters share a single flush.
                     if (cmdLine.logFlushPeriod != 0) {
-                        storage::log_flush();
+                        storage::groupCommit.waitForDurable();
                     }
                 }
 
@@ -247,8 +255,14 @@ namespace mongo {
                             return false;
                         }
 
-                        // check this first for w=0 or w=1
-                        OP_REPL_STATUS s = opReplicatedEnough( gtid, e );
+                        // Returns as soon as a member catches up far enough, but no later
+                        // than the check interval, so the checks above and killOp are
+                        // still noticed.
+                        int waitMillis = std::max( 1 , (int) replAckCheckIntervalMillis );
+                        if ( timeout > 0 ) {
+                            waitMillis = std::min( waitMillis , std::max( 0 , timeout - timer.millis() ) );
+                        }
+                        OP_REPL_STATUS s = waitForReplication( gtid, e, waitMillis );
                         if ( s == REPL_SUCCESS ) {
                             break;
                         }
@@ -270,12 +284,12 @@ namespace mongo {
 
                         verify( sprintf( buf , "w block pass: %lld" , ++passes ) < 30 );
                         c.curop()->setMessage( buf );
-                        sleepmillis(1);
                         killCurrentOp.checkForInterrupt();
                     }
 
                     result.append("writtenTo", getHostsWrittenTo(gtid));
                     int myMillis = timer.recordMillis();
+                    recordReplicationAckLatency( e , myMillis );
                     result.appendNumber( "wtime" , myMillis );
                 }
             }
@@ -433,6 +447,9 @@ namespace mongo {
             help << "{ profile : <n> }\n";
             help << "0=off 1=log slow ops 2=log all\n";
             help << "-1 to get current values\n";
+            help << "optional slowms : <ms> sets the slow op threshold for level 1, for all\n";
+            help << "namespaces, or with ns : <collection> for just that collection (negative clears)\n";
+            help << "optional sampleRate : <0 to 1> profiles only that fraction of the ops that qualify\n";
             help << "http://dochub.mongodb.org/core/databaseprofiler";
         }
         // Need access to the database to enable profiling on it
@@ -457,6 +474,23 @@ namespace mongo {
             BSONElement e = cmdObj.firstElement();
             result.append("was", cc().database()->profile());
             result.append("slowms", cmdLine.slowMS );
+            result.append("sampleRate", getProfileSampleRate());
+            {
+                BSONObjBuilder nsSlowMS(result.subobjStart("nsSlowms"));
+                appendProfileSlowMS(dbname, nsSlowMS);
+                nsSlowMS.done();
+            }
+
+            BSONElement rate = cmdObj["sampleRate"];
+            if ( !rate.eoo() && ( !rate.isNumber() || rate.number() < 0 || rate.number() > 1 ) ) {
+                errmsg = "sampleRate must be a number between 0 and 1";
+                return false;
+            }
+            BSONElement nsElt = cmdObj["ns"];
+            if ( !nsElt.eoo() && ( nsElt.type() != String || nsElt.valuestrsize() <= 1 ) ) {
+                errmsg = "ns must be a collection name";
+                return false;
+            }
 
             int p = (int) e.number();
             bool ok = false;
@@ -470,8 +504,14 @@ namespace mongo {
             }
 
             BSONElement slow = cmdObj["slowms"];
-            if ( slow.isNumber() )
-                cmdLine.slowMS = slow.numberInt();
+            if ( slow.isNumber() ) {
+                if ( nsElt.eoo() )
+                    cmdLine.slowMS = slow.numberInt();
+                else
+                    setProfileSlowMS( dbname + "." + nsElt.String() , slow.numberInt() );
+            }
+            if ( rate.isNumber() )
+                setProfileSampleRate( rate.number() );
 
             return ok;
         }
@@ -632,6 +672,50 @@ namespace mongo {
         }
     } cmdShowLiveTransactions;
 
+    class CmdShowLockContention : public WebInformationCommand {
+    public:
+        CmdShowLockContention() : WebInformationCommand("showLockContention") {}
+
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::showPendingLockRequests);
+            out->push_back(Privilege(AuthorizationManager::SERVER_RESOURCE_NAME, actions));
+        }
+        virtual void help( stringstream& help ) const {
+            help << "returns the most contended document-level lock ranges since startup (or the last reset)\n";
+            help << "{ showLockContention : 1, limit : <n>, sort : 'waitMillis'|'waits'|'timeouts', reset : <bool> }";
+        }
+
+        bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
+            int limit = 20;
+            if (cmdObj["limit"].isNumber()) {
+                limit = cmdObj["limit"].numberInt();
+            }
+            const string sort = cmdObj["sort"].eoo() ? "waitMillis" : cmdObj["sort"].str();
+            if (sort != "waitMillis" && sort != "waits" && sort != "timeouts") {
+                errmsg = "sort must be one of waitMillis, waits or timeouts";
+                return false;
+            }
+
+            {
+                BSONArrayBuilder ab(result.subarrayStart("ranges"));
+                storage::lockContention.appendTopRanges(limit, sort, ab);
+                ab.done();
+            }
+            {
+                BSONObjBuilder b(result.subobjStart("totals"));
+                storage::lockContention.appendStats(b);
+                b.done();
+            }
+            if (cmdObj["reset"].trueValue()) {
+                storage::lockContention.reset();
+            }
+            return true;
+        }
+    } cmdShowLockContention;
+
     class CmdCheckpoint : public Command {
     public:
         CmdCheckpoint() : Command("checkpoint") {}
@@ -190,6 +190,41 @@ namespace mongo {
             return nextjsobj != 0;
         }
         BSONObj nextJsObj() {
+            return _nextJsObj( NULL );
+        }
+
+        /**
+         * Like nextJsObj, for the documents of an insert message.  With objcheck on, the
+         * document is also checked against the insert rules (see validateInsert) in the same
+         * pass, and insertable says whether it passed.  It is false if they weren't checked.
+         */
+        BSONObj nextInsertObj( bool* insertable ) {
+            *insertable = false;
+            BSONObj js = _nextJsObj( cmdLine.objcheck ? insertable : NULL );
+            if ( js.objsize() > BSONObjMaxUserSize ) {
+                *insertable = false;
+            }
+            return js;
+        }
+
+        const Message& msg() const { return m; }
+
+        const char * markGet() {
+            return nextjsobj;
+        }
+
+        void markSet() {
+            mark = nextjsobj;
+        }
+
+        void markReset( const char * toMark = 0) {
+            if( toMark == 0 ) toMark = mark;
+            verify( toMark );
+            nextjsobj = toMark;
+        }
+
+    private:
+        BSONObj _nextJsObj( bool* insertable ) {
             if ( nextjsobj == data ) {
                 nextjsobj += strlen(data) + 1; // skip namespace
                 massert( 13066 ,  "Message contains no documents", theEnd > nextjsobj );
@@ -199,7 +234,9 @@ namespace mongo {
                      theEnd - nextjsobj >= 5 );
 
             if ( cmdLine.objcheck ) {
-                Status status = validateBSON( nextjsobj, theEnd - nextjsobj );
+                Status status = insertable
+                        ? validateBSONForInsert( nextjsobj, theEnd - nextjsobj, insertable )
+                        : validateBSON( nextjsobj, theEnd - nextjsobj );
                 massert( 10307,
                          str::stream() << "Client Error: bad object in message: " << status.reason(),
                          status.isOK() );
@@ -215,23 +252,6 @@ namespace mongo {
             return js;
         }
 
-        const Message& msg() const { return m; }
-
-        const char * markGet() {
-            return nextjsobj;
-        }
-
-        void markSet() {
-            mark = nextjsobj;
-        }
-
-        void markReset( const char * toMark = 0) {
-            if( toMark == 0 ) toMark = mark;
-            verify( toMark );
-            nextjsobj = toMark;
-        }
-
-    private:
         const Message& m;
         int* reserved;
         const char *data;
@@ -17,22 +17,68 @@
 */
 
 #include "mongo/pch.h"
+
+#include <boost/thread/tss.hpp>
+
 #include "mongo/db/descriptor.h"
 #include "mongo/db/keygenerator.h"
+#include "mongo/db/matcher.h"
 
 namespace mongo {
 
+    // The ydb generates keys with nothing but a descriptor to go on, for every row written to a
+    // partial index, so filters are compiled once and kept per thread, keyed by the filter.
+    typedef map<string, shared_ptr<Matcher> > PartialFilterMatchers;
+    static boost::thread_specific_ptr<PartialFilterMatchers> partialFilterMatchers;
+    static const size_t maxPartialFilterMatchers = 64;
+
+    static const Matcher &partialFilterMatcher(const BSONObj &filter) {
+        PartialFilterMatchers *matchers = partialFilterMatchers.get();
+        if (matchers == NULL) {
+            matchers = new PartialFilterMatchers();
+            partialFilterMatchers.reset(matchers);
+        }
+        const string key(filter.objdata(), filter.objsize());
+        PartialFilterMatchers::const_iterator it = matchers->find(key);
+        if (it != matchers->end()) {
+            return *it->second;
+        }
+        if (matchers->size() >= maxPartialFilterMatchers) {
+            matchers->clear();
+        }
+        // the matcher refers to its pattern, which must outlive the descriptor's buffer
+        shared_ptr<Matcher> matcher(new Matcher(filter.getOwned()));
+        (*matchers)[key] = matcher;
+        return *matcher;
+    }
+
+    static BSONObj makeOptions(const BSONObj &clusteringFields, const BSONObj &partialFilter) {
+        BSONObjBuilder b;
+        if (!clusteringFields.isEmpty()) {
+            b.append("clusteringFields", clusteringFields);
+        }
+        if (!partialFilter.isEmpty()) {
+            b.append("partialFilter", partialFilter);
+        }
+        return b.obj();
+    }
+
     Descriptor::Descriptor(const BSONObj &keyPattern,
                            const bool hashed,
                            const int hashSeed,
                            const bool sparse,
-                           const bool clustering) :
-        _data(NULL), _size(serializedSize(keyPattern)), _dataOwned(new char[_size]) {
+                           const bool clustering,
+                           const BSONObj &clusteringFields,
+                           const BSONObj &partialFilter) :
+        _data(NULL), _size(serializedSize(keyPattern, makeOptions(clusteringFields, partialFilter))),
+        _dataOwned(new char[_size]) {
         _data = _dataOwned.get();
+        const BSONObj options = makeOptions(clusteringFields, partialFilter);
 
         // Create a header and write it first.
         Header h(Ordering::make(keyPattern),
-                 hashed, sparse, clustering, hashSeed, keyPattern.nFields());
+                 hashed, sparse, clustering, hashSeed, keyPattern.nFields(),
+                 !options.isEmpty());
         memcpy(_dataOwned.get(), &h, sizeof(Header));
 
         // The offsets array is based after the header. It is an array of
@@ -52,6 +98,12 @@ namespace mongo {
             offset += len;
             verify((char*) &offsetsBase[i] < fieldsBase);
         }
+
+        // Options, if any, go last.
+        if (!options.isEmpty()) {
+            memcpy(fieldsBase + offset, options.objdata(), options.objsize());
+            offset += options.objsize();
+        }
         verify(fieldsBase + offset == _data + _size);
     }
 
@@ -62,7 +114,7 @@ namespace mongo {
         verify(_size > (size_t) FixedSize);
     }
 
-    size_t Descriptor::serializedSize(const BSONObj &keyPattern) {
+    size_t Descriptor::serializedSize(const BSONObj &keyPattern, const BSONObj &options) {
         size_t size = FixedSize;
         for (BSONObjIterator o(keyPattern); o.more(); ++o) {
             const BSONElement &e = *o;
@@ -72,6 +124,9 @@ namespace mongo {
             size += strlen(e.fieldName()) + 1;
         }
         verify(size > (size_t) FixedSize);
+        if (!options.isEmpty()) {
+            size += options.objsize();
+        }
         return size;
     }
 
@@ -99,6 +154,42 @@ namespace mongo {
         }
     }
 
+    BSONObj Descriptor::options() const {
+        const Header &h(*reinterpret_cast<const Header *>(_data));
+        if (!h.hasOptions()) {
+            return BSONObj();
+        }
+        // They follow the last key field string.
+        vector<const char *> fields;
+        fieldNames(fields);
+        const char *const p = fields.back() + strlen(fields.back()) + 1;
+        verify(p < _data + _size);
+        return BSONObj(p);
+    }
+
+    BSONObj Descriptor::clusteringFields() const {
+        const BSONElement e = options()["clusteringFields"];
+        return e.isABSONObj() ? e.Obj() : BSONObj();
+    }
+
+    BSONObj Descriptor::partialFilter() const {
+        const BSONElement e = options()["partialFilter"];
+        return e.isABSONObj() ? e.Obj() : BSONObj();
+    }
+
+    BSONObj Descriptor::projectClusteringFields(const BSONObj &obj) const {
+        const BSONObj fields = clusteringFields();
+        dassert(!fields.isEmpty());
+        BSONObjBuilder b;
+        for (BSONObjIterator it(obj); it.more(); ) {
+            const BSONElement e = it.next();
+            if (fields.hasField(e.fieldName())) {
+                b.append(e);
+            }
+        }
+        return b.obj();
+    }
+
     BSONObj Descriptor::fillKeyFieldNames(const BSONObj &key) const {
         BSONObjBuilder b;
         vector<const char *> fields;
@@ -116,6 +207,11 @@ namespace mongo {
     }
 
     void Descriptor::generateKeys(const BSONObj &obj, BSONObjSet &keys) const {
+        const BSONObj filter = partialFilter();
+        if (!filter.isEmpty() && !partialFilterMatcher(filter).matches(obj)) {
+            // Documents outside a partial index's filter have no keys.
+            return;
+        }
         const Header &h(*reinterpret_cast<const Header *>(_data));
         vector<const char *> fields;
         fieldNames(fields);
@@ -130,4 +226,14 @@ namespace mongo {
         }
     }
 
+    KeyGenerator *Descriptor::makeKeyGenerator() const {
+        const Header &h(*reinterpret_cast<const Header *>(_data));
+        if (h.hashed) {
+            return NULL;
+        }
+        vector<const char *> fields;
+        fieldNames(fields);
+        return new KeyGenerator(fields, h.sparse);
+    }
+
 } // namespace mongo
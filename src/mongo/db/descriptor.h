@@ -24,6 +24,8 @@
 
 namespace mongo {
 
+    class KeyGenerator;
+
     // A Descriptor contains the necessary information for comparing
     // and generating index keys and values.
     //
@@ -39,7 +41,9 @@ namespace mongo {
                    const bool hashed = false,
                    const int hashSeed = 0,
                    const bool sparse = false,
-                   const bool clustering = false);
+                   const bool clustering = false,
+                   const BSONObj &clusteringFields = BSONObj(),
+                   const BSONObj &partialFilter = BSONObj());
         // For interpretting a memory buffer as a descriptor.
         Descriptor(const char *data, const size_t size);
 
@@ -57,6 +61,12 @@ namespace mongo {
 
         void generateKeys(const BSONObj &obj, BSONObjSet &keys) const;
 
+        // @return a new generator for this descriptor's keys, compiled once for
+        // callers that generate keys for many objects, or NULL if the descriptor
+        // is hashed.  It refers to this descriptor's field names, so it must not
+        // outlive the descriptor.
+        KeyGenerator *makeKeyGenerator() const;
+
         BSONObj fillKeyFieldNames(const BSONObj &key) const;
 
         bool clustering() const {
@@ -64,11 +74,27 @@ namespace mongo {
             return h.clustering;
         }
 
-        static size_t serializedSize(const BSONObj &keyPattern);
+        // @return the fields a projected clustering index stores with each key,
+        // empty if the index is not a projected clustering index.
+        BSONObj clusteringFields() const;
+
+        // @return the predicate a document must match to be indexed by a partial
+        // index, empty if the index is not partial.
+        BSONObj partialFilter() const;
+
+        // @return the value a projected clustering index stores for obj: those of
+        // obj's top-level fields that are in clusteringFields().
+        BSONObj projectClusteringFields(const BSONObj &obj) const;
+
+        static size_t serializedSize(const BSONObj &keyPattern,
+                                     const BSONObj &options = BSONObj());
 
     private:
         void fieldNames(vector<const char *> &fields) const;
 
+        // @return the version 2 options, empty for earlier versions.
+        BSONObj options() const;
+
 #pragma pack(1)
         // Descriptor format:
         //   [
@@ -81,6 +107,9 @@ namespace mongo {
         //     4 bytes: integer number of fields
         //     integer array: array of offsets into subsequent byte array for each field string
         //     byte array: array of null terminated field strings
+        //     (version 2 only) bson object: options, which may have
+        //         clusteringFields: { field: 1, ... },
+        //         partialFilter: { <query> }
         //   ]
         struct Header {
         private:
@@ -88,16 +117,25 @@ namespace mongo {
                 // Version 0 is kind of a fake version.
                 VERSION_0 = 0,
                 VERSION_1 = 1,
-                NEXT_VERSION = 2
+                // Adds options (clustering fields, partial filter). Only
+                // descriptors that have options use this version, so that other
+                // dictionaries can still be opened by older versions.
+                VERSION_2 = 2,
+                NEXT_VERSION = 3
             };
             static const int CURRENT_VERSION = (int) NEXT_VERSION - 1;
 
         public:
-            Header(const Ordering &o, char h, char s, char c, int hs, uint32_t n)
-                : ordering(o), version((char) CURRENT_VERSION), hashed(h), sparse(s), clustering(c),
+            Header(const Ordering &o, char h, char s, char c, int hs, uint32_t n, bool hasOptions)
+                : ordering(o), version((char) (hasOptions ? VERSION_2 : VERSION_1)),
+                  hashed(h), sparse(s), clustering(c),
                   hashSeed(hs), numFields(n) {
             }
 
+            bool hasOptions() const {
+                return version >= VERSION_2;
+            }
+
             Ordering ordering;
             char version;
             char hashed;
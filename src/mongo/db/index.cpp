@@ -26,6 +26,7 @@
 #include "mongo/db/curop.h"
 #include "mongo/db/cursor.h"
 #include "mongo/db/keygenerator.h"
+#include "mongo/db/matcher.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/repl/rs.h"
@@ -75,9 +76,13 @@ namespace mongo {
                             _keyPattern.nFields() == 1 );
             uassert( 16242, "Currently hashed indexes cannot guarantee uniqueness. Use a regular index.",
                             !unique() );
+            uassert( 17373, "Currently hashed indexes cannot have clusteringFields.",
+                            _clusteringFields.isEmpty() );
 
             // Create a descriptor with hashed = true and the appropriate hash seed.
-            _descriptor.reset(new Descriptor(_keyPattern, true, _seed, _sparse, _clustering));
+            _descriptor.reset(new Descriptor(_keyPattern, true, _seed, _sparse, _clustering,
+                                             BSONObj(), _partialFilter));
+            _keyGenerator.reset(_descriptor->makeKeyGenerator());
 
         }
 
@@ -212,19 +217,92 @@ namespace mongo {
         return b.obj();
     }
 
+    // A projected clustering index stores some top-level fields of each
+    // document with its keys, so queries on them can be covered.
+    static BSONObj clusteringFieldsFromInfo(const BSONObj &info) {
+        const BSONElement e = info["clusteringFields"];
+        if (!e.ok()) {
+            return BSONObj();
+        }
+        uassert(17370, "clusteringFields must be a non-empty object, e.g. { a: 1, b: 1 }",
+                e.type() == Object && !e.Obj().isEmpty());
+        uassert(17371, "an index cannot be both clustering and have clusteringFields",
+                !info["clustering"].trueValue());
+        for (BSONObjIterator it(e.Obj()); it.more(); ) {
+            const BSONElement f = it.next();
+            uassert(17372, str::stream() << "clusteringFields can only name top-level fields: "
+                                         << f.fieldName(),
+                    f.trueValue() && f.fieldName()[0] != '$' && strchr(f.fieldName(), '.') == NULL);
+        }
+        return e.Obj().copy();
+    }
+
+    static BSONObj partialFilterFromInfo(const BSONObj &info) {
+        const BSONElement e = info["partialFilterExpression"];
+        if (!e.ok()) {
+            return BSONObj();
+        }
+        uassert(17374, "partialFilterExpression must be a non-empty object",
+                e.type() == Object && !e.Obj().isEmpty());
+        for (BSONObjIterator it(e.Obj()); it.more(); ) {
+            // Top-level operators like $and would hide the fields they depend on.
+            const char *name = it.next().fieldName();
+            uassert(17376, str::stream() << "partialFilterExpression cannot use " << name,
+                    name[0] != '$');
+        }
+        return e.Obj().copy();
+    }
+
     IndexDetails::IndexDetails(const BSONObj &info) :
         _info(stripDropDups(info)),
         _keyPattern(info["key"].Obj().copy()),
         _unique(info["unique"].trueValue()),
         _sparse(info["sparse"].trueValue()),
-        _clustering(info["clustering"].trueValue()) {
+        _clustering(info["clustering"].trueValue()),
+        _clusteringFields(clusteringFieldsFromInfo(info)),
+        _partialFilter(partialFilterFromInfo(info)) {
         verify(!_info.isEmpty());
         verify(!_keyPattern.isEmpty());
+        if (!_partialFilter.isEmpty()) {
+            // The query optimizer compares query constraints to the filter's
+            // field ranges, which is only sound if they describe it exactly.
+            _partialFilterRanges.reset(new FieldRangeSet(parentNS().c_str(), _partialFilter, false, true));
+            uassert(17375, str::stream() << "partialFilterExpression can only use equality, "
+                                         << "$in and range predicates on fields: " << _partialFilter,
+                    _partialFilterRanges->mustBeExactMatchRepresentation() &&
+                    _partialFilterRanges->matchPossible());
+            _partialFilterMatcher.reset(new Matcher(_partialFilter));
+        }
+    }
+
+    bool IndexDetails::matchesPartialFilter(const BSONObj &obj) const {
+        return !_partialFilterMatcher || _partialFilterMatcher->matches(obj);
+    }
+
+    bool IndexDetails::partialFilterImpliedBy(const FieldRangeSet &queryConstraints) const {
+        if (!_partialFilterRanges) {
+            return true;
+        }
+        const map<string, FieldRange> &ranges = _partialFilterRanges->ranges();
+        for (map<string, FieldRange>::const_iterator it = ranges.begin(); it != ranges.end(); ++it) {
+            if (it->second.universal()) {
+                continue;
+            }
+            // Every value the query allows must be one the filter allows.
+            FieldRange outside = queryConstraints.range(it->first.c_str());
+            outside -= it->second;
+            if (!outside.empty()) {
+                return false;
+            }
+        }
+        return true;
     }
 
     IndexDetailsBase::IndexDetailsBase(const BSONObj& info) :
         IndexDetails(info),
-        _descriptor(new Descriptor(_keyPattern, false, 0, _sparse, _clustering)) {
+        _descriptor(new Descriptor(_keyPattern, false, 0, _sparse, _clustering,
+                                   _clusteringFields, _partialFilter)),
+        _keyGenerator(_descriptor->makeKeyGenerator()) {
     }
 
 
@@ -334,7 +412,15 @@ namespace mongo {
     }
 
     void IndexDetailsBase::getKeysFromObject(const BSONObj &obj, BSONObjSet &keys) const {
-        _descriptor->generateKeys(obj, keys);
+        if (!matchesPartialFilter(obj)) {
+            // Documents outside a partial index's filter have no keys.
+            return;
+        }
+        if (_keyGenerator) {
+            _keyGenerator->getKeys(obj, keys);
+        } else {
+            _descriptor->generateKeys(obj, keys);
+        }
     }
 
     IndexDetails::Suitability IndexDetails::suitability(const FieldRangeSet &queryConstraints,
@@ -614,8 +700,16 @@ namespace mongo {
         storage::Key skey(key, pk);
         DBT kdbt = skey.dbt();
         DBT vdbt = storage::dbt_make(NULL, 0);
+        // The loader bypasses generate_row_for_put, so project the
+        // clustering fields here the same way it would.
+        BSONObj projected;
         if (_idx.clustering()) {
             vdbt = storage::dbt_make(val.objdata(), val.objsize());
+        } else if (!_idx.clusteringFields().isEmpty()) {
+            projected = _idx._descriptor->projectClusteringFields(val);
+            if (!projected.isEmpty()) {
+                vdbt = storage::dbt_make(projected.objdata(), projected.objsize());
+            }
         }
         const int r = _loader.put(&kdbt, &vdbt);
         if (r != 0) {
@@ -678,6 +772,10 @@ namespace mongo {
     shared_ptr<storage::Cursor> PartitionedIndexDetails::getCursor(const int flags) const {
         uasserted(17243, "should not call getCursor on a PartitionedIndexDetails");
     }
+
+    shared_ptr<storage::Cursor> PartitionedIndexDetails::getCursor(DB_TXN *txn, const int flags) const {
+        uasserted(17380, "should not call getCursor on a PartitionedIndexDetails");
+    }
     
     IndexDetails& PartitionedIndexDetails::getIndexDetailsOfPartition(uint64_t i) const {
         const int idxNum = _pc->findIndexByName(indexName());
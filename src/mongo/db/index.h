@@ -42,6 +42,7 @@ namespace mongo {
     class Collection;
     class FieldRangeSet;
     class IndexDetailsBase;
+    class Matcher;
     class PartitionedCollection;
 
     // Represents an index of a collection.
@@ -161,6 +162,29 @@ namespace mongo {
             return _clustering;
         }
 
+        /**
+         * @return the fields a projected clustering index stores with each key,
+         *         as { field: 1, ... }, or an empty object for other indexes.
+         */
+        const BSONObj &clusteringFields() const {
+            return _clusteringFields;
+        }
+
+        /** @return the filter of a partial index, or an empty object for other indexes. */
+        const BSONObj &partialFilter() const {
+            return _partialFilter;
+        }
+
+        /** @return true if obj is indexed, that is, it matches the partial filter if any. */
+        bool matchesPartialFilter(const BSONObj &obj) const;
+
+        /**
+         * @return true if every document that can match a query with the given
+         *         constraints matches the partial filter, so that the index holds
+         *         all of the query's results.  Always true if the index is not partial.
+         */
+        bool partialFilterImpliedBy(const FieldRangeSet &queryConstraints) const;
+
         string toString() const {
             return _info.toString();
         }
@@ -238,6 +262,8 @@ namespace mongo {
         // access to IndexDetailsBase directly somehow
         // This is a workaround to get going for now
         virtual shared_ptr<storage::Cursor> getCursor(const int flags) const = 0;
+        // a cursor in txn instead of the client's transaction, see ScanReadAhead
+        virtual shared_ptr<storage::Cursor> getCursor(DB_TXN *txn, const int flags) const = 0;
 
     protected:
         // Info about the index. Stored on disk in the database.ns dictionary
@@ -250,6 +276,11 @@ namespace mongo {
         const bool _unique;
         const bool _sparse;
         const bool _clustering;
+        const BSONObj _clusteringFields;
+        const BSONObj _partialFilter;
+        // Compiled from _partialFilter, NULL if the index is not partial.
+        scoped_ptr<Matcher> _partialFilterMatcher;
+        scoped_ptr<FieldRangeSet> _partialFilterRanges;
 
     private:
         mutable AccessStats _accessStats;
@@ -309,6 +340,12 @@ namespace mongo {
             return ret;
         }
 
+        shared_ptr<storage::Cursor> getCursor(DB_TXN *txn, const int flags) const {
+            shared_ptr<storage::Cursor> ret;
+            ret.reset(new storage::Cursor(db(), txn, flags));
+            return ret;
+        }
+
         class Builder {
         public:
             Builder(IndexDetailsBase &idx);
@@ -362,6 +399,9 @@ namespace mongo {
         // in by subclass constructors.
         scoped_ptr<Descriptor> _descriptor;
 
+        // Compiled from _descriptor, and reset() along with it.  NULL for hashed indexes.
+        scoped_ptr<KeyGenerator> _keyGenerator;
+
     private:        
         // Must be called after constructor. Opens the ydb dictionary
         // using _descriptor, which is set by subclass constructors.
@@ -455,6 +495,7 @@ namespace mongo {
         // access to IndexDetailsBase directly somehow
         // This is a workaround to get going for now
         virtual shared_ptr<storage::Cursor> getCursor(const int flags) const;
+        virtual shared_ptr<storage::Cursor> getCursor(DB_TXN *txn, const int flags) const;
     private:
         IndexDetails& getIndexDetailsOfPartition(uint64_t i)  const;
         // This cannot be a shared_ptr, as this is a circular reference
@@ -23,6 +23,8 @@
 #include "mongo/db/jsobj.h"
 #include "mongo/db/queryutil.h"
 #include "mongo/db/collection.h"
+#include "mongo/db/scan_read_ahead.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
@@ -167,6 +169,8 @@ namespace mongo {
         _boundsMustMatch(true),
         _nscanned(0),
         _nscannedObjects(0),
+        _nseeks(0),
+        _nbufferedSeeks(0),
         _prelock(!cc().opSettings().getJustOne() && numWanted == 0),
         _tailable(false),
         _ok(false),
@@ -195,6 +199,8 @@ namespace mongo {
         _boundsMustMatch(true),
         _nscanned(0),
         _nscannedObjects(0),
+        _nseeks(0),
+        _nbufferedSeeks(0),
         _prelock(!cc().opSettings().getJustOne() && numWanted == 0),
         _tailable(false),
         _ok(false),
@@ -263,6 +269,7 @@ namespace mongo {
                 storage::Key sKey(key);
                 buffer->append(sKey, val->size > 0 ?
                         BSONObj(static_cast<const char *>(val->data)) : BSONObj());
+                info->bytes_fetched += key->size + val->size;
 
                 // request more bulk fetching if we are allowed to fetch more rows
                 // and the row buffer is not too full.
@@ -385,6 +392,33 @@ namespace mongo {
         }
     }
 
+    // Cursors that take no row locks prelock only to get prefetching, so they don't need
+    // every combination of intervals locked separately: one range per interval of the
+    // leading field, spanning the rest of the bounds, covers everything the scan will touch
+    // in that interval.
+    void IndexCursor::_prelockLeadingIntervals() {
+        BufBuilder startKeyBuilder(512);
+        BufBuilder endKeyBuilder(512);
+
+        const vector<FieldRange> &ranges = _bounds->ranges();
+        const vector<FieldInterval> &intervals = ranges[0].intervals();
+        for ( vector<FieldInterval>::const_iterator i = intervals.begin();
+              i != intervals.end(); i++ ) {
+            startKeyBuilder.reset(512);
+            endKeyBuilder.reset(512);
+            BSONObjBuilder startKey(startKeyBuilder);
+            BSONObjBuilder endKey(endKeyBuilder);
+            startKey.appendAs( i->_lower._bound, "" );
+            endKey.appendAs( i->_upper._bound, "" );
+            for ( vector<FieldRange>::const_iterator r = ranges.begin() + 1;
+                  r != ranges.end(); r++ ) {
+                startKey.appendAs( r->intervals().front()._lower._bound, "" );
+                endKey.appendAs( r->intervals().back()._upper._bound, "" );
+            }
+            _prelockRange( startKey.done(), endKey.done() );
+        }
+    }
+
     // The ydb prelocking API serves two purposes: to enable prefetching
     // and acquire row locks. Row locks are acquired by serializable
     // transactions, serializable cursors, and RMW (write) cursors.
@@ -408,14 +442,14 @@ namespace mongo {
     // have done anything. For non-points, we can't make any guess as to
     // how much data is in that range.
     void IndexCursor::prelock() {
-        if (cc().txn().serializable() ||
-            cc().opSettings().getQueryCursorMode() != DEFAULT_LOCK_CURSOR ||
-            _bounds == NULL || !_bounds->prefixedByPointInterval()) {
-            if ( _bounds != NULL ) {
-                _prelockBounds();
-            } else {
-                _prelockRange( _startKey, _endKey );
-            }
+        const bool takesRowLocks = cc().txn().serializable() ||
+                                   cc().opSettings().getQueryCursorMode() != DEFAULT_LOCK_CURSOR;
+        if ( _bounds == NULL ) {
+            _prelockRange( _startKey, _endKey );
+        } else if ( takesRowLocks ) {
+            _prelockBounds();
+        } else if ( !_bounds->prefixedByPointInterval() ) {
+            _prelockLeadingIntervals();
         }
     }
 
@@ -493,6 +527,12 @@ namespace mongo {
     void IndexCursor::getCurrentFromBuffer() {
         storage::Key sKey;
         _buffer.current(sKey, _currObj);
+        if ( !_idx.clusteringFields().isEmpty() ) {
+            // The row holds only some of the document's fields, current() still
+            // has to go to the primary key for the rest.
+            _currClusteringFields = _currObj;
+            _currObj = BSONObj();
+        }
 
         _currKeyBufBuilder.reset(512);
         _currKey = sKey.key(_currKeyBufBuilder);
@@ -502,12 +542,46 @@ namespace mongo {
         }
     }
 
+    // Bounds skips usually land a short way ahead of the current key, which on a bulk
+    // fetching cursor is often a row we have already buffered.  The buffer holds the rows
+    // following the current one in cursor order, so the first buffered row at or past the
+    // target is exactly where the getf would land.
+    bool IndexCursor::setPositionFromBuffer(const BSONObj &key, const BSONObj &pk) {
+        if ( !ok() ) {
+            return false;
+        }
+        const storage::Key target( key, !pk.isEmpty() ? &pk : NULL );
+        storage::Key sKey;
+        BSONObj obj;
+        while ( _buffer.next() ) {
+            _buffer.current(sKey, obj);
+            const int c = sKey.woCompare(target, _ordering);
+            if ( forward() ? c >= 0 : c <= 0 ) {
+                getCurrentFromBuffer();
+                TOKULOG(3) << "setPosition hit buffered K, PK, Obj " << _currKey << _currPK << _currObj << endl;
+                return true;
+            }
+        }
+        return false;
+    }
+
     void IndexCursor::setPosition(const BSONObj &key, const BSONObj &pk) {
         TOKULOG(3) << toString() << ": setPosition(): getf " << key << ", pk " << pk << ", direction " << _direction << endl;
 
-        // Empty row buffer, reset fetch iteration, go get more rows.
+        if ( _bounds != NULL && setPositionFromBuffer(key, pk) ) {
+            _nbufferedSeeks++;
+            return;
+        }
+        _nseeks++;
+
+        // Empty row buffer, go get more rows.  A bounds skip continues the same scan a little
+        // further on, so the fetch size keeps growing as it would have without the skip (a
+        // fetch stops once the buffer is gorged anyway).  Anything else starts over with
+        // single row fetches, to optimize point queries.
         _buffer.empty();
-        _getf_iteration = 0;
+        if ( _bounds == NULL ) {
+            _getf_iteration = 0;
+        }
 
         storage::Key sKey( key, !pk.isEmpty() ? &pk : NULL );
         DBT key_dbt = sKey.dbt();;
@@ -714,6 +788,7 @@ again:      while ( !allInclusive && ok() ) {
         int r;
         const int rows_to_fetch = getf_fetch_count();
         struct cursor_getf_extra extra(&_buffer, rows_to_fetch);
+        Timer timer;
         DBC *cursor = _cursor->dbc();
         if ( forward() ) {
             r = cursor->c_getf_next(cursor, getf_flags(), cursor_getf, &extra);
@@ -731,6 +806,9 @@ again:      while ( !allInclusive && ok() ) {
             extra.throwException();
             storage::handle_ydb_error(r);
         }
+        if ( _readAhead ) {
+            _readAhead->noteFetched(extra.bytes_fetched, timer.micros());
+        }
 
         _getf_iteration++;
         return extra.rows_fetched > 0 ? true : false;
@@ -842,6 +920,31 @@ again:      while ( !allInclusive && ok() ) {
         return s;
     }
     
+    void IndexCursor::explainDetails( BSONObjBuilder& b ) const {
+        b.appendNumber( "nseeks", _nseeks );
+        b.appendNumber( "nbufferedSeeks", _nbufferedSeeks );
+        explainReadAhead( b );
+    }
+
+    // Full scans for unfiltered queries, counts, dumps and initial sync read every row, so
+    // they are worth a worker keeping the cache ahead of them.  Scans with a limit, or which
+    // are empty, are not.
+    void IndexCursor::startReadAhead() {
+        if ( !_prelock || !ok() || !cc().opSettings().shouldReadAhead() ) {
+            return;
+        }
+        const bool isSecondary = !_cl->isPKIndex(_idx);
+        const BSONObj &pk = forward() ? minKey : maxKey;
+        const storage::Key sKey( _startKey, isSecondary ? &pk : NULL );
+        _readAhead.reset( ScanReadAhead::make( _idx, sKey, _direction ) );
+    }
+
+    void IndexCursor::explainReadAhead( BSONObjBuilder& b ) const {
+        if ( _readAhead ) {
+            _readAhead->appendStats( b );
+        }
+    }
+
     BSONObj IndexCursor::prettyIndexBounds() const {
         if ( _bounds == NULL ) {
             return BSON( "start" << prettyKey( _startKey ) << "end" << prettyKey( _endKey ) );
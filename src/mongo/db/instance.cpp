@@ -35,6 +35,7 @@
 #include "mongo/base/string_data.h"
 
 #include "mongo/bson/util/atomic_int.h"
+#include "mongo/bson/util/buffer_pool.h"
 
 #include "mongo/db/auth/action_type.h"
 #include "mongo/db/auth/authorization_manager.h"
@@ -61,6 +62,7 @@
 #include "mongo/db/ops/query.h"
 #include "mongo/db/ops/update.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/db/repl/oplog_stream.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/storage/assert_ids.h"
 #include "mongo/db/storage/env.h"
@@ -226,8 +228,19 @@ namespace mongo {
                 Status status = cc().getAuthorizationManager()->checkAuthForQuery(d.getns());
                 uassert(16550, status.reason(), status.isOK());
             }
+            if (isProfileRead(d.getns(), q.query)) {
+                // so the profiled ops that came before this one are visible to it
+                waitForProfileWrites();
+            }
             dbresponse.exhaustNS = runQuery(m, q, op, *resp);
             verify( !resp->empty() );
+            if (!dbresponse.exhaustNS.empty() && str::startsWith(d.getns(), "local.oplog.") && theReplSet) {
+                // A stream's first batch is the query's reply; receivedGetMore notes the rest.
+                QueryResult *qr = (QueryResult *) resp->singleData();
+                if (qr->cursorId) {
+                    oplogStreams.noteSent(qr->cursorId, op.getRemoteString(), resp->size(), qr->nReturned);
+                }
+            }
         }
         catch ( SendStaleConfigException& e ){
             ex.reset( new SendStaleConfigException( e.getns(), e.getInfo().msg, e.getVersionReceived(), e.getVersionWanted() ) );
@@ -306,17 +319,6 @@ namespace mongo {
         ::abort();
     }
 
-    // Profile the current op in an alternate transaction
-    void lockedDoProfile(const Client& c, int op, CurOp& currentOp) {
-        if ( dbHolder().__isLoaded( nsToDatabase( currentOp.getNS() ) , dbpath ) ) {
-            Client::Context ctx(currentOp.getNS(), dbpath);
-            Client::AlternateTransactionStack altStack;
-            Client::Transaction txn(DB_SERIALIZABLE);
-            profile(c, op, currentOp);
-            txn.commit();
-        }
-    }
-
     // Returns false when request includes 'end'
     void assembleResponse( Message &m, DbResponse &dbresponse, const HostAndPort& remote ) {
 
@@ -379,6 +381,9 @@ namespace mongo {
         OpDebug& debug = currentOp.debug();
         debug.op = op;
 
+        BufferPool &bufferPool = BufferPool::forThread();
+        const BufferPool::Stats bufStatsAtStart = bufferPool.stats();
+
         long long logThreshold = cmdLine.slowMS;
         bool shouldLog = logLevel >= 1;
 
@@ -459,6 +464,10 @@ namespace mongo {
         currentOp.ensureStarted();
         currentOp.done();
         debug.executionTime = currentOp.totalTimeMillis();
+        if ( bufferPool.stats().allocs > bufStatsAtStart.allocs ) {
+            debug.bufAllocs = bufferPool.stats().allocs - bufStatsAtStart.allocs;
+            debug.bufReuses = bufferPool.stats().reuses - bufStatsAtStart.reuses;
+        }
 
         logThreshold += currentOp.getExpectedLatencyMs();
 
@@ -467,24 +476,13 @@ namespace mongo {
         }
 
         if ( currentOp.shouldDBProfile( debug.executionTime ) ) {
-            // performance profiling is on
-            if ( Lock::isReadLocked() ) {
-                LOG(1) << "note: not profiling because recursive read lock" << endl;
-            }
-            else {
-                LOCK_REASON(lockReason, "writing to system.profile collection");
-                try {
-                    Lock::DBRead lk( currentOp.getNS(), lockReason );
-                    lockedDoProfile( c, op, currentOp );
-                } catch (RetryWithWriteLock &e) {
-                    Lock::DBWrite lk( currentOp.getNS(), lockReason );
-                    lockedDoProfile( c, op, currentOp );
-                }
-            }
+            // performance profiling is on, the entry is written by the profile writer thread
+            profile( c, op, currentOp );
         }
 
         debug.recordStats();
         debug.reset();
+        bufferPool.reset();
     } /* assembleResponse() */
 
     void receivedKillCursors(Message& m) {
@@ -656,6 +654,10 @@ namespace mongo {
         QueryResult* msgdata = 0;
         GTID last;
         bool isOplog = false;
+        if (str::startsWith(ns, "local.oplog.") && theReplSet) {
+            // a streaming secondary may not have room for the next batch yet
+            oplogStreams.waitForWindow(cursorid);
+        }
         while( 1 ) {
             bool isCursorAuthorized = false;
             try {
@@ -806,6 +808,15 @@ namespace mongo {
             dbresponse.exhaustNS = ns;
         }
 
+        if (isOplog) {
+            if (exhaust) {
+                oplogStreams.noteSent(cursorid, curop.getRemoteString(), resp->size(), msgdata->nReturned);
+            }
+            else {
+                oplogStreams.end(cursorid);
+            }
+        }
+
         return ok;
     }
 
@@ -900,14 +911,14 @@ namespace mongo {
         transaction.commit();
     }
 
-    static void lockedReceivedInsert(const char *ns, Message &m, const vector<BSONObj> &objs, CurOp &op, const bool keepGoing) {
+    static void lockedReceivedInsert(const char *ns, Message &m, const vector<BSONObj> &objs, CurOp &op, const bool keepGoing, const uint64_t flags) {
         // writelock is used to synchronize stepdowns w/ writes
         uassert(10058, "not master", isMasterNs(ns));
 
         Client::Context ctx(ns);
         scoped_ptr<Client::AlternateTransactionStack> altStack(opNeedsAltTxn(ns) ? new Client::AlternateTransactionStack : NULL);
         Client::Transaction transaction(DB_SERIALIZABLE);
-        insertObjects(ns, objs, keepGoing, 0, true);
+        insertObjects(ns, objs, keepGoing, flags, true);
         transaction.commit();
         size_t n = objs.size();
         globalOpCounters.gotInsert(n);
@@ -931,10 +942,16 @@ namespace mongo {
             return;
         }
 
+        // The insert rules are checked along with the BSON, if every document passes there is
+        // no need to check them again one by one.
         vector<BSONObj> objs;
+        bool allInsertable = true;
         while (d.moreJSObjs()) {
-            objs.push_back(d.nextJsObj());
+            bool insertable;
+            objs.push_back(d.nextInsertObj(&insertable));
+            allInsertable = allInsertable && insertable;
         }
+        const uint64_t flags = allInsertable ? Collection::INSERT_RULES_CHECKED : 0;
 
         const bool keepGoing = d.reservedField() & InsertOption_ContinueOnError;
 
@@ -961,11 +978,11 @@ namespace mongo {
         LOCK_REASON(lockReason, "insert");
         try {
             Lock::DBRead lk(ns, lockReason);
-            lockedReceivedInsert(ns, m, objs, op, keepGoing);
+            lockedReceivedInsert(ns, m, objs, op, keepGoing, flags);
         }
         catch (RetryWithWriteLock &e) {
             Lock::DBWrite lk(ns, lockReason);
-            lockedReceivedInsert(ns, m, objs, op, keepGoing);
+            lockedReceivedInsert(ns, m, objs, op, keepGoing, flags);
         }
     }
 
@@ -19,16 +19,26 @@
 
 #include "mongo/pch.h"
 
+#include <boost/thread/condition.hpp>
+#include <boost/thread/tss.hpp>
+
+#include "mongo/base/counter.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/principal_set.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/database.h"
 #include "mongo/db/databaseholder.h"
 #include "mongo/db/introspect.h"
 #include "mongo/db/curop.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/namespacestring.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/db/relock.h"
+#include "mongo/platform/random.h"
+#include "mongo/util/background.h"
+#include "mongo/util/concurrency/spin_lock.h"
 #include "mongo/util/goodies.h"
 
 namespace mongo {
@@ -59,12 +69,135 @@ namespace {
         builder.append("user", bestUser.getUser().empty() ? "" : bestUser.getFullName());
 
     }
-} // namespace
 
-    static void _profile(const Client& c, CurOp& currentOp, BufBuilder& profileBufBuilder) {
-        Database *db = c.database();
-        DEV verify( db );
+    Counter64 profileEntriesQueued;
+    Counter64 profileEntriesWritten;
+    Counter64 profileEntriesDropped;
+    ServerStatusMetricField<Counter64> profileEntriesQueuedDisplay("profiler.queued", &profileEntriesQueued);
+    ServerStatusMetricField<Counter64> profileEntriesWrittenDisplay("profiler.written", &profileEntriesWritten);
+    ServerStatusMetricField<Counter64> profileEntriesDroppedDisplay("profiler.dropped", &profileEntriesDropped);
+
+    /**
+     * Profile entries waiting for the writer thread.  Client threads only hold the spin lock
+     * long enough to copy an entry into the ring, and never wait on the database: when the
+     * writer falls behind and the ring is full, new entries are dropped and counted.
+     */
+    class ProfileQueue : boost::noncopyable {
+    public:
+        struct Entry {
+            string profileNS;
+            BSONObj obj;
+        };
+
+        ProfileQueue() : _ring(Capacity), _head(0), _size(0), _pushed(0), _written(0),
+                         _flushMutex("profileQueue") {}
+
+        void push(const string& profileNS, const BSONObj& obj) {
+            {
+                scoped_spinlock lk(_lock);
+                if (_size < Capacity) {
+                    Entry& e = _ring[(_head + _size) % Capacity];
+                    e.profileNS = profileNS;
+                    e.obj = obj;
+                    _size++;
+                    _pushed++;
+                    profileEntriesQueued.increment();
+                    return;
+                }
+            }
+            profileEntriesDropped.increment();
+            static time_t last = 0;
+            if (time(0) > last + 10) {
+                warning() << "profiler can't keep up, dropping entries for " << profileNS << endl;
+                last = time(0);
+            }
+        }
 
+        /** Move everything queued into out. @return the sequence number of the last entry. */
+        unsigned long long popAll(vector<Entry>& out) {
+            scoped_spinlock lk(_lock);
+            out.reserve(_size);
+            for (; _size > 0; _size--) {
+                Entry& e = _ring[_head];
+                out.push_back(e);
+                e.obj = BSONObj();
+                _head = (_head + 1) % Capacity;
+            }
+            return _pushed;
+        }
+
+        /** Called by the writer once everything up to seq is written (or given up on). */
+        void noteWritten(unsigned long long seq) {
+            scoped_lock lk(_flushMutex);
+            _written = seq;
+            _writtenCond.notify_all();
+        }
+
+        void waitForWrites() {
+            unsigned long long target;
+            {
+                scoped_spinlock lk(_lock);
+                target = _pushed;
+            }
+            scoped_lock lk(_flushMutex);
+            _workCond.notify_one();
+            const boost::xtime deadline = incxtimemillis(5000);
+            while (_written < target) {
+                if (!_writtenCond.timed_wait(lk.boost(), deadline)) {
+                    warning() << "timed out waiting for the profiler to write entries" << endl;
+                    return;
+                }
+            }
+        }
+
+        /** Writer side: sleep until there's work, a flush request, or the timeout. */
+        void waitForWork(int millis) {
+            scoped_lock lk(_flushMutex);
+            _workCond.timed_wait(lk.boost(), incxtimemillis(millis));
+        }
+
+    private:
+        static const size_t Capacity = 4096;
+
+        SpinLock _lock;
+        vector<Entry> _ring;
+        size_t _head;
+        size_t _size;
+        unsigned long long _pushed;
+
+        mongo::mutex _flushMutex;
+        unsigned long long _written;
+        boost::condition _writtenCond;
+        boost::condition _workCond;
+    } profileQueue;
+
+    double profileSampleRate = 1.0;
+
+    bool sampled() {
+        const double rate = profileSampleRate;
+        if (rate >= 1.0) {
+            return true;
+        }
+        if (rate <= 0.0) {
+            return false;
+        }
+        static boost::thread_specific_ptr<PseudoRandom> random;
+        if (!random.get()) {
+            random.reset(new PseudoRandom(static_cast<int64_t>(curTimeMicros64()) ^
+                                          reinterpret_cast<int64_t>(&random)));
+        }
+        const uint32_t r = static_cast<uint32_t>(random->nextInt32());
+        return r < rate * 4294967296.0;
+    }
+
+    SimpleMutex nsSlowMSMutex("profileSlowMS");
+    map<string, int> nsSlowMS;
+    // lets shouldProfile skip the lookup when no namespace has its own threshold
+    AtomicUInt numNSSlowMS;
+
+} // namespace
+
+    static BSONObj _profile(const Client& c, CurOp& currentOp, BufBuilder& profileBufBuilder) {
         // build object
         BSONObjBuilder b(profileBufBuilder);
         b.appendDate("ts", jsTime());
@@ -95,22 +228,16 @@ namespace {
             p = b.done();
         }
 
-        // get or create the profiling collection
-        Collection *cl = getOrCreateProfileCollection(db);
-        if (cl) {
-            insertOneObject(cl, p);
-        }
+        return p.getOwned();
     }
 
     void profile(const Client& c, int op, CurOp& currentOp) {
-        Lock::assertAtLeastReadLocked(currentOp.getNS());
-
         // initialize with 1kb to start, to avoid realloc later
-        // doing this outside the dblock to improve performance
         BufBuilder profileBufBuilder(1024);
 
         try {
-            _profile(c, currentOp, profileBufBuilder);
+            BSONObj p = _profile(c, currentOp, profileBufBuilder);
+            profileQueue.push(getSisterNS(currentOp.getNS(), "system.profile"), p);
         }
         catch (const AssertionException& assertionEx) {
             warning() << "Caught Assertion while trying to profile " << opToString(op)
@@ -119,6 +246,141 @@ namespace {
         }
     }
 
+    bool shouldProfile(int level, const StringData& ns, int ms) {
+        if (level <= 0) {
+            return false;
+        }
+        if (level < 2) {
+            int slowMS = cmdLine.slowMS;
+            if (numNSSlowMS.get() > 0) {
+                SimpleMutex::scoped_lock lk(nsSlowMSMutex);
+                map<string, int>::const_iterator it = nsSlowMS.find(ns.toString());
+                if (it != nsSlowMS.end()) {
+                    slowMS = it->second;
+                }
+            }
+            if (ms < slowMS) {
+                return false;
+            }
+        }
+        return sampled();
+    }
+
+    void setProfileSlowMS(const string& ns, int ms) {
+        SimpleMutex::scoped_lock lk(nsSlowMSMutex);
+        if (ms < 0) {
+            nsSlowMS.erase(ns);
+        } else {
+            nsSlowMS[ns] = ms;
+        }
+        numNSSlowMS.set(nsSlowMS.size());
+    }
+
+    void appendProfileSlowMS(const StringData& db, BSONObjBuilder& b) {
+        SimpleMutex::scoped_lock lk(nsSlowMSMutex);
+        for (map<string, int>::const_iterator it = nsSlowMS.begin(); it != nsSlowMS.end(); ++it) {
+            if (nsToDatabaseSubstring(it->first) == db) {
+                b.append(it->first, it->second);
+            }
+        }
+    }
+
+    double getProfileSampleRate() {
+        return profileSampleRate;
+    }
+
+    void setProfileSampleRate(double rate) {
+        profileSampleRate = std::max(0.0, std::min(1.0, rate));
+    }
+
+    void waitForProfileWrites() {
+        profileQueue.waitForWrites();
+    }
+
+    bool isProfileRead(const StringData& ns, const BSONObj& query) {
+        const NamespaceString nss(ns.toString());
+        if (nss.coll == "system.profile") {
+            return true;
+        }
+        if (nss.isCommand()) {
+            // collStats, count, etc. name their collection in the first element
+            const BSONElement e = query.firstElement();
+            if (str::equals(e.fieldName(), "query") || str::equals(e.fieldName(), "$query")) {
+                return isProfileRead(ns, e.isABSONObj() ? e.Obj() : BSONObj());
+            }
+            return e.type() == String && str::equals(e.valuestr(), "system.profile");
+        }
+        return false;
+    }
+
+    static void writeProfileEntries(const string& profileNS, const vector<BSONObj>& entries) {
+        if (!dbHolder().__isLoaded(nsToDatabase(profileNS), dbpath)) {
+            // dropped since the ops were profiled
+            return;
+        }
+        Client::Context ctx(profileNS, dbpath);
+        Client::Transaction txn(DB_SERIALIZABLE);
+        Collection *cl = getOrCreateProfileCollection(ctx.db());
+        if (cl) {
+            for (vector<BSONObj>::const_iterator it = entries.begin(); it != entries.end(); ++it) {
+                BSONObj p = *it;
+                insertOneObject(cl, p);
+            }
+        }
+        txn.commit();
+        profileEntriesWritten.increment(entries.size());
+    }
+
+    /**
+     * Drains the profile queue into system.profile, one transaction per database per batch, so
+     * client threads never take the locks or open the transactions needed to write there.
+     */
+    class ProfileWriter : public BackgroundJob {
+    public:
+        virtual string name() const { return "ProfileWriter"; }
+
+        virtual void run() {
+            Client::initThread(name().c_str());
+            while (!inShutdown()) {
+                profileQueue.waitForWork(100);
+
+                vector<ProfileQueue::Entry> entries;
+                const unsigned long long seq = profileQueue.popAll(entries);
+
+                // group by database, keeping each one's entries in order
+                map<string, vector<BSONObj> > byNS;
+                for (vector<ProfileQueue::Entry>::const_iterator it = entries.begin();
+                     it != entries.end(); ++it) {
+                    byNS[it->profileNS].push_back(it->obj);
+                }
+                for (map<string, vector<BSONObj> >::const_iterator it = byNS.begin();
+                     it != byNS.end(); ++it) {
+                    const string& ns = it->first;
+                    LOCK_REASON(lockReason, "writing to system.profile collection");
+                    try {
+                        try {
+                            Lock::DBRead lk(ns, lockReason);
+                            writeProfileEntries(ns, it->second);
+                        } catch (RetryWithWriteLock &e) {
+                            Lock::DBWrite lk(ns, lockReason);
+                            writeProfileEntries(ns, it->second);
+                        }
+                    } catch (const DBException& e) {
+                        warning() << "Caught exception while writing " << it->second.size()
+                                  << " entries to " << ns << ": " << e.toString() << endl;
+                    }
+                }
+                profileQueue.noteWritten(seq);
+            }
+            cc().shutdown();
+        }
+    };
+
+    void startProfileWriter() {
+        ProfileWriter* writer = new ProfileWriter();
+        writer->go();
+    }
+
     Collection *getOrCreateProfileCollection(Database *db, bool force) {
         fassert(16372, db);
         const char *profileName = db->profileName().c_str();
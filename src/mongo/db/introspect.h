@@ -32,8 +32,38 @@ namespace mongo {
        do when database->profile is set
     */
 
+    /**
+     * Build the profile entry for currentOp and queue it for the profile writer thread, which
+     * inserts it into system.profile.  Doesn't take any locks.
+     */
     void profile(const Client& c, int op, CurOp& currentOp);
 
+    /**
+     * @return true if an op on ns that took ms should be profiled at the given level, according
+     * to the slowms threshold for ns (or the global one) and the profiler's sample rate.
+     */
+    bool shouldProfile(int level, const StringData& ns, int ms);
+
+    /** Set the slowms threshold for ops on ns, overriding the global one.  Negative clears it. */
+    void setProfileSlowMS(const string& ns, int ms);
+    /** Append the per-namespace slowms thresholds set for db, as { <ns>: <ms>, ... }. */
+    void appendProfileSlowMS(const StringData& db, BSONObjBuilder& b);
+
+    /** The fraction of ops that pass the level and slowms checks which are profiled. */
+    double getProfileSampleRate();
+    void setProfileSampleRate(double rate);
+
+    /**
+     * Wait until the profile entries queued before this call are in system.profile, so that
+     * reads of it see the ops that preceded them.  Must be called without holding a lock.
+     */
+    void waitForProfileWrites();
+
+    /** @return true if the query (or command) on ns reads from a system.profile collection. */
+    bool isProfileRead(const StringData& ns, const BSONObj& query);
+
+    void startProfileWriter();
+
     /**
      * Get (or create) the profile collection
      *
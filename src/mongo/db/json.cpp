@@ -40,8 +40,8 @@ namespace mongo {
         ID_RESERVE_SIZE = 64,
         PAT_RESERVE_SIZE = 4096,
         OPT_RESERVE_SIZE = 64,
-        FIELD_RESERVE_SIZE = 4096,
-        STRINGVAL_RESERVE_SIZE = 4096,
+        FIELD_RESERVE_SIZE = 64,
+        STRINGVAL_RESERVE_SIZE = 64,
         BINDATA_RESERVE_SIZE = 4096,
         BINDATATYPE_RESERVE_SIZE = 4096,
         NS_RESERVE_SIZE = 64
@@ -59,6 +59,33 @@ namespace mongo {
                  *SINGLEQUOTE = "'",
                  *DOUBLEQUOTE = "\"";
 
+    /*
+     * Returns the first character in [p, end) that is terminal, a backslash or a control
+     * character, or end if there is none.  Checks eight bytes at a time, since most strings in
+     * imported data have long runs without escapes.
+     */
+    static const char* findSpecialChar(const char* p, const char* end, char terminal) {
+        const unsigned long long ones = 0x0101010101010101ULL;
+        const unsigned long long highs = 0x8080808080808080ULL;
+        const unsigned long long terminals = ones * static_cast<unsigned char>(terminal);
+        const unsigned long long backslashes = ones * static_cast<unsigned char>('\\');
+        while (end - p >= 8) {
+            unsigned long long v;
+            memcpy(&v, p, sizeof v);
+            const unsigned long long t = v ^ terminals;
+            const unsigned long long b = v ^ backslashes;
+            // the high bit of a byte is set in each term iff some byte is zero (resp. < 0x20)
+            if ((((t - ones) & ~t) | ((b - ones) & ~b) | ((v - ones * 0x20) & ~v)) & highs) {
+                break;
+            }
+            p += 8;
+        }
+        while (p < end && *p != terminal && *p != '\\' && !(0x00 <= *p && *p <= 0x1F)) {
+            ++p;
+        }
+        return p;
+    }
+
     JParse::JParse(const char* str)
         : _buf(str), _input(str), _input_end(str + strlen(str)) {}
 
@@ -72,7 +99,33 @@ namespace mongo {
 
     Status JParse::value(const StringData& fieldName, BSONObjBuilder& builder) {
         MONGO_JSON_DEBUG("fieldName: " << fieldName);
-        if (accept(LBRACE, false)) {
+        // Strings and plain numbers are the most common values and can't be mistaken for any of
+        // the keywords, so check for them before trying each keyword in turn.
+        const char* next = _input;
+        while (next < _input_end && isspace(*next)) {
+            ++next;
+        }
+        const bool isNumber = next < _input_end &&
+                (isdigit(static_cast<unsigned char>(*next)) ||
+                 (*next == '-' && next + 1 < _input_end &&
+                  isdigit(static_cast<unsigned char>(next[1]))));
+
+        if (accept(DOUBLEQUOTE, false) || accept(SINGLEQUOTE, false)) {
+            std::string valueString;
+            valueString.reserve(STRINGVAL_RESERVE_SIZE);
+            Status ret = quotedString(&valueString);
+            if (ret != Status::OK()) {
+                return ret;
+            }
+            builder.append(fieldName, valueString);
+        }
+        else if (isNumber) {
+            Status ret = number(fieldName, builder);
+            if (ret != Status::OK()) {
+                return ret;
+            }
+        }
+        else if (accept(LBRACE, false)) {
             Status ret = object(fieldName, builder);
             if (ret != Status::OK()) {
                 return ret;
@@ -120,15 +173,6 @@ namespace mongo {
                 return ret;
             }
         }
-        else if (accept(DOUBLEQUOTE, false) || accept(SINGLEQUOTE, false)) {
-            std::string valueString;
-            valueString.reserve(STRINGVAL_RESERVE_SIZE);
-            Status ret = quotedString(&valueString);
-            if (ret != Status::OK()) {
-                return ret;
-            }
-            builder.append(fieldName, valueString);
-        }
         else if (accept("true")) {
             builder.append(fieldName, true);
         }
@@ -714,6 +758,43 @@ namespace mongo {
     }
 
     Status JParse::number(const StringData& fieldName, BSONObjBuilder& builder) {
+        // Fast path for integers short enough that they can't overflow, which covers most numbers
+        // in imported data: accumulate the digits directly instead of running both strtod and
+        // strtoll over them.  Anything with a fraction, exponent or hex prefix, or that is too
+        // long, falls through to the general path.
+        {
+            const char* p = _input;
+            while (p < _input_end && isspace(*p)) {
+                ++p;
+            }
+            const bool negative = p < _input_end && *p == '-';
+            if (negative) {
+                ++p;
+            }
+            const char* digits = p;
+            long long ret = 0;
+            while (p < _input_end && p - digits < 18 && isdigit(static_cast<unsigned char>(*p))) {
+                ret = ret * 10 + (*p - '0');
+                ++p;
+            }
+            if (p > digits && p < _input_end && !isdigit(static_cast<unsigned char>(*p)) &&
+                    !match(*p, ".eExX")) {
+                if (negative) {
+                    ret = -ret;
+                }
+                if (ret == static_cast<int>(ret)) {
+                    MONGO_JSON_DEBUG("Type: 32 bit int");
+                    builder.append(fieldName, static_cast<int>(ret));
+                }
+                else {
+                    MONGO_JSON_DEBUG("Type: 64 bit int");
+                    builder.append(fieldName, ret);
+                }
+                _input = p;
+                return Status::OK();
+            }
+        }
+
         char* endptrll;
         char* endptrd;
         long long retll;
@@ -812,8 +893,19 @@ namespace mongo {
             return parseError("Unexpected end of input");
         }
         const char* q = _input;
+        // With a single terminal and no allowed set, copy runs of ordinary characters in bulk.
+        const bool bulkCopy = allowedSet == NULL && terminalSet[0] != '\0' &&
+                              terminalSet[1] == '\0';
         while (q < _input_end && !match(*q, terminalSet)) {
             MONGO_JSON_DEBUG("q: " << q);
+            if (bulkCopy) {
+                const char* run = findSpecialChar(q, _input_end, terminalSet[0]);
+                if (run > q) {
+                    result->append(q, run - q);
+                    q = run;
+                    continue;
+                }
+            }
             if (allowedSet != NULL) {
                 if (!match(*q, allowedSet)) {
                     _input = q;
@@ -18,6 +18,7 @@
 */
 
 #include "mongo/pch.h"
+#include "mongo/bson/util/buffer_pool.h"
 #include "mongo/db/hasher.h"
 #include "mongo/db/keygenerator.h"
 #include "mongo/db/storage/assert_ids.h"
@@ -54,13 +55,155 @@ namespace mongo {
         }
     }
 
+    KeyGenerator::KeyGenerator(const vector<const char *> &fieldNames,
+                               const bool sparse) :
+        _fieldNames(fieldNames),
+        _sparse(sparse) {
+        compile();
+    }
+
+    void KeyGenerator::compile() {
+        if (_fieldNames.empty() || _fieldNames.size() > MaxPlanWidth) {
+            return;
+        }
+        _plan.push_back(PathNode());
+        for (size_t i = 0; i < _fieldNames.size(); i++) {
+            int cur = 0;
+            for (const char *p = _fieldNames[i]; ; ) {
+                const char *dot = strchr(p, '.');
+                const string part = dot != NULL ? string(p, dot - p) : string(p);
+                if (part.empty()) {
+                    // Not a path the plan knows how to walk, leave it to the general algorithm.
+                    _plan.clear();
+                    return;
+                }
+                int next = -1;
+                for (size_t c = 0; c < _plan[cur].children.size(); c++) {
+                    if (_plan[_plan[cur].children[c]].name == part) {
+                        next = _plan[cur].children[c];
+                        break;
+                    }
+                }
+                if (next < 0) {
+                    // push_back may move the nodes, so refer to them by index only.
+                    next = _plan.size();
+                    _plan.push_back(PathNode());
+                    _plan[next].name = part;
+                    _plan[cur].children.push_back(next);
+                }
+                cur = next;
+                if (dot == NULL) {
+                    break;
+                }
+                p = dot + 1;
+            }
+            _plan[cur].fields.push_back(i);
+        }
+    }
+
+    bool KeyGenerator::extract(const PathNode &node, const BSONObj &obj, BSONElement *fixed,
+                               BSONElement &arrElt, unsigned &arrFields, int &numFound) const {
+        // Like getFieldDottedOrArray(), only the first field with a given name counts.
+        unsigned seen = 0;
+        size_t remaining = node.children.size();
+        for (BSONObjIterator it(obj); remaining > 0 && it.more(); ) {
+            const BSONElement e = it.next();
+            const char *name = e.fieldName();
+            for (size_t c = 0; c < node.children.size(); c++) {
+                const unsigned bit = 1U << c;
+                const PathNode &child = _plan[node.children[c]];
+                if ((seen & bit) || strcmp(child.name.c_str(), name) != 0) {
+                    continue;
+                }
+                seen |= bit;
+                remaining--;
+                if (e.type() == Array) {
+                    if (!child.children.empty()) {
+                        // Expanding an array in the middle of a path has subtle rules.
+                        return false;
+                    }
+                    if (!arrElt.eoo() && arrElt.rawdata() != e.rawdata()) {
+                        // Parallel arrays, let the general algorithm report them.
+                        return false;
+                    }
+                    arrElt = e;
+                    for (size_t f = 0; f < child.fields.size(); f++) {
+                        arrFields |= 1U << child.fields[f];
+                        numFound++;
+                    }
+                }
+                else {
+                    for (size_t f = 0; f < child.fields.size(); f++) {
+                        fixed[child.fields[f]] = e;
+                        numFound++;
+                    }
+                    // Paths through a non-object are missing.
+                    if (!child.children.empty() && e.type() == Object &&
+                        !extract(child, e.embeddedObject(), fixed, arrElt, arrFields, numFound)) {
+                        return false;
+                    }
+                }
+                break;
+            }
+        }
+        return true;
+    }
+
+    bool KeyGenerator::getKeysCompiled(const BSONObj &obj, BSONObjSet &keys) const {
+        BSONElement fixed[MaxPlanWidth];
+        for (size_t i = 0; i < _fieldNames.size(); i++) {
+            fixed[i] = nullElt;
+        }
+        BSONElement arrElt;
+        unsigned arrFields = 0;
+        int numFound = 0;
+        if (!extract(_plan[0], obj, fixed, arrElt, arrFields, numFound)) {
+            return false;
+        }
+
+        if (arrElt.eoo()) {
+            if (numFound == 0 && _sparse) {
+                return true;
+            }
+            appendKey(fixed, 0, BSONElement(), keys);
+            return true;
+        }
+
+        // The array is at the end of its path(s), so each member is a key value
+        // as-is, and an empty array indexes as undefined.
+        const BSONObj members = arrElt.embeddedObject();
+        if (members.isEmpty()) {
+            appendKey(fixed, arrFields, undefinedElt, keys);
+        }
+        for (BSONObjIterator it(members); it.more(); ) {
+            appendKey(fixed, arrFields, it.next(), keys);
+        }
+        return true;
+    }
+
+    void KeyGenerator::appendKey(const BSONElement *fixed, const unsigned arrFields,
+                                 const BSONElement &member, BSONObjSet &keys) const {
+        BSONObjBuilder b(128);
+        for (size_t i = 0; i < _fieldNames.size(); i++) {
+            b.appendAs((arrFields & (1U << i)) ? member : fixed[i], "");
+        }
+        keys.insert(b.obj());
+    }
+
     void KeyGenerator::getKeys(const BSONObj &obj, BSONObjSet &keys) const {
+        if (!_plan.empty()) {
+            BufferPool::Scope pooledBuffers;
+            if (getKeysCompiled(obj, keys)) {
+                return;
+            }
+        }
         vector<const char *> fieldNames(_fieldNames);
         getKeys(obj, fieldNames, _sparse, keys);
-    }     
+    }
 
     void KeyGenerator::getKeys(const BSONObj &obj, vector<const char *> &fieldNames,
                                const bool sparse, BSONObjSet &keys) {
+        BufferPool::Scope pooledBuffers;
         vector<BSONElement> fixed( fieldNames.size() );
         _getKeys( fieldNames , fixed , obj, sparse, keys );
         if ( keys.empty() && ! sparse ) {
@@ -52,13 +52,17 @@ namespace mongo {
     };
 
     // Generates keys for a standard index.
+    //
+    // The constructor compiles the field names into a plan that extracts every
+    // indexed path in one walk over the document, which is what an index wants
+    // when it generates keys for many documents.  Documents the plan cannot
+    // handle (arrays in the middle of an indexed path, more than one array) go
+    // through the general algorithm, so the keys are always the same as the
+    // one-time getKeys() would produce.
     class KeyGenerator {
     public:
         KeyGenerator(const vector<const char *> &fieldNames,
-                     const bool sparse) :
-            _fieldNames(fieldNames),
-            _sparse(sparse) {
-        }
+                     const bool sparse);
 
         void getKeys(const BSONObj &obj, BSONObjSet &keys) const;
 
@@ -91,8 +95,38 @@ namespace mongo {
                               const BSONObj &obj, const bool sparse, BSONObjSet &keys, int numNotFound = 0,
                               const BSONObj &array = BSONObj() );
 
+        // A node of the compiled plan: one component of one or more indexed
+        // paths.  The root is _plan[0] and has an empty name.
+        struct PathNode {
+            string name;
+            vector<int> children;   // indexes into _plan
+            vector<int> fields;     // key positions whose path ends here
+        };
+
+        // Keys with more fields, or nodes with more children, than this are
+        // left to the general algorithm.
+        static const size_t MaxPlanWidth = 32;
+
+        void compile();
+
+        /**
+         * Walks obj once, filling fixed[i] for each key position found below node
+         * and noting in arrFields the positions whose value is the array arrElt.
+         * @return false if obj needs the general algorithm.
+         */
+        bool extract(const PathNode &node, const BSONObj &obj, BSONElement *fixed,
+                     BSONElement &arrElt, unsigned &arrFields, int &numFound) const;
+
+        // @return false, before adding any keys, if obj needs the general algorithm.
+        bool getKeysCompiled(const BSONObj &obj, BSONObjSet &keys) const;
+
+        // Adds the key made of fixed, with member at the positions in arrFields.
+        void appendKey(const BSONElement *fixed, const unsigned arrFields,
+                       const BSONElement &member, BSONObjSet &keys) const;
+
         vector<const char *> _fieldNames;
         const bool _sparse;
+        vector<PathNode> _plan;     // empty if the field names could not be compiled
     };
 
 } // namespace mongo
@@ -80,7 +80,17 @@ namespace mongo {
 
             massert( 10341 ,  "code has to be set first!" , ! _jsCode.empty() );
 
-            _func = _scope->createFunction( _jsCode.c_str() );
+            if ( _scope->createFunction( _jsCode.c_str() ) == 0 )
+                return;
+            // Set obj and fullObject inside the engine rather than with a call into the scope for
+            // each document, and wrap the document once, as this, instead of again for obj.
+            _scope->setFunction( "__where" , _jsCode.c_str() );
+            _func = _scope->createFunction(
+                        "function() {"
+                        "  obj = this;"
+                        "  fullObject = true;" // this is a hack b/c fullObject used to be relevant
+                        "  return __where.call(this);"
+                        "}" );
         }
 
         void setScope( const BSONObj& scope ) {
@@ -98,9 +108,6 @@ namespace mongo {
             if ( ! _jsScope.isEmpty() ) {
                 _scope->init( &_jsScope );
             }
-            _scope->setObject( "obj", const_cast< BSONObj & >( obj ) );
-            _scope->setBoolean( "fullObject" , true ); // this is a hack b/c fullObject used to be relevant
-                
 
             int err = _scope->invoke( _func , 0, &obj , 1000 * 60 , false );
             if ( err == -3 ) { // INVOKE_ERROR
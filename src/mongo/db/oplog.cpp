@@ -31,6 +31,7 @@
 #include "mongo/db/repl.h"
 #include "mongo/db/commands.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/repl/refs_stager.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/stats/counters.h"
 #include "mongo/db/stats/timer_stats.h"
@@ -45,6 +46,7 @@
 #include "mongo/util/elapsed_tracker.h"
 #include "mongo/db/storage/assert_ids.h"
 #include "mongo/db/server_parameters.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
@@ -162,58 +164,112 @@ namespace mongo {
         b.append("ref", oid);
         BSONObj bb = b.done();
         writeEntryToOplog(bb);
-        // If the OID has elements that are not in the last partition,
-        // then we need to update the last partition's metadata to reflect
-        // this, so when it comes time to trimming, we don't
-        // accidentally trim a piece of oplog.refs that is still referenced
-        // by an existing piece of the oplog
-        {
-            Collection* rsOplogRefsDetails = getCollection(rsOplogRefs);
-            verify(rsOplogRefsDetails);
-            PartitionedCollection* pc = rsOplogRefsDetails->as<PartitionedCollection>();
-            uint64_t numRef = pc->numPartitions();
+        noteOplogRefsReferenced(oid, gtid);
+    }
 
-            uint64_t minPartitionInserted = 0;
-            {
-                BSONObjBuilder b;            
-                // build the _id
-                BSONObjBuilder b_id( b.subobjStart( "" ) );
-                b_id.append("oid", oid);
-                // probably not necessary to increment _seq, but safe to do
-                b_id.append("seq", 0);
-                b_id.done();
-                minPartitionInserted = pc->partitionWithPK(b.done());
-            }
-            // only update metadata if there are insertions that happened
-            // in partitions OTHER than the last partition ( < numRef-1)
-            if (minPartitionInserted < numRef - 1) {
-                // use an alternate transaction stack,
-                // so that this work does not get lumped in with
-                // the rest of the transaction's work (which can be big)
-                // If this transaction commits and the current "big" one
-                // does not, that's ok. The maxRefGTID will be bigger
-                // than it has to be, and that is benign.
-                Client::AlternateTransactionStack altStack;
-                Client::Transaction txn(DB_SERIALIZABLE);
-                for (uint64_t i = minPartitionInserted; i < numRef - 1; i++) {
-                    // for each one, update metadata
-                    BSONObj refMeta = pc->getPartitionMetadata(i);
-                    GTID currGTID = getGTIDFromBSON("maxRefGTID", refMeta);
-                    if (GTID::cmp(currGTID, gtid) >= 0) {
-                        // currGTID is already higher, do nothing and return
-                        continue;
-                    }
-                    updateMaxRefGTID(refMeta, i, pc, gtid);
+    // If the OID has elements that are not in the last partition,
+    // then we need to update the last partition's metadata to reflect
+    // this, so when it comes time to trimming, we don't
+    // accidentally trim a piece of oplog.refs that is still referenced
+    // by an existing piece of the oplog
+    void noteOplogRefsReferenced(const OID& oid, GTID gtid) {
+        Collection* rsOplogRefsDetails = getCollection(rsOplogRefs);
+        verify(rsOplogRefsDetails);
+        PartitionedCollection* pc = rsOplogRefsDetails->as<PartitionedCollection>();
+        uint64_t numRef = pc->numPartitions();
+
+        uint64_t minPartitionInserted = 0;
+        {
+            BSONObjBuilder b;            
+            // build the _id
+            BSONObjBuilder b_id( b.subobjStart( "" ) );
+            b_id.append("oid", oid);
+            // probably not necessary to increment _seq, but safe to do
+            b_id.append("seq", 0);
+            b_id.done();
+            minPartitionInserted = pc->partitionWithPK(b.done());
+        }
+        // only update metadata if there are insertions that happened
+        // in partitions OTHER than the last partition ( < numRef-1)
+        if (minPartitionInserted < numRef - 1) {
+            // use an alternate transaction stack,
+            // so that this work does not get lumped in with
+            // the rest of the transaction's work (which can be big)
+            // If this transaction commits and the current "big" one
+            // does not, that's ok. The maxRefGTID will be bigger
+            // than it has to be, and that is benign.
+            Client::AlternateTransactionStack altStack;
+            Client::Transaction txn(DB_SERIALIZABLE);
+            for (uint64_t i = minPartitionInserted; i < numRef - 1; i++) {
+                // for each one, update metadata
+                BSONObj refMeta = pc->getPartitionMetadata(i);
+                GTID currGTID = getGTIDFromBSON("maxRefGTID", refMeta);
+                if (GTID::cmp(currGTID, gtid) >= 0) {
+                    // currGTID is already higher, do nothing and return
+                    continue;
                 }
-                txn.commit();
+                updateMaxRefGTID(refMeta, i, pc, gtid);
             }
+            txn.commit();
         }
     }
 
-    void logOpsToOplogRef(BSONObj o) {
+    // If set, spilled ops that can only be undone by aborting the root transaction are
+    // committed to oplog.refs immediately, so secondaries can stage them before the root
+    // commits. Entries left behind by a root that aborts are never referenced and go away when
+    // their partition is trimmed.
+    MONGO_EXPORT_SERVER_PARAMETER(streamLargeTxnRefs, bool, true);
+
+    // Root transactions whose spilled ops were committed to oplog.refs ahead of their oplog
+    // entry. Nothing moves maxRefGTID for those entries until the entry is written, so
+    // trimOplogRefs must not drop the partitions they are in until the root is done.
+    static SimpleMutex openOplogRefsMutex("openOplogRefs");
+    static set<OID> openOplogRefs;
+
+    void releaseOplogRefs(const OID& oid) {
+        SimpleMutex::scoped_lock lk(openOplogRefsMutex);
+        openOplogRefs.erase(oid);
+    }
+
+    // @return the first partition of oplog.refs that may hold entries of an open root
+    // transaction, or the number of partitions if there is none
+    static uint64_t firstPinnedRefsPartition(PartitionedCollection* pc) {
+        OID oldest;
+        {
+            SimpleMutex::scoped_lock lk(openOplogRefsMutex);
+            if (openOplogRefs.empty()) {
+                return pc->numPartitions();
+            }
+            oldest = *openOplogRefs.begin();
+        }
+        // OIDs increase over time, so the oldest open transaction has the lowest _id of them all
+        BSONObjBuilder b;
+        BSONObjBuilder b_id( b.subobjStart( "" ) );
+        b_id.append("oid", oldest);
+        b_id.append("seq", 0);
+        b_id.done();
+        return pc->partitionWithPK(b.done());
+    }
+
+    void logOpsToOplogRef(BSONObj o, bool visibleNow) {
         LOCK_REASON(lockReason, "repl: logging to oplog.refs");
         Client::ReadContext ctx(rsOplogRefs, lockReason);
-        writeEntryToOplogRefs(o);
+        if (visibleNow && streamLargeTxnRefs) {
+            // pinned before the entry is written, and under the read lock, so a concurrent
+            // trimOplogRefs either sees the pin or finishes before the entry exists
+            {
+                SimpleMutex::scoped_lock lk(openOplogRefsMutex);
+                openOplogRefs.insert(o["_id"]["oid"].OID());
+            }
+            Client::AlternateTransactionStack altStack;
+            Client::Transaction txn(DB_SERIALIZABLE);
+            writeEntryToOplogRefs(o);
+            // the root's commit flushes the log anyway
+            txn.commit(DB_TXN_NOSYNC);
+        }
+        else {
+            writeEntryToOplogRefs(o);
+        }
     }
 
     void createOplog() {
@@ -306,27 +362,16 @@ namespace mongo {
             // If something throws in here, the oplog reader ought to get destroyed,
             // so no need for an RAII style of resetting
             r.setSocketTimeout(soTimeoutForReplLargeTxn);
-            shared_ptr<DBClientCursor> c = r.getOplogRefsCursor(oid);
-            uassert(17363, "Could not get oplog refs cursor", c.get());
             // we are doing the work of copying oplog.refs data and writing to oplog
             // underneath a read lock
             // to ensure that neither oplog or oplog.refs has a partition
-            // added, so that the trickery required in logTransactionOpsRef
-            // to update maxRefGTID is not necessary.
-            // If we release the read lock between copying oplog refs range
-            // and writing to oplog, we would have to handle the case
-            // where a partition is added while copying the range
+            // added while we do so. Entries staged while the transaction was
+            // still running may already sit in older partitions, so their
+            // maxRefGTID is updated just like the primary does in logTransactionOpsRef
             LOCK_REASON(lockReason, "repl: copying oplog.refs range");
             Client::ReadContext ctx(rsOplogRefs, lockReason);
-            while (c->more()) {
-                BSONObj b = c->next();
-                BSONElement eOID = b.getFieldDotted("_id.oid");
-                if (oid != eOID.OID()) {
-                    break;
-                }
-                LOG(6) << "copyOplogRefsRange " << b << endl;
-                writeEntryToOplogRefs(b);
-            }
+            oplogRefsStager.finishTransaction(oid, r);
+            noteOplogRefsReferenced(oid, getGTIDFromOplogEntry(o));
             replicateTransactionToOplog(o);
             *bigTxn = true;
             r.resetSocketTimeout();
@@ -626,6 +671,10 @@ namespace mongo {
             if (GTID::cmp(currGTID, maxGTID) > 0) {
                 break;
             }
+            // nor if a root transaction still running has spilled into it
+            if (firstPinnedRefsPartition(pc) == 0) {
+                break;
+            }
             pc->dropPartition(lastID);
         }
     }
@@ -757,6 +806,84 @@ namespace mongo {
         transaction.commit();
     }
 
+    static uint64_t partitionBytes(const shared_ptr<CollectionData>& cd) {
+        CollectionData::Stats stats;
+        cd->fillCollectionStats(stats, NULL, 1);
+        return stats.size + stats.indexSize;
+    }
+
+    void getOplogPartitionStats(vector<OplogPartitionStats>* partitions, uint64_t* refsBytes,
+                                uint64_t* reclaimableRefsBytes, uint64_t* oldestTS) {
+        LOCK_REASON(lockReason, "repl: getting oplog partition sizes");
+        Client::ReadContext ctx(rsoplog, lockReason);
+        Client::Transaction transaction(DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+        Collection* rsOplogDetails = getCollection(rsoplog);
+        PartitionedOplogCollection* poc = rsOplogDetails->as<PartitionedOplogCollection>();
+        partitions->clear();
+        for (uint64_t i = 0; i < poc->numPartitions(); i++) {
+            BSONObj meta = poc->getPartitionMetadata(i);
+            OplogPartitionStats p;
+            p.id = meta["_id"].Long();
+            p.createTime = meta["createTime"]._numberLong();
+            p.bytes = partitionBytes(poc->getPartition(i));
+            partitions->push_back(p);
+        }
+
+        // The oplog.refs partitions that dropping every oplog partition but the last would let
+        // trimOplogRefs drop: those before the last one, up to the first that something newer
+        // references or a running transaction pins.
+        GTID maxTrimmable;
+        bool trimmable = poc->numPartitions() > 1;
+        if (trimmable) {
+            maxTrimmable = getGTIDFromBSON("", poc->getPartitionMetadata(poc->numPartitions() - 2)["max"].Obj());
+        }
+        Collection* rsOplogRefsDetails = getCollection(rsOplogRefs);
+        PartitionedCollection* pc = rsOplogRefsDetails->as<PartitionedCollection>();
+        const uint64_t firstPinned = firstPinnedRefsPartition(pc);
+        *refsBytes = 0;
+        *reclaimableRefsBytes = 0;
+        for (uint64_t i = 0; i < pc->numPartitions(); i++) {
+            const uint64_t bytes = partitionBytes(pc->getPartition(i));
+            *refsBytes += bytes;
+            if (trimmable) {
+                BSONObj meta = pc->getPartitionMetadata(i);
+                trimmable = i + 1 < pc->numPartitions() && i < firstPinned && meta["maxRefGTID"].ok() &&
+                            GTID::cmp(getGTIDFromBSON("maxRefGTID", meta), maxTrimmable) <= 0;
+            }
+            if (trimmable) {
+                *reclaimableRefsBytes += bytes;
+            }
+        }
+
+        *oldestTS = 0;
+        shared_ptr<Cursor> c = Cursor::make(rsOplogDetails, 1);
+        if (c->ok()) {
+            *oldestTS = c->current()["ts"]._numberLong();
+        }
+        transaction.commit();
+    }
+
+    bool dropOldestOplogPartition(uint64_t id) {
+        LOCK_REASON(lockReason, "repl: dropping oldest oplog partition");
+        Client::WriteContext ctx(rsoplog, lockReason);
+        Client::Transaction transaction(DB_SERIALIZABLE);
+        Collection* rsOplogDetails = getCollection(rsoplog);
+        PartitionedOplogCollection* poc = rsOplogDetails->as<PartitionedOplogCollection>();
+        if (poc->numPartitions() == 1) {
+            return false;
+        }
+        BSONObj meta = poc->getPartitionMetadata(0);
+        if ((uint64_t) meta["_id"].Long() != id) {
+            // someone else trimmed the oplog since the caller looked
+            return false;
+        }
+        GTID maxGTIDTrimmed = getGTIDFromBSON("", meta["max"].Obj());
+        poc->dropPartition(id);
+        trimOplogRefs(maxGTIDTrimmed);
+        transaction.commit();
+        return true;
+    }
+
     void convertOplogToPartitionedIfNecessary() {
         LOCK_REASON(lockReason, "repl: maybe convert oplog to partitioned on startup");
         Client::WriteContext ctx(rsoplog, lockReason);
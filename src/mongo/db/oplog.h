@@ -52,7 +52,13 @@ namespace mongo {
     // Write operations to the log (local.oplog.$main)
     void logTransactionOps(GTID gtid, uint64_t timestamp, uint64_t hash, const deque<BSONObj>& ops);
     void logTransactionOpsRef(GTID gtid, uint64_t timestamp, uint64_t hash, OID& oid);
-    void logOpsToOplogRef(BSONObj o);
+    // Keeps partitions of oplog.refs holding entries for oid from being trimmed while the oplog
+    // entry at gtid references them. Requires a read lock on local.
+    void noteOplogRefsReferenced(const OID& oid, GTID gtid);
+    void logOpsToOplogRef(BSONObj o, bool visibleNow);
+    // Called once the root transaction that spilled to oplog.refs as oid has committed or
+    // aborted, letting the partitions holding its entries be trimmed again.
+    void releaseOplogRefs(const OID& oid);
     void deleteOplogFiles();
     
     GTID getGTIDFromOplogEntry(BSONObj o);
@@ -71,6 +77,21 @@ namespace mongo {
     void addOplogPartitions();
     void trimOplogWithTS(uint64_t tsMillis);
     void trimOplogwithGTID(GTID gtid);
+
+    struct OplogPartitionStats {
+        uint64_t id;
+        uint64_t createTime;    // millis
+        uint64_t bytes;         // data and index size
+    };
+    // Sizes of the oplog's partitions, oldest first, the total size of oplog.refs, how much of
+    // it dropping oplog partitions can trim, and the time of the oldest oplog entry (0 if there
+    // is none).
+    void getOplogPartitionStats(vector<OplogPartitionStats>* partitions, uint64_t* refsBytes,
+                                uint64_t* reclaimableRefsBytes, uint64_t* oldestTS);
+    // Drops the oldest oplog partition if it is still the one with id and not the last one,
+    // along with the oplog.refs partitions nothing newer references, in a transaction of its
+    // own. @return true if it was dropped
+    bool dropOldestOplogPartition(uint64_t id);
     void convertOplogToPartitionedIfNecessary();
 
     void updateApplyBitToEntry(BSONObj entry, bool apply);
@@ -31,6 +31,9 @@
 #include "mongo/db/ops/count.h"
 #include "mongo/db/query_optimizer.h"
 #include "mongo/db/commands/server_status.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/s/d_autosplit.h"
 
 // BSON fields for oplog entries
 static const char *KEY_STR_OP_NAME = "op";
@@ -58,6 +61,12 @@ static const char OP_STR_COMMAND[] = "c"; // command
 namespace mongo {
     static Counter64 slowUpdatesByPKPerformed;
     static ServerStatusMetricField<Counter64> fastupdatesPerformedPKDisplay("fastUpdates.performed.slowOnSecondary", &slowUpdatesByPKPerformed);
+    // updates rollback undid from a pre-image instead of refetching the document
+    static Counter64 rollbackUpdatesUndoneLocally;
+    static ServerStatusMetricField<Counter64> rollbackUpdatesUndoneLocallyDisplay("repl.rollback.updatesUndoneLocally", &rollbackUpdatesUndoneLocally);
+
+    // How long pre-images of updates are kept for rollback, 0 to keep none. See RollbackPreImages.
+    MONGO_EXPORT_SERVER_PARAMETER(rollbackPreImageWindowSecs, int, 0);
 
     namespace OplogHelpers {
         bool shouldLogOpForSharding(const char *opstr) {
@@ -108,6 +117,9 @@ namespace mongo {
         }
         
         void logInsert(const char *ns, const BSONObj &row, bool fromMigrate) {
+            if (!fromMigrate) {
+                chunkWrites.noteWrite(ns, row, row.objsize());
+            }
             bool logForSharding = !fromMigrate &&
                                   shouldLogTxnOpForSharding(OP_STR_INSERT, ns, row);
             if (logTxnOpsForReplication() || logForSharding) {
@@ -145,6 +157,9 @@ namespace mongo {
                        bool fromMigrate) {
             bool logForSharding = !fromMigrate &&
                 shouldLogTxnUpdateOpForSharding(OP_STR_UPDATE, ns, oldObj);
+            if (!fromMigrate) {
+                chunkWrites.noteWrite(ns, newObj, newObj.objsize());
+            }
             if (logTxnOpsForReplication() || logForSharding) {
                 BSONObjBuilder b;
                 if (isLocalNs(ns)) {
@@ -173,6 +188,9 @@ namespace mongo {
         {
             bool logForSharding = !fromMigrate &&
                 shouldLogTxnUpdateOpForSharding(OP_STR_UPDATE, ns, oldObj);
+            if (!fromMigrate) {
+                chunkWrites.noteWrite(ns, oldObj, updateobj.objsize());
+            }
             if (logTxnOpsForReplication() || logForSharding) {
                 BSONObjBuilder b;
                 if (isLocalNs(ns)) {
@@ -201,6 +219,9 @@ namespace mongo {
         {
             bool logForSharding = !fromMigrate &&
                 shouldLogTxnUpdateOpForSharding(OP_STR_UPDATE, ns, oldObj);
+            if (!fromMigrate) {
+                chunkWrites.noteWrite(ns, oldObj, updateobj.objsize());
+            }
             if (logTxnOpsForReplication() || logForSharding) {
                 BSONObjBuilder b;
                 if (isLocalNs(ns)) {
@@ -665,6 +686,11 @@ namespace mongo {
             verify(fastUpdateFlags < UpdateFlags::MAX);
             Collection *cl = getCollection(ns);
             uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+            if (docsMap == NULL && RollbackPreImages::enabled()) {
+                BSONObj preImage;
+                const bool found = cl->findByPK(pk, preImage);
+                RollbackPreImages::save(ns, pk, found ? &preImage : NULL);
+            }
             ModSet mods(updateobj, cl->indexKeys());
             uint32_t fastUpdateFlagsToUse = fastUpdateFlags;
             // a little bit of trickery here. Reference comments in
@@ -683,7 +709,13 @@ namespace mongo {
                 ApplyUpdateMessage storageUpdateCallback;
                 bool applied = storageUpdateCallback.applyMods(oldObj, updateobj, query, fastUpdateFlags, newObj);
                 if (applied) {
-                    updateOneObject(cl, pk, oldObj, newObj, false, flags);
+                    if (found) {
+                        updateOneObject(cl, pk, oldObj, newObj, false, flags);
+                    } else {
+                        // an upsert that created the document on the primary
+                        verify(fastUpdateFlags & UpdateFlags::UPSERT);
+                        insertOneObject(cl, newObj, flags);
+                    }
                     slowUpdatesByPKPerformed.increment();
                 }
             }
@@ -701,7 +733,7 @@ namespace mongo {
                 KEY_STR_QUERY,
                 KEY_STR_FLAGS
                 };
-            BSONElement fields[3];
+            BSONElement fields[4];
             op.getFields(4, names, fields);
             const BSONObj pk = fields[0].Obj();     // must exist
             const BSONObj updateobj = fields[1].Obj(); // must exist
@@ -830,8 +862,15 @@ namespace mongo {
             Client::ReadContext ctx(ns, lockReason);
             Collection *cl = getCollection(ns);
             if (!cl->isPKHidden()) {
-                docsMap->addDoc(ns, pk);
                 const BSONObj newPK = cl->getValidatedPKFromObject(newObj);
+                if (!docsMap->docExists(ns, pk) && !docsMap->docExists(ns, newPK)) {
+                    // the entry has the pre-image, undo the update here
+                    BSONObj oldObj = op[KEY_STR_OLD_ROW].Obj(); // must exist
+                    runUpdateFromOplogWithLock(ns, newPK, newObj, oldObj, NULL);
+                    rollbackUpdatesUndoneLocally.increment();
+                    return;
+                }
+                docsMap->addDoc(ns, pk);
                 docsMap->addDoc(ns, newPK);
             }
             else {
@@ -858,8 +897,14 @@ namespace mongo {
             auto_ptr<ModSetState> mss = mods.prepare(oldObj);
             BSONObj newObj = mss->createNewFromMods();
             if (!cl->isPKHidden()) {
-                docsMap->addDoc(ns, pk);
                 const BSONObj newPK = cl->getValidatedPKFromObject(newObj);
+                if (!docsMap->docExists(ns, pk) && !docsMap->docExists(ns, newPK)) {
+                    // likewise, the entry has the pre-image
+                    runUpdateFromOplogWithLock(ns, newPK, newObj, oldObj, NULL);
+                    rollbackUpdatesUndoneLocally.increment();
+                    return;
+                }
+                docsMap->addDoc(ns, pk);
                 docsMap->addDoc(ns, newPK);
             }
             else {
@@ -881,6 +926,11 @@ namespace mongo {
                 Client::ReadContext ctx(ns, lockReason);
                 Collection *cl = getCollection(ns);
                 verify(!cl->isPKHidden()); // sanity check
+                if (RollbackPreImages::enabled() && !docsMap->docExists(ns, pk) &&
+                    RollbackPreImages::undo(cl, pk, updateobj, op[KEY_STR_QUERY].Obj(), op[KEY_STR_FLAGS].Int())) {
+                    rollbackUpdatesUndoneLocally.increment();
+                    return;
+                }
                 docsMap->addDoc(ns, pk);
             }
         }
@@ -1077,4 +1127,180 @@ namespace mongo {
         verify(ok());
         return DocID(_current["ns"].String().c_str(), _current["pk"].Obj());
     }
+
+    static const BSONObj preImagesKeyPattern = BSON("ns" << 1 << "pk" << 1 << "_id" << 1);
+    // pre-images are trimmed this many at a time, each batch in its own transaction
+    static const int preImagesTrimBatch = 1000;
+
+    // Microseconds since the epoch, but never repeated, so that a document's pre-images sort by
+    // when they were taken.
+    static long long nextPreImageSeq() {
+        static SimpleMutex seqMutex("rollbackPreImageSeq");
+        static long long lastSeq = 0;
+        SimpleMutex::scoped_lock lk(seqMutex);
+        lastSeq = max(lastSeq + 1, (long long) curTimeMicros64());
+        return lastSeq;
+    }
+
+    bool RollbackPreImages::enabled() {
+        return rollbackPreImageWindowSecs > 0;
+    }
+
+    void RollbackPreImages::save(const char *ns, const BSONObj &pk, const BSONObj *preImage) {
+        if (!theReplSet || OplogHelpers::isLocalNs(ns)) {
+            return;
+        }
+        LOCK_REASON(lockReason, "repl: saving pre-image for rollback");
+        Client::ReadContext ctx(rsRollbackPreImages, lockReason);
+        Collection *cl = getCollection(rsRollbackPreImages);
+        if (cl == NULL) {
+            // not created yet by maintain()
+            return;
+        }
+        BSONObjBuilder b;
+        b.append("_id", nextPreImageSeq());
+        b.append("ns", ns);
+        b.append("pk", pk);
+        if (preImage != NULL) {
+            b.append("o", *preImage);
+        }
+        BSONObj doc = b.obj();
+        const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+        insertOneObject(cl, doc, flags);
+    }
+
+    bool RollbackPreImages::undo(Collection *cl, const BSONObj &pk, const BSONObj &updateobj,
+                                 const BSONObj &query, const uint32_t fastUpdateFlags) {
+        LOCK_REASON(lockReason, "repl rollback: undoing update with saved pre-image");
+        Client::ReadContext ctx(rsRollbackPreImages, lockReason);
+        Collection *preImages = getCollection(rsRollbackPreImages);
+        if (preImages == NULL) {
+            return false;
+        }
+        const int idxNo = preImages->findIndexByKeyPattern(preImagesKeyPattern);
+        if (idxNo < 0) {
+            return false;
+        }
+        BSONObj saved;
+        {
+            shared_ptr<Cursor> c = Cursor::make(preImages, preImages->idx(idxNo),
+                                                BSON("" << cl->ns() << "" << pk << "" << MAXKEY),
+                                                BSON("" << cl->ns() << "" << pk << "" << MINKEY),
+                                                true, -1);
+            if (!c->ok()) {
+                return false;
+            }
+            saved = c->current().getOwned();
+        }
+        const BSONObj preImage = saved["o"].ok() ? saved["o"].Obj() : BSONObj();
+
+        // Only trust the pre-image if it is the one the update started from, that is, if
+        // applying the update to it gives what is there now.
+        BSONObj expected = preImage;
+        try {
+            if (!preImage.isEmpty() || (fastUpdateFlags & UpdateFlags::UPSERT)) {
+                BSONObj newObj;
+                ApplyUpdateMessage storageUpdateCallback;
+                if (storageUpdateCallback.applyMods(preImage, updateobj, query, fastUpdateFlags, newObj)) {
+                    expected = newObj;
+                }
+            }
+        }
+        catch (DBException &e) {
+            LOG(1) << "could not apply update to saved pre-image of " << pk << " in " << cl->ns()
+                   << ": " << e.toString() << rsLog;
+            return false;
+        }
+        BSONObj current;
+        const bool found = cl->findByPK(pk, current);
+        if (expected.woCompare(current) != 0) {
+            LOG(2) << "saved pre-image of " << pk << " in " << cl->ns()
+                   << " is not for this update, refetching" << rsLog;
+            return false;
+        }
+
+        const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+        BSONObj restored = preImage;
+        if (found && !restored.isEmpty()) {
+            updateOneObject(cl, pk, current, restored, false, flags);
+        }
+        else if (found) {
+            // an upsert created it
+            deleteOneObject(cl, pk, current, flags);
+        }
+        else if (!restored.isEmpty()) {
+            insertOneObject(cl, restored, flags);
+        }
+        deleteOneObject(preImages, saved["_id"].wrap(""), saved, flags);
+        return true;
+    }
+
+    void RollbackPreImages::clear() {
+        LOCK_REASON(lockReason, "repl: dropping rollback pre-images");
+        Client::WriteContext ctx(rsRollbackPreImages, lockReason);
+        Client::Transaction transaction(DB_SERIALIZABLE);
+        Collection *cl = getCollection(rsRollbackPreImages);
+        if (cl != NULL) {
+            string errmsg;
+            BSONObjBuilder result;
+            cl->drop(errmsg, result);
+        }
+        transaction.commit();
+    }
+
+    void RollbackPreImages::maintain() {
+        bool exists;
+        {
+            LOCK_REASON(lockReason, "repl: checking for rollback pre-images");
+            Client::ReadContext ctx(rsRollbackPreImages, lockReason);
+            exists = getCollection(rsRollbackPreImages) != NULL;
+        }
+        if (!enabled()) {
+            if (exists) {
+                log() << "rollbackPreImageWindowSecs is 0, dropping " << rsRollbackPreImages << rsLog;
+                clear();
+            }
+            return;
+        }
+        if (!exists) {
+            LOCK_REASON(lockReason, "repl: creating rollback pre-images");
+            Client::WriteContext ctx(rsRollbackPreImages, lockReason);
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            Collection *cl = getOrCreateCollection(rsRollbackPreImages, false);
+            BSONObj info = BSON("ns" << rsRollbackPreImages << "key" << preImagesKeyPattern <<
+                                "name" << "ns_1_pk_1__id_1");
+            if (cl->ensureIndex(info)) {
+                addToIndexesCatalog(info);
+            }
+            transaction.commit();
+        }
+
+        const long long cutoff = curTimeMicros64() - rollbackPreImageWindowSecs * 1000000LL;
+        while (true) {
+            LOCK_REASON(lockReason, "repl: trimming rollback pre-images");
+            Client::ReadContext ctx(rsRollbackPreImages, lockReason);
+            Client::Transaction transaction(DB_SERIALIZABLE);
+            Collection *cl = getCollection(rsRollbackPreImages);
+            if (cl == NULL) {
+                return;
+            }
+            vector<BSONObj> expired;
+            for (shared_ptr<Cursor> c = Cursor::make(cl, 1);
+                 c->ok() && (int) expired.size() < preImagesTrimBatch; c->advance()) {
+                BSONObj o = c->current();
+                if (o["_id"].numberLong() >= cutoff) {
+                    break;
+                }
+                expired.push_back(o.getOwned());
+            }
+            const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+            for (vector<BSONObj>::const_iterator it = expired.begin(); it != expired.end(); ++it) {
+                deleteOneObject(cl, (*it)["_id"].wrap(""), *it, flags);
+            }
+            transaction.commit();
+            if ((int) expired.size() < preImagesTrimBatch) {
+                return;
+            }
+        }
+    }
 } // namespace mongo
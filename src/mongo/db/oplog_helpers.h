@@ -21,6 +21,8 @@
 
 namespace mongo {
 
+    class Collection;
+
     // objects used for rollback
     class DocID {
     public:
@@ -52,6 +54,29 @@ namespace mongo {
         DocID current();
     };
 
+    // Rollback undoes an update locally, instead of refetching the document from the sync
+    // source, whenever it has the pre-image. Most oplog entries carry it, and need nothing
+    // from here. While the rollbackPreImageWindowSecs parameter is set, this keeps the
+    // pre-images of updates whose oplog entry has none ("ur" entries without "o") in
+    // local.rollback.preimages, for that long, so those can be undone locally too. Fast updates
+    // are not done while it is set, since they never read the pre-image.
+    class RollbackPreImages {
+    public:
+        static bool enabled();
+        // Saves the document at pk, NULL if there was none, before an update that logs no
+        // pre-image. Called in the update's transaction.
+        static void save(const char *ns, const BSONObj &pk, const BSONObj *preImage);
+        // Restores the newest saved pre-image of pk, if applying the given update to it gives
+        // the current document. @return false if the update could not be undone locally
+        static bool undo(Collection *cl, const BSONObj &pk, const BSONObj &updateobj,
+                         const BSONObj &query, const uint32_t fastUpdateFlags);
+        // Creates or drops local.rollback.preimages as the parameter says, and trims pre-images
+        // older than the window. Called periodically by the oplog partition thread.
+        static void maintain();
+        // After a rollback, what is left refers to entries that are gone.
+        static void clear();
+    };
+
     namespace OplogHelpers {
 
         // helper functions for sharding
@@ -214,12 +214,40 @@ namespace mongo {
         cursor.reset( _conn->query( ns, query, 0, 0, fields, _tailingQueryOptions ).release() );
     }
     
-    void OplogReader::tailingQueryGTE(const char *ns, GTID gtid, const BSONObj* fields ) {
+    static Query gteQuery(GTID gtid) {
         BSONObjBuilder q;
         addGTIDToBSON("$gte", gtid, q);
         BSONObjBuilder query;
         query.append("_id", q.done());
-        tailingQuery(ns, Query(query.done()).hint(BSON("_id" << 1)), fields);
+        return Query(query.done()).hint(BSON("_id" << 1));
+    }
+
+    void OplogReader::tailingQueryGTE(const char *ns, GTID gtid, const BSONObj* fields ) {
+        Query query = gteQuery(gtid);
+        tailingQuery(ns, query, fields);
+    }
+
+    bool OplogReader::streamingQueryGTE(const char *ns, GTID gtid) {
+        verify( !haveCursor() );
+        verify( haveConnection() );
+        const string host = _conn->getServerAddress();
+        _streamConn.reset(new DBClientConnection(false, 0, _socketTimeout));
+        string errmsg;
+        if ( !_streamConn->connect(host.c_str(), errmsg) ||
+             (!noauth && !replAuthenticate(_streamConn.get(), true)) ) {
+            log() << "repl: could not open oplog stream to " << host << ": " << errmsg << endl;
+            _streamConn.reset();
+            return false;
+        }
+        Query query = gteQuery(gtid);
+        LOG(2) << "repl: streaming " << ns << ".find(" << query.toString() << ')' << endl;
+        cursor.reset( _streamConn->query( ns, query, 0, 0, NULL,
+                                          _tailingQueryOptions | QueryOption_Exhaust ).release() );
+        if ( !haveCursor() ) {
+            _streamConn.reset();
+            return false;
+        }
+        return true;
     }
 
     shared_ptr<DBClientCursor> OplogReader::getRollbackCursor(GTID lastGTID) {
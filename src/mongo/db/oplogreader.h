@@ -34,6 +34,8 @@ namespace mongo {
 
     class OplogReader {
         shared_ptr<DBClientConnection> _conn;
+        // separate connection for an exhaust cursor, see streamingQueryGTE
+        shared_ptr<DBClientConnection> _streamConn;
         shared_ptr<DBClientCursor> cursor;
         bool _doHandshake;
         int _tailingQueryOptions;
@@ -41,9 +43,12 @@ namespace mongo {
     public:
         OplogReader( bool doHandshake = true );
         ~OplogReader() { }
-        void resetCursor() { cursor.reset(); }
-        void resetConnection() {
+        void resetCursor() {
             cursor.reset();
+            _streamConn.reset();
+        }
+        void resetConnection() {
+            resetCursor();
             _conn.reset();
         }
         shared_ptr<DBClientConnection> conn_shared() { return _conn; }
@@ -75,6 +80,19 @@ namespace mongo {
 
         void tailingQueryGTE(const char *ns, GTID gtid, const BSONObj* fields=0);
 
+        /**
+         * Like tailingQueryGTE, but with an exhaust cursor on a connection of its own, so the
+         * sync target sends batches without waiting for getMores.  The stream connection does
+         * not handshake, so reading it does not count for write concern; see oplog_stream.h.
+         * conn() stays free for other queries.
+         *
+         * @return false if the sync target can't stream, in which case there is no cursor
+         */
+        bool streamingQueryGTE(const char *ns, GTID gtid);
+
+        bool streaming() const { return _streamConn.get() != 0 && cursor.get() != 0; }
+        long long cursorId() const { return cursor.get() ? cursor->getCursorId() : 0; }
+
         /* Do a tailing query, but only send the ts field back. */
         void ghostQueryGTE(const char *ns, GTID gtid) {
             const BSONObj fields = BSON("ts" << 1 << "_id" << 1);
@@ -67,7 +67,8 @@ namespace mongo {
             limit  = -limit;
         }
 
-        Client::WithOpSettings wos(OpSettings().setQueryCursorMode(DEFAULT_LOCK_CURSOR).setBulkFetch(true));
+        Client::WithOpSettings wos(OpSettings().setQueryCursorMode(DEFAULT_LOCK_CURSOR).setBulkFetch(true)
+                                               .setReadAhead(query.isEmpty() && limit == 0));
 
         Lock::assertAtLeastReadLocked(ns);
         try {
@@ -49,7 +49,9 @@ namespace mongo {
     }
 
     void insertOneObject(Collection *cl, BSONObj &obj, uint64_t flags) {
-        validateInsert(obj);
+        if (!(flags & Collection::INSERT_RULES_CHECKED)) {
+            validateInsert(obj);
+        }
         cl->insertObject(obj, flags);
         cl->notifyOfWriteOp();
     }
@@ -72,7 +74,9 @@ namespace mongo {
                     if (logop) {
                         // special case capped colletions until all oplog writing
                         // for inserts is handled in the collection class, not here.
-                        validateInsert(obj);
+                        if (!(flags & Collection::INSERT_RULES_CHECKED)) {
+                            validateInsert(obj);
+                        }
                         CappedCollection *cappedCl = cl->as<CappedCollection>();
                         bool indexBitChanged = false; // need to initialize this
                         cappedCl->insertObjectAndLogOps(objModified, flags, &indexBitChanged);
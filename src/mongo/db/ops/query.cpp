@@ -21,6 +21,7 @@
 
 #include "mongo/db/ops/query.h"
 
+#include "mongo/bson/util/buffer_pool.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/db/client.h"
 #include "mongo/db/clientcursor.h"
@@ -118,6 +119,7 @@ namespace mongo {
                                 bool& exhaust,
                                 bool* isCursorAuthorized ) {
         exhaust = false;
+        BufferPool::Scope pooledBuffers;
         ClientCursor::Pin p(cursorid);
         ClientCursor *client_cursor = p.c();
 
@@ -368,7 +370,8 @@ namespace mongo {
         if ( allowCovered ) {
             const Projection::KeyOnly *keyFieldsOnly = _cursor->keyFieldsOnly();
             if ( keyFieldsOnly ) {
-                return keyFieldsOnly->hydrate( _cursor->currKey(), _cursor->currPK() );
+                return keyFieldsOnly->hydrate( _cursor->currKey(), _cursor->currPK(),
+                                               _cursor->currClusteringFields() );
             }
         }
         resultDetails->loadedRecord = true;
@@ -911,6 +914,7 @@ namespace mongo {
      * @asserts on scan and order memory exhaustion and other cases.
      */
     string runQuery(Message& m, QueryMessage& q, CurOp& curop, Message &result) {
+        BufferPool::Scope pooledBuffers;
         shared_ptr<ParsedQuery> pq_shared( new ParsedQuery(q) );
         ParsedQuery& pq( *pq_shared );
         BSONObj jsobj = q.query;
@@ -981,6 +985,9 @@ namespace mongo {
         settings.setQueryCursorMode(DEFAULT_LOCK_CURSOR);
         settings.setBulkFetch(true);
         settings.setCappedAppendPK(pq.hasOption(QueryOption_AddHiddenPK));
+        // Unfiltered queries with no limit (including dumps and initial sync's clones) read
+        // whole collections.  A batch size looks like a limit here, and turns it off too.
+        settings.setReadAhead(!tailable && query.isEmpty() && pq.getNumToReturn() == 0);
         cc().setOpSettings(settings);
 
         // If our caller has a transaction, it's multi-statement.
@@ -131,6 +131,10 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> fastUpdatesEligiblePKDisplay("fastUpdates.eligible.primaryKey", &fastUpdatesPKEligible);
     static Counter64 fastUpdatesSecEligible;
     static ServerStatusMetricField<Counter64> fastUpdatesEligibleSecDisplay("fastUpdates.eligible.secondaryKey", &fastUpdatesSecEligible);
+    static Counter64 fastUpsertsPerformed;
+    static ServerStatusMetricField<Counter64> fastUpsertsPerformedDisplay("fastUpdates.performed.upsert", &fastUpsertsPerformed);
+    static Counter64 fastUpsertsEligible;
+    static ServerStatusMetricField<Counter64> fastUpsertsEligibleDisplay("fastUpdates.eligible.upsert", &fastUpsertsEligible);
 
     bool ApplyUpdateMessage::applyMods(
         const BSONObj &oldObj,
@@ -144,7 +148,7 @@ namespace mongo {
         // are listed here. We don't want a future version's flag to somehow
         // erroneously make it here (e.g., a future upsert flag)
         verify(fastUpdateFlags < UpdateFlags::MAX);
-        if (oldObj.isEmpty()) {
+        if (oldObj.isEmpty() && !(fastUpdateFlags & UpdateFlags::UPSERT)) {
             // if this update message is allowed to not have an old obj
             // we simply return false, otherwise, we uassert
             if (fastUpdateFlags & UpdateFlags::NO_OLDOBJ_OK) {
@@ -155,7 +159,16 @@ namespace mongo {
         try {
             ModSet mods(msg);
             verify(!mods.hasDynamicArray());
-            if (!query.isEmpty()) {
+            if (oldObj.isEmpty()) {
+                // An upsert of a document that doesn't exist yet. The query is just
+                // the pk, build the new document from it as upsertAndLog() would.
+                newObj = mods.createNewFromQuery(query);
+                checkNoMods(newObj);
+                checkTooLarge(newObj);
+                return true;
+            }
+            // An upsert's query is just the pk, which the old obj matches.
+            if (!query.isEmpty() && !(fastUpdateFlags & UpdateFlags::UPSERT)) {
                 // note, the mods used should not have hasDynamicArray()
                 // be false, making this code ok. This fact is asserted above
                 ResultDetails queryResult;
@@ -235,6 +248,9 @@ namespace mongo {
             // this method logs just the pk and not obj
             // we still need to pass in obj for sharding
             OplogHelpers::logUpdatePKModsWithRow(ns, pk, obj, updateobj, BSONObj(), 0, fromMigrate);
+            if (RollbackPreImages::enabled()) {
+                RollbackPreImages::save(ns, pk, &obj);
+            }
         }
         else {
             OplogHelpers::logUpdateModsWithRow(ns, pk, obj, updateobj, fromMigrate);
@@ -294,7 +310,41 @@ namespace mongo {
         }
         verify(!forceLogFullUpdate(cl, mods));
         *eligible = true;
-        if (!fastUpdatesEnabled) {
+        if (!fastUpdatesEnabled || RollbackPreImages::enabled()) {
+            return false;
+        }
+        return true;
+    }
+
+    // An upsert by pk can be sent as a single update message that modifies the
+    // document if it exists and creates it from the query otherwise, without
+    // reading it first. That requires the query to be nothing but the pk, so
+    // the new document is fully described by the message, and no secondary
+    // indexes, since the message can't insert into them.
+    static bool canRunFastUpsert(
+        Collection *cl,
+        const BSONObj &pk,
+        const BSONObj &query,
+        ModSet* mods,
+        const bool isOperatorUpdate,
+        bool* eligible
+        )
+    {
+        *eligible = false;
+        if (!isOperatorUpdate) {
+            return false;
+        }
+        verify(mods);
+        if (query.nFields() != pk.nFields() || cl->nIndexesBeingBuilt() > 1 ||
+            cl->ns() == cc().bulkLoadNS()) {
+            return false;
+        }
+        if (doFullUpdate(cl, mods) || logOfPreImageRequired(cl) || !cl->fastupdatesOk()) {
+            return false;
+        }
+        verify(!forceLogFullUpdate(cl, mods));
+        *eligible = true;
+        if (!fastUpdatesEnabled || RollbackPreImages::enabled()) {
             return false;
         }
         return true;
@@ -310,7 +360,10 @@ namespace mongo {
                             const bool oldObjMayNotExist,
                             bool* eligible)
     {
-        if (!canRunFastUpdate(cl, upsert, mods, isOperatorUpdate, eligible)) {
+        const bool canRun = upsert ?
+            canRunFastUpsert(cl, pk, query, mods, isOperatorUpdate, eligible) :
+            canRunFastUpdate(cl, upsert, mods, isOperatorUpdate, eligible);
+        if (!canRun) {
             return false;
         }
         verify(mods);
@@ -318,10 +371,13 @@ namespace mongo {
         // looks like we are good to go
         
         // a little optimization to get rid of the query, if we can
+        // (an upsert needs it to build the document it may create)
         const bool singleQueryField = query.nFields() == 1; // TODO: Optimize?
-        const BSONObj queryToUse = singleQueryField ? BSONObj() : query;
+        const BSONObj queryToUse = (singleQueryField && !upsert) ? BSONObj() : query;
         uint32_t fastUpdateFlags = UpdateFlags::FAST_UPDATE_PERFORMED;
-        if (oldObjMayNotExist) {
+        if (upsert) {
+            fastUpdateFlags |= UpdateFlags::UPSERT;
+        } else if (oldObjMayNotExist) {
             fastUpdateFlags |= UpdateFlags::NO_OLDOBJ_OK;
         }
         bool success = updateOneObjectWithMods(cl, pk, updateobj, queryToUse, fastUpdateFlags, fromMigrate, 0, mods);
@@ -347,12 +403,22 @@ namespace mongo {
         // proceed with fetching the pre-image
         bool eligibleForFastUpdate = false;        
         if (tryFastUpdate(ns, cl, pk, patternOrig, updateobj, upsert, fromMigrate, mods.get(), isOperatorUpdate, true, &eligibleForFastUpdate)) {
-            fastUpdatesByPKPerformed.increment();
+            // Like any fast update, we don't know whether a document existed, so a
+            // fast upsert reports that it updated one.
+            if (upsert) {
+                fastUpsertsPerformed.increment();
+            } else {
+                fastUpdatesByPKPerformed.increment();
+            }
             return UpdateResult(1, isOperatorUpdate, 1, BSONObj());
         }
         if (eligibleForFastUpdate) {
             // track the fact that this update could have been fast if fastUpdates were enabled
-            fastUpdatesPKEligible.increment();
+            if (upsert) {
+                fastUpsertsEligible.increment();
+            } else {
+                fastUpdatesPKEligible.increment();
+            }
         }
 
         BSONObj obj;
@@ -21,6 +21,7 @@
 
 #include <algorithm> // for max
 
+#include "mongo/bson/util/buffer_pool.h"
 #include "mongo/db/field_ref.h"
 #include "mongo/db/jsobjmanipulator.h"
 #include "mongo/db/oplog.h"
@@ -781,6 +782,7 @@ namespace mongo {
     }
 
     BSONObj ModSetState::createNewFromMods() {
+        BufferPool::Scope pooledBuffers;
         BSONObjBuilder b( (int)(_obj.objsize() * 1.1) );
         createNewObjFromMods( "" , b , _obj );
         return _newFromMods = b.obj();
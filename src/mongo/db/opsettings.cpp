@@ -26,7 +26,8 @@ namespace mongo {
         _queryCursorMode(DEFAULT_LOCK_CURSOR),
         _shouldBulkFetch(false),
         _shouldAppendPKForCapped(false),
-        _justOne(false) {
+        _justOne(false),
+        _readAhead(false) {
     }
 
     OpSettings& OpSettings::setQueryCursorMode(QueryCursorMode mode) {
@@ -65,4 +66,13 @@ namespace mongo {
         return *this;
     }
 
+    bool OpSettings::shouldReadAhead() {
+        return _readAhead;
+    }
+
+    OpSettings &OpSettings::setReadAhead(bool val) {
+        _readAhead = val;
+        return *this;
+    }
+
 } // namespace mongo
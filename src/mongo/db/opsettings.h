@@ -31,6 +31,7 @@ namespace mongo {
         bool _shouldBulkFetch; // default false
         bool _shouldAppendPKForCapped; // if true, cursor->current should append the pk before returning the row
         bool _justOne; // if true, then the number of affected rows will be at most one.
+        bool _readAhead; // if true, full scans may read ahead of themselves, see ScanReadAhead
       public:
         OpSettings();
 
@@ -45,6 +46,9 @@ namespace mongo {
 
         bool getJustOne();
         OpSettings& setJustOne(bool val);
+
+        bool shouldReadAhead();
+        OpSettings& setReadAhead(bool val);
     };
 
 } // namespace mongo
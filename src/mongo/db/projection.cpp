@@ -18,6 +18,7 @@
 
 #include "pch.h"
 #include "projection.h"
+#include "mongo/bson/util/buffer_pool.h"
 #include "mongo/db/matcher.h"
 #include "mongo/util/mongoutils/str.h"
 
@@ -202,6 +203,7 @@ namespace mongo {
     }
 
     BSONObj Projection::transform( const BSONObj& in, const MatchDetails* details ) const {
+        BufferPool::Scope pooledBuffers;
         BSONObjBuilder b;
         transform( in , b, details );
         return b.obj();
@@ -345,7 +347,8 @@ namespace mongo {
     }
 
     Projection::KeyOnly *Projection::checkKey( const BSONObj &keyPattern,
-                                               const BSONObj &pkPattern ) const {
+                                               const BSONObj &pkPattern,
+                                               const BSONObj &clusteringFields ) const {
         if ( _include ) {
             // if we default to including then we can't
             // use an index because we don't know what we're missing
@@ -356,14 +359,16 @@ namespace mongo {
             return 0;
 
         const bool pkHasIdField = pkPattern.nFields() == 1 && pkPattern["_id"].ok();
-        if ( _includeID && keyPattern["_id"].eoo() && ! pkHasIdField ) {
-            // Requesting to include the _id, but neither the key nor the pk have it.
+        if ( _includeID && keyPattern["_id"].eoo() && ! pkHasIdField &&
+             clusteringFields["_id"].eoo() ) {
+            // Requesting to include the _id, but neither the key, the pk nor
+            // the clustering fields have it.
             return 0;
         }
 
         // at this point we know its all { x : 1 } style,
         // and if the _id was requested, then one of the
-        // key or primary key has it.
+        // key, primary key or clustering fields has it.
 
         auto_ptr<KeyOnly> p( new KeyOnly() );
 
@@ -410,6 +415,24 @@ namespace mongo {
             p->includeIDFromPK();
             got++;
         }
+        else if ( _includeID && ! idCoveredByKey ) {
+            p->addFromClusteringFields( "_id" );
+            got++;
+        }
+
+        // Fields the key doesn't have may still be stored by a projected
+        // clustering index.
+        if ( ! clusteringFields.isEmpty() ) {
+            BSONObjIterator j( _source );
+            while ( j.more() ) {
+                const char *name = j.next().fieldName();
+                if ( ! mongoutils::str::equals( name , "_id" ) &&
+                     keyPattern[name].eoo() && clusteringFields[name].ok() ) {
+                    p->addFromClusteringFields( name );
+                    got++;
+                }
+            }
+        }
         
         int need = _source.nFields();
         if ( _includeID && _source["_id"].eoo() ) {
@@ -421,10 +444,11 @@ namespace mongo {
         return got == need ? p.release() : NULL;
     }
 
-    BSONObj Projection::KeyOnly::hydrate( const BSONObj &key, const BSONObj &pk ) const {
+    BSONObj Projection::KeyOnly::hydrate( const BSONObj &key, const BSONObj &pk,
+                                          const BSONObj &clusteringFields ) const {
         verify( _include.size() == _names.size() );
 
-        BSONObjBuilder b( key.objsize() + _stringSize + 16 );
+        BSONObjBuilder b( key.objsize() + clusteringFields.objsize() + _stringSize + 16 );
 
         BSONObjIterator i(key);
         unsigned n=0;
@@ -444,6 +468,16 @@ namespace mongo {
             b.appendAs( pk.firstElement(), "_id" );
         }
 
+        // Fields missing from the document are missing from its clustering
+        // fields too, and are left out just as transform() would.
+        for ( vector<string>::const_iterator it = _fromClusteringFields.begin();
+              it != _fromClusteringFields.end(); ++it ) {
+            const BSONElement e = clusteringFields[ *it ];
+            if ( e.ok() ) {
+                b.append( e );
+            }
+        }
+
         return b.obj();
     }
 }
@@ -39,11 +39,20 @@ namespace mongo {
 
             KeyOnly() : _stringSize(0), _includeIDFromPK(false) {}
 
-            BSONObj hydrate( const BSONObj &key, const BSONObj &pk ) const;
+            /**
+             * @param clusteringFields - fields stored with the key by a projected
+             *        clustering index, see Cursor::currClusteringFields()
+             */
+            BSONObj hydrate( const BSONObj &key, const BSONObj &pk,
+                             const BSONObj &clusteringFields = BSONObj() ) const;
 
             void addNo() { _add( false , "" ); }
             void addYes( const string& name ) { _add( true , name ); }
             void includeIDFromPK() { _includeIDFromPK = true; }
+            void addFromClusteringFields( const string& name ) {
+                _fromClusteringFields.push_back( name );
+                _stringSize += name.size();
+            }
 
         private:
 
@@ -55,6 +64,7 @@ namespace mongo {
 
             vector<bool> _include; // one entry per field in key.  true iff should be in output
             vector<string> _names; // name of field since key doesn't have names
+            vector<string> _fromClusteringFields; // fields to take from the clustering fields
 
             int _stringSize;
             bool _includeIDFromPK;
@@ -100,12 +110,13 @@ namespace mongo {
 
 
         /**
-         * @return if the keyPattern and pkPattern have all the information needed to return then
-         *         return a new KeyOnly otherwise null
+         * @return if the keyPattern, pkPattern and clusteringFields have all the information
+         *         needed to return then return a new KeyOnly otherwise null
          *         NOTE: a key may have modified the actual data
          *               which has to be handled above this (arrays, geo)
          */
-        KeyOnly *checkKey( const BSONObj &keyPattern, const BSONObj &pkPattern ) const;
+        KeyOnly *checkKey( const BSONObj &keyPattern, const BSONObj &pkPattern,
+                           const BSONObj &clusteringFields = BSONObj() ) const;
 
         bool includeID() const { return _includeID; }
 
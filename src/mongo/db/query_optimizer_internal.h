@@ -144,6 +144,7 @@ namespace mongo {
 
         BSONObj currPK() const { return _c ? _c->currPK() : BSONObj(); }
         BSONObj currKey() const { return _c ? _c->currKey() : BSONObj(); }
+        BSONObj currClusteringFields() const { return _c ? _c->currClusteringFields() : BSONObj(); }
         BSONObj current() const { return _c ? _c->current() : BSONObj(); }
         bool currentMatches( MatchDetails* details );
         
@@ -679,6 +680,7 @@ namespace mongo {
         virtual bool advance();
 
         virtual BSONObj currKey() const { return _c->currKey(); }
+        virtual BSONObj currClusteringFields() const { return _c->currClusteringFields(); }
         virtual BSONObj indexKeyPattern() const { return _c->indexKeyPattern(); }
 
         /** Deduping documents from a prior cursor is handled by the matcher. */
@@ -119,6 +119,10 @@ namespace mongo {
                 _special = special;
             }
 
+            if ( !_index->partialFilterImpliedBy( _frsMulti ) ) {
+                _utility = Disallowed;
+            }
+
             // hopefully safe to use original query in these contexts;
             // don't think we can mix special with $or clause separation yet
             _scanAndOrderRequired = !_order.isEmpty();
@@ -230,9 +234,16 @@ doneCheckOrder:
             _utility = Disallowed;
         }
 
+        // A partial index only has the documents matching its filter, so it can
+        // only answer queries that imply the filter.
+        if ( !_index->partialFilterImpliedBy( _frsMulti ) ) {
+            _utility = Disallowed;
+        }
+
         if ( _parsedQuery && _parsedQuery->getFields() && !_cl->isMultikey( _idxNo ) ) {
             // Does not check modifiedKeys()
-            _keyFieldsOnly.reset( _parsedQuery->getFields()->checkKey( _index->keyPattern(), _cl->pkPattern() ) );
+            _keyFieldsOnly.reset( _parsedQuery->getFields()->checkKey( _index->keyPattern(), _cl->pkPattern(),
+                                                                       _index->clusteringFields() ) );
         }
     }
 
@@ -76,6 +76,14 @@ namespace mongo {
         return _currRunner->currKey();
     }
 
+    BSONObj QueryOptimizerCursorImpl::currClusteringFields() const {
+        if ( _takeover ) {
+            return _takeover->currClusteringFields();
+        }
+        assertOk();
+        return _currRunner->currClusteringFields();
+    }
+
     BSONObj QueryOptimizerCursorImpl::indexKeyPattern() const {
         if ( _takeover ) {
             return _takeover->indexKeyPattern();
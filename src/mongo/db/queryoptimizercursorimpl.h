@@ -104,6 +104,8 @@ namespace mongo {
         
         virtual BSONObj currPK() const;
 
+        virtual BSONObj currClusteringFields() const;
+
         BSONObj _currPK() const;
         
         virtual bool advance();
@@ -1676,7 +1676,13 @@ namespace mongo {
                     break;
                 }
                 // advance to next interval and reset remaining fields
-                _i.inc( i );
+                if ( advanceMethod == -2 ) {
+                    // curr is past this interval, and perhaps many more after it
+                    _i.set( i, firstIntervalNotBefore( i, jj, reverse ) );
+                }
+                else {
+                    _i.inc( i );
+                }
                 _i.setZeroes( i + 1 );
                 first = false;
             }
@@ -1741,6 +1747,42 @@ namespace mongo {
         return -1;
     }
     
+    static bool beyondInterval( const FieldInterval &interval, const BSONElement &elt,
+                                bool reverse ) {
+        FieldRangeVectorIterator::FieldIntervalMatcher matcher( interval, elt, reverse );
+        return matcher.isGteUpperBound() && !matcher.isEqInclusiveUpperBound();
+    }
+
+    int FieldRangeVectorIterator::firstIntervalNotBefore( int intervalIdx,
+                                                         const BSONElement &currElt,
+                                                         bool reverse ) const {
+        const vector<FieldInterval> &intervals = _v._ranges[ intervalIdx ].intervals();
+        const int n = intervals.size();
+        // The intervals are disjoint and ordered in the direction of iteration, so being beyond
+        // an interval's upper bound is true for a prefix of them, starting with the current one.
+        int lo = _i.get( intervalIdx );
+        int hi = lo + 1;
+        for( int step = 1; hi < n && beyondInterval( intervals[ hi ], currElt, reverse );
+             step *= 2 ) {
+            lo = hi;
+            hi = lo + step;
+        }
+        if ( hi > n ) {
+            hi = n;
+        }
+        // currElt is beyond intervals[ lo ] but not intervals[ hi ], if there is one.
+        while( hi - lo > 1 ) {
+            const int mid = lo + ( hi - lo ) / 2;
+            if ( beyondInterval( intervals[ mid ], currElt, reverse ) ) {
+                lo = mid;
+            }
+            else {
+                hi = mid;
+            }
+        }
+        return hi;
+    }
+
     int FieldRangeVectorIterator::advanceToLowerBound( int i ) {
         _cmp[ i ] = &_v._ranges[ i ].intervals()[ _i.get( i ) ]._lower._bound;
         _inc[ i ] = _v._ranges[ i ].intervals()[ _i.get( i ) ]._lower._inclusive;
@@ -661,6 +661,14 @@ namespace mongo {
         int validateCurrentInterval( int intervalIdx, const BSONElement &currElt,
                                     bool reverse, bool first, bool &eqInclusiveUpperBound );
         
+        /**
+         * @return the index of the first interval of field 'intervalIdx' after the current one
+         * that 'currElt' is not beyond, or the number of intervals if there is none.  Gallops
+         * then binary searches, so skipping over many intervals (large $in lists) is cheap.
+         */
+        int firstIntervalNotBefore( int intervalIdx, const BSONElement &currElt,
+                                    bool reverse ) const;
+
         /** Skip to curr / i / nextbounds. */
         int advanceToLowerBound( int i );
         /** Skip to curr / i / superlative. */
@@ -221,6 +221,7 @@ namespace mongo {
             setLogTxnToOplog(logTransactionOps);
             setLogTxnRefToOplog(logTransactionOpsRef);
             setLogOpsToOplogRef(logOpsToOplogRef);
+            setReleaseOplogRefs(releaseOplogRefs);
             setOplogInsertStats(&oplogInsertStats, &oplogInsertBytesStats);
             ReplSetCmdline *replSetCmdline = new ReplSetCmdline(cmdLine._replSet);
             boost::thread t( boost::bind( &startReplSets, replSetCmdline) );
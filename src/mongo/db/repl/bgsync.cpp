@@ -22,6 +22,7 @@
 #include "mongo/db/commands/server_status.h"
 #include "mongo/db/crash.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/oplog_stream.h"
 #include "mongo/db/repl/rs_sync.h"
 #include "mongo/base/counter.h"
 #include "mongo/db/stats/timer_stats.h"
@@ -54,6 +55,20 @@ namespace mongo {
     static ServerStatusMetricField<Counter64> displayBufferSize( "repl.buffer.sizeBytes",
                                                                 &bufferSizeGauge );
 
+    namespace {
+        // Keeps the feedback thread reporting on a stream for as long as produce() reads it.
+        class StreamFeedbackScope : boost::noncopyable {
+          public:
+            StreamFeedbackScope(const string& host, long long cursorId, bool reportPosition,
+                                long long receivedBytes) {
+                oplogStreamFeedback.startStream(host, cursorId, reportPosition, receivedBytes);
+            }
+            ~StreamFeedbackScope() {
+                oplogStreamFeedback.endStream();
+            }
+        };
+    }
+
     // Number and time of each ApplyOps worker pool round
     static TimerStats applyBatchStats;
     static ServerStatusMetricField<TimerStats> displayOpBatchesApplied(
@@ -354,13 +369,26 @@ namespace mongo {
             }
         }
         GTID lastGTIDFetched = theReplSet->gtidManager->getLiveState();
-        r.tailingQueryGTE(rsoplog, lastGTIDFetched);
+        // A delayed secondary has no use for the sync target pushing ops at it.
+        const bool tryStreaming = replOplogStreaming && theReplSet->myConfig().slaveDelay == 0;
+        if (!tryStreaming || !r.streamingQueryGTE(rsoplog, lastGTIDFetched)) {
+            r.tailingQueryGTE(rsoplog, lastGTIDFetched);
+        }
 
         // if target cut connections between connecting and querying (for
         // example, because it stepped down) we might not have a cursor
-        if (!r.haveCursor() || !r.more()) {
+        if (!r.haveCursor()) {
             return 0;
         }
+        // The sync target counts every batch it streams, starting with the query's reply, so
+        // the stream feedback must too.  The loop below counts only the batches it fetches.
+        long long receivedBytes = r.currentBatchMessageSize();
+        if (!r.moreInCurrentBatch()) {
+            if (!r.more()) {
+                return 0;
+            }
+            receivedBytes += r.currentBatchMessageSize();
+        }
 
         try {
             uint64_t ts;
@@ -378,6 +406,21 @@ namespace mongo {
             return 2; // 2 is arbitrary, if we are going fatal, we are done
         }
 
+        const bool streaming = r.streaming();
+        scoped_ptr<StreamFeedbackScope> feedback;
+        if (streaming) {
+            string host;
+            {
+                boost::unique_lock<boost::mutex> lock(_mutex);
+                if (_currentSyncTarget == NULL) {
+                    return 0;
+                }
+                host = _currentSyncTarget->fullName();
+            }
+            feedback.reset(new StreamFeedbackScope(host, r.cursorId(), acknowledgingWrites,
+                                                   receivedBytes));
+        }
+
         while (!_opSyncShouldExit) {
             while (!_opSyncShouldExit) {
                 {
@@ -444,6 +487,9 @@ namespace mongo {
                     }
                     //increment
                     networkByteStats.increment(r.currentBatchMessageSize());
+                    if (streaming) {
+                        oplogStreamFeedback.noteReceived(r.currentBatchMessageSize());
+                    }
 
                 }
 
@@ -480,6 +526,9 @@ namespace mongo {
                         // we are operating as a secondary. We don't have to fsync
                         transaction.commit(DB_TXN_NOSYNC);
                     }
+                    if (streaming) {
+                        oplogStreamFeedback.noteWritten(getGTIDFromOplogEntry(o));
+                    }
                     {
                         GTID currEntry = getGTIDFromOplogEntry(o);
                         uint64_t lastHash = o["h"].numberLong();
@@ -530,6 +579,10 @@ namespace mongo {
         return 0;
     }
 
+    long long BackgroundSync::bufferedBytes() {
+        return bufferSizeGauge.get();
+    }
+
     bool BackgroundSync::shouldChangeSyncTarget() {
         boost::unique_lock<boost::mutex> lock(_mutex);
 
@@ -134,6 +134,9 @@ namespace mongo {
         // For monitoring
         BSONObj getCounters();
 
+        // bytes of oplog entries fetched but not yet applied
+        static long long bufferedBytes();
+
         // for when we are assuming a primary
         // or we are going  into maintenance mode or we are blocking sync
         // When called, this must hold the replica set lock. It cannot hold a
@@ -29,6 +29,7 @@
 #include "connections.h"
 #include "mongo/util/startup_test.h"
 #include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/oplog_stream.h"
 
 namespace mongo {
     /* decls for connections.h */
@@ -488,6 +489,8 @@ namespace mongo {
             b.append("syncingTo", syncTarget->fullName());
         }
         b.append("members", v);
+        // members streaming our oplog
+        oplogStreams.append(b);
         if( replSetBlind )
             b.append("blind",true); // to avoid confusion if set...normally never set except for testing.
     }
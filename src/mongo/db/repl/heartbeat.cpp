@@ -27,6 +27,8 @@
 #include "mongo/db/repl.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/connections.h"
+#include "mongo/db/repl/oplog_stream.h"
+#include "mongo/db/repl/refs_stager.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/repl/rs_config.h"
 #include "mongo/util/background.h"
@@ -566,6 +568,8 @@ namespace mongo {
         boost::thread replInfoUpdater(boost::bind(&ReplSetImpl::updateReplInfoThread, this));
         boost::thread replKeepOplogAlive(boost::bind(&ReplSetImpl::keepOplogAliveThread, this));
         boost::thread replOplogPartition(boost::bind(&ReplSetImpl::oplogPartitionThread, this));
+        boost::thread refsStager(boost::bind(&OplogRefsStager::stagerThread, &oplogRefsStager));
+        boost::thread streamFeedback(boost::bind(&OplogStreamFeedback::feedbackThread, &oplogStreamFeedback));
 
         task::fork(ghost);
 
@@ -0,0 +1,216 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/oplog_partitions.h"
+
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/oplog.h"
+#include "mongo/db/repl.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+
+namespace mongo {
+
+    OplogPartitionManager oplogPartitionManager;
+
+    MONGO_EXPORT_SERVER_PARAMETER(expireOplogBytes, long long, 0);
+
+    static const uint64_t millisPerHour = 60 * 60 * 1000;
+    static const uint64_t millisPerDay = 24 * millisPerHour;
+    // With expireOplogBytes set, a partition is added once the last one holds this fraction of
+    // it, so that the oplog shrinks by about that much at a time.
+    static const long long partitionsPerByteLimit = 16;
+    // Without it, bursts smaller than this do not get a partition of their own.
+    static const uint64_t minBurstPartitionBytes = 64 * 1024 * 1024;
+    // Time over which the write rate is averaged.
+    static const double rateHorizonSecs = 60 * 60;
+
+    OplogPartitionManager::OplogPartitionManager() :
+        _lastPass(0),
+        _lastInsertBytes(0),
+        _bytesPerSec(-1),
+        _oldestTS(0),
+        _oplogBytes(0),
+        _refsBytes(0),
+        _partitions(0),
+        _addedForAge(0),
+        _addedForBytes(0),
+        _droppedForAge(0),
+        _droppedForBytes(0) {
+    }
+
+    // called with _mutex held
+    void OplogPartitionManager::noteWriteRate(uint64_t now) {
+        const long long insertBytes = oplogInsertBytesStats.get();
+        if (_lastPass != 0 && now > _lastPass) {
+            const double secs = (now - _lastPass) / 1000.0;
+            const double rate = (insertBytes - _lastInsertBytes) / secs;
+            if (_bytesPerSec < 0) {
+                _bytesPerSec = rate;
+            }
+            else {
+                _bytesPerSec += min(1.0, secs / rateHorizonSecs) * (rate - _bytesPerSec);
+            }
+        }
+        _lastPass = now;
+        _lastInsertBytes = insertBytes;
+    }
+
+    bool OplogPartitionManager::runPass(uint64_t expireMillis) {
+        const uint64_t now = curTimeMillis64();
+        const long long limitBytes = expireOplogBytes;
+        double bytesPerSec;
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            noteWriteRate(now);
+            bytesPerSec = max(0.0, _bytesPerSec);
+        }
+
+        vector<OplogPartitionStats> partitions;
+        uint64_t refsBytes = 0;
+        uint64_t reclaimableRefsBytes = 0;
+        uint64_t oldestTS = 0;
+        try {
+            getOplogPartitionStats(&partitions, &refsBytes, &reclaimableRefsBytes, &oldestTS);
+        }
+        catch (std::exception& e) {
+            log() << "replSet caught oplog partition thread (when sizing partitions): " << e.what() << rsLog;
+            return false;
+        }
+        verify(!partitions.empty());
+        uint64_t oplogBytes = 0;
+        for (vector<OplogPartitionStats>::const_iterator it = partitions.begin(); it != partitions.end(); ++it) {
+            oplogBytes += it->bytes;
+        }
+
+        // deal with add partition
+        bool added = false;
+        try {
+            const OplogPartitionStats& last = partitions.back();
+            // if expireMillis is greater than a day (or 0), then we partition daily,
+            // otherwise, we partition hourly
+            const uint64_t timeBetweenAdds = (expireMillis == 0 || expireMillis >= millisPerDay) ? millisPerDay : millisPerHour;
+            const uint64_t partitionBytes = limitBytes > 0
+                    ? max(1LL, limitBytes / partitionsPerByteLimit)
+                    : max(minBurstPartitionBytes, (uint64_t) (2 * bytesPerSec * timeBetweenAdds / 1000));
+            const bool addForAge = now > last.createTime && now - last.createTime > timeBetweenAdds;
+            const bool addForBytes = !addForAge && last.bytes >= partitionBytes;
+            LOG(2) << "lastAddTime: " << last.createTime <<
+                " currTime: " << now <<
+                " timeBetweenAdds: " << timeBetweenAdds <<
+                " lastPartitionBytes: " << last.bytes <<
+                " partitionBytes: " << partitionBytes << rsLog;
+            if (addForAge || addForBytes) {
+                LOG(2) << "adding partition!" << rsLog;
+                addOplogPartitions();
+                added = true;
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                (addForAge ? _addedForAge : _addedForBytes)++;
+            }
+            else {
+                LOG(2) << "not adding partition" << rsLog;
+            }
+        }
+        catch (std::exception& e) {
+            log() << "replSet caught oplog partition thread (when adding): " << e.what() << rsLog;
+        }
+
+        // deal with possible drop partition, one at a time
+        bool dropped = false;
+        if (partitions.size() > 1) {
+            try {
+                bool dropForAge = false;
+                if (expireMillis) {
+                    if (now > expireMillis) { // avoid overflow error
+                        // if partition 1 was created before the cutoff, everything in
+                        // partition 0 has expired
+                        dropForAge = partitions[1].createTime <= now - expireMillis;
+                    }
+                    else {
+                        log() << "Not dropping partitions. expireMillis is too large. " <<
+                            "currTime: " << now << " expireMillis: " << expireMillis << rsLog;
+                    }
+                }
+                // oplog.refs that no oplog drop can trim, because the oplog entries referencing
+                // it are in the last partition or its transaction is still running, does not
+                // count: dropping the rest of the oplog for it would not bring the total down.
+                const bool dropForBytes = limitBytes > 0 &&
+                                          oplogBytes + reclaimableRefsBytes > (uint64_t) limitBytes;
+                if ((dropForAge || dropForBytes) && dropOldestOplogPartition(partitions[0].id)) {
+                    LOG(1) << "replSet dropped oplog partition " << partitions[0].id << " of "
+                           << partitions[0].bytes << " bytes" << rsLog;
+                    dropped = true;
+                    oplogBytes -= partitions[0].bytes;
+                    boost::unique_lock<boost::mutex> lk(_mutex);
+                    (dropForAge ? _droppedForAge : _droppedForBytes)++;
+                }
+            }
+            catch (std::exception& e) {
+                log() << "replSet caught oplog partition thread (when dropping): " << e.what() << rsLog;
+            }
+        }
+
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _oldestTS = dropped ? partitions[1].createTime : oldestTS;
+        _oplogBytes = oplogBytes;
+        _refsBytes = refsBytes;
+        _partitions = partitions.size() + (added ? 1 : 0) - (dropped ? 1 : 0);
+        return dropped;
+    }
+
+    void OplogPartitionManager::appendStats(BSONObjBuilder& b) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        if (_lastPass == 0) {
+            return;
+        }
+        const uint64_t now = curTimeMillis64();
+        BSONObjBuilder window(b.subobjStart("window"));
+        window.append("secs", (long long) (_oldestTS != 0 && now > _oldestTS ? (now - _oldestTS) / 1000 : 0));
+        window.append("bytes", (long long) (_oplogBytes + _refsBytes));
+        window.append("oplogBytes", (long long) _oplogBytes);
+        window.append("refsBytes", (long long) _refsBytes);
+        window.done();
+        b.append("partitions", (long long) _partitions);
+        b.append("writeBytesPerSec", (long long) max(0.0, _bytesPerSec));
+        b.append("expireOplogBytes", expireOplogBytes);
+        BSONObjBuilder added(b.subobjStart("added"));
+        added.append("age", _addedForAge);
+        added.append("bytes", _addedForBytes);
+        added.done();
+        BSONObjBuilder dropped(b.subobjStart("dropped"));
+        dropped.append("age", _droppedForAge);
+        dropped.append("bytes", _droppedForBytes);
+        dropped.done();
+    }
+
+    class OplogPartitionsSSS : public ServerStatusSection {
+      public:
+        OplogPartitionsSSS() : ServerStatusSection("oplogPartitions") {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection(const BSONElement& configElement) const {
+            if (!theReplSet) {
+                return BSONObj();
+            }
+            BSONObjBuilder b;
+            oplogPartitionManager.appendStats(b);
+            return b.obj();
+        }
+    } oplogPartitionsSSS;
+
+} // namespace mongo
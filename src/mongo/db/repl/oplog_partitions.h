@@ -0,0 +1,81 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    // server parameter: once the oplog and the part of oplog.refs that trimming the oplog can
+    // drop take more bytes than this, their oldest partitions are dropped whether or not they
+    // have expired.  0 means no limit.
+    extern long long expireOplogBytes;
+
+    /**
+     * Decides, for the oplog partition thread, when to add a partition to the oplog and
+     * oplog.refs and when to drop their oldest one.
+     *
+     * A partition is added once the last one is as old as the expiry settings call for (a day,
+     * or an hour if the oplog expires sooner than that), or once it holds a share of
+     * expireOplogBytes, or, with no byte limit, twice what the long run write rate puts in a
+     * partition that old.  A burst of writes thus ends up in partitions of its own, which can
+     * later be dropped without dropping much else.
+     *
+     * Partitions are dropped one at a time, each in its own transaction, so that trimming a lot
+     * of history never holds the lock on local for long.
+     */
+    class OplogPartitionManager : boost::noncopyable {
+      public:
+        OplogPartitionManager();
+
+        /**
+         * Adds a partition if one is due, and drops the oldest if it is past expireMillis
+         * (0 for no time limit) or the oplog is past expireOplogBytes.
+         *
+         * @return true if a partition was dropped, so another may be due right away
+         */
+        bool runPass(uint64_t expireMillis);
+
+        // oplog window and partition activity, for serverStatus
+        void appendStats(BSONObjBuilder& b);
+
+      private:
+        // folds the oplog bytes written since the last pass into the write rate
+        void noteWriteRate(uint64_t now);
+
+        boost::mutex _mutex;
+        uint64_t _lastPass;             // millis
+        long long _lastInsertBytes;
+        double _bytesPerSec;            // averaged over about an hour
+
+        // as of the last pass
+        uint64_t _oldestTS;
+        uint64_t _oplogBytes;
+        uint64_t _refsBytes;
+        uint64_t _partitions;
+
+        long long _addedForAge;
+        long long _addedForBytes;
+        long long _droppedForAge;
+        long long _droppedForBytes;
+    };
+
+    extern OplogPartitionManager oplogPartitionManager;
+
+} // namespace mongo
@@ -0,0 +1,299 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/oplog_stream.h"
+
+#include "mongo/db/client.h"
+#include "mongo/db/oplogreader.h"
+#include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    OplogStreams oplogStreams;
+    OplogStreamFeedback oplogStreamFeedback;
+
+    MONGO_EXPORT_SERVER_PARAMETER(replOplogStreaming, bool, true);
+    // How many bytes of fetched but unapplied oplog a streaming secondary lets the sync target
+    // have in flight.
+    MONGO_EXPORT_SERVER_PARAMETER(replOplogStreamWindowBytes, int, 64 * 1024 * 1024);
+
+    // A sync target sends anyway after waiting this long for a window, in case acks got lost.
+    static const int maxWindowWaitSecs = 20;
+    // Streams send at least an empty batch every few seconds; one that has sent nothing for this
+    // long lost its connection.
+    static const unsigned long long streamExpiryMillis = 60 * 1000;
+    // How often the feedback thread looks for a window reopened by the applier.
+    static const int feedbackIntervalMillis = 100;
+
+    OplogStreams::Stream::Stream() :
+        started(curTimeMillis64()),
+        lastSent(started),
+        sentOps(0),
+        sentBytes(0),
+        acked(false),
+        ackedBytes(0),
+        windowBytes(0),
+        windowWaits(0),
+        windowWaitMillis(0),
+        rateStart(started),
+        rateStartBytes(0),
+        bytesPerSec(0) {
+    }
+
+    void OplogStreams::waitForWindow(long long cursorId) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        Timer timer;
+        bool waited = false;
+        while (!inShutdown()) {
+            StreamMap::iterator it = _streams.find(cursorId);
+            if (it == _streams.end()) {
+                return;
+            }
+            Stream& s = it->second;
+            if (!s.acked || s.sentBytes < s.ackedBytes + s.windowBytes) {
+                break;
+            }
+            if (timer.seconds() >= maxWindowWaitSecs) {
+                LOG(1) << "replSet oplog stream to " << s.remote << " got no window for "
+                       << maxWindowWaitSecs << " seconds, sending anyway" << rsLog;
+                break;
+            }
+            if (!waited) {
+                s.windowWaits++;
+                waited = true;
+            }
+            _acked.timed_wait(lk, boost::posix_time::milliseconds(500));
+        }
+        if (waited) {
+            StreamMap::iterator it = _streams.find(cursorId);
+            if (it != _streams.end()) {
+                it->second.windowWaitMillis += timer.millis();
+            }
+        }
+    }
+
+    void OplogStreams::noteSent(long long cursorId, const string& remote, long long bytes, int nOps) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        Stream& s = _streams[cursorId];
+        if (s.remote.empty()) {
+            s.remote = remote;
+        }
+        const unsigned long long now = curTimeMillis64();
+        s.lastSent = now;
+        s.sentOps += nOps;
+        s.sentBytes += bytes;
+        if (now - s.rateStart >= 1000) {
+            s.bytesPerSec = (s.sentBytes - s.rateStartBytes) * 1000 / (now - s.rateStart);
+            s.rateStart = now;
+            s.rateStartBytes = s.sentBytes;
+        }
+        expire();
+    }
+
+    void OplogStreams::noteAck(long long cursorId, long long receivedBytes, long long windowBytes) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        StreamMap::iterator it = _streams.find(cursorId);
+        if (it == _streams.end()) {
+            return;
+        }
+        Stream& s = it->second;
+        s.acked = true;
+        s.ackedBytes = max(s.ackedBytes, receivedBytes);
+        s.windowBytes = windowBytes;
+        _acked.notify_all();
+    }
+
+    void OplogStreams::end(long long cursorId) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _streams.erase(cursorId);
+    }
+
+    // called with _mutex held
+    void OplogStreams::expire() {
+        const unsigned long long now = curTimeMillis64();
+        for (StreamMap::iterator it = _streams.begin(); it != _streams.end(); ) {
+            if (now - it->second.lastSent > streamExpiryMillis) {
+                _streams.erase(it++);
+            }
+            else {
+                ++it;
+            }
+        }
+    }
+
+    void OplogStreams::append(BSONObjBuilder& b) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        expire();
+        if (_streams.empty()) {
+            return;
+        }
+        const unsigned long long now = curTimeMillis64();
+        BSONArrayBuilder streams(b.subarrayStart("oplogStreams"));
+        for (StreamMap::const_iterator it = _streams.begin(); it != _streams.end(); ++it) {
+            const Stream& s = it->second;
+            BSONObjBuilder sb(streams.subobjStart());
+            sb.append("remote", s.remote);
+            sb.append("cursorId", it->first);
+            sb.appendDate("started", s.started);
+            sb.append("sentOps", s.sentOps);
+            sb.append("sentBytes", s.sentBytes);
+            // a rate last measured a while ago is stale
+            sb.append("bytesPerSec", now - s.rateStart > 2000 ? 0LL : s.bytesPerSec);
+            sb.append("inFlightBytes", s.sentBytes - s.ackedBytes);
+            if (s.acked) {
+                sb.append("windowBytes", s.windowBytes);
+            }
+            sb.append("windowWaits", s.windowWaits);
+            sb.append("windowWaitMillis", s.windowWaitMillis);
+            sb.done();
+        }
+        streams.done();
+    }
+
+    OplogStreamFeedback::OplogStreamFeedback() :
+        _cursorId(0),
+        _reportPosition(false),
+        _receivedBytes(0),
+        _haveWritten(false),
+        _dirty(false) {
+    }
+
+    void OplogStreamFeedback::startStream(const string& host, long long cursorId, bool reportPosition,
+                                          long long receivedBytes) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _host = host;
+        _cursorId = cursorId;
+        _reportPosition = reportPosition;
+        _receivedBytes = receivedBytes;
+        _haveWritten = false;
+        _dirty = true;
+        _changed.notify_all();
+    }
+
+    void OplogStreamFeedback::noteReceived(long long bytes) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _receivedBytes += bytes;
+        _dirty = true;
+        _changed.notify_all();
+    }
+
+    void OplogStreamFeedback::noteWritten(const GTID& gtid) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _written = gtid;
+        _haveWritten = true;
+        _dirty = true;
+        _changed.notify_all();
+    }
+
+    void OplogStreamFeedback::endStream() {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _cursorId = 0;
+        _dirty = true;
+        _changed.notify_all();
+    }
+
+    void OplogStreamFeedback::feedbackThread() {
+        Client::initThread("rsStreamFeedback");
+        replLocalAuth();
+        scoped_ptr<OplogReader> r;
+        string connectedHost;
+        bool connectedReporting = false;
+
+        // what the sync target was last told
+        long long ackedCursorId = 0;
+        long long ackedBytes = -1;
+        long long ackedWindow = -1;
+        GTID ackedWritten;
+
+        while (!inShutdown()) {
+            string host;
+            long long cursorId;
+            bool reportPosition;
+            long long receivedBytes;
+            GTID written;
+            bool haveWritten;
+            {
+                boost::unique_lock<boost::mutex> lk(_mutex);
+                if (!_dirty) {
+                    _changed.timed_wait(lk, boost::posix_time::milliseconds(feedbackIntervalMillis));
+                }
+                _dirty = false;
+                host = _host;
+                cursorId = _cursorId;
+                reportPosition = _reportPosition;
+                receivedBytes = _receivedBytes;
+                written = _written;
+                haveWritten = _haveWritten;
+            }
+
+            if (cursorId == 0) {
+                r.reset();
+                ackedCursorId = 0;
+                continue;
+            }
+
+            const long long window = max(0LL, (long long) replOplogStreamWindowBytes -
+                                               BackgroundSync::bufferedBytes());
+            const bool sendPosition = reportPosition && haveWritten;
+            if (cursorId == ackedCursorId && receivedBytes == ackedBytes && window == ackedWindow &&
+                (!sendPosition || GTID::cmp(written, ackedWritten) == 0)) {
+                continue;
+            }
+
+            try {
+                if (!r || host != connectedHost || reportPosition != connectedReporting) {
+                    r.reset(new OplogReader(reportPosition /* doHandshake */));
+                    if (!r->connect(host)) {
+                        r.reset();
+                        continue;
+                    }
+                    connectedHost = host;
+                    connectedReporting = reportPosition;
+                }
+
+                BSONObjBuilder cmd;
+                cmd.append("updateSlave", 1);
+                if (sendPosition) {
+                    addGTIDToBSON("gtid", written, cmd);
+                }
+                cmd.append("stream", cursorId);
+                cmd.append("received", receivedBytes);
+                cmd.append("window", window);
+                BSONObj res;
+                if (!r->conn()->runCommand("local", cmd.done(), res)) {
+                    LOG(1) << "replSet oplog stream ack to " << host << " failed: " << res << rsLog;
+                    r.reset();
+                    continue;
+                }
+                ackedCursorId = cursorId;
+                ackedBytes = receivedBytes;
+                ackedWindow = window;
+                ackedWritten = written;
+            }
+            catch (DBException& e) {
+                LOG(1) << "replSet error acking oplog stream to " << host << ": " << e.toString() << rsLog;
+                r.reset();
+            }
+        }
+        cc().shutdown();
+    }
+
+} // namespace mongo
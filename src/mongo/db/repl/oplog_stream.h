@@ -0,0 +1,130 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/db/gtid.h"
+#include "mongo/db/jsobj.h"
+
+/*
+ * Oplog streaming.
+ *
+ * Instead of asking for each batch of the sync target's oplog with a getMore, a secondary can
+ * tail it with an exhaust cursor: the sync target keeps sending batches as they fill, so a
+ * batch costs no round trip.  The stream connection carries no handshake, so batches being
+ * sent say nothing about what the secondary has.  On a second connection, the secondary
+ * reports with updateSlave how far it has written (for write concern) and how many stream
+ * bytes it has received, along with how many more it has room to buffer.  The sync target
+ * stops sending once a stream has that many bytes in flight.
+ */
+
+namespace mongo {
+
+    // server parameter: whether secondaries stream the sync target's oplog
+    extern bool replOplogStreaming;
+
+    /**
+     * Kept by the sync target: the oplog streams it is sending, keyed by cursor id.
+     */
+    class OplogStreams : boost::noncopyable {
+      public:
+        OplogStreams() { }
+
+        // Blocks while the stream has used up the window its member last granted.  No-op for
+        // cursors that are not streaming.
+        void waitForWindow(long long cursorId);
+
+        // A batch of nOps entries, bytes long, was sent on the stream.
+        void noteSent(long long cursorId, const string& remote, long long bytes, int nOps);
+
+        // The member has received the stream's first receivedBytes, and has room for
+        // windowBytes more.
+        void noteAck(long long cursorId, long long receivedBytes, long long windowBytes);
+
+        void end(long long cursorId);
+
+        // for replSetGetStatus, nothing if there are no streams
+        void append(BSONObjBuilder& b);
+
+      private:
+        struct Stream {
+            Stream();
+            string remote;
+            unsigned long long started;     // millis
+            unsigned long long lastSent;
+            long long sentOps;
+            long long sentBytes;
+            bool acked;             // no window until the member's first ack
+            long long ackedBytes;
+            long long windowBytes;
+            long long windowWaits;
+            long long windowWaitMillis;
+            // send rate over the last second or so
+            unsigned long long rateStart;
+            long long rateStartBytes;
+            long long bytesPerSec;
+        };
+        typedef map<long long, Stream> StreamMap;
+
+        void expire();
+
+        boost::mutex _mutex;
+        boost::condition_variable _acked;
+        StreamMap _streams;
+    };
+
+    extern OplogStreams oplogStreams;
+
+    /**
+     * Kept by the secondary: reports on the stream the producer is reading, from its own thread
+     * so that the producer never waits on a round trip.
+     */
+    class OplogStreamFeedback : boost::noncopyable {
+      public:
+        OplogStreamFeedback();
+
+        // Reports on the current stream until shutdown.
+        void feedbackThread();
+
+        /**
+         * The producer started reading the stream for cursorId from host, and has received its
+         * first receivedBytes.  If reportPosition, the feedback connection handshakes so that
+         * the written position counts for write concern.
+         */
+        void startStream(const string& host, long long cursorId, bool reportPosition,
+                         long long receivedBytes);
+        void noteReceived(long long bytes);
+        void noteWritten(const GTID& gtid);
+        void endStream();
+
+      private:
+        boost::mutex _mutex;
+        boost::condition_variable _changed;
+        string _host;
+        long long _cursorId;        // 0 if not streaming
+        bool _reportPosition;
+        long long _receivedBytes;
+        GTID _written;
+        bool _haveWritten;
+        bool _dirty;                // changed since the feedback thread last looked
+    };
+
+    extern OplogStreamFeedback oplogStreamFeedback;
+
+} // namespace mongo
@@ -0,0 +1,367 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/repl/refs_stager.h"
+
+#include <limits>
+
+#include "mongo/base/counter.h"
+#include "mongo/db/client.h"
+#include "mongo/db/collection.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/cursor.h"
+#include "mongo/db/keypattern.h"
+#include "mongo/db/oplog.h"
+#include "mongo/db/oplogreader.h"
+#include "mongo/db/repl/bgsync.h"
+#include "mongo/db/repl/rs.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/stats/timer_stats.h"
+#include "mongo/util/timer.h"
+
+namespace mongo {
+
+    OplogRefsStager oplogRefsStager;
+
+    // Whether secondaries stage oplog.refs entries of transactions still running on the sync target.
+    MONGO_EXPORT_SERVER_PARAMETER(stageLargeTxnRefs, bool, true);
+    // How often the sync target is polled for new oplog.refs entries.
+    MONGO_EXPORT_SERVER_PARAMETER(stageLargeTxnRefsIntervalMillis, int, 200);
+    // Transactions that started longer ago than this are not staged; they are copied in full when
+    // their oplog entry arrives.
+    MONGO_EXPORT_SERVER_PARAMETER(stageLargeTxnRefsHorizonSecs, int, 3600);
+
+    // Large transactions whose oplog entry has been replicated
+    static Counter64 largeTxnCount;
+    static ServerStatusMetricField<Counter64> displayLargeTxnCount( "repl.largeTxn.count",
+                                                                    &largeTxnCount );
+    // Bytes of those transactions that were staged before their oplog entry arrived
+    static Counter64 largeTxnPreStagedBytes;
+    static ServerStatusMetricField<Counter64> displayLargeTxnPreStagedBytes(
+                                                    "repl.largeTxn.preStagedBytes",
+                                                    &largeTxnPreStagedBytes );
+    // Bytes that still had to be copied once the oplog entry arrived
+    static Counter64 largeTxnCommitBytes;
+    static ServerStatusMetricField<Counter64> displayLargeTxnCommitBytes(
+                                                    "repl.largeTxn.copiedAtCommitBytes",
+                                                    &largeTxnCommitBytes );
+    // Number and time of the copies done when the oplog entry arrived
+    static TimerStats largeTxnCommitCopyStats;
+    static ServerStatusMetricField<TimerStats> displayLargeTxnCommitCopy(
+                                                    "repl.largeTxn.commitCopies",
+                                                    &largeTxnCommitCopyStats );
+
+    static const size_t numRecentTxns = 10;
+
+    static Query refsQuery(const BSONObj& idCond) {
+        return Query(BSON("_id" << idCond)).hint(BSON("_id" << 1));
+    }
+
+    static BSONObj refsId(const OID& oid, long long seq) {
+        return BSON("oid" << oid << "seq" << seq);
+    }
+
+    // Copies the entries for oid matched by q into the local oplog.refs, in the caller's
+    // transaction. @return the number of bytes copied
+    static long long copyRefs(OplogReader& r, const OID& oid, const Query& q) {
+        long long bytes = 0;
+        auto_ptr<DBClientCursor> c = r.conn()->query(rsOplogRefs, q, 0, 0, NULL, QueryOption_SlaveOk);
+        uassert(17367, "Could not get oplog refs cursor", c.get());
+        while (c->more()) {
+            BSONObj b = c->nextSafe();
+            if (oid != b.getFieldDotted("_id.oid").OID()) {
+                break;
+            }
+            LOG(6) << "copyOplogRefsRange " << b << endl;
+            writeEntryToOplogRefs(b);
+            bytes += b.objsize();
+        }
+        return bytes;
+    }
+
+    // Drops from staged every seq that is no longer in the local oplog.refs.  Staged entries are
+    // not referenced by anything in our oplog yet, so trimming may have taken them.
+    // @return true if nothing was missing
+    static bool checkStagedRefs(const OID& oid, set<long long>& staged) {
+        Collection* rsOplogRefsDetails = getCollection(rsOplogRefs);
+        verify(rsOplogRefsDetails != NULL);
+        set<long long> present;
+        for (shared_ptr<Cursor> c(Cursor::make(rsOplogRefsDetails,
+                                               rsOplogRefsDetails->getPKIndex(),
+                                               KeyPattern::toKeyFormat(BSON("_id" << refsId(oid, 0))),
+                                               KeyPattern::toKeyFormat(BSON("_id" << refsId(oid, numeric_limits<long long>::max()))),
+                                               true,
+                                               1));
+             c->ok(); c->advance()) {
+            const long long seq = c->currPK().firstElement().embeddedObject()["seq"].numberLong();
+            if (staged.count(seq)) {
+                present.insert(seq);
+            }
+        }
+        const bool complete = present.size() == staged.size();
+        staged.swap(present);
+        return complete;
+    }
+
+    void OplogRefsStager::stagerThread() {
+        Client::initThread("rsRefsStager");
+        replLocalAuth();
+        OplogReader r(false /* doHandshake */);
+        string target;
+
+        while (!inShutdown()) {
+            sleepmillis(stageLargeTxnRefsIntervalMillis);
+            try {
+                const Member* m = NULL;
+                if (stageLargeTxnRefs && theReplSet && theReplSet->isSecondary()) {
+                    BackgroundSync* sync = BackgroundSync::get();
+                    if (sync != NULL) {
+                        m = sync->getSyncTarget();
+                    }
+                }
+                if (m == NULL) {
+                    r.resetConnection();
+                    target.clear();
+                    continue;
+                }
+                const string host = m->fullName();
+                if (host != target) {
+                    r.resetConnection();
+                    target.clear();
+                    if (!r.connect(host)) {
+                        r.resetConnection();
+                        continue;
+                    }
+                    target = host;
+                }
+                stagePass(r);
+            }
+            catch (DBException& e) {
+                LOG(1) << "replSet error staging oplog.refs from " << target << ": " << e.toString() << rsLog;
+                r.resetConnection();
+                target.clear();
+            }
+        }
+        cc().shutdown();
+    }
+
+    void OplogRefsStager::stagePass(OplogReader& r) {
+        OID horizon;
+        horizon.init(Date_t((time(0) - stageLargeTxnRefsHorizonSecs) * 1000LL));
+        expire(horizon);
+
+        // Hop from one transaction to the next with a seek past the last possible seq of the
+        // previous one, so each pass costs one lookup per transaction plus whatever is new.
+        OID cur = horizon;
+        const BSONObj idOnly = BSON("_id" << 1);
+        while (!inShutdown()) {
+            const Query q = refsQuery(BSON("$gt" << refsId(cur, numeric_limits<long long>::max())));
+            BSONObj next = r.conn()->findOne(rsOplogRefs, q, &idOnly, QueryOption_SlaveOk);
+            if (next.isEmpty()) {
+                break;
+            }
+            const OID oid = next.getFieldDotted("_id.oid").OID();
+            const long long firstSeq = next.getFieldDotted("_id.seq").numberLong();
+            cur = oid;
+
+            long long afterSeq;
+            {
+                boost::unique_lock<boost::mutex> lock(_mutex);
+                map<OID, StagedTxn>::iterator it = _txns.find(oid);
+                if (it != _txns.end()) {
+                    if (it->second.done) {
+                        continue;
+                    }
+                    afterSeq = it->second.lastSeq;
+                }
+                else {
+                    afterSeq = -1;
+                }
+            }
+            if (afterSeq < 0) {
+                // First time we see this transaction.  If its first entry is already here, it was
+                // replicated (or staged) before we last started, so leave it alone.
+                bool present;
+                {
+                    LOCK_REASON(lockReason, "repl: checking for staged oplog.refs entry");
+                    Client::ReadContext ctx(rsOplogRefs, lockReason);
+                    Client::Transaction txn(DB_SERIALIZABLE);
+                    BSONObj found;
+                    present = Collection::findOne(rsOplogRefs, BSON("_id" << refsId(oid, firstSeq)), found, true);
+                    txn.commit();
+                }
+                boost::unique_lock<boost::mutex> lock(_mutex);
+                StagedTxn& t = _txns[oid];
+                if (present) {
+                    t.done = true;
+                    continue;
+                }
+                afterSeq = t.lastSeq;
+            }
+            stageTxn(r, oid, afterSeq);
+        }
+    }
+
+    void OplogRefsStager::stageTxn(OplogReader& r, const OID& oid, long long afterSeq) {
+        auto_ptr<DBClientCursor> c = r.conn()->query(rsOplogRefs,
+                                                     refsQuery(BSON("$gt" << refsId(oid, afterSeq))),
+                                                     0, 0, NULL, QueryOption_SlaveOk);
+        uassert(17368, "Could not get oplog refs cursor", c.get());
+        while (c->more() && !inShutdown()) {
+            BSONObj b = c->nextSafe();
+            if (oid != b.getFieldDotted("_id.oid").OID()) {
+                break;
+            }
+            const long long seq = b.getFieldDotted("_id.seq").numberLong();
+            {
+                LOCK_REASON(lockReason, "repl: staging oplog.refs entry");
+                Client::ReadContext ctx(rsOplogRefs, lockReason);
+                Client::Transaction txn(DB_SERIALIZABLE);
+                writeEntryToOplogRefs(b);
+                // we are operating as a secondary. We don't have to fsync
+                txn.commit(DB_TXN_NOSYNC);
+            }
+            // Only note the entry once it is committed, so finishTransaction never counts on
+            // something it cannot see.
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            StagedTxn& t = _txns[oid];
+            if (t.done) {
+                return;
+            }
+            t.seqs.insert(seq);
+            t.lastSeq = std::max(t.lastSeq, seq);
+            t.bytes += b.objsize();
+        }
+    }
+
+    void OplogRefsStager::expire(const OID& horizon) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        _txns.erase(_txns.begin(), _txns.lower_bound(horizon));
+    }
+
+    void OplogRefsStager::finishTransaction(const OID& oid, OplogReader& r) {
+        set<long long> staged;
+        long long stagedBytes;
+        {
+            boost::unique_lock<boost::mutex> lock(_mutex);
+            StagedTxn& t = _txns[oid];
+            t.done = true;
+            staged.swap(t.seqs);
+            stagedBytes = t.bytes;
+        }
+
+        if (!staged.empty() && !checkStagedRefs(oid, staged)) {
+            // Some of what we staged was trimmed before the transaction's oplog entry arrived
+            // to hold on to it.  Rather than trust what is left, copy the whole transaction.
+            LOG(1) << "replSet staged oplog.refs entries of " << oid << " were trimmed, copying it in full" << rsLog;
+            staged.clear();
+            stagedBytes = 0;
+        }
+
+        Timer timer;
+        long long copiedBytes = 0;
+        if (staged.empty()) {
+            copiedBytes = copyRefs(r, oid, refsQuery(BSON("$gt" << refsId(oid, 0))));
+        }
+        else {
+            // Find out which entries we are missing by their _id alone, then copy each run of
+            // missing entries with one range query.  For a transaction that did all of its
+            // spilling at the root, that is just the tail written after our last pass.
+            vector<pair<long long, long long> > runs;
+            const BSONObj idOnly = BSON("_id" << 1);
+            auto_ptr<DBClientCursor> c = r.conn()->query(rsOplogRefs,
+                                                         refsQuery(BSON("$gt" << refsId(oid, 0))),
+                                                         0, 0, &idOnly, QueryOption_SlaveOk);
+            uassert(17369, "Could not get oplog refs cursor", c.get());
+            bool inRun = false;
+            while (c->more()) {
+                BSONObj b = c->nextSafe();
+                if (oid != b.getFieldDotted("_id.oid").OID()) {
+                    break;
+                }
+                const long long seq = b.getFieldDotted("_id.seq").numberLong();
+                if (staged.count(seq)) {
+                    inRun = false;
+                }
+                else if (inRun) {
+                    runs.back().second = seq;
+                }
+                else {
+                    runs.push_back(make_pair(seq, seq));
+                    inRun = true;
+                }
+            }
+            for (vector<pair<long long, long long> >::const_iterator it = runs.begin(); it != runs.end(); ++it) {
+                copiedBytes += copyRefs(r, oid, refsQuery(BSON("$gte" << refsId(oid, it->first) <<
+                                                               "$lte" << refsId(oid, it->second))));
+            }
+        }
+        const int millis = largeTxnCommitCopyStats.record(timer);
+
+        largeTxnCount.increment();
+        largeTxnPreStagedBytes.increment(stagedBytes);
+        largeTxnCommitBytes.increment(copiedBytes);
+
+        const long long total = stagedBytes + copiedBytes;
+        const double preStaged = total > 0 ? double(stagedBytes) / total : 0.0;
+        LOG(1) << "replSet large transaction " << oid << ": " << stagedBytes << " bytes staged, "
+               << copiedBytes << " bytes copied at commit in " << millis << "ms" << rsLog;
+
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        _recent.push_back(BSON("ref" << oid <<
+                               "preStagedBytes" << stagedBytes <<
+                               "copiedAtCommitBytes" << copiedBytes <<
+                               "preStagedRatio" << preStaged <<
+                               "commitCopyMillis" << millis));
+        if (_recent.size() > numRecentTxns) {
+            _recent.pop_front();
+        }
+    }
+
+    void OplogRefsStager::appendStats(BSONObjBuilder& b) {
+        boost::unique_lock<boost::mutex> lock(_mutex);
+        int staging = 0;
+        for (map<OID, StagedTxn>::const_iterator it = _txns.begin(); it != _txns.end(); ++it) {
+            if (!it->second.done) {
+                staging++;
+            }
+        }
+        b.append("staging", staging);
+        BSONArrayBuilder recent(b.subarrayStart("recent"));
+        for (deque<BSONObj>::const_iterator it = _recent.begin(); it != _recent.end(); ++it) {
+            recent.append(*it);
+        }
+        recent.done();
+    }
+
+    class LargeTxnStagingSSS : public ServerStatusSection {
+      public:
+        LargeTxnStagingSSS() : ServerStatusSection("largeTxnStaging") {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection(const BSONElement& configElement) const {
+            if (!theReplSet) {
+                return BSONObj();
+            }
+            BSONObjBuilder b;
+            oplogRefsStager.appendStats(b);
+            return b.obj();
+        }
+    } largeTxnStagingSSS;
+
+} // namespace mongo
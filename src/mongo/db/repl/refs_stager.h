@@ -0,0 +1,79 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/thread/mutex.hpp>
+
+#include "mongo/db/jsobj.h"
+
+namespace mongo {
+
+    class OplogReader;
+
+    /**
+     * Copies the oplog.refs entries of large transactions from the sync target while those
+     * transactions are still running there.  When a transaction's oplog entry arrives, only the
+     * entries that were not staged have to be copied before it can be applied.
+     *
+     * The primary commits the entries a root transaction spills as soon as they are written (see
+     * logOpsToOplogRef), so they can be read before the transaction commits.  Entries spilled by
+     * a child transaction only become visible when the root commits, and are copied then.
+     *
+     * Staging is best effort: anything it missed, or state lost across a restart, just means more
+     * is copied when the oplog entry arrives.
+     */
+    class OplogRefsStager : boost::noncopyable {
+      public:
+        OplogRefsStager() { }
+
+        // Stages entries from the current sync target until shutdown.
+        void stagerThread();
+
+        /**
+         * Called when the oplog entry referencing oid arrives.  Copies the entries for oid that
+         * were not already staged and stops staging oid.  If any staged entry has since been
+         * trimmed, copies all of them.  Requires a read lock on local.
+         */
+        void finishTransaction(const OID& oid, OplogReader& r);
+
+        void appendStats(BSONObjBuilder& b);
+
+      private:
+        struct StagedTxn {
+            StagedTxn() : lastSeq(0), bytes(0), done(false) { }
+            long long lastSeq;      // highest seq staged so far
+            set<long long> seqs;    // every seq staged so far
+            long long bytes;
+            bool done;              // oplog entry has arrived, stop staging
+        };
+
+        // Visits each transaction with entries in the sync target's oplog.refs that started
+        // after the staging horizon, and stages whatever is new.
+        void stagePass(OplogReader& r);
+        void stageTxn(OplogReader& r, const OID& oid, long long afterSeq);
+        void expire(const OID& horizon);
+
+        // _mutex protects all of the class variables
+        boost::mutex _mutex;
+        map<OID, StagedTxn> _txns;
+        // the most recent large transactions to arrive, oldest first
+        deque<BSONObj> _recent;
+    };
+
+    extern OplogRefsStager oplogRefsStager;
+
+} // namespace mongo
@@ -28,6 +28,7 @@
 #include "mongo/db/repl.h"
 #include "mongo/db/repl/bgsync.h"
 #include "mongo/db/repl/connections.h"
+#include "mongo/db/repl/oplog_partitions.h"
 #include "mongo/db/repl/rs.h"
 #include "mongo/db/server_parameters.h"
 #include "mongo/platform/bits.h"
@@ -1139,64 +1140,30 @@ namespace mongo {
         replLocalAuth();
         log() << "starting thread" << rsLog;
         while (_replBackgroundShouldRun) {
-            const uint64_t currTime = curTimeMillis64();
             uint64_t expireMillis = 0;
             {
                 boost::unique_lock<boost::mutex> lock(_oplogPartitionMutex);
                 expireMillis = expireOplogMilliseconds();
             }
-            // deal with add partition
             try {
-                uint64_t lastAddTime = getLastPartitionAddTime();
-                // if expireMillis is greater than a day (or 0), then we partition daily,
-                // otherwise, we partition hourly
-                uint64_t timeBetweenAdds = (expireMillis == 0 || expireMillis >= 24*60*60*1000) ? 24*60*60*1000 : 60*60*1000;
-                LOG(2) << "lastAddTime: " << lastAddTime << 
-                    " currTime: " << currTime <<
-                    " timeBetweenAdds: " << timeBetweenAdds <<
-                    "diff" << currTime - lastAddTime << rsLog;
-                if (currTime > lastAddTime && ((currTime - lastAddTime) > timeBetweenAdds)) {
-                    LOG(2) << "adding partition!" << rsLog;
-                    addOplogPartitions();
-                } 
-                else {
-                    LOG(2) << "not adding partition" << rsLog;
-                }
+                RollbackPreImages::maintain();
             }
-            catch(std::exception& e) {
-                log() << "replSet caught oplog partition thread (when adding): " << e.what() << rsLog;
+            catch (std::exception& e) {
+                log() << "replSet caught oplog partition thread (when trimming rollback pre-images): " << e.what() << rsLog;
             }
-            catch (...) {
-                log() << "exception cought in oplog partition thread (when adding): " << rsLog;
-            }
-
-            // deal with possible drop partition
-            if (expireMillis) {
-                try {
-                    // possibly drop partition
-                    if (currTime > expireMillis) { // avoid overflow error
-                        trimOplogWithTS(curTimeMillis64() - expireMillis);
-                    }
-                    else {
-                        log() << "Not dropping partitions. expireMillis is too large. " <<
-                            "currTime: " << currTime << " expireMillis: " << expireMillis << rsLog;
-                    }
-                }
-                catch(std::exception& e) {
-                    log() << "replSet caught oplog partition thread (when dropping): " << e.what() << rsLog;
-                }
-                catch (...) {
-                    log() << "exception caught in oplog partition thread (when dropping): " << rsLog;
-                }
+            if (oplogPartitionManager.runPass(expireMillis)) {
+                // more partitions may be due to be dropped, don't wait to find out
+                continue;
             }
 
-            // now sleep for 60 seconds. We basically run this loop once a minute
+            // now sleep for 10 seconds, so that a burst of writes does not get far before
+            // it gets a partition of its own
             {
                 boost::unique_lock<boost::mutex> lock(_oplogPartitionMutex);
                 LOG(2) << "sleeping" << rsLog;
                 _oplogPartitionCond.timed_wait(
                     lock,
-                    boost::posix_time::milliseconds(60*1000)
+                    boost::posix_time::milliseconds(10*1000)
                     );
                 LOG(2) << "woke up" << rsLog;
             }
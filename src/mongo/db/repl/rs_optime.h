@@ -30,4 +30,5 @@ namespace mongo {
     const char rsRollbackGTIDSet[] = "local.rollback.gtidset";
     const char rsRollbackDocs[] = "local.rollback.docs";
     const char rsRollbackOpdata[] = "local.rollback.opdata"; // stores oplog entries that are rolled back
+    const char rsRollbackPreImages[] = "local.rollback.preimages"; // see RollbackPreImages
 }
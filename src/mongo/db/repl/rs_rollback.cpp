@@ -28,11 +28,54 @@
 #include "mongo/client/remote_transaction.h"
 #include "mongo/db/ops/delete.h"
 #include "mongo/db/ops/insert.h"
+#include "mongo/util/timer.h"
 
 namespace mongo {
 
     #define ROLLBACK_ID "rollbackStatus"
 
+    // documents fetched from the sync source to replace the ones rollback removed
+    static Counter64 rollbackDocsRefetched;
+    static ServerStatusMetricField<Counter64> displayRollbackDocsRefetched(
+                                                    "repl.rollback.docsRefetched",
+                                                    &rollbackDocsRefetched );
+    // the queries that fetched them, one per batch of documents from a collection
+    static TimerStats rollbackRefetchBatchStats;
+    static ServerStatusMetricField<TimerStats> displayRollbackRefetchBatches(
+                                                    "repl.rollback.refetchBatches",
+                                                    &rollbackRefetchBatchStats );
+
+    // how many documents of a collection are fetched from the sync source with one query
+    static const size_t refetchBatchSize = 500;
+
+    // Logs how far a phase of rollback has gotten, and how fast, every few seconds.
+    class RollbackProgress {
+        const string _what;
+        const long long _total;
+        long long _done;
+        Timer _timer;
+        int _lastLogSecs;
+        long long docsPerSec() const {
+            return _done * 1000 / max(1LL, (long long) _timer.millis());
+        }
+    public:
+        RollbackProgress(const string& what, long long total) :
+            _what(what), _total(total), _done(0), _lastLogSecs(0) {
+        }
+        void note(long long n) {
+            _done += n;
+            if (_timer.seconds() - _lastLogSecs >= 10) {
+                _lastLogSecs = _timer.seconds();
+                log() << "rollback " << _what << ": " << _done << "/" << _total << ", " <<
+                    docsPerSec() << " per second" << rsLog;
+            }
+        }
+        void done() {
+            log() << "rollback done " << _what << ": " << _done << " in " << _timer.seconds() <<
+                " seconds, " << docsPerSec() << " per second" << rsLog;
+        }
+    };
+
     void incRBID();
     void applyMissingOpsInOplog(GTID minUnappliedGTID, const bool inRollback);
 
@@ -233,6 +276,7 @@ namespace mongo {
         // have nothing left (and remain that way, because this is the only
         // thread that can put work on the applier). Now we can rollback
         // the data.
+        RollbackProgress progress("undoing oplog entries", -1);
         while (true) {
             BSONObj o;
             {
@@ -252,18 +296,21 @@ namespace mongo {
                 break;
             }
             rollbackTransactionFromOplog(o, docsMap, rsSave);
+            progress.note(1);
         }
+        progress.done();
         log() << "Rolling back to " << idToRollbackTo.toString() << " produced " <<
             docsMap->size() << " documents for which we need to retrieve a snapshot of." << rsLog;
     }
 
-    void removeDataFromDocsMap() {
+    void removeDataFromDocsMap(long long total) {
         Client::Transaction txn(DB_SERIALIZABLE);
-        RollbackDocsMapIterator docsMap;
         size_t numDocs = 0;
         log() << "Removing documents from collections for rollback." << rsLog;
+        RollbackProgress progress("removing documents", total);
         for (RollbackDocsMapIterator it; it.ok(); it.advance()){
             numDocs++;
+            progress.note(1);
             DocID curr = it.current();
             LOCK_REASON(lockReason, "repl: deleting a doc during rollback");
             Client::ReadContext ctx(curr.ns, lockReason);
@@ -276,37 +323,69 @@ namespace mongo {
                 deleteOneObject(cl, curr.pk, currDoc, Collection::NO_LOCKTREE);
             }
         }
+        progress.done();
         log() << "Done removing " << numDocs << " documents from collections for rollback." << rsLog;
         updateRollbackStatus(BSON("_id" << ROLLBACK_ID << "state" << RB_DOCS_REMOVED<< \
             "info" << "removed docs from docs map"));
         txn.commit(DB_TXN_NOSYNC);
     }
 
+    // Reads the documents of ns with the given pks from the remote snapshot with one query,
+    // and applies them locally
+    static void applySnapshotOfDocs(DBClientConnection* conn, const string& ns, const vector<BSONObj>& pks) {
+        LOCK_REASON(lockReason, "repl: appling snapshot of docs during rollback");
+        Client::ReadContext ctx(ns, lockReason);
+        Collection* cl = getCollection(ns);
+        if (cl->isPKHidden()) {
+            log() << "Collection " << ns << " has a hidden PK, yet it has \
+                a document for which we want to apply a snapshot of: " << \
+                pks[0] << rsLog;
+            throw RollbackOplogException("Collection for which we are applying a document has a hidden PK");
+        }
+        BSONArrayBuilder clauses;
+        for (vector<BSONObj>::const_iterator it = pks.begin(); it != pks.end(); ++it) {
+            clauses.append(cl->fillPKWithFields(*it));
+        }
+        TimerHolder batchTimer(&rollbackRefetchBatchStats);
+        auto_ptr<DBClientCursor> cursor = conn->query(ns, Query(BSON("$or" << clauses.arr())), 0, 0, NULL, QueryOption_SlaveOk);
+        uassert(17379, "Could not create a cursor to read documents from the remote snapshot during rollback", cursor.get());
+        // documents that no longer exist remotely are simply not returned, and stay removed
+        while (cursor->more()) {
+            BSONObj remoteImage = cursor->nextSafe();
+            const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
+            insertOneObject(cl, remoteImage, flags);
+            rollbackDocsRefetched.increment();
+        }
+    }
+
     // on input, conn is a connection for which the caller has created a multi-statement
-    // mvcc transaction over it. Reads the document from the remote server and
-    // applies it locally
-    void applySnapshotOfDocsMap(shared_ptr<DBClientConnection> conn) {
+    // mvcc transaction over it. Reads the documents from the remote server, a batch per
+    // collection at a time, and applies them locally
+    void applySnapshotOfDocsMap(shared_ptr<DBClientConnection> conn, long long total) {
         size_t numDocs = 0;
         log() << "Applying documents to collections for rollback." << rsLog;
+        RollbackProgress progress("fetching documents", total);
+        string ns;
+        vector<BSONObj> pks;
+        // the docs map is sorted by ns, so documents of a collection come together
         for (RollbackDocsMapIterator it; it.ok(); it.advance()){
             numDocs++;
             DocID curr = it.current();
-            LOCK_REASON(lockReason, "repl: appling snapshot of doc during rollback");
-            Client::ReadContext ctx(curr.ns, lockReason);
-            Collection* cl = getCollection(curr.ns);
-            if (cl->isPKHidden()) {
-                log() << "Collection " << curr.ns << " has a hidden PK, yet it has \
-                    a document for which we want to apply a snapshot of: " << \
-                    curr.pk << rsLog;
-                throw RollbackOplogException("Collection for which we are applying a document has a hidden PK");
-            }
-            BSONObj pkWithFields = cl->fillPKWithFields(curr.pk);
-            BSONObj remoteImage = findOneFromConn(conn.get(), curr.ns, Query(pkWithFields));
-            if (!remoteImage.isEmpty()) {
-                const uint64_t flags = Collection::NO_UNIQUE_CHECKS | Collection::NO_LOCKTREE;
-                insertOneObject(cl, remoteImage, flags);
+            if (curr.ns != ns || pks.size() >= refetchBatchSize) {
+                if (!pks.empty()) {
+                    applySnapshotOfDocs(conn.get(), ns, pks);
+                    progress.note(pks.size());
+                    pks.clear();
+                }
+                ns = curr.ns;
             }
+            pks.push_back(curr.pk);
+        }
+        if (!pks.empty()) {
+            applySnapshotOfDocs(conn.get(), ns, pks);
+            progress.note(pks.size());
         }
+        progress.done();
         log() << "Done applying remote images of " << numDocs << " documents to collections for rollback." << rsLog;
     }
 
@@ -456,11 +535,12 @@ namespace mongo {
         BSONObj res = findOneFromConn(conn.get(), rsReplInfo , b.done());
         GTID minUnapplied = getGTIDFromBSON("GTID", res);
 
+        const long long numDocs = RollbackDocsMap().size();
         Client::Transaction txn(DB_SERIALIZABLE);
         RollbackGTIDSetBuilder appliedGTIDsBuilder(minUnapplied);
         createAppliedGTIDSet(minUnapplied, conn, &appliedGTIDsBuilder);
         // apply snapshot of each doc in docsMap
-        applySnapshotOfDocsMap(conn);
+        applySnapshotOfDocsMap(conn, numDocs);
 
         bool ok = rtxn.commit();
         verify(ok);  // absolutely no reason this should fail, it was read only
@@ -604,6 +684,9 @@ namespace mongo {
         RollbackDocsMap::dropDocsMap();
         clearRollbackStatus(o);
         txn.commit(DB_TXN_NOSYNC);
+        // the pre-images left are of entries that were rolled back, or that came before them
+        // and are beyond what a later rollback could reach anyway
+        RollbackPreImages::clear();
         theReplSet->leaveRollbackState();
     }
 
@@ -654,7 +737,7 @@ namespace mongo {
             }
             // at this point docsMap has the list of documents (identified by collection and pk)
             // that we need to get a snapshot of
-            removeDataFromDocsMap();
+            removeDataFromDocsMap(docsMap.size());
         }
 
         if (startState < RB_SNAPSHOT_APPLIED) {
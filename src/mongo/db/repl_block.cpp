@@ -21,12 +21,15 @@
 #include "mongo/db/auth/authorization_manager.h"
 #include "mongo/db/auth/action_set.h"
 #include "mongo/db/auth/action_type.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/util/histogram.h"
 #include "repl.h"
 #include "repl_block.h"
 #include "instance.h"
 #include "../util/background.h"
 #include "../util/mongoutils/str.h"
 #include "replutil.h"
+#include "mongo/db/repl/oplog_stream.h"
 
 //#define REPLDEBUG(x) log() << "replBlock: "  << x << endl;
 #define REPLDEBUG(x)
@@ -100,6 +103,7 @@ namespace mongo {
         void reset() {
             scoped_lock mylk(_mutex);
             _slaves.clear();
+            _wakeWaiters(GTID_MAX);
         }
 
         void update( const BSONObj& rid , const BSONObj config , const string& ns , GTID gtid ) {
@@ -115,16 +119,48 @@ namespace mongo {
                 theReplSet->ghost->updateSlave(ident.obj["_id"].OID(), gtid);
             }
 
-            _threadsWaitingForReplication.notify_all();
+            // Only waiters at or before gtid can have been satisfied by this member moving
+            // there, whether they count members or wait on a tag rule.
+            _wakeWaiters(gtid);
         }
 
         OP_REPL_STATUS opReplicatedEnough( const GTID& gtid, BSONElement w ) {
+            scoped_lock mylk(_mutex);
+            return _opReplicatedEnough_locked(gtid, w);
+        }
+
+        /**
+         * Wait up to maxWaitMillis for gtid to be replicated as w asks.  Waiters are kept in
+         * GTID order, and each is only woken when a member reaches its GTID.
+         * @return REPL_WAITING if it timed out.
+         */
+        OP_REPL_STATUS waitForReplication( const GTID& gtid, BSONElement w, int maxWaitMillis ) {
+            scoped_lock mylk(_mutex);
+            OP_REPL_STATUS s = _opReplicatedEnough_locked(gtid, w);
+            if (s != REPL_WAITING || maxWaitMillis <= 0) {
+                return s;
+            }
+
+            boost::condition replicated;
+            Waiting waiting(_waiters, gtid, &replicated);
+            const boost::xtime deadline = incxtimemillis(maxWaitMillis);
+            while (s == REPL_WAITING) {
+                const bool woken = replicated.timed_wait(mylk.boost(), deadline);
+                s = _opReplicatedEnough_locked(gtid, w);
+                if (!woken) {
+                    break;
+                }
+            }
+            return s;
+        }
+
+        OP_REPL_STATUS _opReplicatedEnough_locked( const GTID& gtid, BSONElement w ) {
             RARELY {
                 REPLDEBUG( "looking for : " << op << " w=" << w );
             }
 
             if (w.isNumber()) {
-                return replicatedToNum(gtid, w.numberInt());
+                return _replicatedToNum_locked(gtid, w.numberInt());
             }
 
             uassert( 16250 , "w has to be a string or a number" , w.type() == String );
@@ -135,7 +171,7 @@ namespace mongo {
             if (wStr == "majority") {
                 // use the entire set, including arbiters, to prevent writing
                 // to a majority of the set but not a majority of voters
-                return replicatedToNum(gtid, theReplSet->config().getMajority());
+                return _replicatedToNum_locked(gtid, theReplSet->config().getMajority());
             }
 
             map<string,ReplSetConfig::TagRule*>::const_iterator it = theReplSet->config().rules.find(wStr);
@@ -146,11 +182,15 @@ namespace mongo {
         }
 
         OP_REPL_STATUS replicatedToNum(const GTID& gtid, int w) {
+            scoped_lock mylk(_mutex);
+            return _replicatedToNum_locked( gtid, w );
+        }
+
+        OP_REPL_STATUS _replicatedToNum_locked(const GTID& gtid, int w) {
             if ( w <= 1 )
                 return REPL_SUCCESS;
 
             w--; // now this is the # of slaves i need
-            scoped_lock mylk(_mutex);
             return _replicatedToNum_slaves_locked( gtid, w );
         }
 
@@ -195,11 +235,30 @@ namespace mongo {
             return _slaves.size();
         }
 
+        typedef multimap<GTID, boost::condition*, GTIDCmp> WaiterMap;
+
+        class Waiting : boost::noncopyable {
+            WaiterMap &_waiters;
+            WaiterMap::iterator _it;
+          public:
+            Waiting(WaiterMap &waiters, const GTID &gtid, boost::condition *c)
+                : _waiters(waiters), _it(waiters.insert(make_pair(gtid, c))) {}
+            ~Waiting() { _waiters.erase(_it); }
+        };
+
+        // Must be called with _mutex held.
+        void _wakeWaiters(const GTID &upTo) {
+            for (WaiterMap::const_iterator it = _waiters.begin();
+                 it != _waiters.end() && GTID::cmp(it->first, upTo) <= 0; ++it) {
+                it->second->notify_one();
+            }
+        }
+
         // need to be careful not to deadlock with this
         mutable mongo::mutex _mutex;
-        boost::condition _threadsWaitingForReplication;
 
         map<Ident,GTID> _slaves;
+        WaiterMap _waiters;
 
     } slaveTracking;
 
@@ -238,6 +297,85 @@ namespace mongo {
         return slaveTracking.opReplicatedEnough( gtid, w );
     }
 
+    static Histogram::Options ackLatencyBuckets() {
+        // [0..1],[2..2],[3..4],...,[2^22+1..max] milliseconds
+        Histogram::Options opts;
+        opts.numBuckets = 24;
+        opts.bucketSize = 1;
+        opts.exponential = true;
+        return opts;
+    }
+
+    /** How long getLastError waited for w, by kind of w. */
+    class ReplAckLatency : boost::noncopyable {
+      public:
+        ReplAckLatency() : _mutex("replAckLatency"), _num(ackLatencyBuckets()),
+                           _majority(ackLatencyBuckets()), _tag(ackLatencyBuckets()) {}
+
+        void record(BSONElement w, int millis) {
+            scoped_lock lk(_mutex);
+            Histogram &h = w.isNumber() ? _num : (w.valuestrsafe() == string("majority") ? _majority : _tag);
+            h.insert(millis < 0 ? 0 : millis);
+        }
+
+        void append(BSONObjBuilder &b) {
+            scoped_lock lk(_mutex);
+            appendHistogram(b, "number", _num);
+            appendHistogram(b, "majority", _majority);
+            appendHistogram(b, "tag", _tag);
+        }
+
+      private:
+        static void appendHistogram(BSONObjBuilder &b, const StringData &name, const Histogram &h) {
+            BSONObjBuilder hb(b.subobjStart(name));
+            long long count = 0;
+            for (uint32_t i = 0; i < h.getBucketsNum(); i++) {
+                count += h.getCount(i);
+            }
+            hb.appendNumber("count", count);
+            // Each is the upper bound of the bucket holding the percentile.
+            hb.appendNumber("p50", (long long) h.getPercentile(50));
+            hb.appendNumber("p95", (long long) h.getPercentile(95));
+            hb.appendNumber("p99", (long long) h.getPercentile(99));
+            {
+                BSONArrayBuilder ab(hb.subarrayStart("buckets"));
+                for (uint32_t i = 0; i < h.getBucketsNum(); i++) {
+                    ab.append((long long) h.getCount(i));
+                }
+                ab.done();
+            }
+            hb.done();
+        }
+
+        mongo::mutex _mutex;
+        Histogram _num;
+        Histogram _majority;
+        Histogram _tag;
+    } replAckLatency;
+
+    class ReplAckLatencySSS : public ServerStatusSection {
+      public:
+        ReplAckLatencySSS() : ServerStatusSection("replAckLatencyMillis") {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection(const BSONElement &configElement) const {
+            if (!anyReplEnabled()) {
+                return BSONObj();
+            }
+            BSONObjBuilder b;
+            replAckLatency.append(b);
+            return b.obj();
+        }
+    } replAckLatencySection;
+
+    OP_REPL_STATUS waitForReplication( GTID gtid, BSONElement w, int maxWaitMillis ) {
+        return slaveTracking.waitForReplication( gtid, w, maxWaitMillis );
+    }
+
+    void recordReplicationAckLatency( BSONElement w, int millis ) {
+        replAckLatency.record( w, millis );
+    }
+
     // TODO: THIS IS ONLY CALLED IN SHARDING,
     // make this better
     bool opReplicatedEnough( GTID gtid, int w ) {
@@ -280,8 +418,16 @@ namespace mongo {
             help << "internal." << endl;
         }
         bool run(const string& dbname, BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl) {
-            GTID value = getGTIDFromBSON("gtid", cmdObj);
-            updateSlaveLocation( *cc().curop(), "local.oplog.rs", value);
+            if (cmdObj.hasField("gtid")) {
+                GTID value = getGTIDFromBSON("gtid", cmdObj);
+                updateSlaveLocation( *cc().curop(), "local.oplog.rs", value);
+            }
+            // acks from a member streaming our oplog, see oplog_stream.h
+            if (cmdObj["stream"].isNumber()) {
+                oplogStreams.noteAck(cmdObj["stream"].numberLong(),
+                                     cmdObj["received"].numberLong(),
+                                     cmdObj["window"].numberLong());
+            }
             return true;
         }
     } cmdUpdateSlave;
@@ -42,6 +42,15 @@ namespace mongo {
     bool opReplicatedEnough( GTID gtid , int w );
     OP_REPL_STATUS opReplicatedEnough( GTID gtid , BSONElement w );
 
+    /**
+     * Like opReplicatedEnough, but if gtid isn't replicated enough yet, waits up to
+     * maxWaitMillis for a member to reach it before returning REPL_WAITING.
+     */
+    OP_REPL_STATUS waitForReplication( GTID gtid , BSONElement w , int maxWaitMillis );
+
+    /** Record how long a getLastError waited for w, for serverStatus. */
+    void recordReplicationAckLatency( BSONElement w , int millis );
+
     std::vector<BSONObj> getHostsWrittenTo(GTID gtid);
 
     void resetSlaveCache();
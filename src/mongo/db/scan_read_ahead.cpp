@@ -0,0 +1,156 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/scan_read_ahead.h"
+
+#include "mongo/db/index.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/cursor.h"
+#include "mongo/db/storage/dbt.h"
+#include "mongo/db/storage/exception.h"
+#include "mongo/db/storage/txn.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    MONGO_EXPORT_SERVER_PARAMETER(scanReadAheadBytes, int, 16 * 1024 * 1024);
+    MONGO_EXPORT_SERVER_PARAMETER(scanReadAheadMaxWorkers, int, 4);
+
+    // The worker reads at most this much before looking at how far ahead it is again.
+    static const long long chunkBytes = 1024 * 1024;
+
+    static SimpleMutex workersMutex("scanReadAheadWorkers");
+    static int workers = 0;
+
+    ScanReadAhead *ScanReadAhead::make(const IndexDetails &idx, const storage::Key &startKey,
+                                       const int direction) {
+        if (scanReadAheadBytes <= 0) {
+            return NULL;
+        }
+        {
+            SimpleMutex::scoped_lock lk(workersMutex);
+            if (workers >= scanReadAheadMaxWorkers) {
+                return NULL;
+            }
+            workers++;
+        }
+        return new ScanReadAhead(idx, startKey, direction);
+    }
+
+    ScanReadAhead::ScanReadAhead(const IndexDetails &idx, const storage::Key &startKey,
+                                 const int direction) :
+        _idx(idx),
+        _startKey(startKey.buf(), startKey.size()),
+        _direction(direction),
+        _windowBytes(scanReadAheadBytes),
+        _stop(false),
+        _done(false),
+        _readBytes(0),
+        _fetchedBytes(0),
+        _maxDistance(0),
+        _stallMicros(0),
+        _workerWaits(0),
+        _thread(boost::bind(&ScanReadAhead::run, this)) {
+    }
+
+    ScanReadAhead::~ScanReadAhead() {
+        {
+            boost::unique_lock<boost::mutex> lk(_mutex);
+            _stop = true;
+            _progress.notify_all();
+        }
+        _thread.join();
+        SimpleMutex::scoped_lock lk(workersMutex);
+        workers--;
+    }
+
+    int ScanReadAhead::getf(const DBT *key, const DBT *val, void *extra) {
+        getf_extra *info = static_cast<getf_extra *>(extra);
+        if (key != NULL) {
+            info->bytes += key->size + val->size;
+            if (info->bytes < info->bytesWanted && !info->readAhead->_stop) {
+                return TOKUDB_CURSOR_CONTINUE;
+            }
+        }
+        return 0;
+    }
+
+    void ScanReadAhead::run() {
+        setThreadName("scanReadAhead");
+        try {
+            storage::Txn txn(NULL, DB_TXN_SNAPSHOT | DB_TXN_READ_ONLY);
+            shared_ptr<storage::Cursor> cursor = _idx.getCursor(txn.db_txn(), 0);
+            DBC *dbc = cursor->dbc();
+            DBT start = storage::dbt_make(_startKey.data(), _startKey.size());
+            getf_extra extra(this, chunkBytes);
+            int r = _direction > 0
+                    ? dbc->c_getf_set_range(dbc, 0, &start, getf, &extra)
+                    : dbc->c_getf_set_range_reverse(dbc, 0, &start, getf, &extra);
+            while (r == 0) {
+                {
+                    boost::unique_lock<boost::mutex> lk(_mutex);
+                    _readBytes += extra.bytes;
+                    while (!_stop && _readBytes - _fetchedBytes >= _windowBytes) {
+                        _workerWaits++;
+                        _progress.wait(lk);
+                    }
+                    if (_stop) {
+                        break;
+                    }
+                    // when behind the scan, everything up to it is cached already, so catching
+                    // up costs little
+                    extra.bytes = 0;
+                    extra.bytesWanted = min(chunkBytes, _windowBytes - (_readBytes - _fetchedBytes));
+                }
+                r = _direction > 0
+                    ? dbc->c_getf_next(dbc, 0, getf, &extra)
+                    : dbc->c_getf_prev(dbc, 0, getf, &extra);
+            }
+            if (r != 0 && r != DB_NOTFOUND) {
+                storage::handle_ydb_error(r);
+            }
+        }
+        catch (std::exception &e) {
+            LOG(1) << "scan read-ahead on " << _idx.indexNamespace() << " stopped: " << e.what() << endl;
+        }
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _done = true;
+    }
+
+    void ScanReadAhead::noteFetched(long long bytes, long long micros) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        _maxDistance = max(_maxDistance, _readBytes - _fetchedBytes);
+        _fetchedBytes += bytes;
+        _stallMicros += micros;
+        _progress.notify_all();
+    }
+
+    void ScanReadAhead::appendStats(BSONObjBuilder &b) {
+        boost::unique_lock<boost::mutex> lk(_mutex);
+        BSONObjBuilder stats(b.subobjStart("readAhead"));
+        stats.appendNumber("windowBytes", _windowBytes);
+        stats.appendNumber("distanceBytes", max(0LL, _readBytes - _fetchedBytes));
+        stats.appendNumber("maxDistanceBytes", _maxDistance);
+        stats.appendNumber("readBytes", _readBytes);
+        stats.appendNumber("workerWaits", _workerWaits);
+        stats.appendNumber("stallMillis", _stallMicros / 1000);
+        stats.append("done", _done);
+        stats.done();
+    }
+
+} // namespace mongo
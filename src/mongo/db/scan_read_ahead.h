@@ -0,0 +1,97 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include <boost/thread/condition_variable.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/thread.hpp>
+
+#include "mongo/db/jsobj.h"
+#include "mongo/db/storage/key.h"
+
+namespace mongo {
+
+    class IndexDetails;
+
+    // server parameter: how far, in bytes of rows, a full scan's read-ahead may get ahead of
+    // the scan.  0 turns read-ahead off.
+    extern int scanReadAheadBytes;
+    // server parameter: how many scans may have a read-ahead worker at once
+    extern int scanReadAheadMaxWorkers;
+
+    /**
+     * Read-ahead for a full scan of an index.
+     *
+     * A worker thread walks the index in the scan's direction, with a cursor and a read-only
+     * snapshot transaction of its own, staying at most scanReadAheadBytes ahead of the scan.
+     * It throws away the rows it reads; what matters is that the nodes holding them are in
+     * the cachetable by the time the scan's bulk fetches reach them, so that the scan does not
+     * wait on the disk for each one.
+     *
+     * The worker takes no locks and the scan never waits for it, so the scan's cursor owns it
+     * and stops it when it goes away, before the index can be closed.
+     */
+    class ScanReadAhead : boost::noncopyable {
+      public:
+        /**
+         * @return a read-ahead for a scan of idx from startKey, or NULL if read-ahead is off or
+         * scanReadAheadMaxWorkers scans already have one.
+         */
+        static ScanReadAhead *make(const IndexDetails &idx, const storage::Key &startKey,
+                                   const int direction);
+
+        // Stops the worker, and waits for it to close its cursor.
+        ~ScanReadAhead();
+
+        // The scan fetched bytes more of rows, and waited micros for them.
+        void noteFetched(long long bytes, long long micros);
+
+        // distance ahead of the scan and time the scan spent waiting, for explain
+        void appendStats(BSONObjBuilder &b);
+
+      private:
+        ScanReadAhead(const IndexDetails &idx, const storage::Key &startKey, const int direction);
+
+        void run();
+
+        struct getf_extra {
+            ScanReadAhead *readAhead;
+            long long bytes;
+            long long bytesWanted;
+            getf_extra(ScanReadAhead *r, long long n) : readAhead(r), bytes(0), bytesWanted(n) { }
+        };
+        static int getf(const DBT *key, const DBT *val, void *extra);
+
+        const IndexDetails &_idx;
+        const string _startKey;         // a storage::Key
+        const int _direction;
+        const long long _windowBytes;
+
+        boost::mutex _mutex;
+        boost::condition_variable _progress;
+        volatile bool _stop;
+        bool _done;                     // the worker reached the end of the index, or failed
+        long long _readBytes;           // by the worker
+        long long _fetchedBytes;        // by the scan
+        long long _maxDistance;
+        long long _stallMicros;
+        long long _workerWaits;         // times the worker was a full window ahead
+
+        boost::thread _thread;
+    };
+
+} // namespace mongo
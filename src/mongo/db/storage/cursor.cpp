@@ -32,6 +32,13 @@ namespace mongo {
             }
         }
 
+        Cursor::Cursor(DB *db, DB_TXN *txn, const int flags) : _dbc(NULL) {
+            int r = db->cursor(db, txn, &_dbc, flags);
+            if (r != 0) {
+                handle_ydb_error(r);
+            }
+        }
+
         Cursor::~Cursor() {
             if (_dbc != NULL) {
                 int r = _dbc->c_close(_dbc);
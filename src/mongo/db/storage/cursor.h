@@ -29,6 +29,8 @@ namespace mongo {
         class Cursor {
         public:
             Cursor(DB *db, const int flags = 0);
+            // for threads without a Client, reading in a transaction of their own
+            Cursor(DB *db, DB_TXN *txn, const int flags);
             ~Cursor();
             DBC *dbc() const {
                 return _dbc;
@@ -45,6 +45,7 @@
 #include "mongo/db/storage/dbt.h"
 #include "mongo/db/storage/exception.h"
 #include "mongo/db/storage/key.h"
+#include "mongo/db/storage/lock_contention.h"
 #include "mongo/util/assert_util.h"
 #include "mongo/util/log.h"
 
@@ -202,7 +203,8 @@ namespace mongo {
         static int generate_row_for_put(DB *dest_db, DB *src_db,
                                         DBT_ARRAY *dest_keys, DBT_ARRAY *dest_vals,
                                         const DBT *src_key, const DBT *src_val) {
-            // Put needs keys and possibly vals (for clustering indexes.)
+            // Put needs keys and possibly vals (for clustering indexes, and the
+            // stored fields of projected clustering indexes.)
             const int r = generate_keys(dest_db, src_db, dest_keys, src_key, src_val);
             if (r != 0) {
                 return r;
@@ -211,11 +213,18 @@ namespace mongo {
             const DBT *desc = &dest_db->cmp_descriptor->dbt;
             Descriptor descriptor(reinterpret_cast<const char *>(desc->data), desc->size);
             if (dest_vals != NULL) {
+                BSONObj projected;
+                if (!descriptor.clustering() && !descriptor.clusteringFields().isEmpty()) {
+                    projected = descriptor.projectClusteringFields(
+                            BSONObj(reinterpret_cast<const char *>(src_val->data)));
+                }
                 // TODO: This copies each value once, which is not good. Find a way to avoid that.
                 dbt_array_clear_and_resize(dest_vals, dest_keys->size);
                 for (size_t i = 0; i < dest_keys->size; i++) {
                     if (descriptor.clustering()) {
                         dbt_array_push(dest_vals, src_val->data, src_val->size);
+                    } else if (!projected.isEmpty()) {
+                        dbt_array_push(dest_vals, projected.objdata(), projected.objsize());
                     } else {
                         dbt_array_push(dest_vals, NULL, 0);
                     }
@@ -942,16 +951,19 @@ namespace mongo {
         static void lock_not_granted_callback(DB *db, uint64_t requesting_txnid,
                                               const DBT *left_key, const DBT *right_key,
                                               uint64_t blocking_txnid) {
-            CurOp *op = cc().curop();
+            BSONObjBuilder info;
+            info.append("index", get_index_name(db));
+            info.appendNumber("requestingTxnid", requesting_txnid);
+            info.appendNumber("blockingTxnid", blocking_txnid);
+            BSONArrayBuilder bounds(info.subarrayStart("bounds"));
+            pretty_bounds(db, left_key, right_key, bounds);
+            bounds.done();
+            const BSONObj infoObj = info.obj();
+            lockContention.noteTimeout(infoObj);
+
+            CurOp *op = haveClient() ? cc().curop() : NULL;
             if (op != NULL) {
-                BSONObjBuilder info;
-                info.append("index", get_index_name(db));
-                info.appendNumber("requestingTxnid", requesting_txnid);
-                info.appendNumber("blockingTxnid", blocking_txnid);
-                BSONArrayBuilder bounds(info.subarrayStart("bounds"));
-                pretty_bounds(db, left_key, right_key, bounds);
-                bounds.done();
-                op->debug().lockNotGrantedInfo = info.obj();
+                op->debug().lockNotGrantedInfo = infoObj;
             }
         }
 
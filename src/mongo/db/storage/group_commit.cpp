@@ -0,0 +1,192 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/storage/group_commit.h"
+
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#include "mongo/db/cmdline.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace storage {
+
+        // Upper bound on how long a leader holds off a flush to let more waiters join.  Zero
+        // disables the window; concurrent waiters are still batched behind a running flush.
+        MONGO_EXPORT_SERVER_PARAMETER(groupCommitMaxWindowMicros, int, 1000);
+
+        GroupCommit groupCommit;
+
+        static Histogram::Options latencyBuckets() {
+            // [0..1],[2..2],[3..4],...,[2^23+1..max] microseconds
+            Histogram::Options opts;
+            opts.numBuckets = 25;
+            opts.bucketSize = 1;
+            opts.exponential = true;
+            return opts;
+        }
+
+        // Weight given to each new sample in the moving averages.
+        static const double avgWeight = 0.125;
+
+        GroupCommit::GroupCommit() :
+            _mutex("groupCommit"),
+            _nextTicket(0), _durableTicket(0), _flushing(false),
+            _lastArrival(0), _avgArrivalGapMicros(0), _avgFlushMicros(0),
+            _flushes(0), _waiters(0), _windowWaits(0),
+            _curSec(0), _curSecFlushes(0), _prevSecFlushes(0),
+            _latency(latencyBuckets()) {
+        }
+
+        long long GroupCommit::windowMicros() const {
+            const long long maxWindow = groupCommitMaxWindowMicros;
+            if (maxWindow <= 0 || _avgArrivalGapMicros <= 0) {
+                return 0;
+            }
+            // Only worth waiting if another waiter is expected before a flush would finish.
+            // Wait long enough to pick up about two more, but never longer than half a flush,
+            // so that the window costs less than the flushes it saves.
+            if (_avgArrivalGapMicros >= _avgFlushMicros) {
+                return 0;
+            }
+            long long window = (long long) (2 * _avgArrivalGapMicros);
+            window = std::min(window, (long long) (_avgFlushMicros / 2));
+            return std::min(window, maxWindow);
+        }
+
+        void GroupCommit::recordFlush(unsigned long long now, long long flushMicros, long long waiters) {
+            _avgFlushMicros += avgWeight * (flushMicros - _avgFlushMicros);
+            _flushes++;
+            _waiters += waiters;
+
+            const time_t sec = now / 1000000;
+            if (sec != _curSec) {
+                _prevSecFlushes = (sec == _curSec + 1) ? _curSecFlushes : 0;
+                _curSec = sec;
+                _curSecFlushes = 0;
+            }
+            _curSecFlushes++;
+        }
+
+        void GroupCommit::waitForDurable() {
+            const unsigned long long arrival = curTimeMicros64();
+
+            scoped_lock lk(_mutex);
+            const unsigned long long ticket = ++_nextTicket;
+            if (_lastArrival != 0 && arrival > _lastArrival) {
+                _avgArrivalGapMicros += avgWeight * ((arrival - _lastArrival) - _avgArrivalGapMicros);
+            }
+            _lastArrival = arrival;
+
+            while (_durableTicket < ticket) {
+                if (_flushing) {
+                    _flushed.wait(lk.boost());
+                    continue;
+                }
+
+                // Become the leader.  Nobody else flushes or signals _flushed until we are done,
+                // so the only thing that can end the window early is a spurious wakeup.
+                _flushing = true;
+                const long long window = windowMicros();
+                if (window > 0) {
+                    _windowWaits++;
+                    _flushed.timed_wait(lk.boost(), boost::posix_time::microseconds(window));
+                }
+
+                // Everyone holding a ticket by now committed before the flush starts.
+                const unsigned long long covered = _nextTicket;
+                const unsigned long long flushStart = curTimeMicros64();
+                try {
+                    lk.boost().unlock();
+                    log_flush();
+                    lk.boost().lock();
+                } catch (...) {
+                    // Let a follower take over as leader and try again.
+                    lk.boost().lock();
+                    _flushing = false;
+                    _flushed.notify_all();
+                    throw;
+                }
+                const unsigned long long flushEnd = curTimeMicros64();
+                recordFlush(flushEnd, flushEnd - flushStart, covered - _durableTicket);
+                _durableTicket = covered;
+                _flushing = false;
+                _flushed.notify_all();
+            }
+
+            const unsigned long long latency = curTimeMicros64() - arrival;
+            _latency.insert(latency > 0xffffffffULL ? 0xffffffffU : (uint32_t) latency);
+        }
+
+        static void appendPercentiles(BSONObjBuilder &b, const Histogram &h) {
+            // Each is the upper bound of the bucket holding the percentile.
+            b.appendNumber("p50", (long long) h.getPercentile(50));
+            b.appendNumber("p95", (long long) h.getPercentile(95));
+            b.appendNumber("p99", (long long) h.getPercentile(99));
+        }
+
+        void GroupCommit::appendStats(BSONObjBuilder &b) {
+            scoped_lock lk(_mutex);
+            b.appendNumber("flushes", _flushes);
+            b.appendNumber("waiters", _waiters);
+            b.append("waitersPerFlush", _flushes > 0 ? (double) _waiters / _flushes : 0.0);
+
+            // Flushes completed during the last full second.
+            const time_t now = curTimeMicros64() / 1000000;
+            long long perSec = 0;
+            if (now == _curSec + 1) {
+                perSec = _curSecFlushes;
+            }
+            else if (now == _curSec) {
+                perSec = _prevSecFlushes;
+            }
+            b.appendNumber("flushesPerSec", perSec);
+
+            b.appendNumber("windowWaits", _windowWaits);
+            b.appendNumber("windowMicros", windowMicros());
+            b.appendNumber("avgFlushMicros", (long long) _avgFlushMicros);
+            {
+                BSONObjBuilder lb(b.subobjStart("latencyMicros"));
+                appendPercentiles(lb, _latency);
+                lb.done();
+            }
+        }
+
+        class GroupCommitSSS : public ServerStatusSection {
+          public:
+            GroupCommitSSS() : ServerStatusSection("groupCommit") {}
+            virtual bool includeByDefault() const { return true; }
+
+            BSONObj generateSection(const BSONElement &configElement) const {
+                if (cmdLine.isMongos()) {
+                    return BSONObj();
+                }
+                BSONObjBuilder b;
+                groupCommit.appendStats(b);
+                return b.obj();
+            }
+        } groupCommitSection;
+
+    } // namespace storage
+
+} // namespace mongo
@@ -0,0 +1,87 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include <boost/thread/condition.hpp>
+
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/histogram.h"
+
+namespace mongo {
+
+    class BSONObjBuilder;
+
+    namespace storage {
+
+        /**
+         * Batches concurrent requests for durability (getLastError with j or fsync) into as few
+         * recovery log flushes as possible.
+         *
+         * The first waiter to arrive while no flush is running becomes the leader.  It may hold
+         * off for a short window so that more waiters can join, then flushes once on behalf of
+         * every waiter that arrived before the flush began.  Waiters that arrive while a flush is
+         * running wait for the next one.  The window adapts to the arrival rate: when waiters
+         * arrive more slowly than a flush completes, there is nothing to gain by waiting and the
+         * leader flushes immediately.
+         */
+        class GroupCommit : boost::noncopyable {
+          public:
+            GroupCommit();
+
+            /**
+             * Returns once the recovery log has been flushed past every transaction committed
+             * before this call.
+             */
+            void waitForDurable();
+
+            void appendStats(BSONObjBuilder &b);
+
+          private:
+            // Must be called with _mutex held.
+            long long windowMicros() const;
+            void recordFlush(unsigned long long now, long long flushMicros, long long waiters);
+
+            mongo::mutex _mutex;
+            boost::condition _flushed;
+
+            // Tickets are handed out in arrival order; a flush that starts after ticket t was
+            // handed out makes ticket t durable.
+            unsigned long long _nextTicket;
+            unsigned long long _durableTicket;
+            bool _flushing;
+
+            // Exponentially weighted averages used to size the window.
+            unsigned long long _lastArrival;
+            double _avgArrivalGapMicros;
+            double _avgFlushMicros;
+
+            long long _flushes;
+            long long _waiters;
+            long long _windowWaits;
+            time_t _curSec;
+            long long _curSecFlushes;
+            long long _prevSecFlushes;
+            Histogram _latency;
+        };
+
+        extern GroupCommit groupCommit;
+
+    } // namespace storage
+
+} // namespace mongo
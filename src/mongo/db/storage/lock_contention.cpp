@@ -0,0 +1,246 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/db/storage/lock_contention.h"
+
+#include "mongo/db/cmdline.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/jsobj.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/db/storage/env.h"
+#include "mongo/util/background.h"
+#include "mongo/util/mongoutils/str.h"
+#include "mongo/util/time_support.h"
+
+namespace mongo {
+
+    namespace storage {
+
+        // How often the sampler looks at the pending lock requests.  Zero disables sampling;
+        // lock timeouts are still recorded.
+        MONGO_EXPORT_SERVER_PARAMETER(lockContentionSampleMillis, int, 100);
+
+        // How many key ranges to keep counts for.  When full, the range contended least
+        // recently is forgotten.
+        static const size_t maxRanges = 1000;
+
+        LockContention lockContention;
+
+        LockContention::LockContention() : _mutex("lockContention"), _samples(0) {}
+
+        LockContention::RangeCounts &LockContention::range(const BSONObj &info, long long nowMillis) {
+            const string index = info["index"].str();
+            const BSONObj bounds = info["bounds"].Obj();
+            const string key = index + '\0' + string(bounds.objdata(), bounds.objsize());
+
+            map<string, RangeCounts>::iterator it = _ranges.find(key);
+            if (it == _ranges.end()) {
+                if (_ranges.size() >= maxRanges) {
+                    map<string, RangeCounts>::iterator oldest = _ranges.begin();
+                    for (map<string, RangeCounts>::iterator r = _ranges.begin(); r != _ranges.end(); ++r) {
+                        if (r->second.lastSeen < oldest->second.lastSeen) {
+                            oldest = r;
+                        }
+                    }
+                    _ranges.erase(oldest);
+                }
+                it = _ranges.insert(make_pair(key, RangeCounts())).first;
+                it->second.index = index;
+                it->second.bounds = bounds.getOwned();
+            }
+            it->second.lastSeen = nowMillis;
+            return it->second;
+        }
+
+        void LockContention::sample(const vector<BSONObj> &pendingLockRequests, long long nowMillis) {
+            scoped_lock lk(_mutex);
+            _samples++;
+
+            map<pair<long long, long long>, long long> pending;
+            for (vector<BSONObj>::const_iterator it = pendingLockRequests.begin();
+                 it != pendingLockRequests.end(); ++it) {
+                const BSONObj &req = *it;
+                const long long started = req["started"].date().millis;
+                const pair<long long, long long> id(req["requestingTxnid"].numberLong(), started);
+
+                // Charge each request only for the time since it was last sampled.
+                long long waitMillis;
+                bool isNew;
+                map<pair<long long, long long>, long long>::const_iterator prev = _pending.find(id);
+                if (prev == _pending.end()) {
+                    waitMillis = nowMillis - started;
+                    isNew = true;
+                }
+                else {
+                    waitMillis = nowMillis - prev->second;
+                    isNew = false;
+                }
+                waitMillis = std::max(0LL, waitMillis);
+                pending[id] = nowMillis;
+
+                RangeCounts &r = range(req, nowMillis);
+                Counts &idx = _indexes[r.index];
+                r.waitMillis += waitMillis;
+                idx.waitMillis += waitMillis;
+                _total.waitMillis += waitMillis;
+                if (isNew) {
+                    r.waits++;
+                    idx.waits++;
+                    _total.waits++;
+                }
+            }
+            _pending.swap(pending);
+        }
+
+        void LockContention::noteTimeout(const BSONObj &info) {
+            scoped_lock lk(_mutex);
+            RangeCounts &r = range(info, curTimeMillis64());
+            r.timeouts++;
+            _indexes[r.index].timeouts++;
+            _total.timeouts++;
+        }
+
+        static void appendCounts(BSONObjBuilder &b, long long waits, long long waitMillis,
+                                 long long timeouts) {
+            b.appendNumber("waits", waits);
+            b.appendNumber("waitMillis", waitMillis);
+            b.appendNumber("timeouts", timeouts);
+        }
+
+        void LockContention::appendStats(BSONObjBuilder &b) {
+            scoped_lock lk(_mutex);
+            b.appendNumber("samples", _samples);
+            appendCounts(b, _total.waits, _total.waitMillis, _total.timeouts);
+
+            // Index names are <collection>.$<index>
+            map<string, Counts> collections;
+            for (map<string, Counts>::const_iterator it = _indexes.begin(); it != _indexes.end(); ++it) {
+                Counts &c = collections[str::before(it->first, ".$")];
+                c.waits += it->second.waits;
+                c.waitMillis += it->second.waitMillis;
+                c.timeouts += it->second.timeouts;
+            }
+            {
+                BSONObjBuilder cb(b.subobjStart("collections"));
+                for (map<string, Counts>::const_iterator it = collections.begin(); it != collections.end(); ++it) {
+                    BSONObjBuilder nb(cb.subobjStart(it->first));
+                    appendCounts(nb, it->second.waits, it->second.waitMillis, it->second.timeouts);
+                    nb.done();
+                }
+                cb.done();
+            }
+            {
+                BSONObjBuilder ib(b.subobjStart("indexes"));
+                for (map<string, Counts>::const_iterator it = _indexes.begin(); it != _indexes.end(); ++it) {
+                    BSONObjBuilder nb(ib.subobjStart(it->first));
+                    appendCounts(nb, it->second.waits, it->second.waitMillis, it->second.timeouts);
+                    nb.done();
+                }
+                ib.done();
+            }
+        }
+
+        void LockContention::appendTopRanges(int n, const StringData &sortField, BSONArrayBuilder &b) {
+            scoped_lock lk(_mutex);
+            vector<pair<long long, const RangeCounts *> > sorted;
+            sorted.reserve(_ranges.size());
+            for (map<string, RangeCounts>::const_iterator it = _ranges.begin(); it != _ranges.end(); ++it) {
+                const RangeCounts &r = it->second;
+                long long v = r.waitMillis;
+                if (sortField == "waits") {
+                    v = r.waits;
+                }
+                else if (sortField == "timeouts") {
+                    v = r.timeouts;
+                }
+                sorted.push_back(make_pair(-v, &r));
+            }
+            const size_t limit = std::min(sorted.size(), (size_t) std::max(n, 0));
+            std::partial_sort(sorted.begin(), sorted.begin() + limit, sorted.end());
+
+            for (size_t i = 0; i < limit; i++) {
+                const RangeCounts &r = *sorted[i].second;
+                if (b.len() + r.bounds.objsize() > BSONObjMaxUserSize - 1024) {
+                    b.append("too many results to return");
+                    break;
+                }
+                BSONObjBuilder rb(b.subobjStart());
+                rb.append("index", r.index);
+                rb.appendArray("bounds", r.bounds);
+                appendCounts(rb, r.waits, r.waitMillis, r.timeouts);
+                rb.appendDate("lastSeen", r.lastSeen);
+                rb.done();
+            }
+        }
+
+        void LockContention::reset() {
+            scoped_lock lk(_mutex);
+            _samples = 0;
+            _total = Counts();
+            _indexes.clear();
+            _ranges.clear();
+            _pending.clear();
+        }
+
+        class LockContentionSSS : public ServerStatusSection {
+          public:
+            LockContentionSSS() : ServerStatusSection("lockContention") {}
+            virtual bool includeByDefault() const { return true; }
+
+            BSONObj generateSection(const BSONElement &configElement) const {
+                if (cmdLine.isMongos()) {
+                    return BSONObj();
+                }
+                BSONObjBuilder b;
+                lockContention.appendStats(b);
+                return b.obj();
+            }
+        } lockContentionSection;
+
+        class LockContentionSampler : public BackgroundJob {
+          public:
+            virtual string name() const { return "LockContentionSampler"; }
+
+            virtual void run() {
+                while (!inShutdown()) {
+                    const int period = lockContentionSampleMillis;
+                    if (period <= 0) {
+                        sleepsecs(1);
+                        continue;
+                    }
+                    sleepmillis(period);
+
+                    try {
+                        vector<BSONObj> pendingLockRequests;
+                        get_pending_lock_request_status(pendingLockRequests);
+                        lockContention.sample(pendingLockRequests, curTimeMillis64());
+                    } catch (const DBException &e) {
+                        LOG(1) << "error sampling pending lock requests: " << e.toString() << endl;
+                    }
+                }
+            }
+        };
+
+        void startLockContentionSampler() {
+            LockContentionSampler *sampler = new LockContentionSampler();
+            sampler->go();
+        }
+
+    } // namespace storage
+
+} // namespace mongo
@@ -0,0 +1,99 @@
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include "mongo/bson/bsonobj.h"
+#include "mongo/util/concurrency/mutex.h"
+
+namespace mongo {
+
+    class BSONArrayBuilder;
+    class BSONObjBuilder;
+
+    namespace storage {
+
+        /**
+         * Aggregates row lock contention in the locktree over time, per index and per locked key
+         * range, so that the ranges behind lock waits and timeouts can be found after the fact.
+         *
+         * Waits are sampled: a background thread periodically looks at the pending lock
+         * requests, counts each request once and charges it for the time it has been waiting.
+         * Waits shorter than the sample period are mostly missed.  Lock timeouts are recorded
+         * as they happen.  Only the most recently contended ranges are kept.
+         */
+        class LockContention : boost::noncopyable {
+          public:
+            LockContention();
+
+            /**
+             * Fold in one pass over the pending lock requests, as returned by
+             * get_pending_lock_request_status().
+             */
+            void sample(const vector<BSONObj> &pendingLockRequests, long long nowMillis);
+
+            /** Record a lock request that timed out; info has the index and the bounds. */
+            void noteTimeout(const BSONObj &info);
+
+            /** Totals and per-collection and per-index counts, for serverStatus. */
+            void appendStats(BSONObjBuilder &b);
+
+            /**
+             * Append the n most contended ranges, ordered by sortField ("waitMillis", "waits"
+             * or "timeouts"), most contended first.
+             */
+            void appendTopRanges(int n, const StringData &sortField, BSONArrayBuilder &b);
+
+            void reset();
+
+          private:
+            struct Counts {
+                Counts() : waits(0), waitMillis(0), timeouts(0) {}
+                long long waits;
+                long long waitMillis;
+                long long timeouts;
+            };
+
+            struct RangeCounts : public Counts {
+                RangeCounts() : lastSeen(0) {}
+                string index;
+                BSONObj bounds;
+                long long lastSeen;
+            };
+
+            // Must be called with _mutex held.
+            RangeCounts &range(const BSONObj &info, long long nowMillis);
+
+            mongo::mutex _mutex;
+            long long _samples;
+            Counts _total;
+            map<string, Counts> _indexes;
+            // Keyed on the index name and the bounds' BSON.
+            map<string, RangeCounts> _ranges;
+            // Requests seen in the last sample, by (requesting txnid, start time), with how far
+            // their wait has been accounted for.
+            map<pair<long long, long long>, long long> _pending;
+        };
+
+        extern LockContention lockContention;
+
+        void startLockContentionSampler();
+
+    } // namespace storage
+
+} // namespace mongo
@@ -42,7 +42,8 @@ namespace mongo {
     static bool _logTxnOpsForSharding = false;
     static void (*_logTxnToOplog)(GTID gtid, uint64_t timestamp, uint64_t hash, const deque<BSONObj>& ops) = NULL;
     static void (*_logTxnOpsRef)(GTID gtid, uint64_t timestamp, uint64_t hash, OID& oid) = NULL;
-    static void (*_logOpsToOplogRef)(BSONObj o) = NULL;
+    static void (*_logOpsToOplogRef)(BSONObj o, bool visibleNow) = NULL;
+    static void (*_releaseOplogRefs)(const OID& oid) = NULL;
     static bool (*_shouldLogOpForSharding)(const char *, const char *, const BSONObj &) = NULL;
     static bool (*_shouldLogUpdateOpForSharding)(const char *, const char *, const BSONObj &) = NULL;
     static void (*_startObjForMigrateLog)(BSONObjBuilder &b) = NULL;
@@ -71,10 +72,14 @@ namespace mongo {
         _logTxnOpsRef = f;
     }
 
-    void setLogOpsToOplogRef(void (*f)(BSONObj o)) {
+    void setLogOpsToOplogRef(void (*f)(BSONObj o, bool visibleNow)) {
         _logOpsToOplogRef = f;
     }
 
+    void setReleaseOplogRefs(void (*f)(const OID& oid)) {
+        _releaseOplogRefs = f;
+    }
+
     void setOplogInsertStats(TimerStats *oplogInsertStats, Counter64 *oplogInsertBytesStats) {
         _oplogInsertStats = oplogInsertStats;
         _oplogInsertBytesStats = oplogInsertBytesStats;
@@ -403,6 +408,11 @@ namespace mongo {
     }
 
     TxnOplog::~TxnOplog() {
+        // By now the root has committed, and its oplog entry holds on to what it spilled, or
+        // it aborted, and nothing ever will.
+        if (_parent == NULL && _oid.isSet() && _releaseOplogRefs != NULL) {
+            _releaseOplogRefs(_oid);
+        }
     }
 
     void TxnOplog::appendOp(const BSONObj& o) {
@@ -457,7 +467,10 @@ namespace mongo {
             BSONObj obj = b.obj();
             TimerHolder timer(&_refsTimer);
             _refsSize += obj.objsize();
-            _logOpsToOplogRef(obj);
+            // Ops spilled by the root can only be undone by aborting the root, so they may be
+            // made visible right away, letting secondaries stage them while we are still
+            // running. Ops spilled by a child must stay in the child's txn in case it aborts.
+            _logOpsToOplogRef(obj, _parent == NULL);
         }
         else {
             // just a sanity check
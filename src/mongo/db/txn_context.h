@@ -46,7 +46,8 @@ namespace mongo {
     bool shouldLogTxnUpdateOpForSharding(const char *opstr, const char *ns, const BSONObj &oldObj);
     void setLogTxnToOplog(void (*)(GTID gtid, uint64_t timestamp, uint64_t hash, const deque<BSONObj>& ops));
     void setLogTxnRefToOplog(void (*f)(GTID gtid, uint64_t timestamp, uint64_t hash, OID& oid));
-    void setLogOpsToOplogRef(void (*f)(BSONObj o));
+    void setLogOpsToOplogRef(void (*f)(BSONObj o, bool visibleNow));
+    void setReleaseOplogRefs(void (*f)(const OID& oid));
     void setOplogInsertStats(TimerStats *oplogInsertStats, Counter64 *oplogInsertBytesStats);
     void setTxnGTIDManager(GTIDManager* m);
     void setTxnCompleteHooks(TxnCompleteHooks *hooks);
@@ -20,6 +20,9 @@
 
 #include "mongo/pch.h"
 
+#include <boost/bind.hpp>
+#include <boost/thread/thread.hpp>
+
 #include "mongo/db/cursor.h"
 #include "mongo/db/clientcursor.h"
 #include "mongo/db/instance.h"
@@ -643,6 +646,99 @@ namespace CursorTests {
             
         } // namespace Pin
 
+        namespace Registry {
+
+            /** Cursors spread over the registry's partitions are all found, pinned and erased. */
+            class FindPinErase {
+            public:
+                void run() {
+                    Client::Transaction transaction(DB_SERIALIZABLE);
+                    Client::WriteContext ctx( ns(), mongo::unittest::EMPTY_STRING );
+                    shared_ptr<Cursor> cursor( BasicCursor::make( getCollection( ns() ) ) );
+                    const unsigned before = ClientCursor::numCursors();
+
+                    vector<CursorId> ids;
+                    for ( int i = 0; i < 1000; ++i ) {
+                        ClientCursor *cc = new ClientCursor( 0, cursor, ns() );
+                        ids.push_back( cc->cursorid() );
+                    }
+                    ASSERT_EQUALS( before + 1000, ClientCursor::numCursors() );
+                    set<CursorId> all;
+                    ClientCursor::find( ns(), all );
+                    ASSERT_EQUALS( 1000U, all.size() );
+
+                    for ( vector<CursorId>::const_iterator i = ids.begin(); i != ids.end(); ++i ) {
+                        ClientCursor::Pin pin( *i );
+                        ASSERT( pin.c() );
+                        ASSERT_EQUALS( *i, pin.c()->cursorid() );
+                    }
+
+                    ASSERT_EQUALS( 1000, ClientCursor::erase( ids.size(), &ids[0] ) );
+                    ASSERT_EQUALS( before, ClientCursor::numCursors() );
+                    ASSERT( !ClientCursor::erase( ids[0] ) );
+                    transaction.commit();
+                }
+            };
+
+            /**
+             * Many threads each create a cursor, pin it for a few getMores and kill it, at once;
+             * every pin finds its own cursor and none are left behind.
+             */
+            class ConcurrentCreatePinKill {
+            public:
+                void run() {
+                    client.insert( ns(), BSON( "a" << 1 ) );
+                    const unsigned before = ClientCursor::numCursors();
+
+                    boost::thread_group threads;
+                    for ( int i = 0; i < nThreads; ++i ) {
+                        threads.create_thread( boost::bind( &ConcurrentCreatePinKill::worker, this ) );
+                    }
+                    threads.join_all();
+
+                    ASSERT_EQUALS( 0U, _failures.get() );
+                    ASSERT_EQUALS( before, ClientCursor::numCursors() );
+                }
+            private:
+                enum { nThreads = 8, N = 500, nGetMores = 4 };
+                // Workers count failures instead of ASSERTing, which would take the process down
+                // off the main thread.
+                AtomicUInt _failures;
+                void worker() {
+                    Client::initThread( "cursorregistry" );
+                    try {
+                        Client::Transaction transaction(DB_SERIALIZABLE);
+                        Client::ReadContext ctx( ns(), mongo::unittest::EMPTY_STRING );
+                        shared_ptr<Cursor> cursor( BasicCursor::make( getCollection( ns() ) ) );
+                        for ( int i = 0; i < N; ++i ) {
+                            ClientCursor *cc = new ClientCursor( 0, cursor, ns() );
+                            const CursorId id = cc->cursorid();
+                            for ( int j = 0; j < nGetMores; ++j ) {
+                                ClientCursor::Pin pin( id );
+                                if ( pin.c() != cc ) {
+                                    _failures++;
+                                }
+                            }
+                            if ( !ClientCursor::erase( id ) ) {
+                                _failures++;
+                            }
+                            ClientCursor::Pin pin( id );
+                            if ( pin.c() ) {
+                                _failures++;
+                            }
+                        }
+                        transaction.commit();
+                    }
+                    catch ( DBException &e ) {
+                        log() << "cursorregistry worker: " << e.what() << endl;
+                        _failures++;
+                    }
+                    cc().shutdown();
+                }
+            };
+
+        } // namespace Registry
+
     } // namespace ClientCursor
     
     class All : public Suite {
@@ -667,6 +763,8 @@ namespace CursorTests {
             add<ClientCursor::Pin::PinCursor>();
             add<ClientCursor::Pin::PinTwice>();
             add<ClientCursor::Pin::CursorDeleted>();
+            add<ClientCursor::Registry::FindPinErase>();
+            add<ClientCursor::Registry::ConcurrentCreatePinKill>();
         }
     } myall;
 } // namespace CursorTests
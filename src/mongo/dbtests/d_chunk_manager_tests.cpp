@@ -120,6 +120,51 @@ namespace {
         }
     };
 
+    class ChunkContainingTests {
+    public:
+        void run() {
+            BSONObj collection = BSON(CollectionType::ns("x.y") <<
+                                      CollectionType::dropped(false) <<
+                                      CollectionType::keyPattern(BSON("a" << 1)) <<
+                                      CollectionType::unique(false));
+
+            // [min->10) , [10->20) , <gap> , [30->max)
+            BSONArray chunks = BSON_ARRAY(BSON(ChunkType::name("x.y-a_MinKey") <<
+                                               ChunkType::ns("x.y") <<
+                                               ChunkType::min(BSON("a" << MINKEY)) <<
+                                               ChunkType::max(BSON("a" << 10))) <<
+
+                                          BSON(ChunkType::name("x.y-a_10") <<
+                                               ChunkType::ns("x.y") <<
+                                               ChunkType::min(BSON("a" << 10)) <<
+                                               ChunkType::max(BSON("a" << 20))) <<
+
+                                          BSON(ChunkType::name("x.y-a_30") <<
+                                               ChunkType::ns("x.y") <<
+                                               ChunkType::min(BSON("a" << 30)) <<
+                                               ChunkType::max(BSON("a" << MAXKEY))));
+
+            ShardChunkManager s ( collection , chunks );
+
+            BSONObj min;
+            BSONObj max;
+            ASSERT( s.getChunkContaining( BSON( "a" << 5 << "b" << 1 ) , &min , &max ) );
+            ASSERT_EQUALS( BSON( "a" << MINKEY ) , min );
+            ASSERT_EQUALS( BSON( "a" << 10 ) , max );
+
+            ASSERT( s.getChunkContaining( BSON( "a" << 10 ) , &min , &max ) );
+            ASSERT_EQUALS( BSON( "a" << 10 ) , min );
+            ASSERT_EQUALS( BSON( "a" << 20 ) , max );
+
+            ASSERT( s.getChunkContaining( BSON( "a" << 40 ) , &min , &max ) );
+            ASSERT_EQUALS( BSON( "a" << 30 ) , min );
+
+            // in the gap, and without a shard key
+            ASSERT( ! s.getChunkContaining( BSON( "a" << 25 ) , &min , &max ) );
+            ASSERT( ! s.getChunkContaining( BSON( "b" << 5 ) , &min , &max ) );
+        }
+    };
+
     class GetNextTests {
     public:
         void run() {
@@ -476,6 +521,7 @@ namespace {
             add< BasicTests >();
             add< BasicCompoundTests >();
             add< RangeTests >();
+            add< ChunkContainingTests >();
             add< GetNextTests >();
             add< DeletedTests >();
             add< ClonePlusTests >();
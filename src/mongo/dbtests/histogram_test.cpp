@@ -79,6 +79,32 @@ namespace mongo {
         }
     };
 
+    class Percentiles {
+    public:
+        void run() {
+            Histogram::Options opts;
+            opts.numBuckets = 4;
+            opts.bucketSize = 10;
+            Histogram h( opts );
+
+            ASSERT_EQUALS( h.getPercentile( 50 ), 0u );
+
+            for ( int i = 0; i < 90; i++ ) {
+                h.insert( 5 );   // first bucket
+            }
+            for ( int i = 0; i < 9; i++ ) {
+                h.insert( 25 );  // third bucket
+            }
+            h.insert( 1000 );    // last bucket
+
+            ASSERT_EQUALS( h.getPercentile( 50 ), 10u );
+            ASSERT_EQUALS( h.getPercentile( 90 ), 10u );
+            ASSERT_EQUALS( h.getPercentile( 95 ), 30u );
+            ASSERT_EQUALS( h.getPercentile( 99 ), 30u );
+            ASSERT_EQUALS( h.getPercentile( 100 ), numeric_limits<uint32_t>::max() );
+        }
+    };
+
     class HistogramSuite : public Suite {
     public:
         HistogramSuite() : Suite( "histogram" ) {}
@@ -87,6 +113,7 @@ namespace mongo {
             add< BoundariesInit >();
             add< BoundariesExponential >();
             add< BoundariesFind >();
+            add< Percentiles >();
             // TODO: complete the test suite
         }
     } histogramSuite;
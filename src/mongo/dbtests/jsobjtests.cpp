@@ -19,10 +19,12 @@
  */
 
 #include "mongo/pch.h"
+#include "mongo/bson/bson_validate.h"
 #include "mongo/bson/util/builder.h"
 #include "mongo/db/jsobj.h"
 #include "mongo/db/jsobjmanipulator.h"
 #include "mongo/db/json.h"
+#include "mongo/db/ops/insert.h"
 #include "mongo/db/repl.h"
 #include "mongo/db/cursor.h"
 #include "mongo/dbtests/dbtests.h"
@@ -943,6 +945,119 @@ namespace JsobjTests {
                 BSONType type_;
             };
 
+            class InsertRules {
+            public:
+                void run() {
+                    check( true, BSON( "_id" << 1 << "a" << BSON( "$b" << 1 ) ) );
+                    check( true, BSON( "a" << BSON_ARRAY( 1 << 2 ) << "_idx" << BSON_ARRAY( 1 ) ) );
+                    check( true, BSONObj() );
+                    check( false, BSON( "a" << 1 << "$b" << 1 ) );
+                    check( false, BSON( "_id" << BSON_ARRAY( 1 ) ) );
+                    BSONObjBuilder regex;
+                    regex.appendRegex( "_id", "x" );
+                    check( false, regex.obj() );
+                    BSONObjBuilder undefined;
+                    undefined.appendUndefined( "_id" );
+                    check( false, undefined.obj() );
+
+                    bool insertable;
+                    const char bad[] = { 0x07, 0x00, 0x00, 0x00, 0x10, 'a', 0x00 };
+                    ASSERT( !validateBSONForInsert( bad, sizeof bad, &insertable ).isOK() );
+                }
+            private:
+                static void check( bool expected, const BSONObj &o ) {
+                    bool insertable = !expected;
+                    ASSERT( validateBSONForInsert( o.objdata(), o.objsize(), &insertable ).isOK() );
+                    ASSERT_EQUALS( expected, insertable );
+                    bool threw = false;
+                    try {
+                        validateInsert( o );
+                    }
+                    catch ( UserException & ) {
+                        threw = true;
+                    }
+                    ASSERT_EQUALS( expected, !threw );
+                }
+            };
+
+            // Checking an insert in one pass agrees with validating the BSON and then
+            // validateInsert, on a document like the ones users insert.
+            class InsertRulesOnePass {
+            public:
+                void run() {
+                    const BSONObj sub = BSON( "a" << 1 << "b" << BSON_ARRAY( 1 << 2 << 3 ) << "c" << "x" );
+                    check( true, doc( BSON( "sub" << sub ) ) );
+                    check( true, doc( BSON( "sub" << BSON( "$a" << 1 ) ) ) );
+                    check( true, doc( BSON( "arr" << BSON_ARRAY( sub << sub ) ) ) );
+                    check( false, doc( BSON( "$sub" << sub ) ) );
+                    check( false, doc( BSON( "_id" << BSON_ARRAY( 1 << 2 ) ) ) );
+                }
+            private:
+                static BSONObj doc( const BSONObj &extra ) {
+                    BSONObjBuilder b;
+                    if ( !extra.hasField( "_id" ) ) {
+                        b.append( "_id", OID::gen() );
+                    }
+                    for ( int i = 0; i < 10; ++i ) {
+                        b.append( string( str::stream() << "n" << i ), i * 1000 );
+                        b.append( string( str::stream() << "s" << i ), "some string value of moderate length" );
+                    }
+                    b.appendElements( extra );
+                    b.appendDate( "ts", 1234567890000LL );
+                    return b.obj();
+                }
+                static void check( bool expected, const BSONObj &o ) {
+                    ASSERT( validateBSON( o.objdata(), o.objsize() ).isOK() );
+                    bool threw = false;
+                    try {
+                        validateInsert( o );
+                    }
+                    catch ( UserException & ) {
+                        threw = true;
+                    }
+                    bool insertable = !expected;
+                    ASSERT( validateBSONForInsert( o.objdata(), o.objsize(), &insertable ).isOK() );
+                    ASSERT_EQUALS( expected, !threw );
+                    ASSERT_EQUALS( expected, insertable );
+                }
+            };
+
+            // Checking an insert in one pass against validating the BSON and then
+            // validateInsert.
+            class Benchmark {
+            public:
+                void run() {
+                    BSONObjBuilder b;
+                    b.append( "_id", OID::gen() );
+                    for ( int i = 0; i < 10; ++i ) {
+                        b.append( string( str::stream() << "n" << i ), i * 1000 );
+                        b.append( string( str::stream() << "s" << i ), "some string value of moderate length" );
+                    }
+                    b.append( "sub", BSON( "a" << 1 << "b" << BSON_ARRAY( 1 << 2 << 3 ) << "c" << "x" ) );
+                    b.appendDate( "ts", 1234567890000LL );
+                    const BSONObj doc = b.obj();
+
+                    Timer t;
+                    for ( int i = 0; i < N; ++i ) {
+                        ASSERT( validateBSON( doc.objdata(), doc.objsize() ).isOK() );
+                        validateInsert( doc );
+                    }
+                    const int twoPassMs = t.millis();
+                    t.reset();
+                    for ( int i = 0; i < N; ++i ) {
+                        bool insertable;
+                        ASSERT( validateBSONForInsert( doc.objdata(), doc.objsize(), &insertable ).isOK() );
+                        ASSERT( insertable );
+                    }
+                    const int onePassMs = t.millis();
+                    cerr << "insert validation: " << N << " docs of " << doc.objsize()
+                         << " bytes, validateBSON + validateInsert " << twoPassMs
+                         << "ms, validateBSONForInsert " << onePassMs << "ms" << endl;
+                }
+            private:
+                enum { N = 1000000 };
+            };
+
         } // namespace Validation
 
     } // namespace BSONObjTests
@@ -1935,6 +2050,9 @@ namespace JsobjTests {
             add< BSONObjTests::Validation::CodeWScopeSmallStrSize >();
             add< BSONObjTests::Validation::CodeWScopeNoSizeForObj >();
             add< BSONObjTests::Validation::CodeWScopeSmallObjSize >();
+            add< BSONObjTests::Validation::InsertRules >();
+            add< BSONObjTests::Validation::InsertRulesOnePass >();
+            add< BSONObjTests::Validation::Benchmark >();
             add< BSONObjTests::Validation::CodeWScopeBadObject >();
             add< BSONObjTests::Validation::NoSize >( Symbol );
             add< BSONObjTests::Validation::NoSize >( Code );
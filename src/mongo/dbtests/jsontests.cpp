@@ -577,6 +577,50 @@ namespace JsonTests {
             }
         };
 
+        // Integers on either side of the int32 and fast path (18 digit) limits.  Only parsed, as
+        // the jsonString forms of NumberLong aren't all accepted by fromjson.
+        class IntegerLimits {
+        public:
+            void run() {
+                BSONObjBuilder b;
+                b.append( "a", 2147483647 );
+                b.append( "b", 2147483648LL );
+                b.append( "c", (int) -2147483648LL );
+                b.append( "d", -2147483649LL );
+                b.append( "e", 123456789012345678LL );
+                b.append( "f", -1234567890123456789LL );
+                b.append( "g", 0 );
+                b.append( "h", 7 );
+                b.append( "i", 10.0 );
+                b.append( "j", 16.0 );
+                BSONObj expected = b.obj();
+                BSONObj actual = fromjson( "{ a : 2147483647, b : 2147483648, c : -2147483648, "
+                                           "d : -2147483649, e : 123456789012345678, "
+                                           "f : -1234567890123456789, g : -0, h : 007, "
+                                           "i : 1e1, j : 0x10 }" );
+                ASSERT_EQUALS( expected, actual );
+                ASSERT( expected.binaryEqual( actual ) );
+            }
+        };
+
+        // Strings long enough to be copied in bulk, with escapes and control characters on
+        // either side of an eight byte boundary.
+        class LongStrings {
+        public:
+            void run() {
+                BSONObj o = fromjson( "{ a : \"abcdefghijklmnopqrstuvwxyz0123456789\", "
+                                      "b : \"abcdefg\\\"hijklmno\\\\pqrstuvwxyz\", "
+                                      "c : \"abcdefgh\\u00e9ijklmnop\xc3\xa9qrstuvwxyz\", "
+                                      "d : 'abcdefghijklm\"nopqrstuvwxyz' }" );
+                ASSERT_EQUALS( "abcdefghijklmnopqrstuvwxyz0123456789", o["a"].String() );
+                ASSERT_EQUALS( "abcdefg\"hijklmno\\pqrstuvwxyz", o["b"].String() );
+                ASSERT_EQUALS( "abcdefgh\xc3\xa9ijklmnop\xc3\xa9qrstuvwxyz", o["c"].String() );
+                ASSERT_EQUALS( "abcdefghijklm\"nopqrstuvwxyz", o["d"].String() );
+                ASSERT_THROWS( fromjson( "{ a : \"abcdefghijklmnop\x01qrstuvwxyz\" }" ),
+                               MsgAssertionException );
+            }
+        };
+
         class TwoElements : public Base {
             virtual BSONObj bson() const {
                 BSONObjBuilder b;
@@ -1605,6 +1649,8 @@ namespace JsonTests {
             add< FromJsonTests::SingleNumber >();
             add< FromJsonTests::RealNumber >();
             add< FromJsonTests::FancyNumber >();
+            add< FromJsonTests::IntegerLimits >();
+            add< FromJsonTests::LongStrings >();
             add< FromJsonTests::TwoElements >();
             add< FromJsonTests::Subobject >();
             add< FromJsonTests::DeeplyNestedObject >();
@@ -20,9 +20,11 @@
 
 #include "mongo/pch.h"
 #include "mongo/db/json.h"
+#include "mongo/db/keygenerator.h"
 #include "mongo/db/queryutil.h"
 
 #include "mongo/dbtests/dbtests.h"
+#include "mongo/util/timer.h"
 
 namespace NamespaceTests {
 
@@ -950,6 +952,141 @@ namespace NamespaceTests {
         protected:
             BSONObj key() const { return BSON( "a" << 1 ); }
         };
+
+        namespace CompiledKeyGenerator {
+
+            static vector<const char *> fieldNames( const BSONObj &keyPattern ) {
+                vector<const char *> fields;
+                for ( BSONObjIterator i( keyPattern ); i.more(); ) {
+                    fields.push_back( i.next().fieldName() );
+                }
+                return fields;
+            }
+
+            /** The compiled plan generates the same keys, or error, as the general algorithm. */
+            class MatchesGeneral {
+            public:
+                void run() {
+                    const char *patterns[] = {
+                        "{a:1}", "{a:1,b:1}", "{'a.b':1}", "{'a.b':1,'a.c':1}", "{a:1,'a.b':1}",
+                        "{'a.b.c':1,d:-1}", "{'a.0':1}", "{'a.0.b':1}", "{b:1,a:1}", NULL
+                    };
+                    const char *docs[] = {
+                        "{}", "{a:1}", "{a:null}", "{b:2}", "{a:1,b:2}", "{a:1,a:2}", "{a:[]}",
+                        "{a:[1,2,2,3]}", "{a:[1,[2,3]],b:4}", "{a:[1,2],b:[3,4]}", "{a:{b:1,c:2}}",
+                        "{a:{b:[1,2],c:3}}", "{a:{b:[1,2],c:[3]}}", "{a:[{b:1},{b:2}]}",
+                        "{a:{b:{c:5}},d:6}", "{a:{b:{c:[5,6]}},d:[]}", "{a:5,d:1}", "{a:{'0':1}}",
+                        "{a:[{'0':1}]}", "{a:[[1]]}", "{a:{b:{}}}", "{a:{c:1},b:[]}", NULL
+                    };
+                    for ( int p = 0; patterns[ p ]; ++p ) {
+                        const BSONObj keyPattern = fromjson( patterns[ p ] );
+                        for ( int sparse = 0; sparse < 2; ++sparse ) {
+                            KeyGenerator compiled( fieldNames( keyPattern ), sparse );
+                            for ( int d = 0; docs[ d ]; ++d ) {
+                                const BSONObj doc = fromjson( docs[ d ] );
+                                BSONObjSet expected, actual;
+                                int expectedCode = 0, actualCode = 0;
+                                try {
+                                    vector<const char *> fields = fieldNames( keyPattern );
+                                    KeyGenerator::getKeys( doc, fields, sparse, expected );
+                                }
+                                catch ( const DBException &e ) {
+                                    expectedCode = e.getCode();
+                                }
+                                try {
+                                    compiled.getKeys( doc, actual );
+                                }
+                                catch ( const DBException &e ) {
+                                    actualCode = e.getCode();
+                                }
+                                ASSERT_EQUALS( expectedCode, actualCode );
+                                ASSERT_EQUALS( expected.size(), actual.size() );
+                                for ( BSONObjSet::const_iterator i = expected.begin(), j = actual.begin();
+                                      i != expected.end(); ++i, ++j ) {
+                                    ASSERT_EQUALS( 0, i->woCompare( *j, BSONObj(), false ) );
+                                }
+                            }
+                        }
+                    }
+                }
+            };
+
+            /** Keys for wide flat, nested and multikey documents, the shapes indexes see most. */
+            class DocumentShapes {
+            public:
+                void run() {
+                    BSONObjBuilder flat;
+                    for ( int i = 0; i < 20; ++i ) {
+                        flat.append( string( str::stream() << "f" << i ), i );
+                    }
+                    check( fromjson( "{f3:1,f17:1}" ), flat.obj(),
+                           BSON_ARRAY( BSON( "" << 3 << "" << 17 ) ) );
+                    check( fromjson( "{'a.b.c':1,'a.b.d':1,'a.e':1}" ),
+                           fromjson( "{x:1,a:{y:2,b:{z:3,c:4,d:5},e:6},w:7}" ),
+                           BSON_ARRAY( BSON( "" << 4 << "" << 5 << "" << 6 ) ) );
+                    check( fromjson( "{tags:1,n:1}" ),
+                           fromjson( "{n:1,tags:['a','b','c'],s:'x'}" ),
+                           BSON_ARRAY( BSON( "" << "a" << "" << 1 ) <<
+                                       BSON( "" << "b" << "" << 1 ) <<
+                                       BSON( "" << "c" << "" << 1 ) ) );
+                }
+            private:
+                static void check( const BSONObj &keyPattern, const BSONObj &doc, const BSONArray &expected ) {
+                    KeyGenerator compiled( fieldNames( keyPattern ), false );
+                    // the same generator, used again, gives the same keys
+                    for ( int pass = 0; pass < 2; ++pass ) {
+                        BSONObjSet keys;
+                        compiled.getKeys( doc, keys );
+                        ASSERT_EQUALS( (size_t) expected.nFields(), keys.size() );
+                        BSONObjIterator e( expected );
+                        for ( BSONObjSet::const_iterator k = keys.begin(); k != keys.end(); ++k ) {
+                            ASSERT_EQUALS( 0, k->woCompare( e.next().Obj(), BSONObj(), false ) );
+                        }
+                    }
+                }
+            };
+
+            /**
+             * Microbenchmark comparing the compiled plan against the general algorithm on flat,
+             * nested and multikey documents.
+             */
+            class Benchmark {
+            public:
+                void run() {
+                    BSONObjBuilder flat;
+                    for ( int i = 0; i < 20; ++i ) {
+                        flat.append( string( str::stream() << "f" << i ), i );
+                    }
+                    time( "flat", fromjson( "{f3:1,f17:1}" ), flat.obj() );
+                    time( "nested", fromjson( "{'a.b.c':1,'a.b.d':1,'a.e':1}" ),
+                          fromjson( "{x:1,a:{y:2,b:{z:3,c:4,d:5},e:6},w:7}" ) );
+                    time( "multikey", fromjson( "{tags:1,n:1}" ),
+                          fromjson( "{n:1,tags:['a','b','c','d','e','f','g','h','i','j'],s:'x'}" ) );
+                }
+            private:
+                enum { N = 100000 };
+                static void time( const char *name, const BSONObj &keyPattern, const BSONObj &doc ) {
+                    const vector<const char *> fields = fieldNames( keyPattern );
+                    Timer t;
+                    for ( int i = 0; i < N; ++i ) {
+                        BSONObjSet keys;
+                        vector<const char *> f( fields );
+                        KeyGenerator::getKeys( doc, f, false, keys );
+                    }
+                    const int generalMs = t.millis();
+                    KeyGenerator compiled( fields, false );
+                    t.reset();
+                    for ( int i = 0; i < N; ++i ) {
+                        BSONObjSet keys;
+                        compiled.getKeys( doc, keys );
+                    }
+                    const int compiledMs = t.millis();
+                    cerr << "KeyGenerator " << name << ": " << N << " docs, general " << generalMs
+                         << "ms, compiled " << compiledMs << "ms" << endl;
+                }
+            };
+
+        } // namespace CompiledKeyGenerator
         
     } // namespace IndexDetailsTests
 
@@ -1135,6 +1272,9 @@ namespace NamespaceTests {
             add< IndexDetailsTests::Suitability >();
             add< IndexDetailsTests::NumericFieldSuitability >();
             add< IndexDetailsTests::IndexMissingField >();
+            add< IndexDetailsTests::CompiledKeyGenerator::MatchesGeneral >();
+            add< IndexDetailsTests::CompiledKeyGenerator::DocumentShapes >();
+            add< IndexDetailsTests::CompiledKeyGenerator::Benchmark >();
             add< CollectionTests::SetIndexIsMultikey >();
             add< CollectionTests::ClearQueryCache >();
         }
@@ -2087,6 +2087,49 @@ namespace QueryUtilTests {
             }
         };
 
+        /** Skipping over many $in intervals at once lands on the right one. */
+        class AdvanceLargeIn : public Base {
+            BSONObj query() {
+                BSONArrayBuilder in;
+                for( int i = 0; i < 1000; ++i ) {
+                    in << i * 2;
+                }
+                return BSON( "a" << BSON( "$in" << in.arr() ) );
+            }
+            BSONObj index() { return BSON( "a" << 1 ); }
+            void check() {
+                assertAdvanceToNext( BSON( "a" << 0 ) );
+                assertAdvanceTo( BSON( "a" << 1 ), BSON( "a" << 2 ) );
+                assertAdvanceTo( BSON( "a" << 501 ), BSON( "a" << 502 ) );
+                assertAdvanceToNext( BSON( "a" << 502 ) );
+                assertAdvanceTo( BSON( "a" << 504.5 ), BSON( "a" << 506 ) );
+                assertAdvanceTo( BSON( "a" << 1995 ), BSON( "a" << 1996 ) );
+                assertAdvanceToNext( BSON( "a" << 1998 ) );
+                assertDoneAdvancing( BSON( "a" << 1999 ) );
+            }
+        };
+
+        /** As above, with a trailing field. */
+        class AdvanceLargeInCompound : public Base {
+            BSONObj query() {
+                BSONArrayBuilder in;
+                for( int i = 0; i < 1000; ++i ) {
+                    in << i * 2;
+                }
+                return BSON( "a" << BSON( "$in" << in.arr() ) << "b" << BSON( "$in" << BSON_ARRAY( 1 << 3 ) ) );
+            }
+            BSONObj index() { return BSON( "a" << 1 << "b" << 1 ); }
+            void check() {
+                assertAdvanceToNext( BSON( "a" << 0 << "b" << 1 ) );
+                assertAdvanceTo( BSON( "a" << 0 << "b" << 2 ), BSON( "a" << 0 << "b" << 3 ) );
+                assertAdvanceTo( BSON( "a" << 901 << "b" << 0 ), BSON( "a" << 902 << "b" << 1 ) );
+                assertAdvanceToAfter( BSON( "a" << 902 << "b" << 4 ), BSON( "a" << 902 ) );
+                assertAdvanceTo( BSON( "a" << 1500 << "b" << 0 ), BSON( "a" << 1500 << "b" << 1 ) );
+                assertAdvanceToNext( BSON( "a" << 1998 << "b" << 3 ) );
+                assertDoneAdvancing( BSON( "a" << 1998 << "b" << 4 ) );
+            }
+        };
+
         namespace CompoundRangeCounter {
 
             class RangeTracking {
@@ -2791,6 +2834,8 @@ namespace QueryUtilTests {
             add<FieldRangeVectorIteratorTests::AdvanceRangeMixedIn>();
             add<FieldRangeVectorIteratorTests::AdvanceRangeMixedMixed>();
             add<FieldRangeVectorIteratorTests::AdvanceMixedMixedIn>();
+            add<FieldRangeVectorIteratorTests::AdvanceLargeIn>();
+            add<FieldRangeVectorIteratorTests::AdvanceLargeInCompound>();
             add<FieldRangeVectorIteratorTests::CompoundRangeCounter::RangeTracking>();
             add<FieldRangeVectorIteratorTests::CompoundRangeCounter::SingleIntervalCount>();
             add<FieldRangeVectorIteratorTests::CompoundRangeCounter::Set>();
@@ -28,6 +28,10 @@
 #include <boost/thread.hpp>
 #include <boost/bind.hpp>
 #include "../db/d_concurrency.h"
+#include "../db/clientcursor.h"
+#include "../db/collection.h"
+#include "../db/cursor.h"
+#include "../db/instance.h"
 #include "../util/concurrency/synchronization.h"
 #include "../util/concurrency/qlock.h"
 #include "dbtests.h"
@@ -846,6 +850,115 @@ namespace ThreadedTests {
         }
     };
 
+    // Throughput of QLock's r and w paths as threads are added.  One thread also takes W now and
+    // then, so the fast paths are seen to still exclude it.
+    template <int nthreads_param>
+    class QLockScaling : public ThreadedTest<nthreads_param> {
+    public:
+        QLockScaling() : _ops(0), _inW(0), _nW(0) { }
+    private:
+        QLock _q;
+        AtomicUInt64 _ops;
+        AtomicInt32 _inW;
+        unsigned _nW;
+
+        virtual void validate() {
+            log() << "QLock r/w with " << nthreads_param << " threads: "
+                  << _ops.load() * 1000 / durationMillis << " ops/sec, " << _nW << " W" << endl;
+            ASSERT( _nW > 0 );
+        }
+        virtual void subthread(int x) {
+            Timer t;
+            unsigned long long n = 0;
+            while( t.millis() < durationMillis ) {
+                if( x == 1 ) {
+                    _q.lock_W();
+                    _inW.store(1);
+                    sleepmicros(100);
+                    _inW.store(0);
+                    _nW++;
+                    _q.unlock_W();
+                }
+                for( int i = 0; i < 1000; i++ ) {
+                    if( i % 4 == 0 ) {
+                        _q.lock_w();
+                        ASSERT_EQUALS( 0, _inW.loadRelaxed() );
+                        _q.unlock_w();
+                    }
+                    else {
+                        _q.lock_r();
+                        ASSERT_EQUALS( 0, _inW.loadRelaxed() );
+                        _q.unlock_r();
+                    }
+                }
+                n += 1000;
+            }
+            _ops.fetchAndAdd(n);
+        }
+        static const int durationMillis = 500;
+    };
+
+    // Throughput of the ClientCursor registry as threads are added: each thread creates a cursor,
+    // pins it for a few getMores and kills it, over and over.
+    template <int nthreads_param>
+    class ClientCursorRegistryScaling : public ThreadedTest<nthreads_param> {
+    public:
+        ClientCursorRegistryScaling() : _ops(0), _before(0) { }
+    private:
+        AtomicUInt64 _ops;
+        // Counted rather than ASSERTed in the subthreads, and checked in validate().
+        AtomicUInt _failures;
+        unsigned _before;
+
+        static const char *ns() { return "unittests.threadedtests.cursorregistry"; }
+
+        virtual void setup() {
+            DBDirectClient c;
+            c.dropCollection( ns() );
+            c.insert( ns(), BSON( "a" << 1 ) );
+            _before = ClientCursor::numCursors();
+        }
+        virtual void validate() {
+            log() << "ClientCursor registry with " << nthreads_param << " threads: "
+                  << _ops.load() * 1000 / durationMillis << " cursors/sec ("
+                  << nGetMores << " getMores each)" << endl;
+            ASSERT_EQUALS( 0U, _failures.get() );
+            ASSERT_EQUALS( _before, ClientCursor::numCursors() );
+        }
+        virtual void subthread(int x) {
+            Client::initThread("cursorregistry");
+            try {
+                Client::Transaction transaction(DB_SERIALIZABLE);
+                Client::ReadContext ctx( ns(), mongo::unittest::EMPTY_STRING );
+                shared_ptr<Cursor> cursor( BasicCursor::make( getCollection( ns() ) ) );
+                Timer t;
+                unsigned long long n = 0;
+                while( t.millis() < durationMillis ) {
+                    for( int i = 0; i < 100; i++ ) {
+                        ClientCursor::Holder cc( new ClientCursor( 0, cursor, ns() ) );
+                        const CursorId id = cc->cursorid();
+                        for( int j = 0; j < nGetMores; j++ ) {
+                            ClientCursor::Pin pin( id );
+                            if( !pin.c() ) {
+                                _failures++;
+                            }
+                        }
+                    }
+                    n += 100;
+                }
+                transaction.commit();
+                _ops.fetchAndAdd(n);
+            }
+            catch( DBException &e ) {
+                log() << "cursorregistry subthread: " << e.what() << endl;
+                _failures++;
+            }
+            cc().shutdown();
+        }
+        static const int durationMillis = 500;
+        static const int nGetMores = 4;
+    };
+
     // Tests waiting on the TicketHolder by running many more threads than can fit into the "hotel", but only
     // max _nRooms threads should ever get in at once
     class TicketHolderWaits : public ThreadedTest<10> {
@@ -928,6 +1041,11 @@ namespace ThreadedTests {
             add< WriteLocksAreGreedy >();
             add< QLockTest >();
             add< QLockTest >();
+            add< QLockScaling<1> >();
+            add< QLockScaling<4> >();
+            add< QLockScaling<16> >();
+            add< ClientCursorRegistryScaling<1> >();
+            add< ClientCursorRegistryScaling<16> >();
 
             // Slack is a test to see how long it takes for another thread to pick up
             // and begin work after another relinquishes the lock.  e.g. a spin lock 
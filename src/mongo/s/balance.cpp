@@ -19,10 +19,14 @@
 
 #include "mongo/s/balance.h"
 
+#include <boost/thread/thread.hpp>
+
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/client/distlock.h"
 #include "mongo/db/cmdline.h"
+#include "mongo/db/commands/server_status.h"
 #include "mongo/db/jsobj.h"
+#include "mongo/db/namespacestring.h"
 #include "mongo/s/chunk.h"
 #include "mongo/s/config.h"
 #include "mongo/s/config_server_checker_service.h"
@@ -34,89 +38,367 @@
 #include "mongo/s/type_mongos.h"
 #include "mongo/s/type_settings.h"
 #include "mongo/s/type_tags.h"
+#include "mongo/util/concurrency/mutex.h"
 #include "mongo/util/version.h"
 
 namespace mongo {
 
     Balancer balancer;
 
-    Balancer::Balancer() : _balancedLastTime(0), _policy( new BalancerPolicy() ) {}
+    /**
+     * Each shard's load on each collection, from the change in the shard's top counters between
+     * two samples.  Shared by the balancer thread and dry runs.
+     */
+    class CollectionLoadTracker {
+    public:
+        CollectionLoadTracker() : _mutex( "CollectionLoadTracker" ) {}
+
+        /** Samples the shards' counters, skipping shards sampled less than a second ago. */
+        void sample( const vector<Shard>& shards ) {
+            for ( vector<Shard>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+                {
+                    scoped_lock lk( _mutex );
+                    const Sample& prev = _samples[i->getName()];
+                    if ( prev.millis != 0 && curTimeMillis64() - prev.millis < 1000 )
+                        continue;
+                }
+
+                BSONObj totals;
+                try {
+                    totals = i->runCommand( "admin", "top", true )["totals"].Obj().getOwned();
+                }
+                catch ( DBException& e ) {
+                    LOG(1) << "could not get load of shard " << i->getName() << causedBy( e ) << endl;
+                    continue;
+                }
+                const unsigned long long now = curTimeMillis64();
+
+                scoped_lock lk( _mutex );
+                Sample& prev = _samples[i->getName()];
+                map<string,ShardLoad> loads;
+                if ( prev.millis != 0 && now > prev.millis ) {
+                    const double secs = ( now - prev.millis ) / 1000.0;
+                    BSONObjIterator it( totals );
+                    while ( it.more() ) {
+                        BSONElement e = it.next();
+                        if ( e.type() != Object )
+                            continue;
+                        BSONElement prevTotals = prev.totals[e.fieldName()];
+                        if ( prevTotals.type() != Object )
+                            continue;
+                        BSONObj before = prevTotals.Obj()["total"].Obj();
+                        BSONObj after = e.Obj()["total"].Obj();
+                        const long long count = after["count"].numberLong() - before["count"].numberLong();
+                        const long long time = after["time"].numberLong() - before["time"].numberLong();
+                        if ( count < 0 || time < 0 ) {
+                            // the shard restarted
+                            continue;
+                        }
+                        ShardLoad& load = loads[e.fieldName()];
+                        load.opsPerSec = count / secs;
+                        load.busyMicrosPerSec = time / secs;
+                    }
+                }
+                prev.millis = now;
+                prev.totals = totals;
+                prev.loads.swap( loads );
+            }
+        }
+
+        ShardLoad get( const string& shard, const string& ns ) {
+            scoped_lock lk( _mutex );
+            map<string,ShardLoad>& loads = _samples[shard].loads;
+            map<string,ShardLoad>::const_iterator i = loads.find( ns );
+            if ( i == loads.end() )
+                return ShardLoad();
+            return i->second;
+        }
+
+    private:
+        struct Sample {
+            Sample() : millis( 0 ) {}
+            unsigned long long millis;
+            BSONObj totals;
+            map<string,ShardLoad> loads;
+        };
+
+        mongo::mutex _mutex;
+        map<string,Sample> _samples;
+    } collectionLoad;
+
+    /**
+     * Asks each shard for the data size of its chunks of ns.  Chunks on shards that can't say
+     * are left without one, which makes the policy balance chunk counts instead.
+     */
+    static void addChunkDataSizes( const string& ns,
+                                   const BSONObj& keyPattern,
+                                   const ShardToChunksMap& shardToChunksMap,
+                                   DistributionStatus* status ) {
+        for ( ShardToChunksMap::const_iterator i = shardToChunksMap.begin();
+              i != shardToChunksMap.end();
+              ++i ) {
+            const vector<BSONObj>& chunks = i->second;
+            if ( chunks.empty() )
+                continue;
+
+            BSONArrayBuilder bounds;
+            for ( unsigned j = 0; j < chunks.size(); j++ ) {
+                bounds.append( BSON( "min" << chunks[j][ChunkType::min()].Obj() <<
+                                     "max" << chunks[j][ChunkType::max()].Obj() ) );
+            }
+
+            BSONObj res;
+            try {
+                res = Shard::make( i->first ).runCommand( nsToDatabase( ns ),
+                                                          BSON( "chunkDataSizes" << ns <<
+                                                                "keyPattern" << keyPattern <<
+                                                                "chunks" << bounds.arr() <<
+                                                                "granularity" << Chunk::MaxChunkSize / 64 ),
+                                                          true );
+            }
+            catch ( DBException& e ) {
+                warning() << "could not get chunk data sizes of " << ns << " from " << i->first
+                          << causedBy( e ) << endl;
+                continue;
+            }
+
+            vector<BSONElement> sizes = res["sizes"].Array();
+            if ( sizes.size() != chunks.size() ) {
+                warning() << "got " << sizes.size() << " chunk data sizes of " << ns << " from "
+                          << i->first << " for " << chunks.size() << " chunks" << endl;
+                continue;
+            }
+            for ( unsigned j = 0; j < chunks.size(); j++ ) {
+                status->setChunkDataSize( chunks[j][ChunkType::min()].Obj(), sizes[j].numberLong() );
+            }
+        }
+    }
+
+    Balancer::Balancer() : _balancedLastTime(0), _policy( new BalancerPolicy() ),
+                           _statusMutex( "Balancer::status" ),
+                           _migrationsStarted(0), _migrationsSucceeded(0), _migrationsFailed(0),
+                           _lastRoundMigrations(0), _lastRoundMillis(0), _lastRoundBytes(0) {}
 
     Balancer::~Balancer() {
     }
 
-    int Balancer::_moveChunks( const vector<CandidateChunkPtr>* candidateChunks ) {
-        int movedCount = 0;
+    void Balancer::_moveChunk( const CandidateChunk& chunkInfo, int* movedCount ) {
+        *movedCount = 0;
 
-        for ( vector<CandidateChunkPtr>::const_iterator it = candidateChunks->begin(); it != candidateChunks->end(); ++it ) {
-            const CandidateChunk& chunkInfo = *it->get();
+        // Changes to metadata, borked metadata, and connectivity problems should cause us to
+        // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
+        // TODO: Handle all these things more cleanly, since they're expected problems
+        try {
 
-            // Changes to metadata, borked metadata, and connectivity problems should cause us to
-            // abort this chunk move, but shouldn't cause us to abort the entire round of chunks.
-            // TODO: Handle all these things more cleanly, since they're expected problems
-            try {
+            DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
+            verify( cfg );
 
-                DBConfigPtr cfg = grid.getDBConfig( chunkInfo.ns );
-                verify( cfg );
+            // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
+            // tried to do so once.
+            ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            verify( cm );
 
-                // NOTE: We purposely do not reload metadata here, since _doBalanceRound already
-                // tried to do so once.
-                ChunkManagerPtr cm = cfg->getChunkManager( chunkInfo.ns );
+            ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+            if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
+                // likely a split happened somewhere
+                cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
                 verify( cm );
 
-                ChunkPtr c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
                 if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                    // likely a split happened somewhere
-                    cm = cfg->getChunkManager( chunkInfo.ns , true /* reload */);
-                    verify( cm );
-
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
-                    if ( c->getMin().woCompare( chunkInfo.chunk.min ) || c->getMax().woCompare( chunkInfo.chunk.max ) ) {
-                        log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
-                        continue;
-                    }
+                    log() << "chunk mismatch after reload, ignoring will retry issue " << chunkInfo.chunk.toString() << endl;
+                    return;
                 }
+            }
 
-                BSONObj res;
-                if (c->moveAndCommit(Shard::make(chunkInfo.to), res)) {
-                    movedCount++;
-                    continue;
+            BSONObj res;
+            if (c->moveAndCommit(Shard::make(chunkInfo.to), res)) {
+                *movedCount = 1;
+                return;
+            }
+
+            // the move requires acquiring the collection metadata's lock, which can fail
+            log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
+                  << " chunk: " << chunkInfo.chunk << endl;
+
+            if ( res["chunkTooBig"].trueValue() ) {
+                // reload just to be safe
+                cm = cfg->getChunkManager( chunkInfo.ns );
+                verify( cm );
+                c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+
+                log() << "forcing a split because migrate failed for size reasons" << endl;
+
+                res = BSONObj();
+                c->singleSplit( true , res );
+                log() << "forced split results: " << res << endl;
+
+                if ( ! res["ok"].trueValue() ) {
+                    log() << "marking chunk as jumbo: " << c->toString() << endl;
+                    c->markAsJumbo();
+                    // we count the chunk as moved so we do another round right away
+                    *movedCount = 1;
                 }
 
-                // the move requires acquiring the collection metadata's lock, which can fail
-                log() << "balancer move failed: " << res << " from: " << chunkInfo.from << " to: " << chunkInfo.to
-                      << " chunk: " << chunkInfo.chunk << endl;
+            }
+        }
+        catch( const DBException& ex ) {
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex ) << endl;
+        }
+        catch( const std::exception& ex ) {
+            // we're on our own thread, so nobody else would catch this
+            warning() << "could not move chunk " << chunkInfo.chunk.toString()
+                      << ", continuing balancing round" << causedBy( ex.what() ) << endl;
+        }
+    }
 
-                if ( res["chunkTooBig"].trueValue() ) {
-                    // reload just to be safe
-                    cm = cfg->getChunkManager( chunkInfo.ns );
-                    verify( cm );
-                    c = cm->findIntersectingChunk( chunkInfo.chunk.min );
+    void Balancer::_pollMigration( const CandidateChunkPtr& chunk ) {
+        const CandidateChunk& chunkInfo = *chunk;
+        BSONObj res;
+        try {
+            res = Shard::make( chunkInfo.to ).runCommand( "admin", "_recvChunkStatus", true );
+        }
+        catch ( DBException& e ) {
+            LOG(1) << "could not get migration status from " << chunkInfo.to << causedBy( e ) << endl;
+            return;
+        }
 
-                    log() << "forcing a split because migrate failed for size reasons" << endl;
+        // The TO-shard may not have started on our chunk yet.  Once done, it keeps reporting
+        // it until its next migration.
+        if ( res["ns"].str() != chunkInfo.ns ||
+             res["min"].type() != Object ||
+             res["min"].Obj().woCompare( chunkInfo.chunk.min ) ||
+             res["counts"].type() != Object ) {
+            return;
+        }
 
-                    res = BSONObj();
-                    c->singleSplit( true , res );
-                    log() << "forced split results: " << res << endl;
+        BSONObj counts = res["counts"].Obj();
+        scoped_lock lk( _statusMutex );
+        for ( unsigned i = 0; i < _inFlight.size(); i++ ) {
+            if ( _inFlight[i].chunk == chunk ) {
+                _inFlight[i].cloned = counts["cloned"].numberLong();
+                _inFlight[i].clonedBytes = counts["clonedBytes"].numberLong();
+            }
+        }
+    }
 
-                    if ( ! res["ok"].trueValue() ) {
-                        log() << "marking chunk as jumbo: " << c->toString() << endl;
-                        c->markAsJumbo();
-                        // we increment moveCount so we do another round right away
-                        movedCount++;
-                    }
+    int Balancer::_moveChunks( const vector<CandidateChunkPtr>* candidateChunks ) {
+        const unsigned long long roundStart = curTimeMillis64();
+
+        // The candidates have no shard in common, so their migrations don't wait on each other.
+        vector<int> moved( candidateChunks->size(), 0 );
+        vector<shared_ptr<boost::thread> > threads;
+        {
+            scoped_lock lk( _statusMutex );
+            _inFlight.clear();
+            for ( unsigned i = 0; i < candidateChunks->size(); i++ )
+                _inFlight.push_back( InFlightMigration( (*candidateChunks)[i] ) );
+            _migrationsStarted += candidateChunks->size();
+        }
+        for ( unsigned i = 0; i < candidateChunks->size(); i++ ) {
+            threads.push_back( shared_ptr<boost::thread>(
+                    new boost::thread( boost::bind( &Balancer::_moveChunk, this,
+                                                    boost::cref( *(*candidateChunks)[i] ),
+                                                    &moved[i] ) ) ) );
+        }
 
+        long long roundBytes = 0;
+        int movedCount = 0;
+        unsigned done = 0;
+        vector<bool> joined( threads.size(), false );
+        while ( done < threads.size() ) {
+            for ( unsigned i = 0; i < threads.size(); i++ ) {
+                if ( joined[i] || ! threads[i]->timed_join( boost::posix_time::milliseconds( 0 ) ) )
+                    continue;
+
+                joined[i] = true;
+                done++;
+                movedCount += moved[i];
+                _pollMigration( (*candidateChunks)[i] );
+
+                scoped_lock lk( _statusMutex );
+                for ( vector<InFlightMigration>::iterator it = _inFlight.begin(); it != _inFlight.end(); ++it ) {
+                    if ( it->chunk != (*candidateChunks)[i] )
+                        continue;
+                    if ( moved[i] ) {
+                        _migrationsSucceeded++;
+                        roundBytes += it->clonedBytes;
+                    }
+                    else {
+                        _migrationsFailed++;
+                    }
+                    _inFlight.erase( it );
+                    break;
                 }
             }
-            catch( const DBException& ex ) {
-                warning() << "could not move chunk " << chunkInfo.chunk.toString()
-                          << ", continuing balancing round" << causedBy( ex ) << endl;
+
+            if ( done < threads.size() ) {
+                sleepsecs( 1 );
+                for ( unsigned i = 0; i < threads.size(); i++ ) {
+                    if ( ! joined[i] )
+                        _pollMigration( (*candidateChunks)[i] );
+                }
             }
         }
 
+        {
+            scoped_lock lk( _statusMutex );
+            _lastRoundMigrations = movedCount;
+            _lastRoundMillis = curTimeMillis64() - roundStart;
+            _lastRoundBytes = roundBytes;
+        }
+
         return movedCount;
     }
 
+    void Balancer::appendMigrationStatus( BSONObjBuilder& b ) const {
+        scoped_lock lk( _statusMutex );
+        const unsigned long long now = curTimeMillis64();
+
+        BSONArrayBuilder inFlight( b.subarrayStart( "inFlight" ) );
+        for ( unsigned i = 0; i < _inFlight.size(); i++ ) {
+            const InFlightMigration& m = _inFlight[i];
+            const unsigned long long millis = now > m.startMillis ? now - m.startMillis : 0;
+            BSONObjBuilder mb( inFlight.subobjStart() );
+            mb.append( "ns", m.chunk->ns );
+            mb.append( "from", m.chunk->from );
+            mb.append( "to", m.chunk->to );
+            mb.append( "min", m.chunk->chunk.min );
+            mb.appendNumber( "elapsedMillis", (long long) millis );
+            mb.appendNumber( "cloned", m.cloned );
+            mb.appendNumber( "clonedBytes", m.clonedBytes );
+            mb.append( "bytesPerSec", millis > 0 ? m.clonedBytes * 1000.0 / millis : 0.0 );
+            mb.done();
+        }
+        inFlight.done();
+
+        b.appendNumber( "started", _migrationsStarted );
+        b.appendNumber( "succeeded", _migrationsSucceeded );
+        b.appendNumber( "failed", _migrationsFailed );
+
+        BSONObjBuilder lb( b.subobjStart( "lastRound" ) );
+        lb.append( "migrations", _lastRoundMigrations );
+        lb.appendNumber( "millis", (long long) _lastRoundMillis );
+        lb.appendNumber( "clonedBytes", _lastRoundBytes );
+        lb.done();
+    }
+
+    class BalancerSSS : public ServerStatusSection {
+    public:
+        BalancerSSS() : ServerStatusSection( "balancer" ) {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection( const BSONElement& configElement ) const {
+            if ( ! cmdLine.isMongos() ) {
+                return BSONObj();
+            }
+            BSONObjBuilder b;
+            balancer.appendMigrationStatus( b );
+            return b.obj();
+        }
+    } balancerSection;
+
     void Balancer::_ping( DBClientBase& conn, bool waiting ) {
         WriteConcern w = conn.getWriteConcern();
         conn.setWriteConcern( W_NONE );
@@ -183,9 +465,16 @@ namespace mongo {
         }        
     }
 
-    void Balancer::_doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks ) {
+    void Balancer::_doBalanceRound( DBClientBase& conn,
+                                    const string& policy,
+                                    int maxMigrations,
+                                    const string& onlyNs,
+                                    vector<CandidateChunkPtr>* candidateChunks,
+                                    BSONObjBuilder* explain ) {
         verify( candidateChunks );
 
+        const bool loadAware = policy == "load";
+
         //
         // 1. Check whether there is any sharded collection to be balanced by querying
         // the ShardsNS::collections collection
@@ -196,6 +485,9 @@ namespace mongo {
         while ( cursor->more() ) {
             BSONObj col = cursor->nextSafe();
 
+            if ( ! onlyNs.empty() && col[CollectionType::ns()].String() != onlyNs )
+                continue;
+
             // sharded collections will have a shard "key".
             if ( ! col[CollectionType::keyPattern()].eoo() &&
                  ! col[CollectionType::noBalance()].trueValue() ){
@@ -228,6 +520,10 @@ namespace mongo {
             LOG(1) << "can't balance without more active shards" << endl;
             return;
         }
+
+        if ( loadAware ) {
+            collectionLoad.sample( allShards );
+        }
         
         ShardInfoMap shardInfo;
         for ( vector<Shard>::const_iterator it = allShards.begin(); it != allShards.end(); ++it ) {
@@ -246,11 +542,19 @@ namespace mongo {
 
         //
         // 3. For each collection, check if the balancing policy recommends moving anything around.
+        // Each shard takes part in at most one of the round's migrations, so they can all run at once.
         //
 
+        set<string> busyShards;
+
         for (vector<string>::const_iterator it = collections.begin(); it != collections.end(); ++it ) {
             const string& ns = *it;
 
+            if ( maxMigrations > 0 && candidateChunks->size() >= (unsigned) maxMigrations ) {
+                LOG(1) << "already have " << maxMigrations << " migrations for this round" << endl;
+                break;
+            }
+
             map< string,vector<BSONObj> > shardToChunksMap;
             cursor = conn.query(ChunkType::ConfigNS,
                                 QUERY(ChunkType::ns(ns)).sort(ChunkType::min()));
@@ -265,6 +569,8 @@ namespace mongo {
             }
             cursor.reset();
 
+            BSONObjBuilder collExplain;
+
             if (shardToChunksMap.empty()) {
                 LOG(1) << "skipping empty collection (" << ns << ")";
                 continue;
@@ -327,6 +633,12 @@ namespace mongo {
 
                 didAnySplits = true;
 
+                if ( explain ) {
+                    collExplain.append( "reason", "tagSplit" );
+                    collExplain.append( "splitAt", min );
+                    break;
+                }
+
                 log() << "ns: " << ns << " need to split on "
                       << min << " because there is a range there" << endl;
 
@@ -347,14 +659,65 @@ namespace mongo {
 
             if ( didAnySplits ) {
                 // state change, just wait till next round
+                if ( explain )
+                    explain->append( ns, collExplain.obj() );
                 continue;
             }
 
-            CandidateChunk* p = _policy->balance( ns, status, _balancedLastTime );
-            if ( p ) candidateChunks->push_back( CandidateChunkPtr( p ) );
+            if ( loadAware ) {
+                addChunkDataSizes( ns, cm->getShardKey().key(), shardToChunksMap, &status );
+                for ( vector<Shard>::const_iterator i = allShards.begin(); i != allShards.end(); ++i ) {
+                    status.setShardLoad( i->getName(), collectionLoad.get( i->getName(), ns ) );
+                }
+            }
+
+            for ( set<string>::const_iterator i = busyShards.begin(); i != busyShards.end(); ++i )
+                status.setShardBusy( *i );
+
+            // A dry run doesn't know how the balancer thread's last round went, so it uses the
+            // thresholds for a round after one that moved nothing.  It only explains the first
+            // decision for each collection.
+            while ( maxMigrations <= 0 || candidateChunks->size() < (unsigned) maxMigrations ) {
+                CandidateChunk* p = _policy->balance( ns, status, explain ? 0 : _balancedLastTime,
+                                                      explain ? &collExplain : NULL );
+                if ( ! p )
+                    break;
+
+                candidateChunks->push_back( CandidateChunkPtr( p ) );
+                if ( explain )
+                    break;
+
+                busyShards.insert( p->from );
+                busyShards.insert( p->to );
+                status.setShardBusy( p->from );
+                status.setShardBusy( p->to );
+            }
+            if ( explain )
+                explain->append( ns, collExplain.obj() );
         }
     }
 
+    void Balancer::dryRun( const string& ns, const string& policy, BSONObjBuilder& result ) {
+        scoped_ptr<ScopedDbConnection> conn(
+                ScopedDbConnection::getInternalScopedDbConnection(
+                        configServer.getPrimary().getConnString(), 30));
+
+        string p = policy;
+        if ( p.empty() ) {
+            BSONObj balancerConfig = conn->get()->findOne( SettingsType::ConfigNS,
+                                                           BSON( SettingsType::key( "balancer" ) ) );
+            p = balancerConfig[SettingsType::balancerPolicy()].str();
+        }
+        result.append( "policy", p.empty() ? SettingsType::balancerPolicy.getDefault() : p );
+
+        vector<CandidateChunkPtr> candidateChunks;
+        BSONObjBuilder collections( result.subobjStart( "collections" ) );
+        _doBalanceRound( conn->conn(), p, 0, ns, &candidateChunks, &collections );
+        collections.done();
+
+        conn->done();
+    }
+
     bool Balancer::_init() {
         try {
 
@@ -468,7 +831,12 @@ namespace mongo {
                     LOG(1) << "*** start balancing round" << endl;
 
                     vector<CandidateChunkPtr> candidateChunks;
-                    _doBalanceRound( conn.conn() , &candidateChunks );
+                    _doBalanceRound( conn.conn(),
+                                     balancerConfig[SettingsType::balancerPolicy()].str(),
+                                     balancerConfig[SettingsType::maxConcurrentMigrations()].numberInt(),
+                                     "",
+                                     &candidateChunks,
+                                     NULL );
                     if ( candidateChunks.size() == 0 ) {
                         LOG(1) << "no need to move any chunk" << endl;
                         _balancedLastTime = 0;
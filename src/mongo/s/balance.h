@@ -24,6 +24,7 @@
 #include "mongo/client/dbclientinterface.h"
 #include "mongo/s/balancer_policy.h"
 #include "mongo/util/background.h"
+#include "mongo/util/concurrency/mutex.h"
 
 namespace mongo {
 
@@ -33,8 +34,12 @@ namespace mongo {
      * uses a 'DistributedLock' for that coordination.
      *
      * The balancer does act continuously but in "rounds". At a given round, it would decide if there is an imbalance by
-     * checking the difference in chunks between the most and least loaded shards. It would issue a request for a chunk
-     * migration per round, if it found so.
+     * checking the difference in chunks between the most and least loaded shards. It would issue requests for chunk
+     * migrations, if it found so. Migrations of a round run at the same time, as long as each shard takes part in at
+     * most one of them, and at most "maxConcurrentMigrations" from the balancer settings, if set.
+     *
+     * With the "load" policy in the balancer settings, it evens out the shards' data size and
+     * load on each collection instead of their number of chunks.
      */
     class Balancer : public BackgroundJob {
     public:
@@ -47,6 +52,20 @@ namespace mongo {
 
         virtual string name() const { return "Balancer"; }
 
+        /**
+         * Runs the balancing policy over the collections as a balancing round would, but moves
+         * and splits nothing, and explains what it would do for each collection in 'result'.
+         *
+         * @param ns only look at this collection, if not empty
+         * @param policy "chunkCount" or "load", or empty for the one in the balancer settings
+         */
+        void dryRun( const string& ns, const string& policy, BSONObjBuilder& result );
+
+        /**
+         * Appends the migrations in flight, with their progress, and totals of past migrations.
+         */
+        void appendMigrationStatus( BSONObjBuilder& b ) const;
+
     private:
         typedef MigrateInfo CandidateChunk;
         typedef shared_ptr<CandidateChunk> CandidateChunkPtr;
@@ -62,6 +81,28 @@ namespace mongo {
 
         // decide which chunks to move; owned here.
         scoped_ptr<BalancerPolicy> _policy;
+
+        struct InFlightMigration {
+            InFlightMigration( const CandidateChunkPtr& c )
+                : chunk( c ), startMillis( curTimeMillis64() ), cloned( 0 ), clonedBytes( 0 ) {}
+
+            CandidateChunkPtr chunk;
+            unsigned long long startMillis;
+
+            // as last reported by the TO-shard
+            long long cloned;
+            long long clonedBytes;
+        };
+
+        // guards the migration status below, which _moveChunks updates and serverStatus reads
+        mutable mongo::mutex _statusMutex;
+        vector<InFlightMigration> _inFlight;
+        long long _migrationsStarted;
+        long long _migrationsSucceeded;
+        long long _migrationsFailed;
+        int _lastRoundMigrations;
+        unsigned long long _lastRoundMillis;
+        long long _lastRoundBytes;
         
         /**
          * Checks that the balancer can connect to all servers it needs to do its job.
@@ -77,18 +118,41 @@ namespace mongo {
          * be moved.
          *
          * @param conn is the connection with the config server(s)
-         * @param candidateChunks (IN/OUT) filled with candidate chunks, one per collection, that could possibly be moved
+         * @param policy is "load" to balance data size and load, otherwise chunk counts
+         * @param maxMigrations is the most candidate chunks to pick, 0 for no limit
+         * @param onlyNs if not empty, is the only collection to look at
+         * @param candidateChunks (IN/OUT) filled with candidate chunks that could possibly be moved at the same time,
+         *        no two of them from or to the same shard
+         * @param explain if not NULL, nothing is split and each collection's first decision is explained
          */
-        void _doBalanceRound( DBClientBase& conn, vector<CandidateChunkPtr>* candidateChunks );
+        void _doBalanceRound( DBClientBase& conn,
+                              const string& policy,
+                              int maxMigrations,
+                              const string& onlyNs,
+                              vector<CandidateChunkPtr>* candidateChunks,
+                              BSONObjBuilder* explain );
 
         /**
-         * Issues chunk migration request, one at a time.
+         * Issues the chunk migration requests, each on its own thread, and waits for all of them. Meanwhile it
+         * follows their progress on the TO-shards.
          *
          * @param candidateChunks possible chunks to move
          * @return number of chunks effectively moved
          */
         int _moveChunks( const vector<CandidateChunkPtr>* candidateChunks );
 
+        /**
+         * Issues one chunk migration request and waits for it.
+         *
+         * @param movedCount set to 1 if the chunk moved, or should be considered moved, 0 otherwise
+         */
+        void _moveChunk( const CandidateChunk& chunkInfo, int* movedCount );
+
+        /**
+         * Asks the TO-shard of a migration in flight how far along it is.
+         */
+        void _pollMigration( const CandidateChunkPtr& chunk );
+
         /**
          * Marks this balancer as being live on the config server(s).
          *
@@ -24,6 +24,7 @@
 #include "mongo/util/text.h"
 
 #include <algorithm>
+#include <cmath>
 
 namespace mongo {
 
@@ -92,6 +93,11 @@ namespace mongo {
                 LOG(1) << i->first << " has writebacks queued." << endl;
                 continue;
             }
+
+            if ( isShardBusy( i->first ) ) {
+                LOG(1) << i->first << " is already in a migration." << endl;
+                continue;
+            }
             
             if ( ! i->second.hasTag( tag ) ) {
                 LOG(1) << i->first << " doesn't have right tag" << endl;
@@ -121,6 +127,9 @@ namespace mongo {
                 // we can't move stuff off anyway
                 continue;
             }
+
+            if ( isShardBusy( i->first ) )
+                continue;
             
             unsigned myChunks = numberOfChunksInShardWithTag( i->first, tag );
             if ( myChunks <= maxChunks )
@@ -134,6 +143,64 @@ namespace mongo {
     }
     
 
+    void DistributionStatus::setShardBusy( const string& shard ) {
+        _busyShards.insert( shard );
+    }
+
+    bool DistributionStatus::isShardBusy( const string& shard ) const {
+        return _busyShards.count( shard ) > 0;
+    }
+
+    void DistributionStatus::setChunkDataSize( const BSONObj& chunkMin, long long bytes ) {
+        _chunkDataSizes[chunkMin.getOwned()] = bytes;
+    }
+
+    void DistributionStatus::setShardLoad( const string& shard, const ShardLoad& load ) {
+        _shardLoads[shard] = load;
+    }
+
+    bool DistributionStatus::hasChunkDataSizes() const {
+        if ( _chunkDataSizes.empty() )
+            return false;
+
+        for ( ShardToChunksMap::const_iterator i = _shardChunks.begin(); i != _shardChunks.end(); ++i ) {
+            for ( unsigned j = 0; j < i->second.size(); j++ ) {
+                if ( _chunkDataSizes.count( i->second[j][ChunkType::min()].Obj() ) == 0 )
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    long long DistributionStatus::chunkDataSize( const BSONObj& chunk ) const {
+        map<BSONObj,long long>::const_iterator i =
+            _chunkDataSizes.find( chunk[ChunkType::min()].Obj() );
+        if ( i == _chunkDataSizes.end() )
+            return 0;
+        return i->second;
+    }
+
+    long long DistributionStatus::dataSizeOfShardWithTag( const string& shard,
+                                                          const string& tag ) const {
+        ShardToChunksMap::const_iterator i = _shardChunks.find( shard );
+        if ( i == _shardChunks.end() )
+            return 0;
+
+        long long total = 0;
+        for ( unsigned j = 0; j < i->second.size(); j++ )
+            if ( tag == getTagForChunk( i->second[j] ) )
+                total += chunkDataSize( i->second[j] );
+
+        return total;
+    }
+
+    ShardLoad DistributionStatus::shardLoad( const string& shard ) const {
+        map<string,ShardLoad>::const_iterator i = _shardLoads.find( shard );
+        if ( i == _shardLoads.end() )
+            return ShardLoad();
+        return i->second;
+    }
+
     const vector<BSONObj>& DistributionStatus::getChunks( const string& shard ) const { 
         ShardToChunksMap::const_iterator i = _shardChunks.find(shard);
         verify( i != _shardChunks.end() );
@@ -221,9 +288,26 @@ namespace mongo {
         }
         return false;
     }
+
+    static BSONObj chunkBounds( const BSONObj& chunk ) {
+        return BSON( ChunkType::min( chunk[ChunkType::min()].Obj() ) <<
+                     ChunkType::max( chunk[ChunkType::max()].Obj() ) );
+    }
+
+    static void explainMove( BSONObjBuilder* explain, const string& reason,
+                             const string& from, const string& to, const BSONObj& chunk ) {
+        if ( ! explain )
+            return;
+        explain->append( "reason", reason );
+        explain->append( "from", from );
+        explain->append( "to", to );
+        explain->append( "chunk", chunkBounds( chunk ) );
+    }
+
     MigrateInfo* BalancerPolicy::balance( const string& ns,
                                           const DistributionStatus& distribution, 
-                                          int balancedLastTime ) {
+                                          int balancedLastTime,
+                                          BSONObjBuilder* explain ) {
 
 
         // 1) check for shards that policy require to us to move off of:
@@ -245,6 +329,9 @@ namespace mongo {
                 
                 if ( distribution.numberOfChunksInShard( shard ) == 0 )
                     continue;
+
+                if ( distribution.isShardBusy( shard ) )
+                    continue;
                 
                 // now we know we need to move to chunks off this shard
                 // we will if we are allowed
@@ -276,6 +363,7 @@ namespace mongo {
                 
                     log() << "going to move " << chunkToMove << " from " << shard << "(" << tag << ")" << " to " << to << endl;
                 
+                    explainMove( explain, "draining", shard, to, chunkToMove );
                     return new MigrateInfo( ns, to, shard, chunkToMove.getOwned() );
                 }
 
@@ -294,6 +382,9 @@ namespace mongo {
             for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
                 string shard = *i;
                 const ShardInfo& info = distribution.shardInfo( shard );
+
+                if ( distribution.isShardBusy( shard ) )
+                    continue;
                 
                 const vector<BSONObj>& chunks = distribution.getChunks( shard );
                 for ( unsigned j = 0; j < chunks.size(); j++ ) {
@@ -319,6 +410,7 @@ namespace mongo {
                     }
                     verify( to != shard );
                     log() << " going to move to: " << to << endl;
+                    explainMove( explain, "tagViolation", shard, to, chunks[j] );
                     return new MigrateInfo( ns, to, shard, chunks[j].getOwned() );
                 }
             }
@@ -344,9 +436,38 @@ namespace mongo {
             std::random_shuffle( tags.begin(), tags.end() );
         }
 
+        const bool haveDataSizes = distribution.hasChunkDataSizes();
+        BSONArrayBuilder tagExplains;
+
         for ( unsigned i=0; i<tags.size(); i++ ) {
             string tag = tags[i];
 
+            // Balance on data size and load when we know them, and there is some data.  Until
+            // then, even out the chunk counts so pre-split collections still spread out.
+            if ( haveDataSizes ) {
+                long long tagDataSize = 0;
+                for ( set<string>::const_iterator j = distribution.shards().begin();
+                      j != distribution.shards().end();
+                      ++j )
+                    tagDataSize += distribution.dataSizeOfShardWithTag( *j, tag );
+
+                if ( tagDataSize > 0 ) {
+                    BSONObjBuilder tagExplain;
+                    MigrateInfo* m = _balanceLoad( ns, distribution, tag, balancedLastTime,
+                                                   explain ? &tagExplain : NULL );
+                    if ( explain )
+                        tagExplains.append( tagExplain.obj() );
+                    if ( m ) {
+                        if ( explain ) {
+                            explain->append( "reason", "load" );
+                            explain->append( "tags", tagExplains.arr() );
+                        }
+                        return m;
+                    }
+                    continue;
+                }
+            }
+
             string from = distribution.getMostOverloadedShard( tag );
             if ( from.size() == 0 )
                 continue;
@@ -358,6 +479,11 @@ namespace mongo {
             string to = distribution.getBestReceieverShard( tag );
             if ( to.size() == 0 ) {
                 log() << "no available shards to take chunks for tag [" << tag << "]" << endl;
+                if ( explain ) {
+                    explain->append( "reason", "noReceiver" );
+                    explain->append( "tag", tag );
+                    explain->append( "tags", tagExplains.arr() );
+                }
                 return NULL;
             }
             
@@ -371,6 +497,14 @@ namespace mongo {
             LOG(1) << "receiver   : " << to << " chunks on " << min << endl;
             LOG(1) << "threshold  : " << threshold << endl;
 
+            if ( explain ) {
+                tagExplains.append( BSON( "tag" << tag <<
+                                          "policy" << "chunkCount" <<
+                                          "from" << from << "fromChunks" << max <<
+                                          "to" << to << "toChunks" << min <<
+                                          "threshold" << threshold ) );
+            }
+
             if ( imbalance < threshold )
                 continue;
 
@@ -388,6 +522,10 @@ namespace mongo {
                 log() << " ns: " << ns << " going to move " << chunks[j]
                       << " from: " << from << " to: " << to << " tag [" << tag << "]"
                       << endl;
+                if ( explain ) {
+                    explainMove( explain, "chunkCount", from, to, chunks[j] );
+                    explain->append( "tags", tagExplains.arr() );
+                }
                 return new MigrateInfo( ns, to, from, chunks[j] );
             }
 
@@ -403,9 +541,193 @@ namespace mongo {
         }
 
         // Everything is balanced here!        
+        if ( explain ) {
+            explain->append( "reason", "balanced" );
+            explain->append( "tags", tagExplains.arr() );
+        }
         return NULL;
     }
 
+    MigrateInfo* BalancerPolicy::_balanceLoad( const string& ns,
+                                               const DistributionStatus& distribution,
+                                               const string& tag,
+                                               int balancedLastTime,
+                                               BSONObjBuilder* explain ) {
+        const set<string>& shards = distribution.shards();
+
+        // Sizes and loads of this tag's chunks per shard.  A shard's load is split between
+        // tags in proportion to their data on it.
+        map<string,long long> sizes;
+        map<string,double> busy;
+        long long totalSize = 0;
+        double totalBusy = 0;
+        unsigned participants = 0;
+        for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+            const ShardInfo& info = distribution.shardInfo( *i );
+            const long long size = distribution.dataSizeOfShardWithTag( *i, tag );
+
+            long long shardSize = 0;
+            const vector<BSONObj>& chunks = distribution.getChunks( *i );
+            for ( unsigned j = 0; j < chunks.size(); j++ )
+                shardSize += distribution.chunkDataSize( chunks[j] );
+
+            sizes[*i] = size;
+            busy[*i] = shardSize > 0
+                       ? distribution.shardLoad( *i ).busyMicrosPerSec * size / shardSize
+                       : 0;
+            totalSize += size;
+            totalBusy += busy[*i];
+
+            if ( info.hasTag( tag ) && ! info.isDraining() )
+                participants++;
+        }
+
+        if ( participants == 0 )
+            return NULL;
+
+        const double meanSize = (double) totalSize / participants;
+        const double meanBusy = totalBusy / participants;
+        const int terms = ( meanSize > 0 ? 1 : 0 ) + ( meanBusy > 0 ? 1 : 0 );
+        verify( terms > 0 ); // the caller checked there is data
+
+        map<string,double> costs;
+        for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+            double cost = 0;
+            if ( meanSize > 0 )
+                cost += sizes[*i] / meanSize;
+            if ( meanBusy > 0 )
+                cost += busy[*i] / meanBusy;
+            costs[*i] = cost / terms;
+        }
+
+        // The donor is the costliest shard we can move chunks off of, the receiver the
+        // cheapest one that could take them.
+        string from;
+        string to;
+        for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+            const ShardInfo& info = distribution.shardInfo( *i );
+            if ( info.hasOpsQueued() || ! info.hasTag( tag ) || info.isDraining() )
+                continue;
+
+            if ( distribution.isShardBusy( *i ) )
+                continue;
+
+            if ( from.empty() || costs[*i] > costs[from] )
+                from = *i;
+
+            if ( info.isSizeMaxed() )
+                continue;
+
+            if ( to.empty() || costs[*i] < costs[to] )
+                to = *i;
+        }
+
+        const double threshold = balancedLastTime ? 0.1 : 0.2;
+
+        if ( explain ) {
+            explain->append( "tag", tag );
+            explain->append( "policy", "load" );
+            explain->append( "threshold", threshold );
+            explain->append( "meanDataSize", meanSize );
+            explain->append( "meanBusyMicrosPerSec", meanBusy );
+
+            BSONObjBuilder sb( explain->subobjStart( "shards" ) );
+            for ( set<string>::const_iterator i = shards.begin(); i != shards.end(); ++i ) {
+                const ShardLoad load = distribution.shardLoad( *i );
+                BSONObjBuilder b( sb.subobjStart( *i ) );
+                b.append( "chunks", distribution.numberOfChunksInShardWithTag( *i, tag ) );
+                b.appendNumber( "dataSize", sizes[*i] );
+                b.append( "opsPerSec", load.opsPerSec );
+                b.append( "busyMicrosPerSec", busy[*i] );
+                b.append( "cost", costs[*i] );
+                b.done();
+            }
+            sb.done();
+        }
+
+        if ( from.empty() || to.empty() || from == to )
+            return NULL;
+
+        const double gap = costs[from] - costs[to];
+
+        LOG(1) << "collection : " << ns << " tag [" << tag << "]" << endl;
+        LOG(1) << "donor      : " << from << " cost " << costs[from] << endl;
+        LOG(1) << "receiver   : " << to << " cost " << costs[to] << endl;
+        LOG(1) << "threshold  : " << threshold << endl;
+
+        if ( explain ) {
+            explain->append( "from", from );
+            explain->append( "to", to );
+        }
+
+        if ( gap < threshold ) {
+            if ( explain )
+                explain->append( "result", "balanced" );
+            return NULL;
+        }
+
+        // Cost of a chunk per byte, when on the donor.
+        double costPerByte = 0;
+        if ( meanSize > 0 )
+            costPerByte += 1 / meanSize;
+        if ( meanBusy > 0 && sizes[from] > 0 )
+            costPerByte += busy[from] / sizes[from] / meanBusy;
+        costPerByte /= terms;
+
+        // Moving a chunk costing c leaves a gap of |gap - 2c|; take the chunk that leaves the
+        // smallest, if it is smaller than what we have.
+        const vector<BSONObj>& chunks = distribution.getChunks( from );
+        int best = -1;
+        double bestCost = 0;
+        unsigned numJumboChunks = 0;
+        for ( unsigned j = 0; j < chunks.size(); j++ ) {
+            if ( distribution.getTagForChunk( chunks[j] ) != tag )
+                continue;
+
+            if ( _isJumbo( chunks[j] ) ) {
+                numJumboChunks++;
+                continue;
+            }
+
+            const double c = distribution.chunkDataSize( chunks[j] ) * costPerByte;
+            if ( c <= 0 || c >= gap )
+                continue;
+
+            if ( best < 0 || fabs( gap - 2 * c ) < fabs( gap - 2 * bestCost ) ) {
+                best = j;
+                bestCost = c;
+            }
+        }
+
+        if ( best < 0 ) {
+            LOG(1) << "no chunk on " << from << " evens out the load of " << ns
+                   << " numJumboChunks: " << numJumboChunks << endl;
+            if ( explain ) {
+                explain->append( "result", "no chunk improves the balance" );
+                explain->append( "numJumboChunks", numJumboChunks );
+            }
+            return NULL;
+        }
+
+        const BSONObj& chunk = chunks[best];
+        log() << " ns: " << ns << " going to move " << chunk
+              << " from: " << from << " (cost " << costs[from] << ")"
+              << " to: " << to << " (cost " << costs[to] << ")"
+              << " tag [" << tag << "]" << endl;
+
+        if ( explain ) {
+            BSONObjBuilder cb( explain->subobjStart( "chunk" ) );
+            cb.appendElements( chunkBounds( chunk ) );
+            cb.appendNumber( "dataSize", distribution.chunkDataSize( chunk ) );
+            cb.append( "cost", bestCost );
+            cb.done();
+            explain->append( "costsAfter", BSON( "from" << costs[from] - bestCost <<
+                                                 "to" << costs[to] + bestCost ) );
+        }
+
+        return new MigrateInfo( ns, to, from, chunk );
+    }
+
 
     ShardInfo::ShardInfo( long long maxSize, long long currSize,
                           bool draining, bool opsQueued,
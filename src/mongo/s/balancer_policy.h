@@ -113,6 +113,20 @@ namespace mongo {
 
     };
 
+    /**
+     * How busy a shard is with one collection, from the difference between two samples of the
+     * shard's per-collection usage counters (the top command).
+     */
+    struct ShardLoad {
+        ShardLoad() : opsPerSec(0), busyMicrosPerSec(0) {}
+
+        double opsPerSec;
+
+        // microseconds spent in operations on the collection per second, that is the op rate
+        // times the mean latency
+        double busyMicrosPerSec;
+    };
+
     typedef map< string,ShardInfo > ShardInfoMap;
     typedef map< string,vector<BSONObj> > ShardToChunksMap;
 
@@ -168,6 +182,33 @@ namespace mongo {
 
         /** @return the ShardInfo for the shard */
         const ShardInfo& shardInfo( const string& shard ) const;
+
+        // ---- data size and load, only filled in for the load balancing policy
+
+        /** sets the estimated data size in bytes of the chunk starting at chunkMin */
+        void setChunkDataSize( const BSONObj& chunkMin, long long bytes );
+
+        /** sets the shard's recent load on the collection */
+        void setShardLoad( const string& shard, const ShardLoad& load );
+
+        /** @return true if every chunk has a data size, which selects the load policy */
+        bool hasChunkDataSizes() const;
+
+        /** @return estimated data size of the chunk in bytes, 0 if unknown */
+        long long chunkDataSize( const BSONObj& chunk ) const;
+
+        /** @return estimated data size of this shard's chunks with the given tag */
+        long long dataSizeOfShardWithTag( const string& shard, const string& tag ) const;
+
+        /** @return the shard's load, all zero if unknown */
+        ShardLoad shardLoad( const string& shard ) const;
+
+        // ---- shards already in a migration this round
+
+        /** the shard won't be picked to give or take a chunk */
+        void setShardBusy( const string& shard );
+
+        bool isShardBusy( const string& shard ) const;
         
         /** writes all state to log() */
         void dump() const;
@@ -178,6 +219,9 @@ namespace mongo {
         map<BSONObj,TagRange> _tagRanges;
         set<string> _allTags;
         set<string> _shards;
+        map<BSONObj,long long> _chunkDataSizes;
+        map<string,ShardLoad> _shardLoads;
+        set<string> _busyShards;
     };
 
     class BalancerPolicy {
@@ -190,16 +234,40 @@ namespace mongo {
          *
          * @param ns is the collections namepace.
          * @param DistributionStatus holds all the info about the current state of the cluster/namespace
+         * If the distribution has data sizes for all chunks, shards are balanced on their data
+         * size and load instead of their number of chunks, see _balanceLoad().
+         *
+         * Shards marked busy in the distribution are neither donors nor receivers, so calling
+         * this again after marking the shards of each move busy gives moves that can run at the
+         * same time.
+         *
          * @param balancedLastTime is the number of chunks effectively moved in the last round.
+         * @param explain if not NULL, gets the reasons for the decision
          * @returns NULL or MigrateInfo of the best move to make towards balacing the collection.
          *          caller owns the MigrateInfo instance
          */
         static MigrateInfo* balance( const string& ns,
                                      const DistributionStatus& distribution,
-                                     int balancedLastTime );
+                                     int balancedLastTime,
+                                     BSONObjBuilder* explain = NULL );
 
     private:
         static bool _isJumbo( const BSONObj& chunk );
+
+        /**
+         * Balances one tag's chunks on cost: a shard's data size over the mean plus its load
+         * over the mean, halved when both are known, so a balanced shard costs 1.  A chunk's
+         * load is taken to be its share of the shard's data.  Picks the move from the costliest
+         * shard to the cheapest that best evens out the two, if they differ by more than the
+         * threshold.
+         *
+         * @return NULL if the tag is balanced, or no chunk makes it more so
+         */
+        static MigrateInfo* _balanceLoad( const string& ns,
+                                          const DistributionStatus& distribution,
+                                          const string& tag,
+                                          int balancedLastTime,
+                                          BSONObjBuilder* explain );
     };
 
 
@@ -542,5 +542,131 @@ namespace mongo {
                 }
             }
         }
+
+        // Two chunks on each of two shards, [0, 10) and [10, 20) on shard0, [20, 30) and
+        // [30, 40) on shard1.
+        static void twoChunksEach( ShardToChunksMap* chunkMap, ShardInfoMap* info ) {
+            for ( int i = 0; i < 4; i++ ) {
+                (*chunkMap)[ i < 2 ? "shard0" : "shard1" ].push_back(
+                    BSON(ChunkType::min(BSON("x" << i * 10)) <<
+                         ChunkType::max(BSON("x" << i * 10 + 10))) );
+            }
+            (*info)["shard0"] = ShardInfo( 0, 0, false, false );
+            (*info)["shard1"] = ShardInfo( 0, 0, false, false );
+        }
+
+        TEST( BalancerPolicyTests , LoadBalanceDataSize ) {
+            ShardToChunksMap chunkMap;
+            ShardInfoMap info;
+            twoChunksEach( &chunkMap, &info );
+
+            DistributionStatus status( info, chunkMap );
+            status.setChunkDataSize( BSON( "x" << 0 ), 100 );
+            status.setChunkDataSize( BSON( "x" << 10 ), 100 );
+            status.setChunkDataSize( BSON( "x" << 20 ), 10 );
+            status.setChunkDataSize( BSON( "x" << 30 ), 10 );
+            ASSERT( status.hasChunkDataSizes() );
+            ASSERT_EQUALS( 200, status.dataSizeOfShardWithTag( "shard0", "" ) );
+
+            BSONObjBuilder explain;
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balance( "ns", status, 0, &explain ) );
+            ASSERT( m );
+            ASSERT_EQUALS( "shard0", m->from );
+            ASSERT_EQUALS( "shard1", m->to );
+            ASSERT_EQUALS( "load", explain.obj()["reason"].str() );
+        }
+
+        TEST( BalancerPolicyTests , LoadBalanceBusy ) {
+            // Same data everywhere, but shard0 is much busier.
+            ShardToChunksMap chunkMap;
+            ShardInfoMap info;
+            twoChunksEach( &chunkMap, &info );
+
+            DistributionStatus status( info, chunkMap );
+            for ( int i = 0; i < 4; i++ )
+                status.setChunkDataSize( BSON( "x" << i * 10 ), 50 );
+            ShardLoad busy;
+            busy.busyMicrosPerSec = 900000;
+            status.setShardLoad( "shard0", busy );
+            busy.busyMicrosPerSec = 100000;
+            status.setShardLoad( "shard1", busy );
+
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balance( "ns", status, 0 ) );
+            ASSERT( m );
+            ASSERT_EQUALS( "shard0", m->from );
+            ASSERT_EQUALS( "shard1", m->to );
+        }
+
+        TEST( BalancerPolicyTests , LoadBalanced ) {
+            ShardToChunksMap chunkMap;
+            ShardInfoMap info;
+            twoChunksEach( &chunkMap, &info );
+
+            DistributionStatus status( info, chunkMap );
+            status.setChunkDataSize( BSON( "x" << 0 ), 100 );
+            status.setChunkDataSize( BSON( "x" << 10 ), 100 );
+            status.setChunkDataSize( BSON( "x" << 20 ), 95 );
+            status.setChunkDataSize( BSON( "x" << 30 ), 100 );
+
+            BSONObjBuilder explain;
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balance( "ns", status, 0, &explain ) );
+            ASSERT( ! m );
+            ASSERT_EQUALS( "balanced", explain.obj()["reason"].str() );
+        }
+
+        TEST( BalancerPolicyTests , LoadWithoutDataBalancesChunkCounts ) {
+            ShardToChunksMap chunkMap;
+            ShardInfoMap info;
+            twoChunksEach( &chunkMap, &info );
+            chunkMap["shard0"].insert( chunkMap["shard0"].end(),
+                                       chunkMap["shard1"].begin(), chunkMap["shard1"].end() );
+            chunkMap["shard1"].clear();
+
+            DistributionStatus status( info, chunkMap );
+            for ( int i = 0; i < 4; i++ )
+                status.setChunkDataSize( BSON( "x" << i * 10 ), 0 );
+
+            BSONObjBuilder explain;
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balance( "ns", status, 1, &explain ) );
+            ASSERT( m );
+            ASSERT_EQUALS( "shard1", m->to );
+            ASSERT_EQUALS( "chunkCount", explain.obj()["reason"].str() );
+        }
+
+        TEST( BalancerPolicyTests , BusyShardsGiveDisjointMoves ) {
+            // Two full shards and two empty ones: two moves can run at once.
+            ShardToChunksMap chunkMap;
+            ShardInfoMap info;
+            for ( int i = 0; i < 20; i++ ) {
+                chunkMap[ i < 10 ? "shard0" : "shard1" ].push_back(
+                    BSON(ChunkType::min(BSON("x" << i * 10)) <<
+                         ChunkType::max(BSON("x" << i * 10 + 10))) );
+            }
+            chunkMap["shard2"] = vector<BSONObj>();
+            chunkMap["shard3"] = vector<BSONObj>();
+            info["shard0"] = ShardInfo( 0, 0, false, false );
+            info["shard1"] = ShardInfo( 0, 0, false, false );
+            info["shard2"] = ShardInfo( 0, 0, false, false );
+            info["shard3"] = ShardInfo( 0, 0, false, false );
+
+            DistributionStatus status( info, chunkMap );
+            set<string> used;
+            for ( int i = 0; i < 2; i++ ) {
+                scoped_ptr<MigrateInfo> m( BalancerPolicy::balance( "ns", status, 1 ) );
+                ASSERT( m );
+                ASSERT( ! used.count( m->from ) );
+                ASSERT( ! used.count( m->to ) );
+                ASSERT( m->from == "shard0" || m->from == "shard1" );
+                ASSERT( m->to == "shard2" || m->to == "shard3" );
+                used.insert( m->from );
+                used.insert( m->to );
+                status.setShardBusy( m->from );
+                status.setShardBusy( m->to );
+            }
+
+            scoped_ptr<MigrateInfo> m( BalancerPolicy::balance( "ns", status, 1 ) );
+            ASSERT( ! m );
+        }
+
     }
 }
@@ -28,6 +28,7 @@
 #include "mongo/db/dbmessage.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/db/stats/counters.h"
+#include "mongo/s/balance.h"
 
 #include "mongo/s/chunk.h"
 #include "mongo/s/client_info.h"
@@ -1093,6 +1094,35 @@ namespace mongo {
             }
         } moveChunkCmd;
 
+        class BalancerDryRunCmd : public GridAdminCmd {
+        public:
+            BalancerDryRunCmd() : GridAdminCmd( "balancerDryRun" ) {}
+            virtual void help( stringstream& help ) const {
+                help << "shows which chunk the balancer would move next in each collection, and why,\n"
+                     << "without moving or splitting anything\n"
+                     << "  { balancerDryRun : 1 [ , ns : 'test.foo' ] [ , policy : 'load' ] }\n"
+                     << "policy is 'chunkCount' or 'load', by default the one in the balancer settings";
+            }
+            virtual void addRequiredPrivileges(const std::string& dbname,
+                                               const BSONObj& cmdObj,
+                                               std::vector<Privilege>* out) {
+                ActionSet actions;
+                actions.addAction(ActionType::listShards);
+                out->push_back(Privilege(AuthorizationManager::CLUSTER_RESOURCE_NAME, actions));
+            }
+            bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
+                const string ns = cmdObj["ns"].str();
+                const string policy = cmdObj["policy"].str();
+                if ( ! policy.empty() && policy != "chunkCount" && policy != "load" ) {
+                    errmsg = "policy must be 'chunkCount' or 'load'";
+                    return false;
+                }
+
+                balancer.dryRun( ns, policy, result );
+                return true;
+            }
+        } balancerDryRunCmd;
+
         // ------------ server level commands -------------
 
         class ListShardsCmd : public GridAdminCmd {
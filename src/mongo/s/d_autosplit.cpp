@@ -0,0 +1,352 @@
+// @file d_autosplit.cpp
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#include "mongo/pch.h"
+
+#include "mongo/s/d_autosplit.h"
+
+#include "mongo/client/connpool.h"
+#include "mongo/db/auth/authorization_manager.h"
+#include "mongo/db/client.h"
+#include "mongo/db/cmdline.h"
+#include "mongo/db/commands/server_status.h"
+#include "mongo/db/instance.h"
+#include "mongo/db/namespacestring.h"
+#include "mongo/db/server_parameters.h"
+#include "mongo/s/chunk.h" // for static genID and the default MaxChunkSize only
+#include "mongo/s/d_logic.h"
+#include "mongo/s/type_settings.h"
+#include "mongo/util/background.h"
+
+namespace mongo {
+
+    // When off, the autosplitter only finds split points and reports them in serverStatus.
+    MONGO_EXPORT_SERVER_PARAMETER(shardAutoSplit, bool, true);
+
+    // Check a chunk once this fraction of the max chunk size has been written to it, like mongos.
+    static const int splitTestFactor = 5;
+
+    // How many suggested splits serverStatus shows.
+    static const size_t maxSuggestions = 20;
+
+    ChunkWriteTracker chunkWrites;
+
+    ChunkWriteTracker::ChunkWriteTracker()
+        : _mutex( "ChunkWriteTracker" ),
+          _maxChunkSize( Chunk::MaxChunkSize ),
+          _checks(0), _splits(0), _skippedSplitVectors(0) {}
+
+    void ChunkWriteTracker::noteWrite( const StringData& ns , const BSONObj& doc , long long bytes ) {
+        const string nsStr = ns.toString();
+        if ( ! shardingState.needShardChunkManager( nsStr ) )
+            return;
+
+        ShardChunkManagerPtr manager = shardingState.getShardChunkManager( nsStr );
+        if ( ! manager )
+            return;
+
+        BSONObj min;
+        BSONObj max;
+        if ( ! manager->getChunkContaining( doc , &min , &max ) )
+            return;
+
+        scoped_lock lk( _mutex );
+        CollectionWrites& coll = _collections[nsStr];
+        if ( ! coll.version.isEquivalentTo( manager->getVersion() ) ) {
+            // Forget the chunks that were split or migrated away.
+            for ( ChunkWritesMap::iterator it = coll.chunks.begin(); it != coll.chunks.end(); ) {
+                BSONObj currMin;
+                BSONObj currMax;
+                if ( manager->getChunkContaining( it->first , &currMin , &currMax ) &&
+                     currMin.woCompare( it->first ) == 0 &&
+                     currMax.woCompare( it->second.max ) == 0 ) {
+                    ++it;
+                }
+                else {
+                    coll.chunks.erase( it++ );
+                }
+            }
+            coll.version = manager->getVersion();
+        }
+
+        ChunkWrites& chunk = coll.chunks[min];
+        if ( chunk.max.isEmpty() )
+            chunk.max = max;
+        chunk.bytes += bytes;
+
+        if ( ! chunk.queued && _maxChunkSize > 0 && chunk.bytes >= _maxChunkSize / splitTestFactor ) {
+            chunk.queued = true;
+            ChunkToCheck c;
+            c.ns = nsStr;
+            c.min = min;
+            c.max = max;
+            c.maxChunkSize = _maxChunkSize;
+            _toCheck.push( c );
+        }
+    }
+
+    bool ChunkWriteTracker::recentlyChecked( const string& ns , const BSONObj& min , const BSONObj& max ,
+                                             long long maxChunkSize ) {
+        scoped_lock lk( _mutex );
+        map<string,CollectionWrites>::const_iterator coll = _collections.find( ns );
+        if ( coll == _collections.end() )
+            return false;
+
+        ChunkWritesMap::const_iterator chunk = coll->second.chunks.find( min );
+        if ( chunk == coll->second.chunks.end() || chunk->second.max.woCompare( max ) != 0 )
+            return false;
+
+        // a smaller max chunk size can find split points the last check couldn't
+        if ( chunk->second.checkedSmall && ! chunk->second.queued &&
+             maxChunkSize >= chunk->second.checkedMaxChunkSize ) {
+            _skippedSplitVectors++;
+            return true;
+        }
+        return false;
+    }
+
+    bool ChunkWriteTracker::nextToCheck( ChunkToCheck* chunk ) {
+        return _toCheck.blockingPop( *chunk , 1 );
+    }
+
+    void ChunkWriteTracker::doneChecking( const ChunkToCheck& chunk , const vector<BSONObj>& splitKeys ,
+                                          bool split ) {
+        scoped_lock lk( _mutex );
+        _checks++;
+
+        CollectionWrites& coll = _collections[chunk.ns];
+        if ( split ) {
+            _splits++;
+            coll.chunks.erase( chunk.min );
+            return;
+        }
+
+        ChunkWritesMap::iterator it = coll.chunks.find( chunk.min );
+        if ( it != coll.chunks.end() ) {
+            it->second.bytes = 0;
+            it->second.queued = false;
+            it->second.checkedSmall = splitKeys.empty();
+            it->second.checkedMaxChunkSize = chunk.maxChunkSize;
+        }
+
+        if ( ! splitKeys.empty() ) {
+            Suggestion s;
+            s.chunk = chunk;
+            s.splitKeys = splitKeys;
+            s.when = jsTime();
+            _suggestions.push_front( s );
+            if ( _suggestions.size() > maxSuggestions )
+                _suggestions.pop_back();
+        }
+    }
+
+    void ChunkWriteTracker::setMaxChunkSize( long long bytes ) {
+        scoped_lock lk( _mutex );
+        _maxChunkSize = bytes;
+    }
+
+    long long ChunkWriteTracker::maxChunkSize() {
+        scoped_lock lk( _mutex );
+        return _maxChunkSize;
+    }
+
+    void ChunkWriteTracker::appendStats( BSONObjBuilder& b ) {
+        scoped_lock lk( _mutex );
+        b.appendBool( "enabled" , shardAutoSplit );
+        b.appendNumber( "maxChunkSize" , _maxChunkSize );
+
+        long long tracked = 0;
+        for ( map<string,CollectionWrites>::const_iterator it = _collections.begin(); it != _collections.end(); ++it )
+            tracked += it->second.chunks.size();
+        b.appendNumber( "trackedChunks" , tracked );
+        b.appendNumber( "queued" , (long long) _toCheck.size() );
+        b.appendNumber( "checks" , _checks );
+        b.appendNumber( "splits" , _splits );
+        b.appendNumber( "skippedSplitVectors" , _skippedSplitVectors );
+
+        BSONArrayBuilder sb( b.subarrayStart( "suggestedSplits" ) );
+        for ( deque<Suggestion>::const_iterator it = _suggestions.begin(); it != _suggestions.end(); ++it ) {
+            BSONObjBuilder s( sb.subobjStart() );
+            s.append( "ns" , it->chunk.ns );
+            s.append( "min" , it->chunk.min );
+            s.append( "max" , it->chunk.max );
+            s.append( "splitKeys" , it->splitKeys );
+            s.appendDate( "when" , it->when );
+            s.done();
+        }
+        sb.done();
+    }
+
+    class AutoSplitSSS : public ServerStatusSection {
+    public:
+        AutoSplitSSS() : ServerStatusSection( "autoSplit" ) {}
+        virtual bool includeByDefault() const { return true; }
+
+        BSONObj generateSection( const BSONElement& configElement ) const {
+            if ( ! shardingState.enabled() ) {
+                return BSONObj();
+            }
+            BSONObjBuilder b;
+            chunkWrites.appendStats( b );
+            return b.obj();
+        }
+    } autoSplitSection;
+
+    /**
+     * Checks the chunks the ChunkWriteTracker queues, and splits the ones that got too big.
+     */
+    class ChunkAutoSplitter : public BackgroundJob {
+    public:
+        ChunkAutoSplitter() : _lastSettingsRefresh(0) {}
+
+        virtual string name() const { return "ChunkAutoSplitter"; }
+
+        virtual void run() {
+            Client::initThread( name().c_str() );
+            if ( ! noauth ) {
+                ShardedConnectionInfo::addHook();
+                cc().getAuthorizationManager()->grantInternalAuthorization( "_chunkAutoSplitter" );
+            }
+
+            while ( ! inShutdown() ) {
+                if ( shardingState.enabled() ) {
+                    // Keep the size current even while idle, so chunks get queued at the right size.
+                    try {
+                        _refreshMaxChunkSize();
+                    }
+                    catch ( DBException& e ) {
+                        LOG(1) << "could not read the max chunk size from the config server" << causedBy( e ) << endl;
+                    }
+                }
+
+                ChunkWriteTracker::ChunkToCheck chunk;
+                if ( ! chunkWrites.nextToCheck( &chunk ) )
+                    continue;
+                // the size may have changed while the chunk was queued
+                chunk.maxChunkSize = chunkWrites.maxChunkSize();
+
+                vector<BSONObj> splitKeys;
+                bool split = false;
+                try {
+                    split = _check( chunk , &splitKeys );
+                }
+                catch ( DBException& e ) {
+                    warning() << "could not check chunk " << chunk.ns << " " << chunk.min << " -->> "
+                              << chunk.max << " for splitting" << causedBy( e ) << endl;
+                }
+                chunkWrites.doneChecking( chunk , splitKeys , split );
+            }
+
+            cc().shutdown();
+        }
+
+    private:
+        void _refreshMaxChunkSize() {
+            if ( curTimeMillis64() - _lastSettingsRefresh < 60 * 1000 )
+                return;
+            _lastSettingsRefresh = curTimeMillis64();
+
+            scoped_ptr<ScopedDbConnection> conn(
+                    ScopedDbConnection::getInternalScopedDbConnection( shardingState.getConfigServer() , 30 ) );
+            BSONObj settings = conn->get()->findOne( SettingsType::ConfigNS ,
+                                                     BSON( SettingsType::key( "chunksize" ) ) );
+            conn->done();
+
+            long long bytes = Chunk::MaxChunkSize;
+            if ( settings[SettingsType::chunksize()].isNumber() && settings[SettingsType::chunksize()].numberLong() > 0 )
+                bytes = settings[SettingsType::chunksize()].numberLong() * 1024 * 1024;
+            chunkWrites.setMaxChunkSize( bytes );
+        }
+
+        /**
+         * Finds split points for the chunk and splits it, if it is still on this shard.
+         *
+         * @return true if it split the chunk
+         */
+        bool _check( const ChunkWriteTracker::ChunkToCheck& chunk , vector<BSONObj>* splitKeys ) {
+            ShardChunkManagerPtr manager = shardingState.getShardChunkManager( chunk.ns );
+            BSONObj currMin;
+            BSONObj currMax;
+            if ( ! manager ||
+                 ! manager->getChunkContaining( chunk.min , &currMin , &currMax ) ||
+                 currMin.woCompare( chunk.min ) ||
+                 currMax.woCompare( chunk.max ) ) {
+                LOG(1) << "chunk " << chunk.ns << " " << chunk.min << " -->> " << chunk.max
+                       << " changed before it could be checked for splitting" << endl;
+                return false;
+            }
+
+            const BSONObj keyPattern = manager->getKey();
+
+            BSONObj res;
+            if ( ! _conn.runCommand( nsToDatabase( chunk.ns ) ,
+                                     BSON( "splitVector" << chunk.ns <<
+                                           "keyPattern" << keyPattern <<
+                                           "min" << chunk.min <<
+                                           "max" << chunk.max <<
+                                           "maxChunkSizeBytes" << chunk.maxChunkSize ) ,
+                                     res ) ) {
+                warning() << "could not find split points for chunk " << chunk.ns << " " << chunk.min
+                          << " -->> " << chunk.max << ": " << res << endl;
+                return false;
+            }
+
+            BSONObjIterator it( res.getObjectField( "splitKeys" ) );
+            while ( it.more() ) {
+                splitKeys->push_back( it.next().Obj().getOwned() );
+            }
+
+            if ( splitKeys->empty() || ! shardAutoSplit )
+                return false;
+
+            const string shardName = shardingState.getShardName();
+            if ( shardName.empty() )
+                return false;
+
+            res = BSONObj();
+            if ( ! _conn.runCommand( "admin" ,
+                                     BSON( "splitChunk" << chunk.ns <<
+                                           "keyPattern" << keyPattern <<
+                                           "min" << chunk.min <<
+                                           "max" << chunk.max <<
+                                           "from" << shardName <<
+                                           "splitKeys" << *splitKeys <<
+                                           "shardId" << Chunk::genID( chunk.ns , chunk.min ) <<
+                                           "configdb" << shardingState.getConfigServer() ) ,
+                                     res ) ) {
+                // The collection lock may be taken by a migration or another split.
+                LOG(1) << "could not autosplit chunk " << chunk.ns << " " << chunk.min << " -->> "
+                       << chunk.max << ": " << res << endl;
+                return false;
+            }
+
+            log() << "autosplit chunk " << chunk.ns << " " << chunk.min << " -->> " << chunk.max
+                  << " into " << splitKeys->size() + 1 << " chunks" << endl;
+            return true;
+        }
+
+        unsigned long long _lastSettingsRefresh;
+        DBDirectClient _conn;
+    };
+
+    void startChunkAutoSplitter() {
+        ChunkAutoSplitter* splitter = new ChunkAutoSplitter();
+        splitter->go();
+    }
+
+}  // namespace mongo
@@ -0,0 +1,126 @@
+// @file d_autosplit.h
+
+/**
+*    Copyright (C) 2014 Tokutek Inc.
+*
+*    This program is free software: you can redistribute it and/or  modify
+*    it under the terms of the GNU Affero General Public License, version 3,
+*    as published by the Free Software Foundation.
+*
+*    This program is distributed in the hope that it will be useful,
+*    but WITHOUT ANY WARRANTY; without even the implied warranty of
+*    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+*    GNU Affero General Public License for more details.
+*
+*    You should have received a copy of the GNU Affero General Public License
+*    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+*/
+
+#pragma once
+
+#include "mongo/pch.h"
+
+#include "mongo/db/jsobj.h"
+#include "mongo/s/chunk_version.h"
+#include "mongo/util/concurrency/mutex.h"
+#include "mongo/util/queue.h"
+
+namespace mongo {
+
+    /**
+     * Counts the bytes written through mongos to each chunk of this shard, so the shard can split
+     * its chunks as they grow instead of waiting for some mongos to guess that they might have.
+     *
+     * Once a fifth of the max chunk size has been written to a chunk, it is queued for the
+     * autosplitter thread, which looks for split points with splitVector (get_key_after_bytes on
+     * a clustering shard key) and splits the chunk itself, or only records the split points it
+     * would use if the shardAutoSplit parameter is off.
+     *
+     * The class is thread safe.
+     */
+    class ChunkWriteTracker : boost::noncopyable {
+    public:
+        struct ChunkToCheck {
+            string ns;
+            BSONObj min;
+            BSONObj max;
+            long long maxChunkSize;    // what the check looks for split points with
+        };
+
+        ChunkWriteTracker();
+
+        /**
+         * Charges 'bytes' to the chunk 'doc' is in, if ns is sharded and the current operation
+         * came through mongos.
+         */
+        void noteWrite( const StringData& ns , const BSONObj& doc , long long bytes );
+
+        /**
+         * @return true if the autosplitter found [min, max) too small to split at a max chunk size
+         *         no bigger than maxChunkSize, and not enough was written to it since for that
+         *         to have changed
+         */
+        bool recentlyChecked( const string& ns , const BSONObj& min , const BSONObj& max ,
+                              long long maxChunkSize );
+
+        /**
+         * Waits up to a second for a chunk to check.
+         */
+        bool nextToCheck( ChunkToCheck* chunk );
+
+        /**
+         * Records the outcome of checking a chunk.  Its count starts over.
+         *
+         * @param splitKeys where it should be split, empty if it is small enough
+         * @param split true if it was split at splitKeys
+         */
+        void doneChecking( const ChunkToCheck& chunk , const vector<BSONObj>& splitKeys , bool split );
+
+        /** sets the max chunk size, in bytes, from the cluster's settings */
+        void setMaxChunkSize( long long bytes );
+
+        long long maxChunkSize();
+
+        /** counters and the latest suggested splits, for serverStatus */
+        void appendStats( BSONObjBuilder& b );
+
+    private:
+        struct ChunkWrites {
+            ChunkWrites() : bytes(0), queued(false), checkedSmall(false), checkedMaxChunkSize(0) {}
+            BSONObj max;
+            long long bytes;       // written since the last check
+            bool queued;
+            bool checkedSmall;     // the last check found no split points
+            long long checkedMaxChunkSize;  // at this max chunk size
+        };
+        typedef map<BSONObj,ChunkWrites,BSONObjCmp> ChunkWritesMap;
+
+        struct CollectionWrites {
+            // version of the chunk manager the chunks below are from
+            ChunkVersion version;
+            ChunkWritesMap chunks;
+        };
+
+        struct Suggestion {
+            ChunkToCheck chunk;
+            vector<BSONObj> splitKeys;
+            Date_t when;
+        };
+
+        mongo::mutex _mutex;
+        map<string,CollectionWrites> _collections;
+        BlockingQueue<ChunkToCheck> _toCheck;
+        long long _maxChunkSize;
+
+        long long _checks;
+        long long _splits;
+        long long _skippedSplitVectors;
+        // most recent first, when splits are only suggested
+        deque<Suggestion> _suggestions;
+    };
+
+    extern ChunkWriteTracker chunkWrites;
+
+    void startChunkAutoSplitter();
+
+}  // namespace mongo
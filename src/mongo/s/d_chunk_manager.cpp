@@ -280,6 +280,33 @@ namespace mongo {
         return good;
     }
 
+    bool ShardChunkManager::getChunkContaining( const BSONObj& doc , BSONObj* foundMin , BSONObj* foundMax ) const {
+        verify( foundMin );
+        verify( foundMax );
+
+        if ( _chunksMap.empty() )
+            return false;
+
+        ShardKeyPattern shardKey( _key );
+        if ( ! shardKey.hasShardKey( doc ) )
+            return false;
+
+        KeyPattern pat( _key );
+        const BSONObj point = pat.extractSingleKey( doc );
+
+        RangeMap::const_iterator it = _chunksMap.upper_bound( point );
+        if ( it == _chunksMap.begin() )
+            return false;
+        it--;
+
+        if ( ! contains( it->first , it->second , point ) )
+            return false;
+
+        *foundMin = it->first;
+        *foundMax = it->second;
+        return true;
+    }
+
     bool ShardChunkManager::getNextChunk( const BSONObj& lookupKey, BSONObj* foundMin , BSONObj* foundMax ) const {
         verify( foundMin );
         verify( foundMax );
@@ -116,6 +116,16 @@ namespace mongo {
          * @return true if shards hold the object
          */
         bool belongsToMe( ClientCursor* cc ) const;
+
+        /**
+         * Finds the chunk of this shard that a document falls in.
+         *
+         * @param doc document containing the full shard key (and, optionally, other attributes)
+         * @param foundMin OUT min for the chunk
+         * @param foundMax OUT max for the chunk
+         * @return false if the document doesn't have the shard key or doesn't belong to this shard
+         */
+        bool getChunkContaining( const BSONObj& doc , BSONObj* foundMin , BSONObj* foundMax ) const;
         
         /**
          * Given a chunk's min key (or empty doc), gets the boundary of the chunk following that one (the first).
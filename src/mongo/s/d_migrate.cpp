@@ -822,6 +822,99 @@ namespace mongo {
         warning() << "moveChunk repl sync timed out after " << t.seconds() << " seconds" << migrateLog;
     }
 
+    /**
+     * Reads the collection's highest chunk version from the config server, and checks that
+     * [min, max) is still a chunk and still on fromShard.
+     *
+     * @return false, with errmsg and result filled in, if it isn't
+     */
+    static bool readChunkFromConfig( const string& ns, const BSONElement& shardId,
+                                     const BSONObj& min, const BSONObj& max,
+                                     const string& fromShard, ChunkVersion* maxVersion,
+                                     string& errmsg, BSONObjBuilder& result ) {
+        scoped_ptr<ScopedDbConnection> conn(
+                ScopedDbConnection::getInternalScopedDbConnection(
+                        shardingState.getConfigServer(), 30));
+
+        BSONObj x;
+        BSONObj currChunk;
+        try{
+            x = conn->get()->findOne(ChunkType::ConfigNS,
+                                     Query(BSON(ChunkType::ns(ns)))
+                                          .sort(BSON(ChunkType::DEPRECATED_lastmod() << -1)));
+
+            currChunk = conn->get()->findOne(ChunkType::ConfigNS,
+                                             shardId.wrap(ChunkType::name().c_str()));
+        }
+        catch( DBException& e ){
+            errmsg = str::stream() << "aborted moveChunk because could not get chunk data from config server " << shardingState.getConfigServer() << causedBy( e );
+            warning() << errmsg << endl;
+            return false;
+        }
+        conn->done();
+
+        if ( currChunk.isEmpty() ) {
+            errmsg = "chunk no longer exists (likely the collection was dropped)";
+            warning() << "aborted moveChunk because " << errmsg << ": " << min << "->" << max << migrateLog;
+            return false;
+        }
+
+        *maxVersion = ChunkVersion::fromBSON(x, ChunkType::DEPRECATED_lastmod());
+        verify(currChunk[ChunkType::shard()].type());
+        verify(currChunk[ChunkType::min()].type());
+        verify(currChunk[ChunkType::max()].type());
+        const string myOldShard = currChunk[ChunkType::shard()].String();
+
+        BSONObj currMin = currChunk[ChunkType::min()].Obj();
+        BSONObj currMax = currChunk[ChunkType::max()].Obj();
+        if ( currMin.woCompare( min ) || currMax.woCompare( max ) ) {
+            errmsg = "boundaries are outdated (likely a split occurred)";
+            result.append( "currMin" , currMin );
+            result.append( "currMax" , currMax );
+            result.append( "requestedMin" , min );
+            result.append( "requestedMax" , max );
+
+            warning() << "aborted moveChunk because" <<  errmsg << ": " << min << "->" << max
+                              << " is now " << currMin << "->" << currMax << migrateLog;
+            return false;
+        }
+
+        if ( myOldShard != fromShard ) {
+            errmsg = "location is outdated (likely balance or migrate occurred)";
+            result.append( "from" , fromShard );
+            result.append( "official" , myOldShard );
+
+            warning() << "aborted moveChunk because " << errmsg << ": chunk is at " << myOldShard
+                              << " and not at " << fromShard << migrateLog;
+            return false;
+        }
+
+        return true;
+    }
+
+    /**
+     * Name of the distributed lock held by a migration of ns from one shard to another.
+     */
+    static string migrationLockName( const string& ns, const string& from, const string& to ) {
+        return str::stream() << ns << "-migrate-" << from << "-" << to;
+    }
+
+    /**
+     * Tells the TO-shard to give up on a migration we are not going to commit.
+     */
+    static void abortRecipient( const Shard& toShard ) {
+        try {
+            scoped_ptr<ScopedDbConnection> connTo(
+                    ScopedDbConnection::getScopedDbConnection( toShard.getConnString() ) );
+            BSONObj res;
+            connTo->get()->runCommand( "admin", BSON( "_recvChunkAbort" << 1 ), res );
+            connTo->done();
+        }
+        catch( DBException& e ) {
+            warning() << "moveChunk could not tell " << toShard.getName() << " to abort" << causedBy( e ) << migrateLog;
+        }
+    }
+
     /**
      * this is the main entry for moveChunk
      * called to initial a move
@@ -855,12 +948,12 @@ namespace mongo {
 
         bool run(const string& , BSONObj& cmdObj, int, string& errmsg, BSONObjBuilder& result, bool) {
             // 1. parse options
-            // 2. make sure my view is complete and lock
+            // 2. make sure my view is complete and lock the shard pair
             // 3. start migrate
             //    in a read lock, get all primary keys and sort so we can do as little seeking as possible
             //    tell to start transferring
             // 4. pause till migrate caught up
-            // 5. LOCK
+            // 5. LOCK the collection, and check again
             //    a) update my config, essentially locking
             //    b) finish migrate
             //    c) update config server
@@ -951,7 +1044,11 @@ namespace mongo {
                 return false;
             }
 
-            DistributedLock lockSetup( ConnectionString( shardingState.getConfigServer() , ConnectionString::SYNC ) , ns );
+            // Migrations of a collection between different shards can copy their data at the same
+            // time, so until the commit we only lock this shard pair.  The collection lock that
+            // splits and drops take is held for the commit.
+            DistributedLock lockSetup( ConnectionString( shardingState.getConfigServer() , ConnectionString::SYNC ) ,
+                                       migrationLockName( ns, fromShard.getName(), toShard.getName() ) );
             dist_lock_try dlk;
 
             try{
@@ -973,56 +1070,9 @@ namespace mongo {
 
             ChunkVersion maxVersion;
             ChunkVersion startingVersion;
-            string myOldShard;
             {
-                scoped_ptr<ScopedDbConnection> conn(
-                        ScopedDbConnection::getInternalScopedDbConnection(
-                                shardingState.getConfigServer(), 30));
-
-                BSONObj x;
-                BSONObj currChunk;
-                try{
-                    x = conn->get()->findOne(ChunkType::ConfigNS,
-                                             Query(BSON(ChunkType::ns(ns)))
-                                                  .sort(BSON(ChunkType::DEPRECATED_lastmod() << -1)));
-
-                    currChunk = conn->get()->findOne(ChunkType::ConfigNS,
-                                                     shardId.wrap(ChunkType::name().c_str()));
-                }
-                catch( DBException& e ){
-                    errmsg = str::stream() << "aborted moveChunk because could not get chunk data from config server " << shardingState.getConfigServer() << causedBy( e );
-                    warning() << errmsg << endl;
-                    return false;
-                }
-
-                maxVersion = ChunkVersion::fromBSON(x, ChunkType::DEPRECATED_lastmod());
-                verify(currChunk[ChunkType::shard()].type());
-                verify(currChunk[ChunkType::min()].type());
-                verify(currChunk[ChunkType::max()].type());
-                myOldShard = currChunk[ChunkType::shard()].String();
-                conn->done();
-
-                BSONObj currMin = currChunk[ChunkType::min()].Obj();
-                BSONObj currMax = currChunk[ChunkType::max()].Obj();
-                if ( currMin.woCompare( min ) || currMax.woCompare( max ) ) {
-                    errmsg = "boundaries are outdated (likely a split occurred)";
-                    result.append( "currMin" , currMin );
-                    result.append( "currMax" , currMax );
-                    result.append( "requestedMin" , min );
-                    result.append( "requestedMax" , max );
-
-                    warning() << "aborted moveChunk because" <<  errmsg << ": " << min << "->" << max
-                                      << " is now " << currMin << "->" << currMax << migrateLog;
-                    return false;
-                }
-
-                if ( myOldShard != fromShard.getName() ) {
-                    errmsg = "location is outdated (likely balance or migrate occurred)";
-                    result.append( "from" , fromShard.getName() );
-                    result.append( "official" , myOldShard );
-
-                    warning() << "aborted moveChunk because " << errmsg << ": chunk is at " << myOldShard
-                                      << " and not at " << fromShard.getName() << migrateLog;
+                if ( ! readChunkFromConfig( ns, shardId, min, max, fromShard.getName(), &maxVersion,
+                                            errmsg, result ) ) {
                     return false;
                 }
 
@@ -1037,7 +1087,7 @@ namespace mongo {
                 }
 
                 // since this could be the first call that enable sharding we also make sure to have the chunk manager up to date
-                shardingState.gotShardName( myOldShard );
+                shardingState.gotShardName( fromShard.getName() );
 
                 // Using the maxVersion we just found will enforce a check - if we use zero version,
                 // it's possible this shard will be *at* zero version from a previous migrate and
@@ -1163,6 +1213,42 @@ namespace mongo {
                 return false;
             }
 
+            // Other migrations of this collection may have committed, or a split or drop happened,
+            // while we copied.  Commits wait their turn for the collection lock.
+            ScopedDistributedLock collLock( ConnectionString( shardingState.getConfigServer() , ConnectionString::SYNC ) , ns );
+            collLock.setLockMessage( (string)"migrate-" + min.toString() );
+            if ( ! collLock.acquire( 5 * 60 * 1000 /* 5 minutes */, &lockHeldMsg ) ) {
+                errmsg = str::stream() << "the collection metadata could not be locked to commit the migration"
+                                       << causedBy( lockHeldMsg );
+                warning() << errmsg << migrateLog;
+                abortRecipient( toShard );
+                return false;
+            }
+
+            if ( ! readChunkFromConfig( ns, shardId, min, max, fromShard.getName(), &maxVersion,
+                                        errmsg, result ) ) {
+                abortRecipient( toShard );
+                return false;
+            }
+
+            if ( ! maxVersion.isEquivalentTo( startingVersion ) ) {
+                // Our ShardChunkManager still has the chunks as they were before that change.
+                // Reload it before donating from it, so that a failed commit undoes back to the
+                // reloaded state rather than the one we started with.
+                log() << "moveChunk reloading chunk state, shard version went from "
+                      << startingVersion << " to " << maxVersion << " during the migration" << migrateLog;
+                ChunkVersion reloadedVersion = maxVersion;
+                shardingState.trySetVersion( ns , reloadedVersion /* will return updated */ );
+                if ( ! reloadedVersion.isEquivalentTo( maxVersion ) ) {
+                    errmsg = str::stream() << "could not reload chunk state at version " << maxVersion.toString()
+                                           << ", got " << reloadedVersion.toString();
+                    warning() << errmsg << migrateLog;
+                    abortRecipient( toShard );
+                    return false;
+                }
+                startingVersion = reloadedVersion;
+            }
+
             log() << "About to enter migrate critical section";
 
             {
@@ -43,6 +43,7 @@
 #include "mongo/s/chunk.h" // for static genID only
 #include "mongo/s/chunk_version.h"
 #include "mongo/s/config.h"
+#include "mongo/s/d_autosplit.h"
 #include "mongo/s/d_logic.h"
 #include "mongo/s/type_chunk.h"
 #include "mongo/util/timer.h"
@@ -500,6 +501,18 @@ namespace mongo {
                 }
             }
 
+            // mongos asks for at most a couple of split points when it guesses a chunk may have
+            // grown.  If this shard's autosplitter already looked at the chunk and nothing much was
+            // written to it since, spare the index scan.
+            if ( !forceMedianSplit && maxSplitPoints > 0 &&
+                 chunkWrites.recentlyChecked( ns, jsobj.getObjectField( "min" ), jsobj.getObjectField( "max" ),
+                                              maxChunkSize ) ) {
+                LOG(1) << "skipping split points lookup for recently checked chunk " << ns << " "
+                       << jsobj.getObjectField( "min" ) << " -->> " << jsobj.getObjectField( "max" ) << endl;
+                result.append( "splitKeys" , splitKeys );
+                return true;
+            }
+
             if (!forceMedianSplit && idx->clustering()) {
                 SplitVectorFinder finder(cl, idx, keyPattern, min, max, splitKeys);
                 finder.find(maxChunkSize, maxSplitPoints);
@@ -638,6 +651,163 @@ namespace mongo {
         }
     } cmdSplitVector;
 
+    /**
+     * Estimates the number of bytes in [min, max) of an index with get_key_after_bytes, the
+     * same fractal tree estimate splitVector uses, without reading the documents.  The step
+     * doubles while it stays inside the range and halves when it overshoots, so a range costs a
+     * number of calls logarithmic in its size over the granularity.
+     */
+    class RangeSizeEstimator {
+        const IndexDetailsBase &_idx;
+        Ordering _ordering;
+        storage::Key _start;
+        storage::Key _max;
+        // Set by the callback for the last step taken.
+        bool _overshot;
+        bool _ranOffEnd;
+        uint64_t _skipped;
+
+      public:
+        RangeSizeEstimator(const IndexDetailsBase &idx, const BSONObj &min, const BSONObj &max)
+                : _idx(idx),
+                  _ordering(Ordering::make(idx.keyPattern())),
+                  _start(min, idx.isIdIndex() ? NULL : &minKey),
+                  _max(max, idx.isIdIndex() ? NULL : &maxKey),
+                  _overshot(false),
+                  _ranOffEnd(false),
+                  _skipped(0) {}
+
+        void operator()(const storage::KeyV1 *endKey, BSONObj *endPK, uint64_t skipped) {
+            _skipped = skipped;
+            if (endKey == NULL) {
+                _overshot = true;
+                _ranOffEnd = true;
+                return;
+            }
+            const storage::KeyV1 max(_max.buf());
+            if (endKey->woCompare(max, _ordering) >= 0 || skipped == 0) {
+                _overshot = true;
+                return;
+            }
+            _overshot = false;
+            _start.reset(*endKey, endPK);
+        }
+
+        /**
+         * @param toEnd true if max is the top of the key space, so that running off the end of
+         *        the index measures the rest of the range exactly.
+         */
+        long long estimate(long long granularity, bool toEnd) {
+            long long bytes = 0;
+            long long step = granularity;
+            while (true) {
+                _ranOffEnd = false;
+                _idx.getKeyAfterBytes(_start, step, *this);
+                if (!_overshot) {
+                    bytes += _skipped;
+                    step *= 2;
+                    continue;
+                }
+                if (_ranOffEnd && toEnd) {
+                    return bytes + _skipped;
+                }
+                if (step <= granularity) {
+                    // Less than one granularity left, call it half.
+                    return bytes + std::min((long long) _skipped, granularity) / 2;
+                }
+                step /= 2;
+            }
+        }
+    };
+
+    class ChunkDataSizes : public QueryCommand {
+    public:
+        ChunkDataSizes() : QueryCommand("chunkDataSizes") {}
+        virtual bool slaveOk() const { return false; }
+        virtual void help( stringstream &help ) const {
+            help <<
+                 "Internal command.\n"
+                 "Estimates the data size of each chunk from the fractal tree stats.\n"
+                 "  { chunkDataSizes : \"blog.post\" , keyPattern:{x:1} ,\n"
+                 "    chunks: [ { min:{x:10} , max:{x:20} } , ... ] , granularity: 1048576 }\n"
+                 "  returns { sizes: [ <bytes> , ... ] } in the order of 'chunks'";
+        }
+        virtual void addRequiredPrivileges(const std::string& dbname,
+                                           const BSONObj& cmdObj,
+                                           std::vector<Privilege>* out) {
+            ActionSet actions;
+            actions.addAction(ActionType::splitVector);
+            out->push_back(Privilege(AuthorizationManager::CLUSTER_RESOURCE_NAME, actions));
+        }
+
+        virtual string parseNs(const string& dbname, const BSONObj& cmdObj) const {
+            return cmdObj.firstElement().valuestr();
+        }
+
+        bool run(const string& dbname, BSONObj& jsobj, int, string& errmsg, BSONObjBuilder& result, bool fromRepl ) {
+            const char* ns = jsobj.getStringField( "chunkDataSizes" );
+            BSONObj keyPattern = jsobj.getObjectField( "keyPattern" );
+            if ( keyPattern.isEmpty() ) {
+                errmsg = "no key pattern found in chunkDataSizes";
+                return false;
+            }
+
+            long long granularity = 1 << 20;
+            if ( jsobj["granularity"].isNumber() ) {
+                granularity = std::max( jsobj["granularity"].numberLong(), 4096LL );
+            }
+
+            Collection *cl = getCollection( ns );
+            if ( ! cl ) {
+                errmsg = "ns not found";
+                return false;
+            }
+
+            const IndexDetails *idx = cl->findIndexByPrefix( keyPattern , true );
+            if ( idx == NULL ) {
+                errmsg = (string)"couldn't find index over sharding key " +
+                         keyPattern.clientReadable().toString();
+                return false;
+            }
+            const IndexDetailsBase* idxBase = dynamic_cast<const IndexDetailsBase *>(idx);
+            if ( idxBase == NULL ) {
+                errmsg = "chunkDataSizes is not supported on partitioned collections";
+                return false;
+            }
+
+            // Scale index bytes to data bytes, for when the index isn't clustering.
+            double scale = 1.0;
+            if ( ! idx->clustering() ) {
+                CollectionData::Stats stats;
+                cl->fillCollectionStats( stats, NULL, 1 );
+                DB_BTREE_STAT64 st;
+                idx->getStat64( &st );
+                if ( st.bt_dsize > 0 ) {
+                    scale = (double) stats.size / st.bt_dsize;
+                }
+            }
+
+            Timer timer;
+            KeyPattern kp( idx->keyPattern() );
+            BSONArrayBuilder sizes( result.subarrayStart( "sizes" ) );
+            BSONObjIterator it( jsobj.getObjectField( "chunks" ) );
+            while ( it.more() ) {
+                BSONObj chunk = it.next().Obj();
+                BSONObj chunkMax = chunk.getObjectField( "max" );
+                BSONObj min = KeyPattern::toKeyFormat( kp.extendRangeBound( chunk.getObjectField( "min" ), false ) );
+                BSONObj max = KeyPattern::toKeyFormat( kp.extendRangeBound( chunkMax, false ) );
+                const bool toEnd = chunkMax.firstElementType() == MaxKey;
+
+                RangeSizeEstimator estimator( *idxBase, min, max );
+                sizes.append( (long long) ( estimator.estimate( granularity, toEnd ) * scale ) );
+            }
+            sizes.done();
+
+            result.append( "timeMillis", timer.millis() );
+            return true;
+        }
+    } cmdChunkDataSizes;
+
     // ** temporary ** 2010-10-22
     // chunkInfo is a helper to collect and log information about the chunks generated in splitChunk.
     // It should hold the chunk state for this module only, while we don't have min/max key info per chunk on the
@@ -31,6 +31,8 @@ namespace mongo {
     const BSONField<BSONObj> SettingsType::balancerActiveWindow("activeWindow");
     const BSONField<bool> SettingsType::shortBalancerSleep("_nosleep");
     const BSONField<bool> SettingsType::secondaryThrottle("_secondaryThrottle");
+    const BSONField<std::string> SettingsType::balancerPolicy("policy", "chunkCount");
+    const BSONField<int> SettingsType::maxConcurrentMigrations("maxConcurrentMigrations");
 
     SettingsType::SettingsType() {
         clear();
@@ -84,6 +86,17 @@ namespace mongo {
                     return false;
                 }
             }
+            if (_isBalancerPolicySet &&
+                    _balancerPolicy != "chunkCount" && _balancerPolicy != "load") {
+                *errMsg = stream() << balancerPolicy.name() <<
+                                      " must be \"chunkCount\" or \"load\"";
+                return false;
+            }
+            if (_isMaxConcurrentMigrationsSet && !(_maxConcurrentMigrations > 0)) {
+                *errMsg = stream() << maxConcurrentMigrations.name() <<
+                                      " must be greater than zero";
+                return false;
+            }
             return true;
         }
         else {
@@ -103,6 +116,10 @@ namespace mongo {
         }
         if (_isShortBalancerSleepSet) builder.append(shortBalancerSleep(), _shortBalancerSleep);
         if (_isSecondaryThrottleSet) builder.append(secondaryThrottle(), _secondaryThrottle);
+        if (_isBalancerPolicySet) builder.append(balancerPolicy(), _balancerPolicy);
+        if (_isMaxConcurrentMigrationsSet) {
+            builder.append(maxConcurrentMigrations(), _maxConcurrentMigrations);
+        }
 
         return builder.obj();
     }
@@ -139,6 +156,15 @@ namespace mongo {
         if (fieldState == FieldParser::FIELD_INVALID) return false;
         _isSecondaryThrottleSet = fieldState == FieldParser::FIELD_SET;
 
+        fieldState = FieldParser::extract(source, balancerPolicy, &_balancerPolicy, errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isBalancerPolicySet = fieldState == FieldParser::FIELD_SET;
+
+        fieldState = FieldParser::extract(source, maxConcurrentMigrations,
+                                          &_maxConcurrentMigrations, errMsg);
+        if (fieldState == FieldParser::FIELD_INVALID) return false;
+        _isMaxConcurrentMigrationsSet = fieldState == FieldParser::FIELD_SET;
+
         return true;
     }
 
@@ -162,6 +188,12 @@ namespace mongo {
         _secondaryThrottle = false;
         _isSecondaryThrottleSet = false;
 
+        _balancerPolicy.clear();
+        _isBalancerPolicySet = false;
+
+        _maxConcurrentMigrations = 0;
+        _isMaxConcurrentMigrationsSet = false;
+
     }
 
     void SettingsType::cloneTo(SettingsType* other) const {
@@ -185,6 +217,12 @@ namespace mongo {
         other->_secondaryThrottle = _secondaryThrottle;
         other->_isSecondaryThrottleSet = _isSecondaryThrottleSet;
 
+        other->_balancerPolicy = _balancerPolicy;
+        other->_isBalancerPolicySet = _isBalancerPolicySet;
+
+        other->_maxConcurrentMigrations = _maxConcurrentMigrations;
+        other->_isMaxConcurrentMigrationsSet = _isMaxConcurrentMigrationsSet;
+
     }
 
     std::string SettingsType::toString() const {
@@ -63,6 +63,8 @@ namespace mongo {
         static const BSONField<BSONObj> balancerActiveWindow;
         static const BSONField<bool> shortBalancerSleep;
         static const BSONField<bool> secondaryThrottle;
+        static const BSONField<std::string> balancerPolicy;
+        static const BSONField<int> maxConcurrentMigrations;
 
         //
         // settings type methods
@@ -229,6 +231,48 @@ namespace mongo {
                 return secondaryThrottle.getDefault();
             }
         }
+        void setBalancerPolicy(const StringData& balancerPolicy) {
+            _balancerPolicy = balancerPolicy.toString();
+            _isBalancerPolicySet = true;
+        }
+
+        void unsetBalancerPolicy() { _isBalancerPolicySet = false; }
+
+        bool isBalancerPolicySet() const {
+            return _isBalancerPolicySet || balancerPolicy.hasDefault();
+        }
+
+        // Calling get*() methods when the member is not set and has no default results in undefined
+        // behavior
+        std::string getBalancerPolicy() const {
+            if (_isBalancerPolicySet) {
+                return _balancerPolicy;
+            } else {
+                dassert(balancerPolicy.hasDefault());
+                return balancerPolicy.getDefault();
+            }
+        }
+        void setMaxConcurrentMigrations(int maxConcurrentMigrations) {
+            _maxConcurrentMigrations = maxConcurrentMigrations;
+            _isMaxConcurrentMigrationsSet = true;
+        }
+
+        void unsetMaxConcurrentMigrations() { _isMaxConcurrentMigrationsSet = false; }
+
+        bool isMaxConcurrentMigrationsSet() const {
+            return _isMaxConcurrentMigrationsSet || maxConcurrentMigrations.hasDefault();
+        }
+
+        // Calling get*() methods when the member is not set and has no default results in undefined
+        // behavior
+        int getMaxConcurrentMigrations() const {
+            if (_isMaxConcurrentMigrationsSet) {
+                return _maxConcurrentMigrations;
+            } else {
+                dassert(maxConcurrentMigrations.hasDefault());
+                return maxConcurrentMigrations.getDefault();
+            }
+        }
 
     private:
         // Convention: (M)andatory, (O)ptional, (S)pecial rule.
@@ -252,6 +296,12 @@ namespace mongo {
 
         bool _secondaryThrottle;         // (O)  only migrate chunks as fast as at least
         bool _isSecondaryThrottleSet;    // one secondary can keep up with
+
+        std::string _balancerPolicy;     // (O)  what to balance: "chunkCount" (the
+        bool _isBalancerPolicySet;       // default), or "load", data size and op load
+
+        int _maxConcurrentMigrations;    // (O)  most migrations to run at once; without it,
+        bool _isMaxConcurrentMigrationsSet; // one per shard, each in at most one migration
     };
 
 } // namespace mongo
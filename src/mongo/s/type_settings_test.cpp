@@ -83,7 +83,9 @@ namespace {
                            SettingsType::balancerActiveWindow(BSON("start" << "23:00" <<
                                                                    "stop" << "6:00" )) <<
                            SettingsType::shortBalancerSleep(true) <<
-                           SettingsType::secondaryThrottle(true));
+                           SettingsType::secondaryThrottle(true) <<
+                           SettingsType::balancerPolicy("load") <<
+                           SettingsType::maxConcurrentMigrations(4));
         ASSERT(settings.parseBSON(objBalancer, &errMsg));
         ASSERT_EQUALS(errMsg, "");
         ASSERT_TRUE(settings.isValid(NULL));
@@ -93,6 +95,26 @@ namespace {
                                                                "stop" << "6:00" ));
         ASSERT_EQUALS(settings.getShortBalancerSleep(), true);
         ASSERT_EQUALS(settings.getSecondaryThrottle(), true);
+        ASSERT_EQUALS(settings.getBalancerPolicy(), "load");
+        ASSERT_EQUALS(settings.getMaxConcurrentMigrations(), 4);
+    }
+
+    TEST(Validity, BadBalancerPolicy) {
+        SettingsType settings;
+        BSONObj obj = BSON(SettingsType::key("balancer") <<
+                           SettingsType::balancerPolicy("random"));
+        string errMsg;
+        ASSERT(settings.parseBSON(obj, &errMsg));
+        ASSERT_FALSE(settings.isValid(NULL));
+    }
+
+    TEST(Validity, BadMaxConcurrentMigrations) {
+        SettingsType settings;
+        BSONObj obj = BSON(SettingsType::key("balancer") <<
+                           SettingsType::maxConcurrentMigrations(0));
+        string errMsg;
+        ASSERT(settings.parseBSON(obj, &errMsg));
+        ASSERT_FALSE(settings.isValid(NULL));
     }
 
     TEST(Validity, BadType) {
@@ -25,33 +25,32 @@
 
 #include <boost/filesystem/operations.hpp>
 #include <boost/filesystem/convenience.hpp>
+#include <boost/thread/thread.hpp>
 
 #include "mongo/base/initializer.h"
+#include "mongo/client/dbclient_rs.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/db/namespacestring.h"
 #include "mongo/tools/tool.h"
+#include "mongo/util/timer.h"
 
 using namespace mongo;
 
 namespace po = boost::program_options;
 
 class Dump : public Tool {
-    class FilePtr : boost::noncopyable {
-    public:
-        /*implicit*/ FilePtr(FILE* f) : _f(f) {}
-        ~FilePtr() { fclose(_f); }
-        operator FILE*() { return _f; }
-    private:
-        FILE* _f;
-    };
 public:
-    Dump() : Tool( "dump" , ALL , "" , "" , true ) {
+    Dump() : Tool( "dump" , ALL , "" , "" , true ),
+        _usingMongos(false), _numWorkers(1), _splitSize(0),
+        _jobsMutex("Dump::_jobsMutex"), _nextJob(0), _failed(false) {
         add_options()
         ("out,o", po::value<string>()->default_value("dump"), "output directory or \"-\" for stdout")
         ("query,q", po::value<string>() , "json query" )
         ("oplog", "Use oplog for point-in-time snapshotting" )
         ("repair", "try to recover a crashed database" )
         ("forceTableScan", "deprecated" )
+        ("numParallelCollections,j", po::value<int>()->default_value(1), "number of collections (or _id ranges of split collections) to dump at once, each over its own connection")
+        ("splitSize", po::value<int>()->default_value(0), "with -j, split collections larger than this many MB into _id ranges dumped in parallel (0 disables)")
         ;
     }
 
@@ -68,70 +67,276 @@ public:
         out << "Export MongoDB data to BSON files.\n" << endl;
     }
 
-    // This is a functor that writes a BSONObj to a file
-    struct Writer {
-        Writer(FILE* out, ProgressMeter* m) :_out(out), _m(m) {}
+    // The file one collection is dumped to.  When the collection is split into _id ranges, the
+    // ranges are dumped concurrently over separate connections, so writers hand over whole
+    // buffers of documents and append them under the lock.  The file is only opened once the
+    // collection's first range starts, so queueing many collections doesn't hold many files
+    // open.  An empty fileName means stdout.
+    class CollectionOutput : boost::noncopyable {
+    public:
+        CollectionOutput(const string& ns, const string& fileName, unsigned long long count, int ranges)
+            : _mutex("CollectionOutput"), _ns(ns), _fileName(fileName), _out(NULL),
+              _ranges(ranges), _objects(0), _bytes(0) {
+            if (!fileName.empty()) {
+                _m.reset(new ProgressMeter(count, 3, 1));
+                _m->setName("Collection File Writing Progress");
+                _m->setUnits("objects");
+            }
+        }
+
+        ~CollectionOutput() {
+            if (_out && _out != stdout) {
+                fclose(_out);
+            }
+        }
 
-        void operator () (const BSONObj& obj) {
-            size_t toWrite = obj.objsize();
+        // Called as each range starts.
+        void open() {
+            scoped_lock lk(_mutex);
+            if (_out) {
+                return;
+            }
+            if (_fileName.empty()) {
+                _out = stdout;
+                return;
+            }
+            _out = fopen(_fileName.c_str(), "wb");
+            uassert(10262, errnoWithPrefix("couldn't open file"), _out);
+            _timer.reset();
+        }
+
+        void write(const BufBuilder& buf, int nobjs) {
+            scoped_lock lk(_mutex);
+            size_t toWrite = buf.len();
             size_t written = 0;
 
             while (toWrite) {
-                size_t ret = fwrite( obj.objdata()+written, 1, toWrite, _out );
+                size_t ret = fwrite( buf.buf()+written, 1, toWrite, _out );
                 uassert(14035, errnoWithPrefix("couldn't write to file"), ret);
                 toWrite -= ret;
                 written += ret;
             }
 
+            _objects += nobjs;
+            _bytes += buf.len();
             // if there's a progress bar, hit it
             if (_m) {
-                _m->hit();
+                _m->hit(nobjs);
+            }
+        }
+
+        // Called as each range finishes.  The last one closes the file and reports throughput.
+        void rangeDone() {
+            scoped_lock lk(_mutex);
+            verify(_ranges > 0);
+            if (--_ranges > 0) {
+                return;
+            }
+            if (_out && _out != stdout) {
+                fclose(_out);
+            }
+            _out = NULL;
+            if (_m) {
+                const double secs = std::max(_timer.micros() / 1000000.0, 0.001);
+                log() << "\t\t " << _ns << ": " << _objects << " objects, "
+                      << _bytes / (1024 * 1024) << "MB in " << secs << "s ("
+                      << (long long) (_objects / secs) << " objects/s, "
+                      << _bytes / secs / (1024 * 1024) << " MB/s)" << endl;
             }
         }
 
+    private:
+        mongo::mutex _mutex;
+        const string _ns;
+        const string _fileName;
         FILE* _out;
-        ProgressMeter* _m;
+        int _ranges;
+        scoped_ptr<ProgressMeter> _m;
+        long long _objects;
+        long long _bytes;
+        Timer _timer;
     };
 
-    void doCollection( const string coll , FILE* out , ProgressMeter *m ) {
+    // Buffers the documents of one cursor and flushes them to the CollectionOutput about a
+    // megabyte at a time.
+    class Writer : boost::noncopyable {
+    public:
+        explicit Writer(CollectionOutput& out) : _out(out), _nobjs(0) {}
+
+        void write(const BSONObj& obj) {
+            if (_buf.len() > 0 && _buf.len() + obj.objsize() > FlushBytes) {
+                flush();
+            }
+            _buf.appendBuf(obj.objdata(), obj.objsize());
+            _nobjs++;
+        }
+
+        void flush() {
+            if (_nobjs > 0) {
+                _out.write(_buf, _nobjs);
+                _buf.reset();
+                _nobjs = 0;
+            }
+        }
+
+    private:
+        static const int FlushBytes = 1024 * 1024;
+        CollectionOutput& _out;
+        BufBuilder _buf;
+        int _nobjs;
+    };
+
+    // One unit of work for the dump workers: a collection, or an _id range of one.  An empty
+    // min or max leaves that end of the range open.
+    struct DumpJob {
+        string ns;
+        BSONObj min;
+        BSONObj max;
+        shared_ptr<CollectionOutput> out;
+    };
+
+    // With a replica set, read from a secondary like conn(true) does.
+    static DBClientBase& readConn(DBClientBase& c) {
+        if (c.type() == ConnectionString::SET) {
+            return static_cast<DBClientReplicaSet&>(c).slaveConn();
+        }
+        return c;
+    }
+
+    void doCollection( DBClientBase& connBase , const DumpJob& job ) {
         Query q = _query;
+        if (!job.min.isEmpty() || !job.max.isEmpty()) {
+            q.hint(BSON("_id" << 1));
+            if (!job.min.isEmpty()) {
+                q.minKey(job.min);
+            }
+            if (!job.max.isEmpty()) {
+                q.maxKey(job.max);
+            }
+        }
 
         int queryOptions = QueryOption_SlaveOk | QueryOption_NoCursorTimeout;
-        if (startsWith(coll.c_str(), "local.oplog.")) {
+        if (startsWith(job.ns.c_str(), "local.oplog.")) {
             queryOptions |= QueryOption_OplogReplay;
         }
         
-        DBClientBase& connBase = conn(true);
-        Writer writer(out, m);
+        job.out->open();
+        Writer writer(*job.out);
 
         // use low-latency "exhaust" mode if going over the network
         if (!_usingMongos && typeid(connBase) == typeid(DBClientConnection&)) {
             DBClientConnection& conn = static_cast<DBClientConnection&>(connBase);
-            boost::function<void(const BSONObj&)> castedWriter(writer); // needed for overload resolution
-            conn.query( castedWriter, coll.c_str() , q , NULL, queryOptions | QueryOption_Exhaust);
+            boost::function<void(const BSONObj&)> castedWriter(boost::bind(&Writer::write, &writer, _1)); // needed for overload resolution
+            conn.query( castedWriter, job.ns.c_str() , q , NULL, queryOptions | QueryOption_Exhaust);
         }
         else {
             //This branch should only be taken with DBDirectClient or mongos which doesn't support exhaust mode
-            scoped_ptr<DBClientCursor> cursor(connBase.query( coll.c_str() , q , 0 , 0 , 0 , queryOptions ));
+            scoped_ptr<DBClientCursor> cursor(connBase.query( job.ns.c_str() , q , 0 , 0 , 0 , queryOptions ));
             while ( cursor->more() ) {
-                writer(cursor->next());
+                writer.write(cursor->next());
             }
         }
+        writer.flush();
     }
 
+    // Dumps coll on the main connection right away.
     void writeCollectionFile( const string coll , boost::filesystem::path outputFile ) {
         log() << "\t" << coll << " to " << outputFile.string() << endl;
 
-        FilePtr f (fopen(outputFile.string().c_str(), "wb"));
-        uassert(10262, errnoWithPrefix("couldn't open file"), f);
+        DumpJob job;
+        job.ns = coll;
+        job.out.reset(new CollectionOutput(coll, outputFile.string(), conn(true).count(coll.c_str(), BSONObj(), QueryOption_SlaveOk), 1));
+        doCollection(conn(true), job);
+        job.out->rangeDone();
+    }
 
-        ProgressMeter m(conn(true).count(coll.c_str(), BSONObj(), QueryOption_SlaveOk));
-        m.setName("Collection File Writing Progress");
-        m.setUnits("objects");
+    // Queues coll for the dump workers, split into _id ranges of about --splitSize megabytes
+    // if it is big enough.
+    void scheduleCollectionFile( const string coll , boost::filesystem::path outputFile ) {
+        vector<BSONObj> splitKeys;
+        if (_splitSize > 0 && _numWorkers > 1 && !_usingMongos && canOpenConnections() &&
+                !NamespaceString(coll).isSystem()) {
+            BSONObj res;
+            if (conn(true).runCommand(nsToDatabase(coll),
+                                      BSON("splitVector" << coll <<
+                                           "keyPattern" << BSON("_id" << 1) <<
+                                           "maxChunkSizeBytes" << _splitSize * 1024 * 1024),
+                                      res)) {
+                BSONForEach(e, res["splitKeys"].Obj()) {
+                    splitKeys.push_back(e.Obj().getOwned());
+                }
+            }
+            else {
+                LOG(1) << "\tcouldn't split " << coll << ", dumping it in one range: " << res << endl;
+            }
+        }
+
+        if (splitKeys.empty()) {
+            log() << "\t" << coll << " to " << outputFile.string() << endl;
+        }
+        else {
+            log() << "\t" << coll << " to " << outputFile.string()
+                  << " in " << splitKeys.size() + 1 << " ranges" << endl;
+        }
+
+        shared_ptr<CollectionOutput> out(
+                new CollectionOutput(coll, outputFile.string(), conn(true).count(coll.c_str(), BSONObj(), QueryOption_SlaveOk),
+                                     splitKeys.size() + 1));
+        for (size_t i = 0; i <= splitKeys.size(); i++) {
+            DumpJob job;
+            job.ns = coll;
+            job.min = i > 0 ? splitKeys[i - 1] : BSONObj();
+            job.max = i < splitKeys.size() ? splitKeys[i] : BSONObj();
+            job.out = out;
+            _jobs.push_back(job);
+        }
+    }
 
-        doCollection(coll, f, &m);
+    void dumpWorker() {
+        scoped_ptr<DBClientBase> owned;
+        try {
+            DBClientBase* c = &conn(true);
+            if (_numWorkers > 1) {
+                owned.reset(newConnection());
+                c = &readConn(*owned);
+            }
+            while (true) {
+                DumpJob job;
+                {
+                    scoped_lock lk(_jobsMutex);
+                    if (_nextJob >= _jobs.size()) {
+                        break;
+                    }
+                    job = _jobs[_nextJob++];
+                }
+                doCollection(*c, job);
+                job.out->rangeDone();
+            }
+        }
+        catch (DBException& e) {
+            error() << "dump worker failed: " << e.toString() << endl;
+            scoped_lock lk(_jobsMutex);
+            _failed = true;
+        }
+    }
 
-        log() << "\t\t " << m.done() << " objects" << endl;
+    // Runs every queued job on _numWorkers connections.  Returns false if any of them failed.
+    bool runJobs() {
+        _nextJob = 0;
+        _failed = false;
+        if (_numWorkers > 1) {
+            boost::thread_group workers;
+            for (int i = 0; i < _numWorkers; i++) {
+                workers.create_thread(boost::bind(&Dump::dumpWorker, this));
+            }
+            workers.join_all();
+        }
+        else {
+            dumpWorker();
+        }
+        bool ok = !_failed && _nextJob == _jobs.size();
+        _jobs.clear();
+        return ok;
     }
 
     void writeMetadataFile( const string coll, boost::filesystem::path outputFile, 
@@ -173,7 +378,11 @@ public:
 
 
     void writeCollectionStdout( const string coll ) {
-        doCollection(coll, stdout, NULL);
+        DumpJob job;
+        job.ns = coll;
+        job.out.reset(new CollectionOutput(coll, "", 0, 1));
+        doCollection(conn(true), job);
+        job.out->rangeDone();
     }
 
     void go( const string db , const boost::filesystem::path outdir ) {
@@ -247,7 +456,7 @@ public:
         for (vector<string>::iterator it = collections.begin(); it != collections.end(); ++it) {
             string name = *it;
             const string filename = name.substr( db.size() + 1 );
-            writeCollectionFile( name , outdir / ( filename + ".bson" ) );
+            scheduleCollectionFile( name , outdir / ( filename + ".bson" ) );
             writeMetadataFile( name, outdir / (filename + ".metadata.json"), collectionOptions, indexes, partitionInfo);
         }
 
@@ -334,6 +543,13 @@ public:
 
         _usingMongos = isMongos();
 
+        _numWorkers = std::max(getParam("numParallelCollections", 1), 1);
+        if (_numWorkers > 1 && !canOpenConnections()) {
+            log() << "--numParallelCollections needs a server connection, dumping one collection at a time" << endl;
+            _numWorkers = 1;
+        }
+        _splitSize = getParam("splitSize", 0);
+
         boost::filesystem::path root( out );
         string db = _db;
 
@@ -374,6 +590,11 @@ public:
             go( db , root / db );
         }
 
+        if (!runJobs()) {
+            error() << "dump failed" << endl;
+            return -1;
+        }
+
         if (!opLogName.empty()) {
             BSONObjBuilder b;
             b.appendDate("$gt", opLogStart);
@@ -388,6 +609,13 @@ public:
 
     bool _usingMongos;
     BSONObj _query;
+    int _numWorkers;
+    int _splitSize;
+
+    mongo::mutex _jobsMutex;
+    vector<DumpJob> _jobs;
+    size_t _nextJob;
+    bool _failed;
 };
 
 int main( int argc , char ** argv, char ** envp ) {
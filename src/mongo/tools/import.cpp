@@ -24,12 +24,16 @@
 #include "mongo/util/text.h"
 #include "mongo/base/initializer.h"
 #include "mongo/client/remote_loader.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/queue.h"
 
 #include <fstream>
 #include <iostream>
 #include <boost/program_options.hpp>
 #include <boost/algorithm/string.hpp>
 #include <boost/filesystem/operations.hpp>
+#include <boost/thread/condition.hpp>
+#include <boost/thread/thread.hpp>
 
 using namespace mongo;
 using std::string;
@@ -49,9 +53,51 @@ class Import : public Tool {
     bool _doimport;
     bool _jsonArray;
     bool _doBulkLoad;
+    bool _stopOnError;
     vector<string> _upsertFields;
     static const int BUF_SIZE;
 
+    /*
+     * A run of consecutive input rows and what became of them.  The reader fills in rows (or, for
+     * --jsonArray, objs directly), a parser worker turns rows into objs, and the inserters take
+     * chunks in input order.
+     */
+    struct Chunk {
+        Chunk() : seq(0), bytes(0), errors(0), stopped(false) {}
+        long long seq;
+        vector<string> rows;
+        vector<BSONObj> objs;
+        long long bytes;    // input consumed, for the progress meter
+        int errors;         // rows that failed to read or parse
+        bool stopped;       // hit an error with --stopOnError, nothing after it should be imported
+    };
+
+    static const int ChunkRows = 1000;
+    static const int ChunkBytes = 4 * 1024 * 1024;
+    // Leaves room for the message header and namespace.
+    static const int BatchBytes = MaxMessageSizeBytes - 16 * 1024;
+
+    // The import pipeline: one reader thread reads rows into chunks, _numParsers threads parse
+    // them, and the inserters take them in input order and send them to the server.
+    static const long long MaxChunksInFlight = 64;
+    int _numParsers;
+    boost::scoped_array<char> _lineBuffer;
+    BlockingQueue<Chunk*> _toParse;
+    mongo::mutex _chunksMutex;
+    boost::condition _chunksCond;
+    map<long long, shared_ptr<Chunk> > _parsed;
+    long long _nextInsert;
+    long long _numChunks;
+    bool _readDone;
+    volatile bool _stop;
+
+    mongo::mutex _statsMutex;
+    string _ns;
+    ProgressMeter* _pm;
+    time_t _start;
+    long long _num;
+    long long _errors;
+
     void csvTokenizeRow(const string& row, vector<string>& tokens) {
         bool inQuotes = false;
         bool prevWasQuote = false;
@@ -141,7 +187,7 @@ class Import : public Tool {
             numBytesSkipped += 3;
         }
 
-        uassert(13289, "Invalid UTF8 character detected", isValidUTF8(buf));
+        // the UTF-8 check is left to the parser workers, see parseRow
         return numBytesSkipped;
     }
 
@@ -170,13 +216,13 @@ class Import : public Tool {
     }
 
     /*
-     * Parses one object from the input file.  This usually corresponds to one line in the input
-     * file, unless the file is a CSV and contains a newline within a quoted string entry.
-     * Returns a true if a BSONObj was successfully created and false if not.
+     * Reads the text of one object from the input file into row.  This usually corresponds to one
+     * line in the input file, unless the file is a CSV and contains a newline within a quoted
+     * string entry.  Returns false if there was nothing but a blank line.  Only called from the
+     * reader thread, which owns _lineBuffer.
      */
-    bool parseRow(istream* in, BSONObj& o, int& numBytesRead) {
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
+    bool readRow(istream* in, string& row, int& numBytesRead) {
+        char* line = _lineBuffer.get();
 
         numBytesRead = getLine(in, line);
         line += numBytesRead;
@@ -186,54 +232,66 @@ class Import : public Tool {
         }
         numBytesRead += strlen( line );
 
+        if (_type != CSV) {
+            row = line;
+            return true;
+        }
+
+        row.clear();
+        bool inside_quotes = false;
+        while (true) {
+            // Deal with line breaks in quoted strings
+            for (const char* q = strchr(line, '"'); q != NULL; q = strchr(q + 1, '"')) {
+                inside_quotes = !inside_quotes;
+            }
+
+            row.append(line);
+
+            if (inside_quotes) {
+                row.append("\n");
+                line = _lineBuffer.get();
+                int num = getLine(in, line);
+                line += num;
+                numBytesRead += num;
+
+                uassert (15854, "CSV file ends while inside quoted field", line[0] != '\0');
+                numBytesRead += strlen( line );
+            } else {
+                break;
+            }
+        }
+        // now 'row' is string corresponding to one row of the CSV file
+        // (which may span multiple lines) and represents one BSONObj
+        return true;
+    }
+
+    /*
+     * Parses one object out of a row read by readRow.  Doesn't modify any state unless this is
+     * the header line, so the parser workers can run it concurrently.
+     */
+    void parseRow(const string& row, BSONObj& o) {
+        uassert(13289, "Invalid UTF8 character detected", isValidUTF8(row));
+
         if (_type == JSON) {
             // Strip out trailing whitespace
-            char * end = ( line + strlen( line ) ) - 1;
-            while ( end >= line && isspace(*end) ) {
-                *end = 0;
-                end--;
+            size_t len = row.size();
+            while ( len > 0 && isspace(row[len - 1]) ) {
+                len--;
             }
             try {
-                o = fromjson( line );
+                o = fromjson( len == row.size() ? row : row.substr(0, len) );
             } catch ( MsgAssertionException& e ) {
                 uasserted(13504, string("BSON representation of supplied JSON is too large: ") + e.what());
             }
-            return true;
+            return;
         }
 
         vector<string> tokens;
         if (_type == CSV) {
-            string row;
-            bool inside_quotes = false;
-            size_t last_quote = 0;
-            while (true) {
-                string lineStr(line);
-                // Deal with line breaks in quoted strings
-                last_quote = lineStr.find_first_of('"');
-                while (last_quote != string::npos) {
-                    inside_quotes = !inside_quotes;
-                    last_quote = lineStr.find_first_of('"', last_quote+1);
-                }
-
-                row.append(lineStr);
-
-                if (inside_quotes) {
-                    row.append("\n");
-                    int num = getLine(in, line);
-                    line += num;
-                    numBytesRead += num;
-
-                    uassert (15854, "CSV file ends while inside quoted field", line[0] != '\0');
-                    numBytesRead += strlen( line );
-                } else {
-                    break;
-                }
-            }
-            // now 'row' is string corresponding to one row of the CSV file
-            // (which may span multiple lines) and represents one BSONObj
             csvTokenizeRow(row, tokens);
         }
         else {  // _type == TSV
+            const char* line = row.c_str();
             while (line[0] != '\t' && isspace(line[0])) { // Strip leading whitespace, but not tabs
                 line++;
             }
@@ -265,11 +323,270 @@ class Import : public Tool {
             }
         }
         o = b.obj();
+    }
+
+    void readerThread(istream* in) {
+        long long seq = 0;
+        auto_ptr<Chunk> chunk(new Chunk);
+        bool eof = false;
+        while (!eof && !_stop) {
+            try {
+                if (_jsonArray) {
+                    readJSONArray(in, *chunk);
+                    eof = true;
+                }
+                else {
+                    string row;
+                    int len = 0;
+                    bool got = readRow(in, row, len);
+                    chunk->bytes += len + 1;
+                    if (got) {
+                        chunk->rows.push_back(row);
+                    }
+                    eof = in->rdstate() != 0;
+                }
+            }
+            catch ( std::exception& e ) {
+                log() << "exception:" << e.what() << endl;
+                chunk->errors++;
+                if (_stopOnError) {
+                    chunk->stopped = true;
+                }
+                // a bad read leaves the stream unusable
+                eof = eof || _stopOnError || in->rdstate() != 0;
+            }
+
+            if (eof || chunk->stopped || (int) chunk->rows.size() >= ChunkRows ||
+                    chunk->bytes >= ChunkBytes) {
+                chunk->seq = seq++;
+                {
+                    // don't get too far ahead of the inserters
+                    scoped_lock lk(_chunksMutex);
+                    while (chunk->seq - _nextInsert >= MaxChunksInFlight && !_stop) {
+                        _chunksCond.wait(lk.boost());
+                    }
+                }
+                _toParse.push(chunk.release());
+                chunk.reset(new Chunk);
+                if (eof || _stop) {
+                    break;
+                }
+            }
+        }
+
+        scoped_lock lk(_chunksMutex);
+        _numChunks = seq;
+        _readDone = true;
+        _chunksCond.notify_all();
+        for (int i = 0; i < _numParsers; i++) {
+            _toParse.push(NULL);
+        }
+    }
+
+    // The whole array must be on one line, so the reader parses it itself.
+    void readJSONArray(istream* in, Chunk& chunk) {
+        char* line = _lineBuffer.get();
+        int bytesProcessed = getLine(in, line);
+        line += bytesProcessed;
+        chunk.bytes += bytesProcessed;
+        uassert(13289, "Invalid UTF8 character detected", isValidUTF8(line));
+        while (true) {
+            BSONObj o;
+            if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
+                break;
+            }
+            chunk.bytes += bytesProcessed;
+            line += bytesProcessed;
+            chunk.objs.push_back(o);
+        }
+    }
+
+    void parserThread() {
+        while (Chunk* c = _toParse.blockingPop()) {
+            shared_ptr<Chunk> chunk(c);
+            if (!_stop) {
+                for (vector<string>::const_iterator it = chunk->rows.begin(); it != chunk->rows.end(); ++it) {
+                    try {
+                        BSONObj o;
+                        parseRow(*it, o);
+                        chunk->objs.push_back(o);
+                    }
+                    catch ( std::exception& e ) {
+                        log() << "exception:" << e.what() << endl;
+                        log() << *it << endl;
+                        chunk->errors++;
+
+                        if (_stopOnError) {
+                            chunk->stopped = true;
+                            break;
+                        }
+                    }
+                }
+            }
+            chunk->rows.clear();
+
+            scoped_lock lk(_chunksMutex);
+            _parsed[chunk->seq] = chunk;
+            _chunksCond.notify_all();
+        }
+    }
+
+    // Returns the next chunk in input order, or an empty pointer once there are no more.
+    shared_ptr<Chunk> nextParsed() {
+        scoped_lock lk(_chunksMutex);
+        while (true) {
+            map<long long, shared_ptr<Chunk> >::iterator it = _parsed.find(_nextInsert);
+            if (it != _parsed.end()) {
+                shared_ptr<Chunk> chunk = it->second;
+                _parsed.erase(it);
+                _nextInsert++;
+                _chunksCond.notify_all();
+                return chunk;
+            }
+            if (_stop || (_readDone && _nextInsert >= _numChunks)) {
+                return shared_ptr<Chunk>();
+            }
+            _chunksCond.wait(lk.boost());
+        }
+    }
+
+    void stop() {
+        scoped_lock lk(_chunksMutex);
+        _stop = true;
+        _chunksCond.notify_all();
+    }
+
+    /**
+     * Sends a batch of objects as batched inserts, never sending an object that may already be in
+     * the collection a second time.
+     *
+     * Without --stopOnError the server skips objects that fail under ContinueOnError, except that
+     * a failure of the last object aborts the whole insert.  So all but the last object go out
+     * with ContinueOnError and the last one goes out on its own, and nothing needs to be resent.
+     * Only the last failure of each insert is reported.
+     *
+     * With --stopOnError the batch goes out without ContinueOnError, so any failure aborts the
+     * whole insert and nothing from it is committed.  It is then sent again one object at a time,
+     * stopping at the first failure, as before batching.
+     * @return false if --stopOnError and an object failed with something other than a
+     * duplicate key
+     */
+    bool insertBatch(DBClientBase& c, const vector<BSONObj>& batch) {
+        if (_stopOnError) {
+            c.insert(_ns, batch);
+            if (c.getLastError().empty()) {
+                return true;
+            }
+            for (vector<BSONObj>::const_iterator it = batch.begin(); it != batch.end(); ++it) {
+                c.insert(_ns, *it);
+                if (!checkLastError(c)) {
+                    return false;
+                }
+            }
+            return true;
+        }
+        if (batch.size() > 1) {
+            vector<BSONObj> allButLast(batch.begin(), batch.end() - 1);
+            c.insert(_ns, allButLast, InsertOption_ContinueOnError);
+            checkLastError(c);
+        }
+        c.insert(_ns, batch.back());
+        checkLastError(c);
         return true;
     }
 
+    // Sends a chunk's objects as batched inserts, or upserts them one at a time.
+    // @return false if the import should stop
+    bool insertChunk(DBClientBase& c, const Chunk& chunk, bool& checkedFirst) {
+        bool ok = true;
+        if (_doimport && _upsert) {
+            for (vector<BSONObj>::const_iterator it = chunk.objs.begin(); it != chunk.objs.end(); ++it) {
+                const BSONObj& o = *it;
+                bool doUpsert = true;
+                BSONObjBuilder b;
+                for (vector<string>::const_iterator f=_upsertFields.begin(), end=_upsertFields.end(); f!=end; ++f) {
+                    BSONElement e = o.getFieldDotted(f->c_str());
+                    if (e.eoo()) {
+                        doUpsert = false;
+                        break;
+                    }
+                    b.appendAs(e, *f);
+                }
+
+                if (doUpsert) {
+                    c.update(_ns, Query(b.obj()), o, true);
+                }
+                else {
+                    c.insert( _ns.c_str() , o );
+                }
+                if (!checkedFirst) {
+                    checkLastError(c);
+                    checkedFirst = true;
+                }
+            }
+        }
+        else if (_doimport) {
+            vector<BSONObj> batch;
+            int batchBytes = 0;
+            for (vector<BSONObj>::const_iterator it = chunk.objs.begin(); it != chunk.objs.end() && ok; ++it) {
+                if (!batch.empty() && batchBytes + it->objsize() > BatchBytes) {
+                    ok = insertBatch(c, batch);
+                    batch.clear();
+                    batchBytes = 0;
+                }
+                batch.push_back(*it);
+                batchBytes += it->objsize();
+            }
+            if (!batch.empty() && ok) {
+                ok = insertBatch(c, batch);
+            }
+        }
+
+        scoped_lock lk(_statsMutex);
+        _num += chunk.objs.size();
+        _errors += chunk.errors;
+        if ( _pm->hit( chunk.bytes ) ) {
+            log() << "\t\t\t" << _num << "\t" << ( _num / std::max( time(0) - _start , (time_t) 1 ) ) << "/second" << endl;
+        }
+        return ok;
+    }
+
+    void inserterThread(DBClientBase* c) {
+        scoped_ptr<DBClientBase> owned;
+        try {
+            if (c == NULL) {
+                owned.reset(newConnection());
+                c = owned.get();
+            }
+            bool checkedFirst = false;
+            while (shared_ptr<Chunk> chunk = nextParsed()) {
+                if (!insertChunk(*c, *chunk, checkedFirst) || chunk->stopped) {
+                    stop();
+                    break;
+                }
+            }
+            if (_doimport) {
+                // this is for two reasons: to wait for all operations to reach the server and be
+                // processed, and to check if there was an error (on the last op)
+                checkLastError(*c);
+            }
+        }
+        catch ( std::exception& e ) {
+            log() << "exception:" << e.what() << endl;
+            {
+                scoped_lock lk(_statsMutex);
+                _errors++;
+            }
+            stop();
+        }
+    }
+
 public:
-    Import() : Tool( "import" ) {
+    Import() : Tool( "import" ),
+        _numParsers(1), _lineBuffer(new char[BUF_SIZE+2]),
+        _chunksMutex("Import::_chunksMutex"), _nextInsert(0), _numChunks(0),
+        _readDone(false), _stop(false),
+        _statsMutex("Import::_statsMutex"), _pm(NULL), _start(0), _num(0), _errors(0) {
         addFieldOptions();
         add_options()
         ("ignoreBlanks","if given, empty fields in csv and tsv will be ignored")
@@ -281,6 +598,8 @@ public:
         ("upsertFields", po::value<string>(), "comma-separated fields for the query part of the upsert. You should make sure this is indexed" )
         ("stopOnError", "stop importing at first error rather than continuing" )
         ("jsonArray", "load a json array, not one item per line. Currently limited to 16MB." )
+        ("numParsers", po::value<int>(), "number of threads parsing input (default: one per core)" )
+        ("numInsertionWorkers", po::value<int>()->default_value(1), "number of connections inserting at once when the bulk loader can't be used (upserts always use one)" )
         ;
         add_hidden_options()
         ("noimport", "don't actually import. useful for benchmarking parser" )
@@ -292,6 +611,7 @@ public:
         _upsert = false;
         _doimport = true;
         _jsonArray = false;
+        _stopOnError = false;
     }
     ;
     virtual void printExtraHelp( ostream & out ) {
@@ -304,8 +624,8 @@ public:
     unsigned long long lastErrorFailures;
 
     /** @return true if ok */
-    bool checkLastError() { 
-        string s = conn().getLastError();
+    bool checkLastError(DBClientBase& c) { 
+        string s = c.getLastError();
         if( !s.empty() ) { 
             if( str::contains(s,"uplicate") ) {
                 // we don't want to return an error from the mongoimport process for
@@ -313,6 +633,7 @@ public:
                 log() << s << endl;
             }
             else {
+                scoped_lock lk(_statsMutex);
                 lastErrorFailures++;
                 log() << "error: " << s << endl;
                 return false;
@@ -324,7 +645,6 @@ public:
     int run() {
         string filename = getParam( "file" );
         long long fileSize = 0;
-        int headerRows = 0;
 
         istream * in = &cin;
 
@@ -406,10 +726,7 @@ public:
 
         if ( _type == CSV || _type == TSV ) {
             _headerLine = hasParam( "headerline" );
-            if ( _headerLine ) {
-                headerRows = 1;
-            }
-            else {
+            if ( ! _headerLine ) {
                 needFields();
             }
         }
@@ -418,17 +735,34 @@ public:
             _jsonArray = true;
         }
 
-        time_t start = time(0);
+        _stopOnError = hasParam("stopOnError");
+        _numParsers = hasParam("numParsers") ? getParam("numParsers", 1)
+                                             : (int) boost::thread::hardware_concurrency();
+        _numParsers = std::max(_numParsers, 1);
+
+        _start = time(0);
         LOG(1) << "filesize: " << fileSize << endl;
-        ProgressMeter pm( fileSize );
-        int num = 0;
-        int lastNumChecked = num;
-        int errors = 0;
+        ProgressMeter pm( fileSize , 3 , 1 );
+        _pm = &pm;
+        _num = 0;
+        _errors = 0;
         lastErrorFailures = 0;
-        int len = 0;
-        // buffer and line are only used when parsing a jsonArray
-        boost::scoped_array<char> buffer(new char[BUF_SIZE+2]);
-        char* line = buffer.get();
+        _ns = ns;
+
+        if ( _headerLine ) {
+            // the header names the fields for every other row, so parse it before anything else
+            string row;
+            int len = 0;
+            bool got = false;
+            while ( !got && in->rdstate() == 0 ) {
+                got = readRow(in, row, len);
+            }
+            if ( got ) {
+                BSONObj o;
+                parseRow(row, o);
+            }
+            _headerLine = false;
+        }
 
         scoped_ptr<RemoteLoader> loader;
         if (_doBulkLoad) {
@@ -437,92 +771,39 @@ public:
             NamespaceString n(ns);
             loader.reset(new RemoteLoader(conn(), n.db, n.coll, vector<BSONObj>(), BSONObj()));
         }
-        while ( _jsonArray || in->rdstate() == 0 ) {
-            try {
-                BSONObj o;
-                if (_jsonArray) {
-                    int bytesProcessed = 0;
-                    if (line == buffer.get()) { // Only read on first pass - the whole array must be on one line.
-                        bytesProcessed = getLine(in, line);
-                        line += bytesProcessed;
-                        len += bytesProcessed;
-                    }
-                    if ((bytesProcessed = parseJSONArray(line, o)) < 0) {
-                        len += bytesProcessed;
-                        break;
-                    }
-                    len += bytesProcessed;
-                    line += bytesProcessed;
-                }
-                else {
-                    if (!parseRow(in, o, len)) {
-                        continue;
-                    }
-                }
-
-                if ( _headerLine ) {
-                    _headerLine = false;
-                }
-                else if (_doimport) {
-                    bool doUpsert = _upsert;
-                    BSONObjBuilder b;
-                    if (_upsert) {
-                        for (vector<string>::const_iterator it=_upsertFields.begin(), end=_upsertFields.end(); it!=end; ++it) {
-                            BSONElement e = o.getFieldDotted(it->c_str());
-                            if (e.eoo()) {
-                                doUpsert = false;
-                                break;
-                            }
-                            b.appendAs(e, *it);
-                        }
-                    }
-
-                    if (doUpsert) {
-                        conn().update(ns, Query(b.obj()), o, true);
-                    }
-                    else {
-                        conn().insert( ns.c_str() , o );
-                    }
 
-                    if( num < 10 ) { 
-                        // we absolutely want to check the first and last op of the batch. we do 
-                        // a few more as that won't be too time expensive.
-                        checkLastError();
-                        lastNumChecked = num;
-                    }
-                }
-
-                num++;
-            }
-            catch ( std::exception& e ) {
-                log() << "exception:" << e.what() << endl;
-                log() << line << endl;
-                errors++;
-
-                if (hasParam("stopOnError") || _jsonArray)
-                    break;
-            }
+        // Only this connection may write while the loader is in use, and upserts have to be
+        // applied in input order.
+        int numInserters = std::max(getParam("numInsertionWorkers", 1), 1);
+        if ((loader && loader->usingLoader()) || _upsert || !canOpenConnections()) {
+            numInserters = 1;
+        }
 
-            if ( pm.hit( len + 1 ) ) {
-                log() << "\t\t\t" << num << "\t" << ( num / ( time(0) - start ) ) << "/second" << endl;
-            }
+        boost::thread_group threads;
+        threads.create_thread(boost::bind(&Import::readerThread, this, in));
+        for (int i = 0; i < _numParsers; i++) {
+            threads.create_thread(boost::bind(&Import::parserThread, this));
+        }
+        for (int i = 1; i < numInserters; i++) {
+            threads.create_thread(boost::bind(&Import::inserterThread, this, (DBClientBase*) NULL));
         }
+        inserterThread(&conn());
+        threads.join_all();
+
         if (loader) {
             loader->commit();
         }
 
-        // this is for two reasons: to wait for all operations to reach the server and be processed, and this will wait until all data reaches the server,
-        // and secondly to check if there were an error (on the last op)
-        if( lastNumChecked+1 != num ) { // avoid redundant log message if already reported above
-            log() << "check " << lastNumChecked << " " << num << endl;
-            checkLastError();
-        }
+        const long long num = _num;
+        const long long errors = _errors;
+        const double secs = std::max((double) (time(0) - _start), 1.0);
+        log() << "\t\t\t" << num << " objects in " << secs << "s (" << (long long) (num / secs) << "/second)" << endl;
 
         bool hadErrors = lastErrorFailures || errors;
 
         // the message is vague on lastErrorFailures as we don't call it on every single operation. 
         // so if we have a lastErrorFailure there might be more than just what has been counted.
-        log() << (lastErrorFailures ? "tried to import " : "imported ") << ( num - headerRows ) << " objects" << endl;
+        log() << (lastErrorFailures ? "tried to import " : "imported ") << num << " objects" << endl;
 
         if ( !hadErrors )
             return 0;
@@ -24,6 +24,7 @@
 #include <boost/program_options.hpp>
 #include <boost/scoped_ptr.hpp>
 #include <boost/lexical_cast.hpp>
+#include <boost/thread/thread.hpp>
 #include <fcntl.h>
 #include <fstream>
 #include <set>
@@ -35,6 +36,8 @@
 #include "mongo/db/json.h"
 #include "mongo/client/dbclientcursor.h"
 #include "mongo/client/remote_loader.h"
+#include "mongo/util/net/message.h"
+#include "mongo/util/timer.h"
 
 using namespace mongo;
 
@@ -48,10 +51,7 @@ public:
     bool _restoreIndexes;
     int _w;
     bool _doBulkLoad;
-    string _curns;
-    string _curdb;
-    string _curcoll;
-    set<string> _users; // For restoring users with --drop
+    int _numWorkers;
 
     std::string _defaultCompression;
     BytesQuantity<int> _defaultPageSize;
@@ -59,7 +59,8 @@ public:
 
     Restore() : BSONTool( "restore" ),
         _drop(false), _restoreOptions(false), _restoreIndexes(false),
-        _w(0), _doBulkLoad(false) {
+        _w(0), _doBulkLoad(false), _numWorkers(1),
+        _jobsMutex("Restore::_jobsMutex"), _nextJob(0), _failed(false) {
         // Default values set here will show up in help text, but will supercede any default value
         // used when calling getParam below.
         add_options()
@@ -71,6 +72,7 @@ public:
         ("noIndexRestore" , "don't restore indexes")
         ("w" , po::value<int>()->default_value(0) , "minimum number of replicas per write. WARNING, setting w > 1 prevents the bulk load optimization." )
         ("noLoader", "don't use bulk loader")
+        ("numParallelCollections,j", po::value<int>()->default_value(1), "number of collections to restore at once, each over its own connection")
         ("defaultCompression", po::value(&_defaultCompression)->default_value(""), "default compression method to use for collections and indexes (unless otherwise specified in metadata.json)")
         ("defaultPageSize", po::value(&_defaultPageSize)->default_value(0), "default pageSize value to use for collections and indexes (unless otherwise specified in metadata.json)")
         ("defaultReadPageSize", po::value(&_defaultReadPageSize)->default_value(0), "default readPageSize value to use for collections and indexes (unless otherwise specified in metadata.json)")
@@ -113,6 +115,11 @@ public:
         if (hasParam( "noLoader" )) {
             _doBulkLoad = false;
         }
+        _numWorkers = std::max(getParam("numParallelCollections", 1), 1);
+        if (_numWorkers > 1 && !canOpenConnections()) {
+            log() << "--numParallelCollections needs a server connection, restoring one collection at a time" << endl;
+            _numWorkers = 1;
+        }
         if (hasParam( "keepIndexVersion" )) {
             log() << "warning: --keepIndexVersion is deprecated in TokuMX" << endl;
         }
@@ -133,14 +140,91 @@ public:
          * .bson file, or a single .bson file itself (a collection).
          */
         drillDown(root, _db != "", _coll != "", true);
-        string err = conn().getLastError(_db == "" ? "admin" : _db);
-        if (!err.empty()) {
-            error() << err;
+        if (!runJobs()) {
+            error() << "restore failed" << endl;
+            return -1;
         }
 
         return EXIT_CLEAN;
     }
 
+    // One .bson file to restore, queued by drillDown.
+    struct RestoreJob {
+        boost::filesystem::path root;
+        string ns;
+        string oldCollName; // Name of the collection that was dumped from
+    };
+
+    // The state of restoring one collection over one connection.
+    struct CollectionRestore : boost::noncopyable {
+        CollectionRestore(DBClientBase& c, const string& ns_)
+            : conn(c), ns(ns_), batchBytes(0), objects(0), bytes(0) {
+            NamespaceString nss(ns);
+            db = nss.db;
+            coll = nss.coll;
+        }
+
+        DBClientBase& conn;
+        string ns;
+        string db;
+        string coll;
+        vector<BSONObj> batch;
+        int batchBytes;
+        set<string> users; // For restoring users with --drop
+        long long objects;
+        long long bytes;
+    };
+
+    void restoreWorker() {
+        scoped_ptr<DBClientBase> owned;
+        try {
+            DBClientBase* c = &conn();
+            if (_numWorkers > 1) {
+                owned.reset(newConnection());
+                c = owned.get();
+            }
+            while (true) {
+                RestoreJob job;
+                {
+                    scoped_lock lk(_jobsMutex);
+                    if (_nextJob >= _jobs.size()) {
+                        break;
+                    }
+                    job = _jobs[_nextJob++];
+                }
+                restoreCollection(*c, job);
+            }
+            string err = c->getLastError(_db == "" ? "admin" : _db);
+            if (!err.empty()) {
+                error() << err << endl;
+            }
+        }
+        catch (DBException& e) {
+            error() << "restore worker failed: " << e.toString() << endl;
+            scoped_lock lk(_jobsMutex);
+            _failed = true;
+        }
+    }
+
+    // Restores every queued file on _numWorkers connections.  Returns false if any failed.
+    bool runJobs() {
+        _nextJob = 0;
+        _failed = false;
+        if (_numWorkers > 1 && _jobs.size() > 1) {
+            boost::thread_group workers;
+            for (int i = 0; i < _numWorkers; i++) {
+                workers.create_thread(boost::bind(&Restore::restoreWorker, this));
+            }
+            workers.join_all();
+        }
+        else {
+            restoreWorker();
+        }
+        bool ok = !_failed && _nextJob == _jobs.size();
+        _jobs.clear();
+        return ok;
+    }
+
     void drillDown( boost::filesystem::path root, bool use_db, bool use_coll, bool top_level=false ) {
         LOG(2) << "drillDown: " << root.string() << endl;
 
@@ -216,35 +300,45 @@ public:
 
         verify( ns.size() );
 
-        string oldCollName = root.leaf().string(); // Name of the collection that was dumped from
-        oldCollName = oldCollName.substr( 0 , oldCollName.find_last_of( "." ) );
+        RestoreJob job;
+        job.root = root;
+        job.oldCollName = root.leaf().string();
+        job.oldCollName = job.oldCollName.substr( 0 , job.oldCollName.find_last_of( "." ) );
         if (use_coll) {
             ns += "." + _coll;
         }
         else {
-            ns += "." + oldCollName;
+            ns += "." + job.oldCollName;
         }
+        job.ns = ns;
+        _jobs.push_back(job);
+    }
+
+    void restoreCollection( DBClientBase& c, const RestoreJob& job ) {
+        const boost::filesystem::path& root = job.root;
+        const string& ns = job.ns;
+        CollectionRestore cr(c, ns);
 
         log() << "\tgoing into namespace [" << ns << "]" << endl;
 
         if ( _drop ) {
             if (root.leaf() != "system.users.bson" ) {
                 log() << "\t dropping" << endl;
-                conn().dropCollection( ns );
+                c.dropCollection( ns );
             } else {
                 // Create map of the users currently in the DB
                 BSONObj fields = BSON("user" << 1);
-                scoped_ptr<DBClientCursor> cursor(conn().query(ns, Query(), 0, 0, &fields));
+                scoped_ptr<DBClientCursor> cursor(c.query(ns, Query(), 0, 0, &fields));
                 while (cursor->more()) {
                     BSONObj user = cursor->next();
-                    _users.insert(user["user"].String());
+                    cr.users.insert(user["user"].String());
                 }
             }
         }
 
         BSONObj metadataObject;
         if (_restoreOptions || _restoreIndexes) {
-            boost::filesystem::path metadataFile = (root.branch_path() / (oldCollName + ".metadata.json"));
+            boost::filesystem::path metadataFile = (root.branch_path() / (job.oldCollName + ".metadata.json"));
             if (!boost::filesystem::exists(metadataFile.string())) {
                 // This is fine because dumps from before 2.1 won't have a metadata file, just print a warning.
                 // System collections shouldn't have metadata so don't warn if that file is missing.
@@ -256,15 +350,10 @@ public:
             }
         }
 
-        _curns = ns.c_str();
-        NamespaceString nss(_curns);
-        _curdb = nss.db;
-        _curcoll = nss.coll;
-
         // If drop is not used, warn if the collection exists.
         if (!_drop) {
-            scoped_ptr<DBClientCursor> cursor(conn().query(_curdb + ".system.namespaces",
-                                                            Query(BSON("name" << ns))));
+            scoped_ptr<DBClientCursor> cursor(c.query(cr.db + ".system.namespaces",
+                                                      Query(BSON("name" << ns))));
             if (cursor->more()) {
                 // collection already exists show warning
                 warning() << "Restoring to " << ns << " without dropping. Restored data "
@@ -278,67 +367,120 @@ public:
             const vector<BSONElement> indexElements = metadataObject["indexes"].Array();
             for (vector<BSONElement>::const_iterator it = indexElements.begin(); it != indexElements.end(); ++it) {
                 // Need to make sure the ns field gets updated to
-                // the proper _curdb + _curns value, if we're
+                // the proper db + coll value, if we're
                 // restoring to a different database.
                 // Also need to update the options with any defaults specified on the command line
-                indexes.push_back(updateOptions(renameIndexNs(it->Obj())));
+                indexes.push_back(updateOptions(renameIndexNs(cr, it->Obj())));
             }
         }
         const BSONObj options = updateOptions(_restoreOptions && metadataObject.hasField("options")
                                               ? metadataObject["options"].Obj()
                                               : BSONObj());
 
+        const boost::function<void(const BSONObj&)> handler =
+                boost::bind(&Restore::insertObject, this, boost::ref(cr), _1);
+        Timer t;
         if (_doBulkLoad && !options["partitioned"].trueValue()) {
-            RemoteLoader loader(conn(), _curdb, _curcoll, indexes, options);
-            processFile( root );
+            RemoteLoader loader(c, cr.db, cr.coll, indexes, options);
+            processFile( root , handler );
+            flush( cr );
             BSONObj res;
             bool ok = loader.commit(&res);
             if (!ok) {
-                error() << "Error committing load for " << _curdb << "." << _curcoll << ": " << res << endl;
+                error() << "Error committing load for " << ns << ": " << res << endl;
             }
         } else {
             // No bulk load. Create collection and indexes manually.
             if (!options.isEmpty()) {
-                createCollectionWithOptions(options, metadataObject);
+                createCollectionWithOptions(cr, options, metadataObject);
             }
             // Build indexes last - it's a little faster.
-            processFile( root );
+            processFile( root , handler );
+            flush( cr );
             for (vector<BSONObj>::iterator it = indexes.begin(); it != indexes.end(); ++it) {
-                createIndex(*it);
+                createIndex(cr, *it);
             }
         }
 
+        const double secs = std::max(t.micros() / 1000000.0, 0.001);
+        log() << "\tfinished " << ns << ": " << cr.objects << " objects, "
+              << cr.bytes / (1024 * 1024) << "MB in " << secs << "s ("
+              << (long long) (cr.objects / secs) << " objects/s, "
+              << cr.bytes / secs / (1024 * 1024) << " MB/s)" << endl;
+
         if (_drop && root.leaf() == "system.users.bson") {
             // Delete any users that used to exist but weren't in the dump file
-            for (set<string>::iterator it = _users.begin(); it != _users.end(); ++it) {
+            for (set<string>::iterator it = cr.users.begin(); it != cr.users.end(); ++it) {
                 BSONObj userMatch = BSON("user" << *it);
-                conn().remove(ns, Query(userMatch));
+                c.remove(ns, Query(userMatch));
             }
-            _users.clear();
         }
     }
 
     virtual void gotObject( const BSONObj& obj ) {
-        StringData collstr = nsToCollectionSubstring(_curns);
+        // Each collection is processed with its own insertObject handler, see restoreCollection.
+        verify(false);
+    }
+
+    void insertObject( CollectionRestore& cr, const BSONObj& obj ) {
+        StringData collstr = nsToCollectionSubstring(cr.ns);
         massert( 16910, "Shouldn't be inserting into system.indexes directly",
                         collstr != "system.indexes" );
-        if (_drop && collstr == "system.users" && _users.count(obj["user"].String())) {
+        cr.objects++;
+        cr.bytes += obj.objsize();
+        if (_drop && collstr == "system.users" && cr.users.count(obj["user"].String())) {
             // Since system collections can't be dropped, we have to manually
             // replace the contents of the system.users collection
+            flush(cr);
             BSONObj userMatch = BSON("user" << obj["user"].String());
-            conn().update(_curns, Query(userMatch), obj);
-            _users.erase(obj["user"].String());
+            cr.conn.update(cr.ns, Query(userMatch), obj);
+            cr.users.erase(obj["user"].String());
+        } else if (NamespaceString::isSystem(cr.ns)) {
+            // the server only takes system collection inserts one at a time
+            flush(cr);
+            insertOne(cr, obj);
         } else {
-            conn().insert( _curns , obj );
+            if (cr.batchBytes + obj.objsize() > BatchBytes) {
+                flush(cr);
+            }
+            // processFile reuses its buffer for the next object
+            cr.batch.push_back(obj.getOwned());
+            cr.batchBytes += obj.objsize();
+        }
+    }
 
-            // wait for insert to propagate to "w" nodes (doesn't warn if w used without replset)
-            if ( _w > 0 ) {
-                string err = conn().getLastError(_curdb, false, false, _w);
-                if (!err.empty()) {
-                    error() << err << endl;
-                }
+    void insertOne( CollectionRestore& cr, const BSONObj& obj ) {
+        cr.conn.insert( cr.ns , obj );
+
+        // wait for insert to propagate to "w" nodes (doesn't warn if w used without replset)
+        if ( _w > 0 ) {
+            string err = cr.conn.getLastError(cr.db, false, false, _w);
+            if (!err.empty()) {
+                error() << err << endl;
+            }
+        }
+    }
+
+    // Sends the batched inserts without ever sending a document twice.  Under ContinueOnError
+    // the server leaves out the documents that fail and commits the rest, unless the last one
+    // fails, which aborts the whole insert.  So all but the last document go out as one message
+    // and the last one goes out on its own, and a failure never needs a resend.
+    void flush( CollectionRestore& cr ) {
+        if (cr.batch.empty()) {
+            return;
+        }
+        if (cr.batch.size() > 1) {
+            vector<BSONObj> allButLast(cr.batch.begin(), cr.batch.end() - 1);
+            cr.conn.insert( cr.ns , allButLast , InsertOption_ContinueOnError );
+            string err = cr.conn.getLastError(cr.db, false, false, 0);
+            if (!err.empty()) {
+                error() << err << endl;
             }
         }
+        // waits for the whole batch to propagate to "w" nodes
+        insertOne(cr, cr.batch.back());
+        cr.batch.clear();
+        cr.batchBytes = 0;
     }
 
 private:
@@ -406,14 +548,14 @@ private:
         return nfields == obj2.nFields();
     }
 
-    void createCollectionWithOptions(BSONObj obj, BSONObj metadataObject) {
+    void createCollectionWithOptions(CollectionRestore& cr, BSONObj obj, BSONObj metadataObject) {
         BSONObjIterator i(obj);
 
         // Rebuild obj as a command object for the "create" command.
         // - {create: <name>} comes first, where <name> is the new name for the collection
         // - elements with type Undefined get skipped over
         BSONObjBuilder bo;
-        bo.append("create", _curcoll);
+        bo.append("create", cr.coll);
         while (i.more()) {
             BSONElement e = i.next();
 
@@ -422,7 +564,7 @@ private:
             }
 
             if (e.type() == Undefined) {
-                log() << _curns << ": skipping undefined field: " << e.fieldName() << endl;
+                log() << cr.ns << ": skipping undefined field: " << e.fieldName() << endl;
                 continue;
             }
 
@@ -431,17 +573,17 @@ private:
         obj = bo.obj();
 
         BSONObj fields = BSON("options" << 1);
-        scoped_ptr<DBClientCursor> cursor(conn().query(_curdb + ".system.namespaces", Query(BSON("name" << _curns)), 0, 0, &fields));
+        scoped_ptr<DBClientCursor> cursor(cr.conn.query(cr.db + ".system.namespaces", Query(BSON("name" << cr.ns)), 0, 0, &fields));
 
         bool createColl = true;
         if (cursor->more()) {
             createColl = false;
             if (metadataObject["partitioned"].trueValue()) {
-                log() << "Collection " << _curns << " already exists, so we will not be creating the automatic partitions" << endl;
+                log() << "Collection " << cr.ns << " already exists, so we will not be creating the automatic partitions" << endl;
             }
             BSONObj nsObj = cursor->next();
             if (!nsObj.hasField("options") || !optionsSame(obj, nsObj["options"].Obj())) {
-                    log() << "WARNING: collection " << _curns << " exists with different options than are in the metadata.json file and not using --drop. Options in the metadata file will be ignored." << endl;
+                    log() << "WARNING: collection " << cr.ns << " exists with different options than are in the metadata.json file and not using --drop. Options in the metadata file will be ignored." << endl;
             }
         }
 
@@ -450,10 +592,10 @@ private:
         }
 
         BSONObj info;
-        if (!conn().runCommand(_curdb, obj, info)) {
-            uasserted(15936, "Creating collection " + _curns + " failed. Errmsg: " + info["errmsg"].String());
+        if (!cr.conn.runCommand(cr.db, obj, info)) {
+            uasserted(15936, "Creating collection " + cr.ns + " failed. Errmsg: " + info["errmsg"].String());
         } else {
-            log() << "\tCreated collection " << _curns << " with options: " << obj.jsonString() << endl;
+            log() << "\tCreated collection " << cr.ns << " with options: " << obj.jsonString() << endl;
             if (metadataObject["partitionInfo"].trueValue()) {
                 BSONObj res;
                 BSONObjBuilder b;
@@ -462,20 +604,19 @@ private:
                 b.appendAs(pInfo["partitions"], "info");
                 BSONObj o = b.obj();
                 log() << "the obj, " << o << endl;
-                bool ok = conn().runCommand(_curdb, o, info);
+                bool ok = cr.conn.runCommand(cr.db, o, info);
                 log() << "ok: " << ok << "info: " << info << endl;
             }
         }
     }
 
-    BSONObj renameIndexNs(const BSONObj &orig) {
+    BSONObj renameIndexNs(const CollectionRestore& cr, const BSONObj &orig) {
         BSONObjBuilder bo;
         BSONObjIterator i(orig);
         while ( i.more() ) {
             BSONElement e = i.next();
             if (strcmp(e.fieldName(), "ns") == 0) {
-                string s = _curdb + "." + _curcoll;
-                bo.append("ns", s);
+                bo.append("ns", cr.ns);
             }
             else if (strcmp(e.fieldName(), "v") != 0) { // Remove index version number
                 bo.append(e);
@@ -486,12 +627,12 @@ private:
 
     /* We must handle if the dbname or collection name is different at restore time than what was dumped.
      */
-    void createIndex(BSONObj indexObj) {
+    void createIndex(CollectionRestore& cr, BSONObj indexObj) {
         LOG(0) << "\tCreating index: " << indexObj << endl;
-        conn().insert( _curdb + ".system.indexes" ,  indexObj );
+        cr.conn.insert( cr.db + ".system.indexes" ,  indexObj );
 
         // We're stricter about errors for indexes than for regular data
-        BSONObj err = conn().getLastErrorDetailed(_curdb, false, false, _w);
+        BSONObj err = cr.conn.getLastErrorDetailed(cr.db, false, false, _w);
 
         if (err.hasField("err") && !err["err"].isNull()) {
             if (err["err"].str() == "norepl" && _w > 1) {
@@ -514,6 +655,14 @@ private:
         massert(16441, str::stream() << "Error calling getLastError: " << err["errmsg"],
                 err["ok"].trueValue());
     }
+
+    // Leaves room for the message header and namespace.
+    static const int BatchBytes = MaxMessageSizeBytes - 16 * 1024;
+
+    mongo::mutex _jobsMutex;
+    vector<RestoreJob> _jobs;
+    size_t _nextJob;
+    bool _failed;
 };
 
 int main( int argc , char ** argv, char ** envp ) {
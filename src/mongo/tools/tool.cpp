@@ -432,10 +432,33 @@ namespace mongo {
             return;
         }
 
-        _conn->auth( BSON( saslCommandPrincipalSourceFieldName << getAuthenticationDatabase() <<
-                           saslCommandPrincipalFieldName << _username <<
-                           saslCommandPasswordFieldName << _password  <<
-                           saslCommandMechanismFieldName << _authenticationMechanism ) );
+        auth( *_conn );
+    }
+
+    void Tool::auth( DBClientBase &c ) {
+        if ( _username.empty() ) {
+            return;
+        }
+
+        c.auth( BSON( saslCommandPrincipalSourceFieldName << getAuthenticationDatabase() <<
+                      saslCommandPrincipalFieldName << _username <<
+                      saslCommandPasswordFieldName << _password  <<
+                      saslCommandMechanismFieldName << _authenticationMechanism ) );
+    }
+
+    DBClientBase* Tool::newConnection() {
+        verify( canOpenConnections() );
+
+        string errmsg;
+        ConnectionString cs = ConnectionString::parse( _host , errmsg );
+        // _host was already parsed successfully when the first connection was made
+        verify( cs.isValid() );
+
+        auto_ptr<DBClientBase> c( cs.connect( errmsg ) );
+        uassert( 17377 , str::stream() << "couldn't connect to [" << _host << "] " << errmsg ,
+                 c.get() );
+        auth( *c );
+        return c.release();
     }
 
     BSONTool::BSONTool( const char * name, DBAccess access , bool objcheck )
@@ -463,18 +486,24 @@ namespace mongo {
 
     long long BSONTool::processFile( const boost::filesystem::path& root ) {
         _fileName = root.string();
+        return processFile( root , boost::bind( &BSONTool::gotObject , this , _1 ) );
+    }
+
+    long long BSONTool::processFile( const boost::filesystem::path& root ,
+                                     const boost::function<void(const BSONObj&)>& handler ) {
+        const string fileName = root.string();
 
         unsigned long long fileLength = file_size( root );
 
         if ( fileLength == 0 ) {
-            out() << "file " << _fileName << " empty, skipping" << endl;
+            out() << "file " << fileName << " empty, skipping" << endl;
             return 0;
         }
 
 
-        FILE* file = fopen( _fileName.c_str() , "rb" );
+        FILE* file = fopen( fileName.c_str() , "rb" );
         if ( ! file ) {
-            log() << "error opening file: " << _fileName << " " << errnoWithDescription() << endl;
+            log() << "error opening file: " << fileName << " " << errnoWithDescription() << endl;
             return 0;
         }
 
@@ -524,7 +553,7 @@ namespace mongo {
             }
 
             if ( _matcher.get() == 0 || _matcher->matches( o ) ) {
-                gotObject( o );
+                handler( o );
                 processed++;
             }
 
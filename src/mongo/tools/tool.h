@@ -106,6 +106,14 @@ namespace mongo {
 
         mongo::DBClientBase &conn( bool slaveIfPaired = false );
 
+        /**
+         * Opens another authenticated connection to the same host, for tools that work over
+         * several connections at once.  The caller owns the result.  Not available with
+         * --dbpath, where there is only the one DBDirectClient.
+         */
+        mongo::DBClientBase *newConnection();
+        bool canOpenConnections() const { return _host != "DIRECT" && !_noconnection; }
+
         string _name;
 
         string _db;
@@ -144,6 +152,7 @@ namespace mongo {
 
     private:
         void auth();
+        void auth( mongo::DBClientBase &c );
     };
 
     class BSONTool : public Tool {
@@ -160,6 +169,13 @@ namespace mongo {
 
         long long processFile( const boost::filesystem::path& file );
 
+        /**
+         * Like processFile, but hands each object to handler instead of gotObject and touches no
+         * member state, so several files can be processed at once by different threads.
+         */
+        long long processFile( const boost::filesystem::path& file ,
+                               const boost::function<void(const BSONObj&)>& handler );
+
     };
 
 }
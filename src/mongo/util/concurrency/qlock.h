@@ -21,6 +21,10 @@
 #include <boost/noncopyable.hpp>
 #include <boost/thread/mutex.hpp>
 #include <boost/thread/condition.hpp>
+#if defined(__linux__)
+#include <sched.h>
+#endif
+#include "mongo/platform/atomic_word.h"
 #include "../assert_util.h"
 #include "../time_support.h"
 
@@ -67,9 +71,37 @@ namespace mongo {
             boost::condition c;
             int n;
         };
+
+        /* r and w holders aren't counted under m.  Each CPU has its own pair of counters on its
+           own cache line, and while nothing that conflicts with r (or w) is held or wanted,
+           lock_r/unlock_r (lock_w/unlock_w) only touch the counters of the CPU they run on.
+           Threads requesting a conflicting state first block the fast path by setting
+           flags.rBlocked/wBlocked under m, and only then sum the counters; a fast path that
+           increments its counter and then sees the flag set backs off and takes m.  Unlocks
+           only take m to notify when someone is waiting for holders to leave.  r.n and w.n
+           are not used.
+        */
+        struct Counts {
+            Counts() : r(0), w(0) { }
+            AtomicInt32 r;
+            AtomicInt32 w;
+        };
+        typedef Padded<Counts, 128> Slot;
+        enum { NumSlots = 64 };
+        Slot slots[NumSlots];
+
+        struct Flags {
+            Flags() : rBlocked(0), wBlocked(0), waiters(0) { }
+            AtomicInt32 rBlocked;
+            AtomicInt32 wBlocked;
+            AtomicInt32 waiters;   // threads waiting for r or w holders to leave
+        };
+        Padded<Flags, 128> flags;
+
         boost::mutex m;
         Z r,w,R,W,U,X;
         int numPendingGlobalWrites;  // >0 if someone wants to acquire a write lock
+        int numPendingR;             // R requests waiting, only block the w fast path
         long long generationX;
         long long generationXExit;
         void _lock_W();
@@ -78,8 +110,51 @@ namespace mongo {
             return numPendingGlobalWrites > 0;
         }
 
-        bool W_legal() const { return r.n + w.n + R.n + W.n + X.n == 0; }
-        bool R_legal_ignore_greed() const { return w.n + W.n + X.n == 0; }
+        // A thread may lock and unlock on different slots, only the sums matter.
+        Slot& mySlot() {
+#if defined(__linux__)
+            const int cpu = sched_getcpu();
+            if ( cpu >= 0 )
+                return slots[cpu % NumSlots];
+#endif
+            // different threads' stacks are far apart
+            char here;
+            return slots[(reinterpret_cast<size_t>(&here) >> 16) % NumSlots];
+        }
+
+        // counts can be transiently high while a fast path backs off, never low
+        int nr() const {
+            int n = 0;
+            for ( int i = 0; i < NumSlots; i++ )
+                n += slots[i].r.loadRelaxed();
+            return n;
+        }
+        int nw() const {
+            int n = 0;
+            for ( int i = 0; i < NumSlots; i++ )
+                n += slots[i].w.loadRelaxed();
+            return n;
+        }
+
+        // call with m held after changing anything r_legal or w_legal depends on, and before
+        // looking at nr() or nw()
+        void updateFastPaths() {
+            const int rb = r_legal() ? 0 : 1;
+            const int wb = w_legal() && numPendingR == 0 ? 0 : 1;
+            if ( flags.rBlocked.loadRelaxed() != rb )
+                flags.rBlocked.store(rb);
+            if ( flags.wBlocked.loadRelaxed() != wb )
+                flags.wBlocked.store(wb);
+        }
+
+        struct Waiting : boost::noncopyable {
+            AtomicInt32& _waiters;
+            Waiting(AtomicInt32& waiters) : _waiters(waiters) { _waiters.fetchAndAdd(1); }
+            ~Waiting() { _waiters.fetchAndSubtract(1); }
+        };
+
+        bool W_legal() const { return nr() + nw() + R.n + W.n + X.n == 0; }
+        bool R_legal_ignore_greed() const { return nw() + W.n + X.n == 0; }
         bool r_legal_ignore_greed() const { return W.n + X.n == 0; }
         bool w_legal_ignore_greed() const { return R.n + W.n + X.n == 0; }
 
@@ -95,13 +170,14 @@ namespace mongo {
             return !_areQueueJumpingGlobalWritesPending() && r_legal_ignore_greed();
         }
 
-        bool X_legal() const { return w.n + r.n + R.n + W.n == 0; }
+        bool X_legal() const { return nw() + nr() + R.n + W.n == 0; }
 
         void notifyWeUnlocked(char me);
         static bool i_block(char me, char them);
     public:
         QLock() :
             numPendingGlobalWrites(0),
+            numPendingR(0),
             generationX(0),
             generationXExit(0) {
         }
@@ -120,6 +196,9 @@ namespace mongo {
         void R_to_W(); // caution see notes below
         bool w_to_X();
         void X_to_w();
+
+        /** Take w only if that doesn't involve waiting or touching shared state. */
+        bool lock_w_try_fast();
     };
 
     inline bool QLock::i_block(char me, char them) {
@@ -136,25 +215,29 @@ namespace mongo {
 
     inline void QLock::notifyWeUnlocked(char me) {
         fassert(16201, W.n == 0);
+        // summing the slots isn't free, do it once
+        const int rw = nr() + nw();
         if ( me == 'X' ) {
             X.c.notify_all();
         }
         if( U.n ) {
             // U is highest priority
-            if( (r.n + w.n + W.n + X.n == 0) && (R.n == 1) ) {
+            if( (rw + W.n + X.n == 0) && (R.n == 1) ) {
                 U.c.notify_one();
                 return;
             }
         }
-        if ( X_legal() && i_block(me, 'X') ) {
+        if ( rw + R.n + W.n == 0 && i_block(me, 'X') ) {
+            // X_legal()
             X.c.notify_one();
         }
-        if ( W_legal() && i_block(me, 'W') ) {
+        if ( rw + R.n + W.n + X.n == 0 && i_block(me, 'W') ) {
+            // W_legal()
             W.c.notify_one();
             if( _areQueueJumpingGlobalWritesPending() )
                 return;
         }
-        if ( R_legal_ignore_greed() && i_block(me, 'R') ) {
+        if ( i_block(me, 'R') && R_legal_ignore_greed() ) {
             R.c.notify_all();
         }
         if ( w_legal_ignore_greed() && i_block(me, 'w') ) {
@@ -168,44 +251,88 @@ namespace mongo {
     // "i will be reading. i promise to coordinate my activities with w's as i go with more 
     //  granular locks."
     inline void QLock::lock_r() {
+        bool backedOff = false;
+        if ( !flags.rBlocked.loadRelaxed() ) {
+            Slot& s = mySlot();
+            s.r.fetchAndAdd(1);
+            if ( !flags.rBlocked.load() )
+                return;
+            s.r.fetchAndSubtract(1);
+            backedOff = true;
+        }
         boost::mutex::scoped_lock lk(m);
+        if ( backedOff && W.n == 0 ) {
+            // someone may have counted us
+            notifyWeUnlocked('r');
+        }
         while( !r_legal() ) {
             r.c.wait(m);
         }
-        r.n++;
+        mySlot().r.fetchAndAdd(1);
     }
 
     // "i will be writing. i promise to coordinate my activities with w's and r's as i go with more 
     //  granular locks."
     inline void QLock::lock_w() { 
+        if ( lock_w_try_fast() )
+            return;
         boost::mutex::scoped_lock lk(m);
+        if ( W.n == 0 ) {
+            // we may have backed off, and someone may have counted us
+            notifyWeUnlocked('w');
+        }
         while( !w_legal() ) {
             w.c.wait(m);
         }
-        w.n++;
+        mySlot().w.fetchAndAdd(1);
+    }
+
+    inline bool QLock::lock_w_try_fast() {
+        if ( flags.wBlocked.loadRelaxed() )
+            return false;
+        Slot& s = mySlot();
+        s.w.fetchAndAdd(1);
+        if ( !flags.wBlocked.load() )
+            return true;
+        s.w.fetchAndSubtract(1);
+        return false;
     }
 
     // "i will be reading. i will coordinate with no one. you better stop them if they
     // are writing."
     inline void QLock::lock_R() {
         boost::mutex::scoped_lock lk(m);
-        while( ! R_legal() ) {
-            R.c.wait(m);
+        ++numPendingR;
+        updateFastPaths();
+        if ( !R_legal() ) {
+            Waiting waiting(flags.waiters);
+            while( ! R_legal() ) {
+                R.c.wait(m);
+            }
         }
+        --numPendingR;
         R.n++;
+        updateFastPaths();
     }
 
     inline bool QLock::lock_R_try(int millis) {
         unsigned long long end = curTimeMillis64() + millis;
         boost::mutex::scoped_lock lk(m);
-        while( !R_legal() && curTimeMillis64() < end ) {
-            R.c.timed_wait(m, boost::posix_time::milliseconds(millis));
+        ++numPendingR;
+        updateFastPaths();
+        {
+            Waiting waiting(flags.waiters);
+            while( !R_legal() && curTimeMillis64() < end ) {
+                R.c.timed_wait(m, boost::posix_time::milliseconds(millis));
+            }
         }
-        if ( R_legal() ) {
+        --numPendingR;
+        const bool got = R_legal();
+        if ( got ) {
             R.n++;
-            return true;
         }
-        return false;
+        updateFastPaths();
+        return got;
     }
 
     inline bool QLock::lock_W_try(int millis) {
@@ -213,17 +340,25 @@ namespace mongo {
         boost::mutex::scoped_lock lk(m);
 
         ++numPendingGlobalWrites;
-        while (!W_legal() && curTimeMillis64() < end) {
-            W.c.timed_wait(m, boost::posix_time::milliseconds(millis));
+        updateFastPaths();
+        {
+            Waiting waiting(flags.waiters);
+            while (!W_legal() && curTimeMillis64() < end) {
+                W.c.timed_wait(m, boost::posix_time::milliseconds(millis));
+            }
         }
         --numPendingGlobalWrites;
 
         if (W_legal()) {
             W.n++;
             fassert( 16202, W.n == 1 );
+            updateFastPaths();
             return true;
         }
 
+        updateFastPaths();
+        // we blocked the fast paths for a while, let through whoever went slow meanwhile
+        notifyWeUnlocked('W');
         return false;
     }
 
@@ -236,6 +371,7 @@ namespace mongo {
         fassert(16205, U.n == 0);
         W.n = 0;
         R.n = 1;
+        updateFastPaths();
         notifyWeUnlocked('W');
     }
 
@@ -258,9 +394,13 @@ namespace mongo {
         U.n = 1;
 
         ++numPendingGlobalWrites;
+        updateFastPaths();
 
-        while( W.n + R.n + w.n + r.n > 1 ) {
-            U.c.wait(m);
+        {
+            Waiting waiting(flags.waiters);
+            while( W.n + R.n + nw() + nr() > 1 ) {
+                U.c.wait(m);
+            }
         }
         --numPendingGlobalWrites;
 
@@ -271,24 +411,28 @@ namespace mongo {
         R.n = 0;
         W.n = 1;
         U.n = 0;
+        updateFastPaths();
     }
 
     inline bool QLock::w_to_X() {
         boost::mutex::scoped_lock lk(m);
 
-        fassert( 16212, w.n > 0 );
+        fassert( 16212, nw() > 0 );
 
         ++X.n;
-        --w.n;
+        updateFastPaths();
+        mySlot().w.fetchAndSubtract(1);
 
         long long myGeneration = generationX;
 
+        Waiting waiting(flags.waiters);
         while ( !X_legal() && (myGeneration == generationX) )
             X.c.wait(m);
 
         if ( myGeneration == generationX ) {
-            fassert( 16214, X_legal() );
-            fassert( 16215, w.n == 0 );
+            // X_legal() held when the loop ended.  w can only be transiently nonzero now, from
+            // fast paths that will see they are blocked and back off.
+            fassert( 16214, R.n == 0 && W.n == 0 );
             ++generationX;
             notifyWeUnlocked('w');
             return true;
@@ -298,7 +442,7 @@ namespace mongo {
             X.c.wait(m);
 
         fassert( 16216, R.n == 0 );
-        fassert( 16217, w.n > 0 );
+        fassert( 16217, nw() > 0 );
         return false;
     }
 
@@ -307,23 +451,28 @@ namespace mongo {
 
         fassert( 16219, W.n == 0 );
         fassert( 16220, R.n == 0 );
-        fassert( 16221, w.n == 0 );
         fassert( 16222, X.n > 0 );
 
-        w.n = X.n;
+        mySlot().w.fetchAndAdd(X.n);
         X.n = 0;
         ++generationXExit;
+        updateFastPaths();
         notifyWeUnlocked('X');
     }
 
     // "i will be writing. i will coordinate with no one. you better stop them all"
     inline void QLock::_lock_W() {
         ++numPendingGlobalWrites;
-        while( !W_legal() ) {
-            W.c.wait(m);
+        updateFastPaths();
+        if ( !W_legal() ) {
+            Waiting waiting(flags.waiters);
+            while( !W_legal() ) {
+                W.c.wait(m);
+            }
         }
         --numPendingGlobalWrites;
         W.n++;
+        updateFastPaths();
     }
     inline void QLock::lock_W() {
         boost::mutex::scoped_lock lk(m);
@@ -331,16 +480,22 @@ namespace mongo {
     }
 
     inline void QLock::unlock_r() {
-        boost::mutex::scoped_lock lk(m);
-        fassert(16137, r.n > 0);
-        --r.n;
-        notifyWeUnlocked('r');
+        mySlot().r.fetchAndSubtract(1);
+        if ( flags.waiters.load() ) {
+            boost::mutex::scoped_lock lk(m);
+            // whoever was waiting for us may already have W
+            if ( W.n == 0 )
+                notifyWeUnlocked('r');
+        }
     }
     inline void QLock::unlock_w() {
-        boost::mutex::scoped_lock lk(m);
-        fassert(16138, w.n > 0);
-        --w.n;
-        notifyWeUnlocked('w');
+        mySlot().w.fetchAndSubtract(1);
+        if ( flags.waiters.load() ) {
+            boost::mutex::scoped_lock lk(m);
+            // whoever was waiting for us may already have W
+            if ( W.n == 0 )
+                notifyWeUnlocked('w');
+        }
     }
 
     inline void QLock::unlock_R() {
@@ -351,6 +506,7 @@ namespace mongo {
     inline void QLock::_unlock_R() {
         fassert(16139, R.n > 0);
         --R.n;
+        updateFastPaths();
         notifyWeUnlocked('R');
     }
 
@@ -358,6 +514,7 @@ namespace mongo {
         boost::mutex::scoped_lock lk(m);
         fassert(16140, W.n == 1);
         --W.n;
+        updateFastPaths();
         notifyWeUnlocked('W');
     }
 
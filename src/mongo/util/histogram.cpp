@@ -108,6 +108,26 @@ namespace mongo {
         return _numBuckets;
     }
 
+    uint32_t Histogram::getPercentile( uint32_t percent ) const {
+        uint64_t total = 0;
+        for ( uint32_t i = 0; i < _numBuckets; i++ ) {
+            total += _buckets[i];
+        }
+        if ( total == 0 ) {
+            return 0;
+        }
+
+        const uint64_t want = ( total * percent + 99 ) / 100;
+        uint64_t seen = 0;
+        for ( uint32_t i = 0; i < _numBuckets; i++ ) {
+            seen += _buckets[i];
+            if ( seen >= want ) {
+                return _boundaries[i];
+            }
+        }
+        return _boundaries[ _numBuckets-1 ];
+    }
+
     uint32_t Histogram::_findBucket( uint32_t element ) const {
         // TODO assert not too small a value?
 
@@ -99,6 +99,13 @@ namespace mongo {
          */
         uint32_t getBucketsNum() const;
 
+        /**
+         * Return the upper bound of the bucket holding the 'percent'-th
+         * percentile of the elements inserted so far, or 0 if there are
+         * none.
+         */
+        uint32_t getPercentile( uint32_t percent ) const;
+
     private:
         /**
          * Returns the bucket where 'element' should fall